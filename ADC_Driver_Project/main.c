@@ -4,6 +4,7 @@
 #include "uart.h"
 #include "delay.h"
 #include "adc.h"
+#include "telemetry.h"
 
 #include <string.h>
 #include <stdint.h>
@@ -41,6 +42,7 @@ int main(void) {
     InitUART2();
     
     init_adc();
+    update_vdd_mV();
     
     // init debugging LED
     TRISBbits.TRISB8 = 0; // Set LED as Output
@@ -55,11 +57,20 @@ int main(void) {
     
     const uint8_t ENABLE_DEBUG = 1;
     const uint8_t ENABLE_BAR_CHART = 0;
+    const uint8_t ENABLE_BINARY_TELEMETRY = 0; // ADC_BATCH frames instead of text; see telemetry.h
     
     
 //    if (ENABLE_DEBUG)
     Disp2String("DEBUG: Starting while(1)\n");
     
+    if (ENABLE_BINARY_TELEMETRY) {
+        telemetry_init();
+    }
+    
+    uint16_t batch[TELEMETRY_ADC_BATCH_LEN];
+    uint8_t batch_count = 0;
+    uint32_t batch_timestamp = 0;
+    
     while (1) {
         // Disp2String("DEBUG: Top of while(1)\n");
         
@@ -68,10 +79,24 @@ int main(void) {
 //        LATBbits.LATB8 = 0; // turn LED off
 //        delay32_ms(250);
         
+        vdd_monitor_poll();
         const uint16_t adc_value = read_adc_value();
         
+        if (ENABLE_BINARY_TELEMETRY) {
+            if (batch_count == 0) {
+                batch_timestamp = telemetry_timestamp();
+            }
+            batch[batch_count++] = adc_value;
+            if (batch_count == TELEMETRY_ADC_BATCH_LEN) {
+                telemetry_send_adc_batch(batch_timestamp, vdd_mV, batch, batch_count);
+                batch_count = 0;
+            }
+            continue;
+        }
+        
+        // VDD is reported so the host can convert ratiometrically as well
         char msg[200];
-        sprintf(msg, "ADC Value: %04d  ", adc_value);
+        sprintf(msg, "ADC Value: %04d  VDD_mV: %04u  ", adc_value, vdd_mV);
         
         const uint8_t main_msg_len = strlen(msg);
         
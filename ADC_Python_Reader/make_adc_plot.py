@@ -1,71 +1,71 @@
 import polars as pl
 import serial
-import serial.tools.list_ports # important
-import easygui
 from loguru import logger
-import re
+import argparse
 import time
 import sys
 import hvplot
+from pathlib import Path
 
-# pip install polars pyserial loguru easygui hvplot
+sys.path.insert(0, str(Path(__file__).parent.parent / "Python_Serial_Tools"))
+from serial_ingest import IngestParser, KIND_ADC
+from live_view import run_dashboard
+from serial_sources import open_source, read_available
+from capture_store import CaptureWriter, ingest_metadata, parse_meta_args, scan_capture, SAMPLE_TIME
 
-def prompt_for_serial_port():
-	port_list = serial.tools.list_ports.comports()
-	port_list_str: list[str] = [port.device for port in port_list]
-	logger.info(f"Available ports: {port_list_str}")
+# pip install polars numpy pyserial loguru easygui hvplot
 
-	if not port_list:
-		logger.error("No serial ports found. Exiting...")
-		sys.exit(1)
+NOMINAL_VDD_MV = 3300
 
-	if len(port_list_str) == 1:
-		logger.info(f"Only one port found: {port_list_str[0]}")
-		return port_list_str[0]
-
-	port = easygui.choicebox("Select the serial port", choices=[port.device for port in port_list])
-
-	if not port:
-		logger.error("No port selected. Exiting...")
-		sys.exit(1)
-
-	return port
-
-def read_serial_data(port: str) -> pl.DataFrame:
-	"""Reads data from the serial port and returns a DataFrame with the data.
-	Columns: timestamp, adc_value
+def read_serial_data(ser, writer: CaptureWriter | None = None) -> pl.DataFrame:
+	"""Reads data from the serial port (or a replay) and returns a DataFrame with the data.
+	Columns: timestamp, adc_value, vdd_mV (plus device_ticks and seq, -1 for text)
+	Takes the text lines or the binary telemetry frames (ENABLE_BINARY_TELEMETRY).
+	With a `writer`, samples go to disk as they arrive instead of piling up in RAM.
 	"""
 	logger.info(f"Starting reading data. Press Ctrl+C to stop...")
 
-	with serial.Serial(port, 9600, timeout=1) as ser:
-		data: list[dict] = []
+	parser = IngestParser(keep_samples=(writer is None))
+	with ser:
 		start_sampling_time = time.time()
 		last_print_msg_time = time.time()
 
 		try:
 			while True:
-				line = ser.readline()
-				line = line.decode("utf-8", errors='ignore').strip()
-
-				adc_value_search = re.search(r"ADC Value: (\d+)", line)
-
-				if adc_value_search:
-					adc_value = int(adc_value_search.group(1))
-					data.append({
-						"timestamp": time.time() - start_sampling_time,
-						"adc_value": adc_value,
-					})
+				# whatever has arrived, in one read, instead of a line at a time
+				chunk = read_available(ser, start_sampling_time)
+				if chunk is None:
+					logger.info("Replay finished.")
+					break
+				batch = parser.feed(*chunk)
+				if writer:
+					writer.write(batch)
 
 				if time.time() - last_print_msg_time > 0.5:
-					logger.info(f"Read {len(data)} samples so far ({time.time()-start_sampling_time:.1f} sec)...")
+					logger.info(f"Read {parser.sample_count} samples so far ({time.time()-start_sampling_time:.1f} sec)...")
 					last_print_msg_time = time.time()
 
 		except KeyboardInterrupt:
 			logger.info("Got keyboard interrupt. Exiting...")
 
-	df = pl.DataFrame(data)
+	logger.info(f"Ingest: {parser.summary()}")
+	if writer:
+		writer.close(ingest_metadata(parser))
+		logger.info(f"Saved {writer.rows_written} samples to {writer.path}")
+		samples = scan_capture(writer.path).filter(pl.col('kind') == KIND_ADC).collect()
+	else:
+		samples = parser.samples.to_polars().filter(pl.col('kind') == KIND_ADC)
+	df = samples.select(
+		# device time on the host clock for binary frames, arrival time for text
+		timestamp = SAMPLE_TIME,
+		adc_value = pl.col('value'),
+		# firmware measures VDD against the band gap; fall back to nominal for older firmware
+		vdd_mV = pl.when(pl.col('vdd_mV') >= 0).then(pl.col('vdd_mV')).otherwise(NOMINAL_VDD_MV),
+		device_ticks = pl.col('device_ticks'),
+		seq = pl.col('seq'),
+	)
 	df = df.with_columns(
-		adc_voltage = df['adc_value'] * 3.3 / 1023,
+		adc_voltage = df['adc_value'] * (df['vdd_mV'] / 1000) / 1023,
 	)
 	return df
 
@@ -73,10 +73,30 @@ def main():
 	serial_version = serial.__version__
 	logger.info(f"Using pyserial version: {serial_version}")
 
-	port = prompt_for_serial_port()
-	logger.info(f"Selected port: {port}")
-
-	df = read_serial_data(port)
+	parser = argparse.ArgumentParser(description="Log and plot ADC readings")
+	parser.add_argument("--port", help="serial port (default: prompt)")
+	parser.add_argument("--baud", type=int, default=9600)
+	parser.add_argument("--live", action="store_true", help="plot the most recent samples as they arrive, instead of everything after Ctrl+C")
+	parser.add_argument("--save", type=Path, help="write every sample to this Parquet file as it arrives")
+	parser.add_argument("--meta", action="append", default=[], help="KEY=VALUE stored with --save (clock_khz, ctmu_range, ...)")
+	parser.add_argument("--record", type=Path, help="also write the raw bytes, with arrival times, to this capture (.gz to compress)")
+	parser.add_argument("--replay", type=Path, help="read a --record capture instead of a port")
+	parser.add_argument("--replay-speed", type=float, default=1.0, help="replay pace, 0 for as fast as possible")
+	args = parser.parse_args()
+
+	metadata = {"logger": "make_adc_plot", "baud": args.baud, **parse_meta_args(args.meta)}
+	ser = open_source(args.port, args.baud, args.record, args.replay, args.replay_speed, metadata)
+
+	writer = None
+	if args.save:
+		writer = CaptureWriter(args.save, {**metadata, "port": getattr(ser, "port", None), **getattr(ser, "metadata", {})})
+
+	if args.live:
+		with ser:
+			run_dashboard(ser, KIND_ADC, 'ADC Value vs. Time', 'ADC Value (0-1023)', 'counts', writer=writer)
+		return
+
+	df = read_serial_data(ser, writer)
 
 	logger.info(f"Done reading ADC data: {df}")
 	
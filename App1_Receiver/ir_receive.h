@@ -51,6 +51,17 @@ void ir_set_led_state(uint8_t en);
 
 void ir_tx_32_bit_code(uint32_t code);
 
+// Samples (~200 us each) in main()'s carrier detect log: a message is up to 405,
+// and the log starts at the first carrier, so 1.5x is ample. It's on the stack;
+// 900 left under 128 B of headroom (make -C PIC24_Host_Sim stack-check).
+#define CARRIER_DETECT_LOG_LEN (600)
+
+// Compile-time, not in App2's parameter registry (params.h): the sample period
+// below, the 25 and the elem_count_* windows (ir_receive.c) are all counted in
+// samples, so retuning one means retuning them together.
+#define IR_SAMPLE_DELAY_CYCLES (750) // empirically 201 us per sample, incl. the loop
+#define IR_CARRIER_MIN_SAMPLES (25) // (4500 us start bit) / (200 us per sample) = 22 minimum
+
 void debug_print_carrier_log(const uint8_t carrier_detect_log[], uint32_t carrier_detect_log_len);
 uint32_t parse_carrier_log_to_code(const uint8_t carrier_detect_log[], uint32_t carrier_detect_log_len);
 
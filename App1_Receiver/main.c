@@ -6,6 +6,7 @@
 #include "io.h"
 #include "ir_receive.h"
 #include "delay.h"
+#include "stack_paint.h"
 
 #include <string.h>
 #include <stdint.h>
@@ -29,6 +30,8 @@
 // - RB8 (Pin 17) = debugging LED output
 
 int main(void) {
+    stack_paint(); // before anything else has used the stack
+    
     // Clock output on REFO
     TRISBbits.TRISB15 = 0;  // Set RB15 as output for REFO (DIP PIN 18)
     REFOCONbits.ROEN = 1; // Ref oscillator is enabled
@@ -120,9 +123,9 @@ int main(void) {
         //   - 32 bits * 560us (ON carrier) = 17920us
         //   - 32 bits * 1690us (OFF carrier) = 54080us
         //   = (4500*2) + (32*560) + (32*1690) = 81000us = 81ms = (405 detects * (200us per detect))
-        const uint32_t carrier_detect_log_len = 900; // 900 is about 2*405, so ample
+        const uint32_t carrier_detect_log_len = CARRIER_DETECT_LOG_LEN;
         // TODO: could convert the following bool array to use all 8 bits of each byte
-        uint8_t carrier_detect_log[carrier_detect_log_len]; // earliest at 0; init to all zeros
+        uint8_t carrier_detect_log[CARRIER_DETECT_LOG_LEN]; // earliest at 0; init to all zeros
         memset(carrier_detect_log, 0, carrier_detect_log_len); // init to all zeros
         
         uint32_t carrier_detected_count_in_log = 0;
@@ -130,7 +133,7 @@ int main(void) {
         while (! get_ir_rx_state()) {
             // just delay until it's active, so that the code always starts around the start of the buffer
             LATBbits.LATB8 = !LATBbits.LATB8; // DEBUG: toggle light
-            delay32_cycles(750);
+            delay32_cycles(IR_SAMPLE_DELAY_CYCLES);
         }
         
         for (uint32_t carrier_detect_log_idx = 0; carrier_detect_log_idx < carrier_detect_log_len; carrier_detect_log_idx++) {
@@ -146,7 +149,7 @@ int main(void) {
             
             // delay32_us(200);
              LATBbits.LATB8 = !LATBbits.LATB8; // DEBUG: toggle light
-            delay32_cycles(750);
+            delay32_cycles(IR_SAMPLE_DELAY_CYCLES);
             // emperically, 800 cycles = 215us per sample (on each edge)
             // emperically, 600 cycles = 165us per sample (on each edge)
             // emperically, 700 cycles = 189us per sample
@@ -157,7 +160,7 @@ int main(void) {
         uint32_t received_code = 0;
 
         // 25 is kinda arbitrary, but reasonable: (4500us start bit) / (200us per detect) = 22 detects minimum
-        if (carrier_detected_count_in_log > 25) {
+        if (carrier_detected_count_in_log > IR_CARRIER_MIN_SAMPLES) {
             Disp2String("Carrier was detected in >25 samples...\n");
             debug_print_carrier_log(carrier_detect_log, carrier_detect_log_len);
             Disp2String("Done debug print, parsing code...\n");
@@ -165,7 +168,7 @@ int main(void) {
             // run the parser
             received_code = parse_carrier_log_to_code(carrier_detect_log, carrier_detect_log_len);
 
-            char msg[20];
+            char msg[50]; // also holds the stack report below
             sprintf(msg, "Received code: 0x%04X%04X", (uint16_t)(received_code>>16), (uint16_t)(received_code&0xFFFF));
             Disp2String(msg);
 
@@ -183,6 +186,12 @@ int main(void) {
                 Disp2String(" (OTHER)");
             }
             Disp2String("\n\n");
+            
+            if (ENABLE_DEBUG) {
+                sprintf(msg, "DEBUG: stack high-water=%uB, headroom=%uB\n",
+                        stack_high_water_bytes(), stack_headroom_bytes());
+                Disp2String(msg);
+            }
         }
         else {
             // TODO: maybe disable this printing, even during debug
@@ -1,71 +1,71 @@
 import polars as pl
 import serial
-import serial.tools.list_ports # important
-import easygui
 from loguru import logger
-import re
+import argparse
 import time
 import sys
 import hvplot
+from pathlib import Path
 
-# pip install polars pyserial loguru easygui hvplot
+sys.path.insert(0, str(Path(__file__).parent.parent / "Python_Serial_Tools"))
+from serial_ingest import IngestParser, KIND_CAP_PF
+from live_view import run_dashboard
+from serial_sources import open_source, read_available
+from capture_store import CaptureWriter, ingest_metadata, parse_meta_args, scan_capture, SAMPLE_TIME
 
-def prompt_for_serial_port():
-	port_list = serial.tools.list_ports.comports()
-	port_list_str: list[str] = [port.device for port in port_list]
-	logger.info(f"Available ports: {port_list_str}")
+# pip install polars numpy pyserial loguru easygui hvplot
 
-	if not port_list:
-		logger.error("No serial ports found. Exiting...")
-		sys.exit(1)
-
-	if len(port_list_str) == 1:
-		logger.info(f"Only one port found: {port_list_str[0]}")
-		return port_list_str[0]
-
-	port = easygui.choicebox("Select the serial port", choices=[port.device for port in port_list])
-
-	if not port:
-		logger.error("No port selected. Exiting...")
-		sys.exit(1)
-
-	return port
-
-def read_serial_data(port: str) -> pl.DataFrame:
-	"""Reads data from the serial port and returns a DataFrame with the data.
-	Columns: timestamp, cap_value
+def read_serial_data(ser, writer: CaptureWriter | None = None) -> pl.DataFrame:
+	"""Reads data from the serial port (or a replay) and returns a DataFrame with the data.
+	Columns: timestamp, cap_value (plus device_ticks and seq, -1 for text)
+	Takes the text lines or the binary telemetry frames (ENABLE_BINARY_TELEMETRY).
+	With a `writer`, samples go to disk as they arrive instead of piling up in RAM.
 	"""
 	logger.info(f"Starting reading data. Press Ctrl+C to stop...")
 
-	with serial.Serial(port, 9600, timeout=1) as ser:
-		data: list[dict] = []
+	parser = IngestParser(keep_samples=(writer is None))
+	with ser:
 		start_sampling_time = time.time()
 		last_print_msg_time = time.time()
+		last_logged_count = 0
+		cap_value = 0
 
 		try:
 			while True:
-				line = ser.readline()
-				line = line.decode("utf-8", errors='ignore').strip()
-
-				cap_value_search = re.search(r"REPORT_CAP_pF=(\d+)", line)
-
-				if cap_value_search:
-					cap_value = int(cap_value_search.group(1))
-					data.append({
-						"timestamp": time.time() - start_sampling_time,
-						"cap_value": cap_value,
-					})
-
-					if time.time() - last_print_msg_time > 0.5:
-						logger.info(f"Read {len(data)} samples so far. Last value: {cap_value:>8} pF (at {time.time()-start_sampling_time:.1f} sec)...")
-						last_print_msg_time = time.time()
-				else:
-					logger.debug(f"Received: {line}")
+				# whatever has arrived, in one read, instead of a line at a time
+				chunk = read_available(ser, start_sampling_time)
+				if chunk is None:
+					logger.info("Replay finished.")
+					break
+				batch = parser.feed(*chunk)
+				if writer:
+					writer.write(batch)
+				if len(batch['value']):
+					cap_value = batch['value'][-1]
+
+				sample_count = parser.sample_count
+				if (sample_count > last_logged_count) and (time.time() - last_print_msg_time > 0.5):
+					logger.info(f"Read {sample_count} samples so far. Last value: {cap_value:>8} pF (at {time.time()-start_sampling_time:.1f} sec)...")
+					last_print_msg_time = time.time()
+					last_logged_count = sample_count
 
 		except KeyboardInterrupt:
 			logger.info("Got keyboard interrupt. Exiting...")
 
-	df = pl.DataFrame(data)
+	logger.info(f"Ingest: {parser.summary()}")
+	if writer:
+		writer.close(ingest_metadata(parser))
+		logger.info(f"Saved {writer.rows_written} samples to {writer.path}")
+		samples = scan_capture(writer.path).filter(pl.col('kind') == KIND_CAP_PF).collect()
+	else:
+		samples = parser.samples.to_polars().filter(pl.col('kind') == KIND_CAP_PF)
+	df = samples.select(
+		# device time on the host clock for binary frames, arrival time for text
+		timestamp = SAMPLE_TIME,
+		cap_value = pl.col('value'),
+		device_ticks = pl.col('device_ticks'),
+		seq = pl.col('seq'),
+	)
 	df = df.with_columns(
 		pl.col('cap_value').replace({
 			(0xFFFFFFFF - 6): 0, # replace the over-range indicator with 0 to avoid skewing the axis limits
@@ -80,10 +80,30 @@ def main():
 	serial_version = serial.__version__
 	logger.info(f"Using pyserial version: {serial_version}")
 
-	port = prompt_for_serial_port()
-	logger.info(f"Selected port: {port}")
-
-	df = read_serial_data(port)
+	parser = argparse.ArgumentParser(description="Log and plot capacitance readings")
+	parser.add_argument("--port", help="serial port (default: prompt)")
+	parser.add_argument("--baud", type=int, default=9600)
+	parser.add_argument("--live", action="store_true", help="plot the most recent samples as they arrive, instead of everything after Ctrl+C")
+	parser.add_argument("--save", type=Path, help="write every sample to this Parquet file as it arrives")
+	parser.add_argument("--meta", action="append", default=[], help="KEY=VALUE stored with --save (clock_khz, ctmu_range, ...)")
+	parser.add_argument("--record", type=Path, help="also write the raw bytes, with arrival times, to this capture (.gz to compress)")
+	parser.add_argument("--replay", type=Path, help="read a --record capture instead of a port")
+	parser.add_argument("--replay-speed", type=float, default=1.0, help="replay pace, 0 for as fast as possible")
+	args = parser.parse_args()
+
+	metadata = {"logger": "make_capacitance_plot", "baud": args.baud, **parse_meta_args(args.meta)}
+	ser = open_source(args.port, args.baud, args.record, args.replay, args.replay_speed, metadata)
+
+	writer = None
+	if args.save:
+		writer = CaptureWriter(args.save, {**metadata, "port": getattr(ser, "port", None), **getattr(ser, "metadata", {})})
+
+	if args.live:
+		with ser:
+			run_dashboard(ser, KIND_CAP_PF, 'Capacitance (pF) vs. Time', 'Capacitance Value (pF)', 'pF', writer=writer)
+		return
+
+	df = read_serial_data(ser, writer)
 
 	logger.info(f"Done reading cap data: {df}")
 	
@@ -9,6 +9,8 @@
 #include "adc.h"
 #include "delay.h"
 
+#define ADC_OFFSET_SAMPLE_COUNT (16)
+
 void init_adc(void) {
     TRISBbits.TRISB13 = 1; // AN11/RB13 as INPUT
     
@@ -55,33 +57,17 @@ void init_adc(void) {
     AD1CSSLbits.CSSL11 = 0; // analog channel omitted from input scan
 }
 
-uint16_t read_adc_value(void) {
-    // Returns a 10-bit unsigned number
-    
-    // Enable ADC module
-    AD1CON1bits.ADON = 1;
-    
-    AD1CON1bits.SAMP = 1; // Start sampling
-    while (!AD1CON1bits.DONE); // Wait for conversion to complete // not needed for CTMU mode (SSRC=0b000), maybe
-    
-    const uint16_t adc_value = ADC1BUF0;
-    
-    AD1CON1bits.SAMP = 0; // End sampling
-    AD1CON1bits.ADON = 0; // Turn off ADC - saves power
-    
-    return adc_value;
-}
-
-float adc_val_to_volts(uint16_t val_10_bits) {
-    return ((float) val_10_bits) * 3.3 / 1023.0;
-}
-
-uint16_t adc_val_to_mV(uint16_t val_10_bits) {
-    // Option 1: slower
-    // return (uint16_t) (adc_val_to_volts(val_10_bits) * 1000);
-
-    // Option 2: should be faster (uses a bit-shift)
-    // first, cast to a wider type to avoid overflow, because I don't trust C
-    const uint32_t val_wider = (uint32_t) val_10_bits;
-    return (uint16_t) ((val_wider * 3300) >> 10);
+void calibrate_adc_offset(void) {
+    // drive AN11/RB13 to GND, so anything read is the ADC's zero-scale error
+    TRISBbits.TRISB13 = 0; // Set pin as output (0)
+    LATBbits.LATB13 = 0; // set pin state to LOW
+    delay32_ms(1);
+    
+    int32_t adc_sum = 0;
+    for (uint8_t i = 0; i < ADC_OFFSET_SAMPLE_COUNT; i++) {
+        adc_sum += read_adc_value();
+    }
+    adc_offset = (int16_t) (adc_sum / ADC_OFFSET_SAMPLE_COUNT);
+    
+    TRISBbits.TRISB13 = 1; // AN11/RB13 back to INPUT
 }
@@ -32,12 +32,10 @@
 #define	__INCLUDE_GUARD__ADC_H__
 
 #include <xc.h> // include processor files - each processor file is guarded.  
+#include "adc_vdd.h" // read_adc_value(), vdd_mV, ...
 
 void init_adc(void);
-uint16_t read_adc_value(void);
-
-float adc_val_to_volts(uint16_t val_10_bits);
-uint16_t adc_val_to_mV(uint16_t val_10_bits);
+void calibrate_adc_offset(void);
 
 #endif	/* __INCLUDE_GUARD__ADC_H__ */
 
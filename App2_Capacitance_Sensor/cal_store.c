@@ -0,0 +1,37 @@
+/*
+ * File:   cal_store.c
+ */
+
+
+#include "xc.h"
+#include "cal_store.h"
+#include "record_store.h"
+#include "adc.h"
+
+#include <string.h>
+
+static record_store_t cal_store = RECORD_STORE_INIT(CAL_STORE_FIRST_WORD, CAL_STORE_SLOT_WORDS,
+        CAL_STORE_SLOT_COUNT, CAL_RECORD_MAGIC | CAL_RECORD_VERSION, cal_record_t);
+
+uint8_t cal_store_load(void) {
+    // Applies the newest valid record; returns 0 (defaults kept) if none.
+    cal_record_t record;
+    if (!record_store_load(&cal_store, &record)) {
+        return 0;
+    }
+    
+    ctmu_cal = record.ctmu;
+    adc_offset = record.adc_offset;
+    vdd_mV = record.vdd_mV;
+    return 1;
+}
+
+void cal_store_save(void) {
+    cal_record_t record;
+    memset(&record, 0, sizeof(record)); // padding included, for the CRC
+    
+    record.ctmu = ctmu_cal;
+    record.adc_offset = adc_offset;
+    record.vdd_mV = vdd_mV;
+    record_store_save(&cal_store, &record);
+}
@@ -28,24 +28,35 @@
 
 // This is a guard condition so that contents of this file are not included
 // more than once.  
-#ifndef __INCLUDE_GUARD_CLOCK_H__
-#define	__INCLUDE_GUARD_CLOCK_H__
+#ifndef __INCLUDE_GUARD__CAL_STORE_H__
+#define	__INCLUDE_GUARD__CAL_STORE_H__
 
 #include <xc.h> // include processor files - each processor file is guarded.  
 #include <stdint.h>
 
+#include "z_sense.h"
+#include "record_store.h"
 
-#ifdef	__cplusplus
-extern "C" {
-#endif /* __cplusplus */
+// Calibration record, kept in data EEPROM so calibration runs once per board.
+// Bump CAL_RECORD_VERSION whenever the layout changes; old records are ignored.
+#define CAL_RECORD_MAGIC (0xCA00)
+#define CAL_RECORD_VERSION (2) // 2: current_pA in pA, not 1/1000 of it
 
-    // TODO If C++ is being used, regular C code needs function names to have C 
-    // linkage so the functions can be used by the c code. 
+// Wear-levelled in CAL_STORE_SLOT_COUNT slots (record_store.h)
+#define CAL_STORE_FIRST_WORD (0)
+#define CAL_STORE_SLOT_WORDS (16)
+#define CAL_STORE_SLOT_COUNT (8)
 
-#ifdef	__cplusplus
-}
-#endif /* __cplusplus */
+typedef struct {
+    record_header_t header; // CAL_RECORD_MAGIC | CAL_RECORD_VERSION, sequence
+    ctmu_cal_t ctmu; // current_pA and itrim per range, stray_pF
+    int16_t adc_offset;
+    uint16_t vdd_mV;
+    uint16_t crc; // CRC-16/CCITT (crc16.h) of everything above; must stay last
+} cal_record_t;
 
-void set_clock_freq(uint16_t clk_freq_khz);
+uint8_t cal_store_load(void);
+void cal_store_save(void);
+
+#endif	/* __INCLUDE_GUARD__CAL_STORE_H__ */
 
-#endif	/* __INCLUDE_GUARD_CLOCK_H__ */
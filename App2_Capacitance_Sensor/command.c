@@ -0,0 +1,192 @@
+/*
+ * File:   command.c
+ */
+
+
+#include "xc.h"
+#include "command.h"
+#include "uart_queue.h"
+#include "params.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Read-only status, next to the parameters in get/list
+typedef struct {
+    const char* name;
+    volatile uint16_t* value;
+} command_status_t;
+
+static const command_status_t command_status[] = {
+    {"rx_overrun", &uart_rx_overrun_count},
+    {"rx_framing", &uart_rx_framing_error_count},
+    {"rx_dropped", &uart_rx_dropped_count},
+};
+#define COMMAND_STATUS_LEN (sizeof(command_status) / sizeof(command_status[0]))
+#define COMMAND_LIST_LEN (PARAM_COUNT + COMMAND_STATUS_LEN)
+
+// strcpy() of a fixed reply, which fails to compile if it doesn't fit in
+// COMMAND_REPLY_MAX_LEN (the array size goes negative)
+#define COMMAND_REPLY_TEXT(reply, text) \
+    ((void) sizeof(char[(sizeof(text) <= COMMAND_REPLY_MAX_LEN) ? 1 : -1]), strcpy((reply), (text)))
+
+// A line stays in the UART RX ring until its end arrives (the ring is the
+// line buffer); these are kept between calls while it does.
+static uint8_t command_scanned = 0; // bytes at the front of the ring known not to end a line
+static uint8_t command_overlong = 0; // the ring filled up without an end of line; skipping to the next
+static uint8_t command_list_next = COMMAND_LIST_LEN; // "list" answers one entry per call
+
+static uint8_t command_find_status(const char* name) {
+    // returns COMMAND_STATUS_LEN if there is no such entry
+    uint8_t i = 0;
+    while ((i < COMMAND_STATUS_LEN) && (strcmp(command_status[i].name, name) != 0)) {
+        i++;
+    }
+    return i;
+}
+
+static void command_list_entry(uint8_t entry, char* reply) {
+    if (entry < PARAM_COUNT) {
+        const param_info_t* info = &param_info[entry];
+        snprintf(reply, COMMAND_REPLY_MAX_LEN, "CMD: %s=%ld (%ld..%ld)%s\n", info->name, (long) params_get(entry),
+                (long) info->min, (long) info->max, (info->flags & PARAM_PERSIST) ? "" : " not saved");
+    }
+    else {
+        const command_status_t* status = &command_status[entry - PARAM_COUNT];
+        snprintf(reply, COMMAND_REPLY_MAX_LEN, "CMD: %s=%u read-only\n", status->name, *status->value);
+    }
+}
+
+// Runs one complete line, in place (it gets split up)
+static uint8_t command_run(char* line, char* reply) {
+    const char* verb = strtok(line, " ");
+    const char* name = strtok(NULL, " ");
+    const char* arg = strtok(NULL, " ");
+    if (verb == NULL) {
+        return 0; // blank line
+    }
+    if ((name == NULL) && (arg == NULL)) {
+        if (strcmp(verb, "list") == 0) {
+            command_list_next = 1;
+            command_list_entry(0, reply);
+            return 1;
+        }
+        if (strcmp(verb, "save") == 0) {
+            params_save();
+            COMMAND_REPLY_TEXT(reply, "CMD: saved\n");
+            return 1;
+        }
+        if (strcmp(verb, "defaults") == 0) {
+            params_reset(); // "save" to keep them
+            COMMAND_REPLY_TEXT(reply, "CMD: defaults loaded\n");
+            return 1;
+        }
+    }
+    const uint8_t is_set = (strcmp(verb, "set") == 0);
+    if (!is_set && (strcmp(verb, "get") != 0)) {
+        COMMAND_REPLY_TEXT(reply, "CMD: ERR unknown command\n");
+        return 1;
+    }
+    if ((name == NULL) || ((arg != NULL) != is_set)) {
+        COMMAND_REPLY_TEXT(reply, "CMD: ERR usage: get|set <name> [value]\n");
+        return 1;
+    }
+    const uint8_t id = params_find(name);
+    if (id == PARAM_COUNT) {
+        const uint8_t status = command_find_status(name);
+        if (status == COMMAND_STATUS_LEN) {
+            COMMAND_REPLY_TEXT(reply, "CMD: ERR unknown name\n");
+        }
+        else if (is_set) {
+            COMMAND_REPLY_TEXT(reply, "CMD: ERR read-only\n");
+        }
+        else {
+            snprintf(reply, COMMAND_REPLY_MAX_LEN, "CMD: %s=%u\n", name, *command_status[status].value);
+        }
+        return 1;
+    }
+    
+    if (is_set) {
+        char* end;
+        const long value = strtol(arg, &end, 10);
+        if ((*end != '\0') || !params_in_range(id, value)) {
+            snprintf(reply, COMMAND_REPLY_MAX_LEN, "CMD: ERR %s is %ld..%ld\n", name, (long) param_info[id].min,
+                    (long) param_info[id].max);
+            return 1;
+        }
+        if (!params_set(id, value)) {
+            COMMAND_REPLY_TEXT(reply, "CMD: ERR touch_release >= touch_press\n");
+            return 1;
+        }
+    }
+    snprintf(reply, COMMAND_REPLY_MAX_LEN, "CMD: %s=%ld\n", name, (long) params_get(id));
+    return 1;
+}
+
+///// Runs the first complete line received, if there is one. Returns 0 until
+///// there is; then 1, with the answer to send in `reply`
+///// (COMMAND_REPLY_MAX_LEN bytes). Call it until it returns 0 to catch up
+///// after a burst.
+uint8_t command_poll(char* reply) {
+    if (command_list_next < COMMAND_LIST_LEN) {
+        command_list_entry(command_list_next++, reply);
+        return 1;
+    }
+    
+    for (;;) {
+        // find the end of the first line
+        const uint8_t count = uart_rx_count();
+        uint8_t len = command_scanned;
+        while ((len < count) && (uart_rx_peek(len) != '\n') && (uart_rx_peek(len) != '\r')) {
+            len++;
+        }
+        if (len == count) {
+            if (count < UART_RX_BUF_LEN - 1) {
+                command_scanned = len;
+                return 0; // the rest is still on its way
+            }
+            len = count; // the ring is full of one line: drop it all, and the rest of it when it comes
+            command_overlong = 1;
+        }
+        
+        // take it out of the ring, with its end of line
+        char line[COMMAND_LINE_MAX_LEN + 1];
+        uint8_t line_len = 0;
+        uint8_t too_long = command_overlong;
+        uint8_t lost = 0;
+        for (uint8_t i = 0; i < len; i++) {
+            uint8_t c;
+            uart_rx_getc(&c);
+            if (c == UART_RX_LOST) {
+                lost = 1;
+            }
+            else if (line_len < COMMAND_LINE_MAX_LEN) {
+                line[line_len++] = (char) c;
+            }
+            else {
+                too_long = 1;
+            }
+        }
+        command_scanned = 0;
+        if (len == count) {
+            continue; // no end of line yet
+        }
+        uint8_t end;
+        uart_rx_getc(&end);
+        line[line_len] = '\0';
+        command_overlong = 0;
+        
+        if (lost) {
+            COMMAND_REPLY_TEXT(reply, "CMD: ERR receive error, line ignored\n");
+            return 1;
+        }
+        if (too_long) {
+            COMMAND_REPLY_TEXT(reply, "CMD: ERR line too long\n");
+            return 1;
+        }
+        if (command_run(line, reply)) {
+            return 1;
+        }
+    }
+}
@@ -0,0 +1,55 @@
+/* Microchip Technology Inc. and its subsidiaries.  You may use this software 
+ * and any derivatives exclusively with Microchip products. 
+ * 
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS".  NO WARRANTIES, WHETHER 
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED 
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A 
+ * PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION 
+ * WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION. 
+ *
+ * IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, 
+ * INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND 
+ * WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS 
+ * BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE 
+ * FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS 
+ * IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF 
+ * ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE 
+ * TERMS. 
+ */
+
+/* 
+ * File:   
+ * Author: 
+ * Comments:
+ * Revision history: 
+ */
+
+// more than once.  
+#ifndef __INCLUDE_GUARD__COMMAND_H__
+#define	__INCLUDE_GUARD__COMMAND_H__
+
+#include <xc.h> // include processor files - each processor file is guarded.  
+#include <stdint.h>
+
+// Line commands from the host over UART2 RX, for tuning without reflashing:
+//   get <name>            -> "CMD: <name>=<value>"
+//   set <name> <value>    -> "CMD: <name>=<value>" (the value now in effect)
+//   list                  -> "CMD: <name>=<value> (<min>..<max>)", one line per
+//                            parameter (params.h), then the read-only status
+//   save                  -> "CMD: saved" (the parameters, to data EEPROM)
+//   defaults              -> "CMD: defaults loaded" (not saved until "save")
+//   anything else         -> "CMD: ERR <why>"
+// Lines end with \n or \r (empty lines are ignored). A line that lost bytes on
+// the way in (overrun, framing error, ring full) is answered with an ERR and
+// not run, so a half-received "set" never changes anything.
+#define COMMAND_LINE_MAX_LEN (24) // "set charge_us 16000" with room to spare
+// Longest reply, "CMD: ERR usage: get|set <name> [value]\n" + NUL. The fixed
+// ones are checked against it when command.c compiles, the formatted ones are
+// cut short (snprintf) rather than overrun it.
+#define COMMAND_REPLY_MAX_LEN (40)
+
+uint8_t command_poll(char* reply);
+
+#endif	/* __INCLUDE_GUARD__COMMAND_H__ */
@@ -0,0 +1,44 @@
+/*
+ * File:   eeprom.c
+ */
+
+
+#include "xc.h"
+#include "eeprom.h"
+
+// NVMCON operations (see the data EEPROM chapter of the datasheet)
+#define NVMCON_ERASE_WORD (0x4058)
+#define NVMCON_WRITE_WORD (0x4004)
+
+// the whole data EEPROM, placed by the linker
+uint16_t __attribute__((space(eedata))) eeprom_data[EEPROM_WORD_COUNT];
+
+uint16_t eeprom_read_word(uint16_t word_idx) {
+    TBLPAG = __builtin_tblpage(eeprom_data);
+    const uint16_t offset = __builtin_tbloffset(eeprom_data) + (word_idx << 1);
+    return __builtin_tblrdl(offset);
+}
+
+void nvm_unlock_and_wait(void) {
+    __builtin_disi(5); // the unlock sequence must not be interrupted
+    __builtin_write_NVM();
+    while (NVMCONbits.WR == 1); // ~4 ms per erase/write
+}
+
+void eeprom_write_word(uint16_t word_idx, uint16_t value) {
+    if (eeprom_read_word(word_idx) == value) {
+        return; // already there; save the endurance and ~8 ms
+    }
+    
+    TBLPAG = __builtin_tblpage(eeprom_data);
+    const uint16_t offset = __builtin_tbloffset(eeprom_data) + (word_idx << 1);
+    
+    // a word must be erased (to 0xFFFF) before it can be written
+    NVMCON = NVMCON_ERASE_WORD;
+    __builtin_tblwtl(offset, 0xFFFF); // dummy write, selects the word
+    nvm_unlock_and_wait();
+    
+    NVMCON = NVMCON_WRITE_WORD;
+    __builtin_tblwtl(offset, value);
+    nvm_unlock_and_wait();
+}
@@ -28,18 +28,17 @@
 
 // This is a guard condition so that contents of this file are not included
 // more than once.  
-#ifndef __INCLUDE_GUARD_TIMER_H__
-#define	__INCLUDE_GUARD_TIMER_H__
+#ifndef __INCLUDE_GUARD__EEPROM_H__
+#define	__INCLUDE_GUARD__EEPROM_H__
 
 #include <xc.h> // include processor files - each processor file is guarded.  
+#include <stdint.h>
 
-extern uint16_t active_clk_freq_khz;
-extern uint16_t active_clk_freq_MHz;
+// PIC24F16KA102 data EEPROM: 512 bytes = 256 words (0x7FFE00 to 0x7FFFFF)
+#define EEPROM_WORD_COUNT (256)
 
-void delay_us(uint16_t delay_time_us);
-//void delay_ms(uint16_t delay_time_ms); // disable
-void delay_sec(uint16_t delay_time_sec);
+uint16_t eeprom_read_word(uint16_t word_idx);
+void eeprom_write_word(uint16_t word_idx, uint16_t value);
 
-
-#endif	/* __INCLUDE_GUARD_TIMER_H__ */
+#endif	/* __INCLUDE_GUARD__EEPROM_H__ */
 
@@ -1,10 +1,17 @@
 
 #include "xc.h"
 #include "clock.h"
-#include "uart.h"
+#include "uart_queue.h"
 #include "delay.h"
 #include "z_sense.h"
 #include "adc.h"
+#include "cal_store.h"
+#include "touch.h"
+#include "stream.h"
+#include "stack_paint.h"
+#include "telemetry.h"
+#include "command.h"
+#include "params.h"
 
 #include <string.h>
 #include <stdint.h>
@@ -23,7 +30,24 @@
 // - PIN_RB2_CN6 (Pin 6) = IR Receiver
 // - RB8 (Pin 17) = debugging LED output
 
+// Starts streaming with the current parameters. If charge_us doesn't fit in
+// period_us, says so (the UART is still free) and stays stopped until the
+// next command.
+void start_streaming(uint8_t binary) {
+    if (stream_start(PARAM_U16(PARAM_CHARGE_US), PARAM_I16(PARAM_CTMU_RANGE), PARAM_U16(PARAM_STREAM_PERIOD_US), binary)) {
+        return;
+    }
+    if (binary) {
+        telemetry_send_text("ERROR: charge_us + 100 must fit in period_us, not streaming\n");
+    }
+    else {
+        Disp2String("ERROR: charge_us + 100 must fit in period_us, not streaming\n");
+    }
+}
+
 int main(void) {
+    stack_paint(); // before anything else has used the stack
+    
     // Clock output on REFO
     TRISBbits.TRISB15 = 0;  // Set RB15 as output for REFO (DIP PIN 18)
     REFOCONbits.ROEN = 1; // Ref oscillator is enabled
@@ -59,30 +83,140 @@ int main(void) {
     
     delay32_ms(1000);
     
+    const uint8_t ENABLE_SINGLE_SHOT = 0;
+    const uint8_t ENABLE_TOUCH_SCAN = 0; // needs REFO (RB15) off, see touch.c
+    const uint8_t ENABLE_STREAMING = 0; // interrupt-driven, ~1000 samples/s
+    const uint8_t ENABLE_STACK_REPORT = 0; // stack high-water after each report
+    const uint8_t ENABLE_BINARY_TELEMETRY = 0; // COBS/CRC frames instead of text; see telemetry.h
+    const uint8_t ENABLE_COMMANDS = 0; // get/set parameters from the host; see command.h
+    
+    // calibration runs once per board; the result is kept in data EEPROM
+    if (!cal_store_load()) {
+        Disp2String("DEBUG: no stored calibration, using defaults\n");
+        
+        // one-time calibration, then save it
+        // calibrate_adc_offset();
+        // ctmu_calibrate_stray_pF(); // nothing connected to AN11
+        // ctmu_calibrate_current_from_cap(100000); // 100 nF reference on AN11 (10 nF or more)
+        // ctmu_calibrate_current_from_resistor(0, 100000L); // or: 100k to GND, per range
+        // cal_store_save();
+        // ctmu_cal_report();
+    }
+    // tunables saved with "save" over UART (see params.h)
+    if (!params_load()) {
+        Disp2String("DEBUG: no stored parameters, using defaults\n");
+    }
+    update_vdd_mV(); // measure VDD before the first reading; the stored VDD is only a fallback
+    
+    if (ENABLE_TOUCH_SCAN) {
+        touch_init(); // hands off the keys while the baselines are taken
+    }
+    
     Disp2String("\n\nDEBUG: Starting while(1)\n");
     
+    if (ENABLE_BINARY_TELEMETRY) {
+        // from here on, text goes out as TEXT frames
+        telemetry_init();
+    }
+    
+    if (ENABLE_COMMANDS) {
+        uart_rx_start(); // keeps the UART on from here on
+    }
+    
+    if (ENABLE_STREAMING) {
+        // from here on, only the TX queue may use the UART (no Disp2String)
+        start_streaming(ENABLE_BINARY_TELEMETRY);
+    }
     
     while (1) {
-        Disp2String("\n");
+        if (ENABLE_COMMANDS) {
+            char reply[COMMAND_REPLY_MAX_LEN];
+            while (command_poll(reply)) {
+                if (ENABLE_STREAMING) {
+                    // pause for a blocking reply, then go on with the new settings
+                    stream_stop();
+                    uart_tx_flush();
+                }
+                if (ENABLE_BINARY_TELEMETRY) {
+                    telemetry_send_text(reply);
+                }
+                else {
+                    Disp2String(reply);
+                }
+                if (ENABLE_STREAMING) {
+                    start_streaming(ENABLE_BINARY_TELEMETRY);
+                }
+            }
+        }
+        
+        if (ENABLE_STREAMING) {
+            stream_poll();
+            continue;
+        }
+        
+        if (ENABLE_TOUCH_SCAN) {
+            touch_scan();
+            
+            touch_event_t event;
+            while (touch_get_event(&event)) {
+                char msg[40];
+                sprintf(msg, "    TOUCH_KEY=%u %s\n", event.channel, event.is_press ? "PRESS" : "RELEASE");
+                if (ENABLE_BINARY_TELEMETRY) {
+                    telemetry_send_text(msg);
+                }
+                else {
+                    Disp2String(msg);
+                }
+            }
+            continue;
+        }
+        
+        if (!ENABLE_BINARY_TELEMETRY) {
+            Disp2String("\n");
+        }
         
         // r_sense_and_log(0, 100000L, 100);
         // r_sense_and_log(0, 91000, 100);
         // r_sense_and_log(1, 10000, 100);
         
-        // c_sense_2_point_delta_pF_v1(); // old demo function
+        // keep the cached VDD fresh as the battery sags
+        vdd_monitor_poll();
 
         // classic "average out the noise" method
-        uint8_t avg_count = 3;
+        const uint8_t avg_count = PARAM_U16(PARAM_AVG_COUNT);
         uint64_t c_pF_sum = 0;
         for (uint8_t i = 0; i < avg_count; i++) {
-            c_pF_sum += (uint64_t) c_sense_2_point_delta_pF();
+            if (ENABLE_SINGLE_SHOT) {
+                // hardware-timed, <1 ms per reading, but a fixed range
+                c_pF_sum += (uint64_t) c_sense_single_shot_pF(PARAM_U16(PARAM_CHARGE_US), PARAM_I16(PARAM_CTMU_RANGE));
+            }
+            else {
+                c_pF_sum += (uint64_t) c_sense_2_point_delta_pF();
+            }
         }
         const uint32_t c_pF = c_pF_sum / avg_count;
 
         // report the capacitance for Python to read
-        char msg[40];
-        sprintf(msg, "    REPORT_CAP_pF=%lu\n", c_pF);
-        Disp2String(msg);
+        if (ENABLE_BINARY_TELEMETRY) {
+            telemetry_send_cap_pF(c_pF);
+        }
+        else {
+            char msg[40];
+            sprintf(msg, "    REPORT_CAP_pF=%lu\n", c_pF);
+            Disp2String(msg);
+        }
+        
+        if (ENABLE_STACK_REPORT) {
+            char stack_msg[50];
+            sprintf(stack_msg, "DEBUG: stack high-water=%uB, headroom=%uB\n",
+                    stack_high_water_bytes(), stack_headroom_bytes());
+            if (ENABLE_BINARY_TELEMETRY) {
+                telemetry_send_text(stack_msg);
+            }
+            else {
+                Disp2String(stack_msg);
+            }
+        }
         
         // LATBbits.LATB8 = 1; // turn LED on
         // delay32_ms(1000);
@@ -0,0 +1,114 @@
+/*
+ * File:   params.c
+ */
+
+
+#include "xc.h"
+#include "params.h"
+#include "record_store.h"
+#include "z_sense.h"
+#include "stream.h"
+#include "touch.h"
+
+#include <string.h>
+
+const param_info_t param_info[PARAM_COUNT] = {
+    [PARAM_CTMU_RANGE] = {"range", PARAM_TYPE_I16, PARAM_PERSIST, -1, 1, 1}, // -1=0.55uA, 0=5.5uA, 1=55uA
+    [PARAM_CHARGE_US] = {"charge_us", PARAM_TYPE_U16, PARAM_PERSIST, 1, SINGLE_SHOT_MAX_CHARGE_TIME_US, SINGLE_SHOT_DEFAULT_CHARGE_TIME_US},
+    [PARAM_STREAM_PERIOD_US] = {"period_us", PARAM_TYPE_U16, PARAM_PERSIST, 100, STREAM_MAX_PERIOD_US, STREAM_DEFAULT_PERIOD_US},
+    [PARAM_AVG_COUNT] = {"avg", PARAM_TYPE_U16, PARAM_PERSIST, 1, 255, 3},
+    [PARAM_TOUCH_PRESS_DELTA] = {"touch_press", PARAM_TYPE_U16, PARAM_PERSIST, 1, 1023, TOUCH_PRESS_DELTA},
+    [PARAM_TOUCH_RELEASE_DELTA] = {"touch_release", PARAM_TYPE_U16, PARAM_PERSIST, 0, 1023, TOUCH_RELEASE_DELTA},
+    [PARAM_TOUCH_DEBOUNCE_SCANS] = {"touch_debounce", PARAM_TYPE_U16, PARAM_PERSIST, 1, 255, TOUCH_DEBOUNCE_SCANS},
+    [PARAM_DEBUG] = {"debug", PARAM_TYPE_BOOL, 0, 0, 1, 0}, // back off after a reset
+};
+
+uint16_t param_values[PARAM_COUNT];
+
+typedef struct {
+    record_header_t header; // PARAM_RECORD_MAGIC | PARAM_RECORD_VERSION, sequence
+    uint16_t values[PARAM_COUNT]; // all of them; only the PARAM_PERSIST ones are applied
+    uint16_t crc; // CRC-16/CCITT of everything above; must stay last
+} param_record_t;
+
+static record_store_t param_store = RECORD_STORE_INIT(PARAM_STORE_FIRST_WORD, PARAM_STORE_SLOT_WORDS,
+        PARAM_STORE_SLOT_COUNT, PARAM_RECORD_MAGIC | PARAM_RECORD_VERSION, param_record_t);
+
+void params_reset(void) {
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        param_values[id] = (uint16_t) param_info[id].default_value;
+    }
+}
+
+uint8_t params_find(const char* name) {
+    // returns PARAM_COUNT if there is no such parameter
+    uint8_t id = 0;
+    while ((id < PARAM_COUNT) && (strcmp(param_info[id].name, name) != 0)) {
+        id++;
+    }
+    return id;
+}
+
+int32_t params_get(uint8_t id) {
+    return (param_info[id].type == PARAM_TYPE_I16) ? PARAM_I16(id) : PARAM_U16(id);
+}
+
+uint8_t params_in_range(uint8_t id, int32_t value) {
+    return (value >= param_info[id].min) && (value <= param_info[id].max);
+}
+
+// the touch hysteresis only works with release below press
+static uint8_t params_touch_order_ok(uint16_t press_delta, uint16_t release_delta) {
+    return release_delta < press_delta;
+}
+
+uint8_t params_set(uint8_t id, int32_t value) {
+    // returns 0 (and changes nothing) if `value` is out of range, or would
+    // put touch_release at or above touch_press
+    if (!params_in_range(id, value)) {
+        return 0;
+    }
+    if ((id == PARAM_TOUCH_PRESS_DELTA)
+            && !params_touch_order_ok((uint16_t) value, PARAM_U16(PARAM_TOUCH_RELEASE_DELTA))) {
+        return 0;
+    }
+    if ((id == PARAM_TOUCH_RELEASE_DELTA)
+            && !params_touch_order_ok(PARAM_U16(PARAM_TOUCH_PRESS_DELTA), (uint16_t) value)) {
+        return 0;
+    }
+    param_values[id] = (uint16_t) value;
+    return 1;
+}
+
+uint8_t params_load(void) {
+    // Defaults, then the newest valid record's PARAM_PERSIST values on top;
+    // returns 0 if there was no record. A value out of its (possibly since
+    // narrowed) range keeps the default, and so do both touch deltas if the
+    // saved pair is out of order.
+    param_record_t record;
+    params_reset();
+    if (!record_store_load(&param_store, &record)) {
+        return 0;
+    }
+    
+    // not through params_set(): the pair is only in order once both are in
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        const uint16_t raw = record.values[id];
+        if ((param_info[id].flags & PARAM_PERSIST)
+                && params_in_range(id, (param_info[id].type == PARAM_TYPE_I16) ? (int16_t) raw : raw)) {
+            param_values[id] = raw;
+        }
+    }
+    if (!params_touch_order_ok(PARAM_U16(PARAM_TOUCH_PRESS_DELTA), PARAM_U16(PARAM_TOUCH_RELEASE_DELTA))) {
+        param_values[PARAM_TOUCH_PRESS_DELTA] = (uint16_t) param_info[PARAM_TOUCH_PRESS_DELTA].default_value;
+        param_values[PARAM_TOUCH_RELEASE_DELTA] = (uint16_t) param_info[PARAM_TOUCH_RELEASE_DELTA].default_value;
+    }
+    return 1;
+}
+
+void params_save(void) {
+    // ~4-8 ms per changed word, like cal_store_save()
+    param_record_t record;
+    memcpy(record.values, param_values, sizeof(record.values));
+    record_store_save(&param_store, &record);
+}
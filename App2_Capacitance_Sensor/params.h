@@ -0,0 +1,96 @@
+/* Microchip Technology Inc. and its subsidiaries.  You may use this software 
+ * and any derivatives exclusively with Microchip products. 
+ * 
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS".  NO WARRANTIES, WHETHER 
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED 
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A 
+ * PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION 
+ * WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION. 
+ *
+ * IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, 
+ * INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND 
+ * WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS 
+ * BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE 
+ * FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS 
+ * IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF 
+ * ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE 
+ * TERMS. 
+ */
+
+/* 
+ * File:   
+ * Author: 
+ * Comments:
+ * Revision history: 
+ */
+
+// more than once.  
+#ifndef __INCLUDE_GUARD__PARAMS_H__
+#define	__INCLUDE_GUARD__PARAMS_H__
+
+#include <xc.h> // include processor files - each processor file is guarded.  
+#include <stdint.h>
+
+// Runtime parameters: the tunables the drivers used to have as constants,
+// each with a type, range and default, read through PARAM_U16()/PARAM_I16()
+// (an array load) and set over UART (command.h) without reflashing.
+// params_save() keeps the PARAM_PERSIST ones in data EEPROM, the same way as
+// the calibration record (cal_store.h), in the slots after it.
+// App2 only: App1_Receiver's sampler and decode windows are tied to its
+// cycle-counted ~200 us sample period and stay compile-time (ir_receive.h).
+typedef enum {
+    PARAM_CTMU_RANGE, // single-shot/stream CTMU current
+    PARAM_CHARGE_US, // single-shot/stream charge time
+    PARAM_STREAM_PERIOD_US,
+    PARAM_AVG_COUNT, // readings averaged per blocking report
+    PARAM_TOUCH_PRESS_DELTA,
+    PARAM_TOUCH_RELEASE_DELTA,
+    PARAM_TOUCH_DEBOUNCE_SCANS,
+    PARAM_DEBUG, // z_sense deep debug lines
+    PARAM_COUNT
+} param_id_t;
+
+typedef enum {
+    PARAM_TYPE_U16,
+    PARAM_TYPE_I16,
+    PARAM_TYPE_BOOL,
+} param_type_t;
+
+#define PARAM_PERSIST (0x01) // saved by params_save()
+
+typedef struct {
+    const char* name; // as used over UART
+    uint8_t type; // param_type_t
+    uint8_t flags;
+    int32_t min;
+    int32_t max;
+    int32_t default_value;
+} param_info_t;
+
+extern const param_info_t param_info[PARAM_COUNT];
+extern uint16_t param_values[PARAM_COUNT]; // only params_set()/params_load() write these
+
+#define PARAM_U16(id) (param_values[(id)])
+#define PARAM_I16(id) ((int16_t) param_values[(id)])
+
+// Saved record; bump PARAM_RECORD_VERSION whenever param_id_t changes
+#define PARAM_RECORD_MAGIC (0xBA00)
+#define PARAM_RECORD_VERSION (1)
+
+// Wear-levelled like cal_store.h (record_store.h): CAL_STORE_SLOT_COUNT * CAL_STORE_SLOT_WORDS
+// words from word 0 are the calibration's, these follow up to the end
+#define PARAM_STORE_FIRST_WORD (128)
+#define PARAM_STORE_SLOT_WORDS (16) // the record is PARAM_COUNT + 3 words
+#define PARAM_STORE_SLOT_COUNT (8)
+
+void params_reset(void);
+uint8_t params_load(void);
+void params_save(void);
+uint8_t params_find(const char* name);
+uint8_t params_in_range(uint8_t id, int32_t value);
+uint8_t params_set(uint8_t id, int32_t value);
+int32_t params_get(uint8_t id);
+
+#endif	/* __INCLUDE_GUARD__PARAMS_H__ */
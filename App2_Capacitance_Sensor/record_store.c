@@ -0,0 +1,79 @@
+/*
+ * File:   record_store.c
+ */
+
+
+#include "xc.h"
+#include "record_store.h"
+#include "eeprom.h"
+#include "crc16.h"
+
+static uint16_t slot_first_word(const record_store_t* store, uint8_t slot) {
+    return store->first_word + (((uint16_t) slot) * store->slot_words);
+}
+
+static uint16_t record_crc(const record_store_t* store, const void* record) {
+    return crc16_ccitt(CRC16_CCITT_INIT, (const uint8_t*) record, store->crc_offset);
+}
+
+static uint8_t read_record(const record_store_t* store, uint8_t slot, void* record) {
+    // returns 1 if the slot holds a complete record of this version
+    uint16_t* words = (uint16_t*) record;
+    for (uint16_t i = 0; i < store->record_words; i++) {
+        words[i] = eeprom_read_word(slot_first_word(store, slot) + i);
+    }
+    
+    if (((const record_header_t*) record)->magic_version != store->magic_version) {
+        return 0;
+    }
+    return *((const uint16_t*) ((const uint8_t*) record + store->crc_offset)) == record_crc(store, record);
+}
+
+uint8_t record_store_load(record_store_t* store, void* record) {
+    // Reads the newest valid record into `record`; returns 0 (and leaves
+    // `record` undefined) if no slot holds one.
+    store->newest_slot = -1;
+    
+    for (uint8_t slot = 0; slot < store->slot_count; slot++) {
+        if (!read_record(store, slot, record)) {
+            continue;
+        }
+        // sequence numbers wrap, so compare by signed difference
+        const uint16_t sequence = ((const record_header_t*) record)->sequence;
+        if ((store->newest_slot < 0) || (((int16_t) (sequence - store->newest_sequence)) > 0)) {
+            store->newest_slot = (int8_t) slot;
+            store->newest_sequence = sequence;
+        }
+    }
+    
+    if (store->newest_slot < 0) {
+        return 0;
+    }
+    // read it again rather than keeping a second record on the stack
+    return read_record(store, (uint8_t) store->newest_slot, record);
+}
+
+void record_store_save(record_store_t* store, void* record) {
+    // Fills in the header and crc of `record` and writes it to the slot after
+    // the newest one; ~4-8 ms per changed word.
+    record_header_t* header = (record_header_t*) record;
+    header->magic_version = store->magic_version;
+    header->sequence = (store->newest_slot < 0) ? 0 : (store->newest_sequence + 1);
+    *((uint16_t*) ((uint8_t*) record + store->crc_offset)) = record_crc(store, record);
+    
+    // never overwrite the newest valid record; rotate through the slots
+    const uint8_t slot = (store->newest_slot < 0) ? 0 : ((store->newest_slot + 1) % store->slot_count);
+    const uint16_t first_word = slot_first_word(store, slot);
+    const uint16_t* words = (const uint16_t*) record;
+    
+    // invalidate the header first, write the body, then the header last, so
+    // the slot only looks like a record once it is complete
+    eeprom_write_word(first_word, 0xFFFF);
+    for (uint16_t i = 1; i < store->record_words; i++) {
+        eeprom_write_word(first_word + i, words[i]);
+    }
+    eeprom_write_word(first_word, words[0]);
+    
+    store->newest_slot = (int8_t) slot;
+    store->newest_sequence = header->sequence;
+}
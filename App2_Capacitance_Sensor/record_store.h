@@ -0,0 +1,68 @@
+/* Microchip Technology Inc. and its subsidiaries.  You may use this software 
+ * and any derivatives exclusively with Microchip products. 
+ * 
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS".  NO WARRANTIES, WHETHER 
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED 
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A 
+ * PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION 
+ * WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION. 
+ *
+ * IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, 
+ * INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND 
+ * WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS 
+ * BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE 
+ * FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS 
+ * IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF 
+ * ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE 
+ * TERMS. 
+ */
+
+/* 
+ * File:   
+ * Author: 
+ * Comments:
+ * Revision history: 
+ */
+
+// This is a guard condition so that contents of this file are not included
+// more than once.  
+#ifndef __INCLUDE_GUARD__RECORD_STORE_H__
+#define	__INCLUDE_GUARD__RECORD_STORE_H__
+
+#include <xc.h> // include processor files - each processor file is guarded.  
+#include <stdint.h>
+#include <stddef.h>
+
+// Wear-levelled record in data EEPROM, shared by cal_store.h and params.h.
+// Each save goes to the next of slot_count slots of slot_words words, and the
+// valid record with the newest sequence number wins at load. A record starts
+// with a record_header_t and ends with a uint16_t crc (CRC-16/CCITT of
+// everything before it); the header is written last, so a save cut short by
+// power loss leaves the previous slot as the newest valid one.
+typedef struct {
+    uint16_t magic_version; // the store's magic_version
+    uint16_t sequence; // increments each save (wraps)
+} record_header_t;
+
+typedef struct {
+    uint16_t first_word;
+    uint16_t slot_words; // at least record_words
+    uint8_t slot_count;
+    uint16_t magic_version; // bump the version whenever the layout changes; old records are ignored
+    uint16_t record_words;
+    uint16_t crc_offset; // bytes the CRC covers, where the crc field sits
+    int8_t newest_slot; // slot of the record loaded or saved last (-1: none)
+    uint16_t newest_sequence; // and its sequence number
+} record_store_t;
+
+// record_store_t initializer for a record type `type` with a `crc` field
+#define RECORD_STORE_INIT(first_word, slot_words, slot_count, magic_version, type) \
+    { (first_word), (slot_words), (slot_count), (magic_version), \
+      ((sizeof(type) + 1) / 2), offsetof(type, crc), -1, 0 }
+
+uint8_t record_store_load(record_store_t* store, void* record);
+void record_store_save(record_store_t* store, void* record);
+
+#endif	/* __INCLUDE_GUARD__RECORD_STORE_H__ */
@@ -0,0 +1,152 @@
+/*
+ * File:   stream.c
+ */
+
+
+#include "xc.h"
+#include "stream.h"
+#include "z_sense.h"
+#include "adc.h"
+#include "uart_queue.h"
+#include "telemetry.h"
+
+#include <stdio.h>
+
+// raw end-of-charge ADC readings, written by _ADC1Interrupt(), read by main
+volatile uint16_t stream_fifo[STREAM_SAMPLE_FIFO_LEN];
+volatile uint8_t stream_fifo_head = 0; // next to write
+volatile uint8_t stream_fifo_tail = 0; // next to read
+
+volatile uint8_t stream_shot_in_flight = 0;
+volatile uint16_t stream_dropped = 0; // samples lost: FIFO full, or a shot still running
+
+uint16_t stream_charge_time_us = SINGLE_SHOT_DEFAULT_CHARGE_TIME_US;
+int8_t stream_ctmu_exp_val = 1;
+uint8_t stream_binary = 0; // 1 = telemetry CAP_PF frames instead of REPORT_CAP_pF lines
+
+// running average for the next report
+uint32_t stream_adc_sum = 0;
+uint16_t stream_adc_count = 0;
+
+// Non-blocking telemetry_send_cap_pF(). Returns 0 if the TX queue is full;
+// the frame's sequence number is used up anyway, so the host counts it as lost.
+static uint8_t telemetry_enqueue_cap_pF(uint32_t c_pF) {
+    uint8_t frame[TELEMETRY_MAX_FRAME_LEN];
+    return uart_tx_enqueue_bytes(frame, telemetry_encode_cap_pF(c_pF, frame));
+}
+
+uint8_t stream_start(uint16_t charge_time_us, int8_t ctmu_exp_val, uint16_t period_us, uint8_t binary) {
+    // returns 0 (and doesn't start) if a shot can't finish within the period:
+    // Timer2 would find one still in flight every time, and drop every other sample
+    if (period_us > STREAM_MAX_PERIOD_US) {
+        period_us = STREAM_MAX_PERIOD_US;
+    }
+    stream_fifo_head = 0;
+    stream_fifo_tail = 0;
+    stream_shot_in_flight = 0;
+    stream_dropped = 0;
+    stream_adc_sum = 0;
+    stream_adc_count = 0;
+    if (((uint32_t) charge_time_us + STREAM_SHOT_OVERHEAD_US) > period_us) {
+        return 0; // (with nothing left over for stream_poll() to report)
+    }
+    stream_charge_time_us = charge_time_us;
+    stream_ctmu_exp_val = ctmu_exp_val;
+    stream_binary = binary;
+    
+    TRISBbits.TRISB13 = 1; // AN11 as input
+    
+    // ADC interrupt when the CTMU-triggered conversion is done
+    IFS0bits.AD1IF = 0;
+    IPC3bits.AD1IP = STREAM_ADC_PRIORITY;
+    IEC0bits.AD1IE = 1;
+    
+    // Timer2 paces the shots, 1:1 prescale from Fcy
+    T2CON = 0;
+    TMR2 = 0;
+    PR2 = period_us * STREAM_TIMER2_TICKS_PER_US;
+    IFS0bits.T2IF = 0;
+    IPC1bits.T2IP = STREAM_TIMER2_PRIORITY;
+    IEC0bits.T2IE = 1;
+    T2CONbits.TON = 1;
+    return 1;
+}
+
+void stream_stop(void) {
+    T2CONbits.TON = 0;
+    IEC0bits.T2IE = 0;
+    while (stream_shot_in_flight); // let the last shot finish
+    IEC0bits.AD1IE = 0;
+    IFS0bits.AD1IF = 0;
+}
+
+void __attribute__ ((interrupt, no_auto_psv)) _T2Interrupt(void) {
+    IFS0bits.T2IF = 0;
+    if (stream_shot_in_flight) {
+        stream_dropped++; // period shorter than a shot; skip this one
+        return;
+    }
+    stream_shot_in_flight = 1;
+    ctmu_single_shot_arm(SINGLE_SHOT_DEFAULT_AN_CHANNEL, stream_charge_time_us, stream_ctmu_exp_val);
+    ctmu_single_shot_fire();
+}
+
+void __attribute__ ((interrupt, no_auto_psv)) _ADC1Interrupt(void) {
+    IFS0bits.AD1IF = 0;
+    const uint16_t end_adc_val = ctmu_single_shot_finish();
+    stream_shot_in_flight = 0;
+    
+    const uint8_t next_head = (stream_fifo_head + 1) % STREAM_SAMPLE_FIFO_LEN;
+    if (next_head == stream_fifo_tail) {
+        stream_dropped++; // main loop fell behind
+        return;
+    }
+    stream_fifo[stream_fifo_head] = end_adc_val;
+    stream_fifo_head = next_head;
+}
+
+uint8_t stream_get_sample(uint16_t* end_adc_val) {
+    // returns 1 and fills `end_adc_val` if a sample was waiting
+    if (stream_fifo_tail == stream_fifo_head) {
+        return 0;
+    }
+    *end_adc_val = stream_fifo[stream_fifo_tail];
+    stream_fifo_tail = (stream_fifo_tail + 1) % STREAM_SAMPLE_FIFO_LEN;
+    return 1;
+}
+
+uint16_t stream_dropped_count(void) {
+    return stream_dropped;
+}
+
+// Call from the main loop as often as possible. Averages every sample since
+// the last report, so the report rate follows whatever the baud rate allows
+// and no sample is thrown away while the UART is busy.
+void stream_poll(void) {
+    uint16_t end_adc_val;
+    while (stream_get_sample(&end_adc_val)) {
+        stream_adc_sum += end_adc_val;
+        stream_adc_count++;
+    }
+    
+    if (stream_adc_count < STREAM_MIN_AVG_COUNT) {
+        return;
+    }
+    if (uart_tx_free() < (stream_binary ? TELEMETRY_MAX_FRAME_LEN : STREAM_REPORT_MAX_LEN)) {
+        return; // previous report still going out; don't format one we can't send
+    }
+    
+    // average in ADC counts, then one conversion per report
+    const uint16_t avg_adc_val = (uint16_t) ((stream_adc_sum + (stream_adc_count / 2)) / stream_adc_count);
+    stream_adc_sum = 0;
+    stream_adc_count = 0;
+    
+    const uint32_t c_pF = ctmu_single_shot_adc_to_pF(avg_adc_val, stream_charge_time_us, stream_ctmu_exp_val);
+    if (stream_binary) {
+        telemetry_enqueue_cap_pF(c_pF);
+        return;
+    }
+    char msg[STREAM_REPORT_MAX_LEN];
+    sprintf(msg, "    REPORT_CAP_pF=%lu\n", c_pF);
+    uart_tx_enqueue(msg);
+}
@@ -0,0 +1,62 @@
+/* Microchip Technology Inc. and its subsidiaries.  You may use this software 
+ * and any derivatives exclusively with Microchip products. 
+ * 
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS".  NO WARRANTIES, WHETHER 
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED 
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A 
+ * PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION 
+ * WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION. 
+ *
+ * IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, 
+ * INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND 
+ * WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS 
+ * BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE 
+ * FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS 
+ * IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF 
+ * ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE 
+ * TERMS. 
+ */
+
+/* 
+ * File:   
+ * Author: 
+ * Comments:
+ * Revision history: 
+ */
+
+// This is a guard condition so that contents of this file are not included
+// more than once.  
+#ifndef __INCLUDE_GUARD__STREAM_H__
+#define	__INCLUDE_GUARD__STREAM_H__
+
+#include <xc.h> // include processor files - each processor file is guarded.  
+#include <stdint.h>
+
+// Continuous capacitance mode. Timer2 starts a single-shot CTMU charge every
+// period, the ADC interrupt collects the end reading, and stream_poll() in the
+// main loop turns samples into REPORT_CAP_pF lines (or telemetry frames) for
+// the TX queue. The UART sends report N while the CTMU charges for the next
+// samples.
+#define STREAM_TIMER2_TICKS_PER_US (4) // Fcy = 4 MHz, Timer2 1:1 prescale
+#define STREAM_MAX_PERIOD_US (16000) // PR2 is 16 bits
+#define STREAM_DEFAULT_PERIOD_US (1000) // 500 us charge + ~100 us discharge/ISR
+#define STREAM_SHOT_OVERHEAD_US (100) // discharge + ISRs; a period must fit the charge plus this
+#define STREAM_SAMPLE_FIFO_LEN (16)
+#define STREAM_MIN_AVG_COUNT (3) // like the blocking loop, at least 3 per report
+#define STREAM_REPORT_MAX_LEN (32) // "    REPORT_CAP_pF=4294967295\n" + NUL
+
+#define STREAM_TIMER2_PRIORITY (4)
+#define STREAM_ADC_PRIORITY (5) // above Timer2: collect a sample before starting the next
+
+uint8_t stream_start(uint16_t charge_time_us, int8_t ctmu_exp_val, uint16_t period_us, uint8_t binary);
+void stream_stop(void);
+uint8_t stream_get_sample(uint16_t* end_adc_val);
+void stream_poll(void);
+uint16_t stream_dropped_count(void);
+
+void __attribute__ ((interrupt, no_auto_psv)) _T2Interrupt(void);
+void __attribute__ ((interrupt, no_auto_psv)) _ADC1Interrupt(void);
+
+#endif	/* __INCLUDE_GUARD__STREAM_H__ */
@@ -0,0 +1,140 @@
+/*
+ * File:   touch.c
+ */
+
+
+#include "xc.h"
+#include "touch.h"
+#include "z_sense.h"
+#include "params.h"
+
+typedef struct {
+    uint8_t an_channel;
+    volatile unsigned int* tris; // TRIS register of the pin
+    uint16_t pin_mask;
+} touch_electrode_t;
+
+typedef struct {
+    uint16_t baseline_q4; // ADC counts << TOUCH_BASELINE_SHIFT
+    uint16_t last_reading;
+    uint8_t is_touched;
+    uint8_t debounce_count;
+} touch_channel_t;
+
+// Every analog pin except AN2/AN3 (RB0/RB1 are UART2). Pin numbers are the
+// 20-pin package's, as elsewhere; RB3 is only bonded out on the 28-pin one.
+// NOTE: AN9/RB15 is also the REFO scope output, so main must not enable REFO
+// while scanning.
+const touch_electrode_t touch_electrodes[TOUCH_CHANNEL_COUNT] = {
+    {0, &TRISA, (1U << 0)}, // AN0/RA0, Pin 2
+    {1, &TRISA, (1U << 1)}, // AN1/RA1, Pin 3
+    {4, &TRISB, (1U << 2)}, // AN4/RB2, Pin 6
+    {5, &TRISB, (1U << 3)}, // AN5/RB3, 28-pin package only (its Pin 7)
+    {9, &TRISB, (1U << 15)}, // AN9/RB15, Pin 18
+    {10, &TRISB, (1U << 14)}, // AN10/RB14, Pin 17
+    {11, &TRISB, (1U << 13)}, // AN11/RB13, Pin 16
+    {12, &TRISB, (1U << 12)}, // AN12/RB12, Pin 15
+};
+
+touch_channel_t touch_channels[TOUCH_CHANNEL_COUNT];
+
+touch_event_t touch_event_queue[TOUCH_EVENT_QUEUE_LEN];
+uint8_t touch_event_head = 0; // next to write
+uint8_t touch_event_tail = 0; // next to read
+
+uint16_t touch_read_channel(uint8_t channel) {
+    const touch_electrode_t* electrode = &touch_electrodes[channel];
+    *(electrode->tris) |= electrode->pin_mask; // input
+    return ctmu_single_shot_adc(electrode->an_channel, TOUCH_CHARGE_TIME_US, TOUCH_CTMU_EXP);
+}
+
+void touch_push_event(uint8_t channel, uint8_t is_press) {
+    const uint8_t next_head = (touch_event_head + 1) % TOUCH_EVENT_QUEUE_LEN;
+    if (next_head == touch_event_tail) {
+        return; // queue full; the state mask is still correct
+    }
+    touch_event_queue[touch_event_head].channel = channel;
+    touch_event_queue[touch_event_head].is_press = is_press;
+    touch_event_head = next_head;
+}
+
+void touch_init(void) {
+    // seed each baseline with the average of a few untouched scans
+    uint32_t reading_sums[TOUCH_CHANNEL_COUNT] = {0};
+    
+    for (uint8_t scan = 0; scan < TOUCH_INIT_SCANS; scan++) {
+        for (uint8_t channel = 0; channel < TOUCH_CHANNEL_COUNT; channel++) {
+            reading_sums[channel] += touch_read_channel(channel);
+        }
+    }
+    
+    for (uint8_t channel = 0; channel < TOUCH_CHANNEL_COUNT; channel++) {
+        touch_channels[channel].baseline_q4 = (uint16_t) ((reading_sums[channel] << TOUCH_BASELINE_SHIFT) / TOUCH_INIT_SCANS);
+        touch_channels[channel].last_reading = (uint16_t) (reading_sums[channel] / TOUCH_INIT_SCANS);
+        touch_channels[channel].is_touched = 0;
+        touch_channels[channel].debounce_count = 0;
+    }
+    touch_event_head = 0;
+    touch_event_tail = 0;
+}
+
+uint16_t touch_get_delta(uint8_t channel) {
+    const touch_channel_t* ch = &touch_channels[channel];
+    const uint16_t baseline = ch->baseline_q4 >> TOUCH_BASELINE_SHIFT;
+    return (ch->last_reading < baseline) ? (baseline - ch->last_reading) : 0;
+}
+
+void touch_scan(void) {
+    // one pass over all electrodes: ~8 * (40 us charge + ~50 us overhead)
+    for (uint8_t channel = 0; channel < TOUCH_CHANNEL_COUNT; channel++) {
+        touch_channel_t* ch = &touch_channels[channel];
+        ch->last_reading = touch_read_channel(channel);
+        
+        const uint16_t delta = touch_get_delta(channel);
+        
+        // hysteresis: press and release thresholds differ
+        const uint8_t wants_change = ch->is_touched
+                ? (delta < PARAM_U16(PARAM_TOUCH_RELEASE_DELTA))
+                : (delta >= PARAM_U16(PARAM_TOUCH_PRESS_DELTA));
+        
+        if (wants_change) {
+            ch->debounce_count++;
+            if (ch->debounce_count >= PARAM_U16(PARAM_TOUCH_DEBOUNCE_SCANS)) {
+                ch->is_touched = !ch->is_touched;
+                ch->debounce_count = 0;
+                touch_push_event(channel, ch->is_touched);
+            }
+        }
+        else {
+            ch->debounce_count = 0;
+        }
+        
+        // Drift tracking (temperature, humidity): follow the reading while
+        // untouched, but freeze during (or just before) a touch so a long
+        // press isn't absorbed
+        if ((!ch->is_touched) && (ch->debounce_count == 0)) {
+            ch->baseline_q4 += ((int16_t) ch->last_reading) - ((int16_t) (ch->baseline_q4 >> TOUCH_BASELINE_SHIFT));
+        }
+    }
+}
+
+uint8_t touch_get_event(touch_event_t* event) {
+    // returns 1 and fills `event` if one was queued
+    if (touch_event_tail == touch_event_head) {
+        return 0;
+    }
+    *event = touch_event_queue[touch_event_tail];
+    touch_event_tail = (touch_event_tail + 1) % TOUCH_EVENT_QUEUE_LEN;
+    return 1;
+}
+
+uint16_t touch_state_mask(void) {
+    // bit n = electrode n is touched
+    uint16_t mask = 0;
+    for (uint8_t channel = 0; channel < TOUCH_CHANNEL_COUNT; channel++) {
+        if (touch_channels[channel].is_touched) {
+            mask |= (1U << channel);
+        }
+    }
+    return mask;
+}
@@ -0,0 +1,64 @@
+/* Microchip Technology Inc. and its subsidiaries.  You may use this software 
+ * and any derivatives exclusively with Microchip products. 
+ * 
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS".  NO WARRANTIES, WHETHER 
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED 
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A 
+ * PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION 
+ * WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION. 
+ *
+ * IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, 
+ * INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND 
+ * WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS 
+ * BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE 
+ * FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS 
+ * IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF 
+ * ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE 
+ * TERMS. 
+ */
+
+/* 
+ * File:   
+ * Author: 
+ * Comments:
+ * Revision history: 
+ */
+
+// This is a guard condition so that contents of this file are not included
+// more than once.  
+#ifndef __INCLUDE_GUARD__TOUCH_H__
+#define	__INCLUDE_GUARD__TOUCH_H__
+
+#include <xc.h> // include processor files - each processor file is guarded.  
+#include <stdint.h>
+
+// Capacitive touch keys, scanned round-robin with short single-shot CTMU pulses.
+// A finger adds capacitance, so the pulse charges the electrode to a LOWER
+// voltage; "delta" below is (baseline - reading) in ADC counts.
+#define TOUCH_CHANNEL_COUNT (8)
+
+#define TOUCH_CTMU_EXP (-1) // 0.55 uA
+#define TOUCH_CHARGE_TIME_US (40) // ~1 V on a 20 pF electrode
+// defaults of the touch_* parameters (params.h)
+#define TOUCH_PRESS_DELTA (40) // counts below baseline to report a press
+#define TOUCH_RELEASE_DELTA (20) // and back above this to report a release
+#define TOUCH_DEBOUNCE_SCANS (2) // consecutive scans before a state change
+#define TOUCH_BASELINE_SHIFT (4) // baseline IIR: moves 1/16 of the error per scan
+#define TOUCH_INIT_SCANS (16)
+#define TOUCH_EVENT_QUEUE_LEN (16)
+
+typedef struct {
+    uint8_t channel; // index into the electrode table, not the AN number
+    uint8_t is_press; // 1 = touch, 0 = release
+} touch_event_t;
+
+void touch_init(void);
+void touch_scan(void);
+uint8_t touch_get_event(touch_event_t* event);
+uint16_t touch_state_mask(void);
+uint16_t touch_get_delta(uint8_t channel);
+
+#endif	/* __INCLUDE_GUARD__TOUCH_H__ */
+
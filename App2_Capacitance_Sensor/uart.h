@@ -1,34 +0,0 @@
-/* 
- * File:   UART2.h
- * Author: rvyas
- *
- * Created on November 19, 2016, 9:22 PM
- */
-
-#ifndef __INCLUDE_GUARD_UART2_H__
-#define	__INCLUDE_GUARD_UART2_H__
-
-#ifdef	__cplusplus
-extern "C" {
-#endif
-
-
-
-
-#ifdef	__cplusplus
-}
-#endif
-
-void InitUART2(void);
-void XmitUART2(char, unsigned int);
-
-void __attribute__ ((interrupt, no_auto_psv)) _U2RXInterrupt(void);
-void __attribute__ ((interrupt, no_auto_psv)) _U2TXInterrupt(void); 
-
-//void Disp2Hex(unsigned int);
-//void Disp2Hex32(unsigned long int);
-void Disp2String(char*);
-//void Disp2Dec(unsigned int);
-
-#endif	/* __INCLUDE_GUARD_UART2_H__ */
-
@@ -3,7 +3,6 @@
  */
 
 
-#include <math.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
@@ -12,39 +11,20 @@
 #include "uart.h"
 #include "adc.h"
 #include "delay.h"
+#include "params.h"
 
 // Output is on Pin 16/AN11/RB13
 
-#define F_to_pF(cap_F) ((cap_F) * 1000000000000.0)
-#define pF_to_F(cap_pF) ((cap_pF) / 1000000000000.0)
-
-#define F_to_nF(cap_F) ((cap_F) * 1000000000.0)
-#define nF_to_F(cap_nF) ((cap_nF) / 1000000000.0)
-
-#define F_to_uF(cap_F) ((cap_F) * 1000000.0)
-#define uF_to_F(cap_uF) ((cap_uF) / 1000000.0)
-
-const uint8_t enable_debug = 0;
-
 const uint32_t FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE = 0xFFFFFFFF - 6;
 
 // Arg current_value_exponent:
 //     -1 -> 5.5x10^-1 uA = 0.55 uA
 //      0 -> 5.5x10^0  uA = 5.5 uA
 //      1 -> 5.5x10^1  uA = 55  uA
-void init_ctmu(int8_t current_value_exponent) {
-    CTMUCONbits.CTMUEN = 1; // enable
-    // TODO: maybe more in here
-    
-    // these should all be zero by default, but good to set like this anyway
-    CTMUCONbits.TGEN = 0;
-    CTMUCONbits.EDGEN = 0;
-    CTMUCONbits.IDISSEN = 0;
-    CTMUCONbits.CTTRIG = 0;
-    
-    
+void set_ctmu_current_range(int8_t current_value_exponent) {
+    // per-range trim from calibration; uncalibrated is 0b01111 (max pos offset)
     // CTMUICONbits.ITRIM = 0b00000; // 5 bits of offset (no offset)
-    CTMUICONbits.ITRIM = 0b01111; // 5 bits of offset (max pos offset)
+    CTMUICONbits.ITRIM = ctmu_cal.itrim[ctmu_exp_to_range_idx(current_value_exponent)];
     
     if (current_value_exponent == -1) {
         // 0.55 uA
@@ -58,6 +38,19 @@ void init_ctmu(int8_t current_value_exponent) {
         // 55 uA
         CTMUICONbits.IRNG = 0b11;
     }
+}
+
+void init_ctmu(int8_t current_value_exponent) {
+    CTMUCONbits.CTMUEN = 1; // enable
+    // TODO: maybe more in here
+    
+    // these should all be zero by default, but good to set like this anyway
+    CTMUCONbits.TGEN = 0;
+    CTMUCONbits.EDGEN = 0;
+    CTMUCONbits.IDISSEN = 0;
+    CTMUCONbits.CTTRIG = 0;
+    
+    set_ctmu_current_range(current_value_exponent);
     
     CTMUCONbits.EDG1STAT = 1;
     CTMUCONbits.EDG2STAT = 0;
@@ -65,32 +58,49 @@ void init_ctmu(int8_t current_value_exponent) {
     AD1CON1bits.SAMP = 1; // Start sampling
 }
 
-float convert_ctmu_exp_to_uA(int8_t current_value_exponent) {
-    if (current_value_exponent == -1) {
-        return 0.55;
-    }
-    else if (current_value_exponent == 0) {
-        return 5.5;
-    }
-    else if (current_value_exponent == 1) {
-        return 55.0;
+// current_pA and ITRIM for the 0.55 uA, 5.5 uA, 55 uA ranges, then stray_pF
+#define CTMU_CAL_UNCALIBRATED { {550000UL, 5500000UL, 55000000UL}, {0b01111, 0b01111, 0b01111}, 0 }
+
+// Uncalibrated coefficients (program memory): the nominal IRNG currents.
+// ctmu_cal_report() prints measured values in this same form.
+const ctmu_cal_t ctmu_cal_defaults = CTMU_CAL_UNCALIBRATED;
+
+// active coefficients
+ctmu_cal_t ctmu_cal = CTMU_CAL_UNCALIBRATED;
+
+uint8_t ctmu_exp_to_range_idx(int8_t ctmu_exp_val) {
+    // -1 -> 0, 0 -> 1, 1 -> 2
+    // The "range" parameter is bounded by params_set(), and this runs from the
+    // Timer2 ISR (ctmu_single_shot_arm), so no blocking report here: just clamp
+    if ((ctmu_exp_val < -1) || (ctmu_exp_val > 1)) {
+        return 1;
     }
-    Disp2String("ERROR: convert_ctmu_exp_to_A() called with invalid value\n");
-    return 0.0;
+    return (uint8_t) (ctmu_exp_val + 1);
 }
 
-float convert_ctmu_exp_to_A(int8_t current_value_exponent) {
-    if (current_value_exponent == -1) {
-        return 0.55e-6;
+// Cap from a constant-current charge: C = i * dt / dV
+// With i in pA, dt in us, and dV in mV: C [pF] = i * dt / dV / 1000
+// Integer only; the product needs 64 bits (55 uA * 1 s = 5.5e13 pA*us).
+uint32_t ctmu_charge_to_pF(int8_t ctmu_exp_val, uint32_t charge_time_us, int32_t delta_mV) {
+    if (delta_mV <= 0) {
+        return FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE; // can't divide
     }
-    else if (current_value_exponent == 0) {
-        return 5.5e-6;
+    
+    const uint64_t charge_pA_us = ((uint64_t) ctmu_cal.current_pA[ctmu_exp_to_range_idx(ctmu_exp_val)]) * charge_time_us;
+    uint64_t cap_pF = charge_pA_us / (((uint64_t) delta_mV) * 1000);
+    
+    // remove the pin/wiring capacitance that is always in parallel
+    if (cap_pF > ctmu_cal.stray_pF) {
+        cap_pF -= ctmu_cal.stray_pF;
     }
-    else if (current_value_exponent == 1) {
-        return 55.0e-6;
+    else {
+        cap_pF = 0;
     }
-    Disp2String("ERROR: convert_ctmu_exp_to_A() called with invalid value\n");
-    return 0.0;
+    
+    if (cap_pF >= FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE) {
+        return FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE;
+    }
+    return (uint32_t) cap_pF;
 }
 
 void disable_ctmu_and_pull_pin_low() {
@@ -103,62 +113,10 @@ void disable_ctmu_and_pull_pin_low() {
     LATBbits.LATB13 = 0; // set pin state to LOW
 }
 
-#if 0
-uint32_t c_sense_2_point_delta_pF_v1() {
-    const uint16_t low_discharge_time_at_start_ms = 50;
-    const uint16_t charge_time_ms = 10;
-    const uint8_t ctmu_exp_val = 1; // -1=0.55, 0=5.5uA, 1=55uA
-    
-    // first, disable the CTMU and pull the pin low to discharge the cap
-    const uint16_t extra_adc_val_0 = read_adc_value();
-    
-    disable_ctmu_and_pull_pin_low();
-    delay32_ms(low_discharge_time_at_start_ms);
-    init_adc(); // must re-init after disable_ctmu_and_pull_pin_low()
-    
-    const uint16_t pre_ctmu_adc_val = read_adc_value();
-    
-    // set the CTMU, and wait a bit for it to charge the cap
-    init_ctmu(ctmu_exp_val);
-    delay32_ms(10); // try waiting for CTMU to get going
-    
-    const uint16_t start_adc_val = read_adc_value();
-    delay32_ms(charge_time_ms); // delay while capacitor charges from CTMU  
-    const uint16_t end_adc_val = read_adc_value();
-    
-    const uint32_t pre_ctmu_adc_val_mV = (uint32_t) adc_val_to_mV(pre_ctmu_adc_val);
-    const uint32_t start_adc_val_mV = (uint32_t) adc_val_to_mV(start_adc_val);
-    const uint32_t end_adc_val_mV = (uint32_t) adc_val_to_mV(end_adc_val);
-    
-    const int32_t delta_mV = end_adc_val_mV - start_adc_val_mV;
-    if (delta_mV <= 0) {
-        // cannot have 0 in the denom, so early return
-        Disp2String("DEBUG: delta_mV<=0, so can't divide\n");
-        return 0;
-    }
-    const float cap_F = convert_ctmu_exp_to_A(ctmu_exp_val) * ((float) charge_time_ms) / ((float) delta_mV) / 1000.0; // i * dt/dV, note t=msec, V=mV
-    const uint32_t cap_pF = (uint32_t) F_to_pF(cap_F);
-
-    char msg[255];
-    sprintf(msg, "DEBUG: extra_adc_val_0=%d=%dmV, pre_ctmu_adc=%d=%lumV, start_adc=%d=%lumV, end_adc=%d=%lumV, delta_mV=%lu, cap=%lup=%lun=%luu\n",
-            extra_adc_val_0, adc_val_to_mV(extra_adc_val_0),
-            pre_ctmu_adc_val, pre_ctmu_adc_val_mV,
-            start_adc_val, start_adc_val_mV,
-            end_adc_val, end_adc_val_mV,
-            delta_mV,
-            cap_pF,
-            ((uint32_t) F_to_nF(cap_F)),
-            ((uint32_t) F_to_uF(cap_F))
-        );
-    Disp2String(msg);
-    return cap_pF;
-}
-#endif
-
-
 uint32_t c_sense_2_point_delta_pF_configurable(
     uint16_t charge_time_ms,
-    int8_t ctmu_exp_val
+    int8_t ctmu_exp_val,
+    ctmu_reading_t* reading // optional (NULL): the raw ramp, for auto-ranging
 ) {
     // first, disable the CTMU and pull the pin low to discharge the cap
     // const uint16_t extra_adc_val_0 = read_adc_value();
@@ -181,7 +139,7 @@ uint32_t c_sense_2_point_delta_pF_configurable(
     
     // set the CTMU, and wait a bit for it to charge the cap
     init_ctmu(ctmu_exp_val);
-    delay32_ms(10); // try waiting for CTMU to get going
+    delay32_ms(CTMU_PRECHARGE_MS); // try waiting for CTMU to get going
     
     const uint16_t start_adc_val = read_adc_value();
     delay32_ms(charge_time_ms); // delay while capacitor charges from CTMU  
@@ -192,6 +150,11 @@ uint32_t c_sense_2_point_delta_pF_configurable(
     const uint32_t end_adc_val_mV = (uint32_t) adc_val_to_mV(end_adc_val);
     
     const int32_t delta_mV = end_adc_val_mV - start_adc_val_mV;
+    if (reading != NULL) {
+        reading->start_mV = (uint16_t) start_adc_val_mV;
+        reading->end_mV = (uint16_t) end_adc_val_mV;
+    }
+    
     uint32_t cap_pF;
     if (delta_mV <= 5) { // require at least this many mV for it to be "valid"
         // cannot have 0 in the denom, so early return
@@ -199,89 +162,455 @@ uint32_t c_sense_2_point_delta_pF_configurable(
         cap_pF = FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE;
     }
     else {
-        // NOTE: the 1000.0 multiplier is a mystery
-        const float cap_F = convert_ctmu_exp_to_A(ctmu_exp_val) * ((float) charge_time_ms) / ((float) delta_mV) / 1000.0; // i * dt/dV, note t=msec, V=mV
-        cap_pF = (uint32_t) F_to_pF(cap_F);
+        cap_pF = ctmu_charge_to_pF(ctmu_exp_val, ((uint32_t) charge_time_ms) * 1000, delta_mV);
     }
 
-    char msg[150];
-    sprintf(msg, "DEBUG (deep): discharge_time=%lums, charge_time=%dms, pre_ctmu_adc=%d=%lumV, start_adc=%d=%lumV, end_adc=%d=%lumV, delta_mV=%ld, cap=%lup=%lun=%luu\n",
+    if (PARAM_U16(PARAM_DEBUG)) { // only format what will be sent
+        char msg[150];
+        sprintf(msg, "DEBUG (deep): discharge_time=%lums, charge_time=%dms, pre_ctmu_adc=%d=%lumV, start_adc=%d=%lumV, end_adc=%d=%lumV, delta_mV=%ld, cap=%lup=%lun=%luu\n",
             
-            // extra_adc_val_0=%d=%dmV,
-            // extra_adc_val_0, adc_val_to_mV(extra_adc_val_0),
+                // extra_adc_val_0=%d=%dmV,
+                // extra_adc_val_0, adc_val_to_mV(extra_adc_val_0),
             
-            discharge_time_occupied_ms,
-            charge_time_ms,
-            pre_ctmu_adc_val, pre_ctmu_adc_val_mV,
-            start_adc_val, start_adc_val_mV,
-            end_adc_val, end_adc_val_mV,
-            delta_mV,
-            cap_pF,
-            ((uint32_t) (cap_pF / 1000)),
-            ((uint32_t) (cap_pF / 1000000))
-        );
-    if (enable_debug) {
+                discharge_time_occupied_ms,
+                charge_time_ms,
+                pre_ctmu_adc_val, pre_ctmu_adc_val_mV,
+                start_adc_val, start_adc_val_mV,
+                end_adc_val, end_adc_val_mV,
+                delta_mV,
+                cap_pF,
+                ((uint32_t) (cap_pF / 1000)),
+                ((uint32_t) (cap_pF / 1000000))
+            );
         Disp2String(msg);
     }
     return cap_pF;
 }
 
-uint32_t c_sense_2_point_delta_pF() {
-    // start around good for 1nF, and then adjust up or down
-    int8_t ctmu_exp_val = 0;
-    uint16_t charge_time_ms = 16;
+// Single-shot mode: instead of delay32_ms() windows, Timer1 times the charge in
+// hardware. Its period match is CTMU edge 2, which stops the current source and
+// (with CTTRIG) starts the ADC conversion exactly at the end of the window.
+// The cap is emptied through the CTMU's own discharge switch (IDISSEN), so a
+// whole reading takes roughly charge_time_us plus ~50 us.
+// The single shot is split in phases so the streaming mode (stream.c) can run
+// them from interrupts; ctmu_single_shot_adc() runs them back-to-back.
+
+// Configure the CTMU, ADC, and Timer1 for one shot on `an_channel`, and drain
+// the cap. The caller sets the pin of `an_channel` as an input.
+void ctmu_single_shot_arm(uint8_t an_channel, uint16_t charge_time_us, int8_t ctmu_exp_val) {
+    if (charge_time_us > SINGLE_SHOT_MAX_CHARGE_TIME_US) {
+        charge_time_us = SINGLE_SHOT_MAX_CHARGE_TIME_US;
+    }
+    
+    init_adc(); // AN11/RB13 as analog input
+    if (an_channel != SINGLE_SHOT_DEFAULT_AN_CHANNEL) {
+        // the CTMU current goes to whichever input the ADC mux selects
+        AD1CHSbits.CH0SA = an_channel;
+        AD1PCFG &= ~(1U << an_channel); // analog mode
+    }
+    
+    // CTMU edge mode, both edges idle, current range selected
+    CTMUCONbits.CTMUEN = 1;
+    CTMUCONbits.TGEN = 0;
+    CTMUCONbits.EDGSEQEN = 0;
+    CTMUCONbits.EDG1STAT = 0;
+    CTMUCONbits.EDG2STAT = 0;
+    set_ctmu_current_range(ctmu_exp_val);
     
-    uint32_t cap_pF = 0;
-    uint8_t retry_num = 0;
+    // drain the cap through the CTMU discharge switch
+    CTMUCONbits.IDISSEN = 1;
+    delay32_cycles(SINGLE_SHOT_DISCHARGE_CYCLES);
+    CTMUCONbits.IDISSEN = 0;
+    
+    // edge 2 = Timer1 period match, which also triggers the ADC
+    CTMUCONbits.EDG2SEL = 0b00; // Timer1
+    CTMUCONbits.EDG2POL = 1; // rising edge
+    CTMUCONbits.CTTRIG = 1; // CTMU edge triggers the ADC
+    CTMUCONbits.EDGEN = 1; // hardware edges enabled
+    
+    // ADC: sample during the whole charge, convert on the CTMU trigger
+    AD1CON1bits.SSRC = 0b100; // CTMU event ends sampling and starts conversion
+    AD1CON1bits.ADON = 1;
+    AD1CON1bits.SAMP = 1;
+    
+    // Timer1 counts Fcy (4 MHz at 8 MHz FRC), 1:1 prescale
+    T1CON = 0;
+    TMR1 = 0;
+    PR1 = charge_time_us * SINGLE_SHOT_TIMER1_TICKS_PER_US;
+    IFS0bits.T1IF = 0;
+}
 
-    for (retry_num = 0; retry_num < 15; retry_num++) {
-        cap_pF = c_sense_2_point_delta_pF_configurable(charge_time_ms, ctmu_exp_val);
+void ctmu_single_shot_fire(void) {
+    // edge 1 (start charging) is software, started right alongside Timer1
+    T1CONbits.TON = 1;
+    CTMUCONbits.EDG1STAT = 1;
+}
 
-        // print out all the info (debugging only)
-        char msg[150];
-        sprintf(
-            msg,
-            "DEBUG: retry_num=%d, cap=%lup=%lun=%luu, ctmu_exp_val=%d, charge_time_ms=%d\n",
-            retry_num,
-            cap_pF,
-            ((uint32_t) (cap_pF / 1000)),
-            ((uint32_t) (cap_pF / 1000000)),
-            ctmu_exp_val, charge_time_ms
-        );
-        if (enable_debug) {
-            Disp2String(msg);
+// Call once AD1CON1bits.DONE is set; returns the end-of-window reading and
+// leaves the cap discharged for the next one
+uint16_t ctmu_single_shot_finish(void) {
+    const uint16_t end_adc_val = ADC1BUF0;
+    
+    T1CONbits.TON = 0;
+    CTMUCONbits.EDGEN = 0;
+    CTMUCONbits.CTTRIG = 0;
+    CTMUCONbits.EDG1STAT = 0;
+    CTMUCONbits.EDG2STAT = 0;
+    CTMUCONbits.IDISSEN = 1;
+    
+    AD1CON1bits.SAMP = 0;
+    AD1CON1bits.SSRC = 0b111; // back to auto-convert for read_adc_value()
+    AD1CON1bits.ADON = 0; // Turn off ADC - saves power
+    
+    delay32_cycles(SINGLE_SHOT_DISCHARGE_CYCLES);
+    CTMUCONbits.IDISSEN = 0;
+    
+    return end_adc_val;
+}
+
+// Returns the raw ADC value at the end of the window
+uint16_t ctmu_single_shot_adc(uint8_t an_channel, uint16_t charge_time_us, int8_t ctmu_exp_val) {
+    ctmu_single_shot_arm(an_channel, charge_time_us, ctmu_exp_val);
+    ctmu_single_shot_fire();
+    while (!AD1CON1bits.DONE); // Wait for the end-edge conversion
+    return ctmu_single_shot_finish();
+}
+
+uint32_t ctmu_single_shot_adc_to_pF(uint16_t end_adc_val, uint16_t charge_time_us, int8_t ctmu_exp_val) {
+    // charge started from ~0 V after IDISSEN, so the end reading is the full delta
+    const int32_t delta_mV = (int32_t) adc_val_to_mV(end_adc_val);
+    if (delta_mV <= 5) { // require at least this many mV for it to be "valid"
+        return FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE;
+    }
+    return ctmu_charge_to_pF(ctmu_exp_val, charge_time_us, delta_mV);
+}
+
+uint32_t c_sense_single_shot_pF(uint16_t charge_time_us, int8_t ctmu_exp_val) {
+    if (charge_time_us > SINGLE_SHOT_MAX_CHARGE_TIME_US) {
+        charge_time_us = SINGLE_SHOT_MAX_CHARGE_TIME_US;
+    }
+    const uint16_t end_adc_val = ctmu_single_shot_adc(SINGLE_SHOT_DEFAULT_AN_CHANNEL, charge_time_us, ctmu_exp_val);
+    const uint32_t cap_pF = ctmu_single_shot_adc_to_pF(end_adc_val, charge_time_us, ctmu_exp_val);
+    
+    if (PARAM_U16(PARAM_DEBUG)) {
+        char msg[100];
+        sprintf(msg, "DEBUG (single-shot): charge_time=%uus, end_adc=%u=%umV, cap=%lup\n",
+                charge_time_us, end_adc_val, adc_val_to_mV(end_adc_val), cap_pF);
+        Disp2String(msg);
+    }
+    return cap_pF;
+}
+
+// Pick the fastest range whose ramp ends near CTMU_TARGET_END_MV, given the
+// charge rate measured at `range`. The rate scales 10x per current exponent,
+// so this is closed-form: no trial measurements needed.
+// Returns 0 (range untouched) if no range fits.
+uint8_t ctmu_predict_range(uint32_t rate_uV_per_ms, ctmu_range_t* range) {
+    // try the highest current first, since it needs the shortest charge time
+    for (int8_t exp_val = 1; exp_val >= -1; exp_val--) {
+        uint32_t rate = rate_uV_per_ms;
+        for (int8_t e = range->ctmu_exp_val; e < exp_val; e++) {
+            rate *= 10;
+        }
+        for (int8_t e = range->ctmu_exp_val; e > exp_val; e--) {
+            rate /= 10;
+        }
+        if (rate == 0) {
+            rate = 1;
+        }
+        
+        // the ramp runs for the pre-charge wait plus the charge window
+        const uint32_t total_ms = (CTMU_TARGET_END_MV * 1000UL) / rate;
+        if (total_ms < (CTMU_PRECHARGE_MS + CTMU_CHARGE_TIME_MIN_MS)) {
+            continue; // too fast at this current; try a lower one
         }
+        
+        uint32_t charge_time_ms = total_ms - CTMU_PRECHARGE_MS;
+        if (charge_time_ms > CTMU_CHARGE_TIME_MAX_MS) {
+            // lower currents are slower still, so this is the best there is
+            charge_time_ms = CTMU_CHARGE_TIME_MAX_MS;
+            if (((rate * charge_time_ms) / 1000) < CTMU_MIN_DELTA_MV) {
+                return 0; // cap too big to resolve
+            }
+        }
+        
+        range->ctmu_exp_val = exp_val;
+        range->charge_time_ms = (uint16_t) charge_time_ms;
+        return 1;
+    }
+    return 0; // cap too small, even the lowest current saturates
+}
 
-        if (cap_pF == FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE) {
-            // try again with a higher current, if we can
-            // otherwise, add more time
-            if (ctmu_exp_val < 1) {
-                ctmu_exp_val++;
+// The same for a single shot, whose window can be as short as
+// SINGLE_SHOT_MIN_CHARGE_TIME_US: for caps that saturate the ramp's 10 ms
+// pre-charge even at 0.55 uA. Sets range->single_shot_us.
+// Returns 0 (range untouched) if no range fits.
+uint8_t ctmu_predict_single_shot(uint32_t rate_uV_per_us, ctmu_range_t* range) {
+    for (int8_t exp_val = 1; exp_val >= -1; exp_val--) {
+        uint32_t rate = rate_uV_per_us;
+        for (int8_t e = range->ctmu_exp_val; e < exp_val; e++) {
+            rate *= 10;
+        }
+        for (int8_t e = range->ctmu_exp_val; e > exp_val; e--) {
+            rate /= 10;
+        }
+        if (rate == 0) {
+            rate = 1;
+        }
+        
+        // no pre-charge: the ramp starts from the discharged cap
+        uint32_t charge_time_us = (CTMU_TARGET_END_MV * 1000UL) / rate;
+        if (charge_time_us < SINGLE_SHOT_MIN_CHARGE_TIME_US) {
+            continue;
+        }
+        if (charge_time_us > SINGLE_SHOT_MAX_CHARGE_TIME_US) {
+            charge_time_us = SINGLE_SHOT_MAX_CHARGE_TIME_US;
+            if ((rate * charge_time_us) < (CTMU_MIN_DELTA_MV * 1000UL)) {
+                return 0; // too big for Timer1's window; the ramp can take it
             }
-            else if ((charge_time_ms*2) < 1000) {
-                charge_time_ms *= 2;
+        }
+        
+        range->ctmu_exp_val = exp_val;
+        range->single_shot_us = (uint16_t) charge_time_us;
+        return 1;
+    }
+    return 0;
+}
+
+// Auto-ranging with single shots from `range` (single_shot_us set), until
+// a reading is back in the ramp's range (CTMU_RAMP_MIN_PF).
+// Returns FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE if the cap is too big for
+// them, and 0 if it saturates even the shortest window at 0.55 uA (which the
+// pin capacitance alone never does).
+static uint32_t c_sense_auto_single_shot_pF(ctmu_range_t* range) {
+    uint8_t was_saturated = 0;
+    for (uint8_t try_num = 0; try_num < CTMU_AUTO_RANGE_MAX_TRIES; try_num++) {
+        const uint16_t end_adc_val = ctmu_single_shot_adc(SINGLE_SHOT_DEFAULT_AN_CHANNEL, range->single_shot_us,
+                range->ctmu_exp_val);
+        const uint32_t end_mV = adc_val_to_mV(end_adc_val);
+        const uint8_t is_saturated = (end_mV + CTMU_SATURATION_MARGIN_MV) >= vdd_mV;
+        was_saturated = is_saturated;
+        
+        if (PARAM_U16(PARAM_DEBUG)) {
+            char msg[100];
+            sprintf(msg, "DEBUG: try_num=%d, ctmu_exp_val=%d, single_shot_us=%u, end=%lumV\n",
+                    try_num, range->ctmu_exp_val, range->single_shot_us, end_mV);
+            Disp2String(msg);
+        }
+        
+        uint32_t rate_uV_per_us;
+        if (is_saturated) {
+            rate_uV_per_us = (end_mV * 1000UL * CTMU_SATURATED_RATE_FACTOR) / range->single_shot_us;
+        }
+        else {
+            rate_uV_per_us = (((end_mV < 1) ? 1 : end_mV) * 1000UL) / range->single_shot_us;
+        }
+        
+        ctmu_range_t next_range = *range;
+        const uint8_t is_predicted = ctmu_predict_single_shot(rate_uV_per_us, &next_range);
+        
+        if ((!is_saturated) && (end_mV >= CTMU_MIN_DELTA_MV)) {
+            const uint32_t cap_pF = ctmu_single_shot_adc_to_pF(end_adc_val, range->single_shot_us, range->ctmu_exp_val);
+            if (cap_pF >= CTMU_RAMP_MIN_PF) {
+                // back in the ramp's range: hand it the rate for next time
+                ctmu_range_t ramp_range = {range->ctmu_exp_val, CTMU_CHARGE_TIME_MIN_MS, 0};
+                if (ctmu_predict_range((uint32_t) ((((uint64_t) end_mV) * 1000000UL) / range->single_shot_us),
+                        &ramp_range)) {
+                    *range = ramp_range;
+                    return cap_pF;
+                }
             }
-            else {
-                break; // give up, and return the OVER_RANGE value
+            if (is_predicted) {
+                *range = next_range;
             }
+            return cap_pF;
         }
-        else if (cap_pF <= 10) {
-            // try again with a lower current, if we can
-            // otherwise, try will less time
-            if (ctmu_exp_val > -1) {
-                ctmu_exp_val--;
-            }
-            else if ((charge_time_ms/2) > 1) {
-                charge_time_ms /= 2;
+        
+        if ((!is_predicted)
+                || ((next_range.ctmu_exp_val == range->ctmu_exp_val)
+                    && (next_range.single_shot_us == range->single_shot_us))) {
+            break;
+        }
+        *range = next_range;
+    }
+    return was_saturated ? 0 : FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE;
+}
+
+uint32_t c_sense_auto_range_pF(ctmu_range_t* range) {
+    // `range` starts at the last good range for this channel, so a steady
+    // cap is read in one measurement; a changed cap is re-ranged from its
+    // measured dV/dt, which normally converges on the second measurement
+    uint32_t cap_pF = FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE;
+    uint8_t was_saturated = 0; // how the last attempt failed
+    
+    if (range->single_shot_us != 0) {
+        cap_pF = c_sense_auto_single_shot_pF(range);
+        if (cap_pF != FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE) {
+            return cap_pF;
+        }
+        // grown past a single shot: back to the ramp, at its shortest window
+        range->single_shot_us = 0;
+        range->charge_time_ms = CTMU_CHARGE_TIME_MIN_MS;
+    }
+    
+    for (uint8_t try_num = 0; try_num < CTMU_AUTO_RANGE_MAX_TRIES; try_num++) {
+        ctmu_reading_t reading;
+        cap_pF = c_sense_2_point_delta_pF_configurable(range->charge_time_ms, range->ctmu_exp_val, &reading);
+        
+        const int32_t delta_mV = ((int32_t) reading.end_mV) - ((int32_t) reading.start_mV);
+        const uint8_t is_saturated = (reading.end_mV + CTMU_SATURATION_MARGIN_MV) >= vdd_mV;
+        was_saturated = is_saturated;
+        
+        if (PARAM_U16(PARAM_DEBUG)) {
+            char msg[150];
+            sprintf(msg, "DEBUG: try_num=%d, cap=%lup, ctmu_exp_val=%d, charge_time_ms=%u, start=%umV, end=%umV\n",
+                    try_num, cap_pF, range->ctmu_exp_val, range->charge_time_ms,
+                    reading.start_mV, reading.end_mV);
+            Disp2String(msg);
+        }
+        
+        uint32_t rate_uV_per_ms;
+        if (is_saturated) {
+            // hit the rail (maybe during the pre-charge), so the true rate is
+            // at least this; overshoot the estimate to get off the rail quickly
+            rate_uV_per_ms = ((uint32_t) reading.end_mV * 1000UL * CTMU_SATURATED_RATE_FACTOR)
+                    / (CTMU_PRECHARGE_MS + range->charge_time_ms);
+        }
+        else {
+            if (delta_mV < 1) {
+                rate_uV_per_ms = 1000UL / range->charge_time_ms; // below the noise floor
             }
             else {
-                break; // give up, and return the too-low value
+                rate_uV_per_ms = ((uint32_t) delta_mV * 1000UL) / range->charge_time_ms;
             }
         }
+        
+        ctmu_range_t next_range = *range;
+        const uint8_t is_predicted = ctmu_predict_range(rate_uV_per_ms, &next_range);
+        
+        if ((!is_saturated) && (delta_mV >= CTMU_MIN_DELTA_MV)) {
+            // good reading; keep the refined range for next time, no re-measure
+            if (is_predicted) {
+                *range = next_range;
+            }
+            return cap_pF;
+        }
+        
+        if ((!is_predicted)
+                || ((next_range.ctmu_exp_val == range->ctmu_exp_val)
+                    && (next_range.charge_time_ms == range->charge_time_ms))) {
+            break; // nowhere better to go
+        }
+        *range = next_range;
+    }
+    
+    if (!was_saturated) {
+        return FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE; // a ramp too small even at the longest charge
+    }
+    
+    // Saturated even at the lowest current: too small for the ramp, so time
+    // it with single shots, probing with the shortest window
+    range->ctmu_exp_val = -1;
+    range->single_shot_us = SINGLE_SHOT_MIN_CHARGE_TIME_US;
+    return c_sense_auto_single_shot_pF(range);
+}
+
+uint32_t c_sense_2_point_delta_pF() {
+    // last good range for the AN11 channel; starts around good for 1nF
+    static ctmu_range_t an11_range = {0, 16};
+    
+    return c_sense_auto_range_pF(&an11_range);
+}
+
+// Calibration: run once per board with the fixtures described below, then
+// cal_store_save() it to data EEPROM (or ctmu_cal_report() it and paste it
+// over ctmu_cal_defaults).
+
+void ctmu_calibrate_stray_pF(void) {
+    // Nothing connected to AN11: whatever is read is the pin + wiring, well
+    // below the ramp's range, so auto-ranging times it with single shots.
+    // A failed calibration keeps the old value.
+    const uint32_t old_stray_pF = ctmu_cal.stray_pF;
+    ctmu_cal.stray_pF = 0;
+    
+    uint32_t stray_pF_sum = 0;
+    for (uint8_t i = 0; i < CTMU_CAL_SAMPLE_COUNT; i++) {
+        const uint32_t cap_pF = c_sense_2_point_delta_pF();
+        if ((cap_pF == FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE) || (cap_pF == 0)) {
+            Disp2String("ERROR: ctmu_calibrate_stray_pF() read out of range; is AN11 open?\n");
+            ctmu_cal.stray_pF = old_stray_pF;
+            return;
+        }
+        stray_pF_sum += cap_pF;
+    }
+    ctmu_cal.stray_pF = stray_pF_sum / CTMU_CAL_SAMPLE_COUNT;
+}
+
+void ctmu_calibrate_current_from_resistor(int8_t ctmu_exp_val, uint32_t resistance_ohms) {
+    // Known resistor from AN11 to GND (as in Project_6_CTMU's r_sense_and_log):
+    // the CTMU current settles at i = V / R.
+    // For 0.55uA use ~1M, for 5.5uA use 100k, for 55uA use 10k.
+    init_adc();
+    init_ctmu(ctmu_exp_val);
+    delay32_ms(CTMU_PRECHARGE_MS);
+    
+    uint32_t adc_sum = 0;
+    for (uint8_t i = 0; i < CTMU_CAL_SAMPLE_COUNT; i++) {
+        adc_sum += read_adc_value();
+    }
+    disable_ctmu_and_pull_pin_low();
+    
+    const uint32_t v_uV = ((adc_sum * vdd_mV) >> 10) * 1000UL / CTMU_CAL_SAMPLE_COUNT;
+    
+    // i [pA] = V [uV] / R [ohm] * 1e6
+    ctmu_cal.current_pA[ctmu_exp_to_range_idx(ctmu_exp_val)] = (uint32_t) ((((uint64_t) v_uV) * 1000000ULL) / resistance_ohms);
+}
+
+void ctmu_calibrate_current_from_cap(uint32_t reference_pF) {
+    // Known reference cap on AN11, 10 nF or more so the stray is a small part
+    // of it (stray should be calibrated first): solves the effective current
+    // of whichever range auto-ranging settles on
+    ctmu_range_t range = {0, 16};
+    const uint32_t cap_pF = c_sense_auto_range_pF(&range);
+    if ((cap_pF == FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE) || (cap_pF == 0)) {
+        Disp2String("ERROR: ctmu_calibrate_current_from_cap() reference is out of range\n");
+        return;
+    }
+    
+    // the same ramp (or single shot) again, averaged
+    uint64_t delta_mV_sum = 0;
+    for (uint8_t i = 0; i < CTMU_CAL_SAMPLE_COUNT; i++) {
+        if (range.single_shot_us != 0) {
+            delta_mV_sum += adc_val_to_mV(ctmu_single_shot_adc(SINGLE_SHOT_DEFAULT_AN_CHANNEL, range.single_shot_us,
+                    range.ctmu_exp_val));
+        }
         else {
-            // success, value is in range
-            break;
+            ctmu_reading_t reading;
+            c_sense_2_point_delta_pF_configurable(range.charge_time_ms, range.ctmu_exp_val, &reading);
+            if (reading.end_mV > reading.start_mV) {
+                delta_mV_sum += reading.end_mV - reading.start_mV;
+            }
         }
     }
-    return cap_pF;
+    if (delta_mV_sum == 0) {
+        Disp2String("ERROR: ctmu_calibrate_current_from_cap() saw no ramp\n");
+        return;
+    }
+    
+    // i [pA] = C [pF] * dV [mV] * 1000 / dt [us]
+    const uint64_t charge_time_us = (range.single_shot_us != 0)
+            ? range.single_shot_us : ((uint64_t) range.charge_time_ms) * 1000;
+    ctmu_cal.current_pA[ctmu_exp_to_range_idx(range.ctmu_exp_val)] = (uint32_t) (
+            (((uint64_t) (reference_pF + ctmu_cal.stray_pF)) * delta_mV_sum * 1000)
+            / (charge_time_us * CTMU_CAL_SAMPLE_COUNT));
+}
+
+void ctmu_cal_report(void) {
+    // printed as a C initializer for ctmu_cal_defaults
+    char msg[100];
+    sprintf(msg, "CTMU_CAL = { {%lu, %lu, %lu}, {%d, %d, %d}, %lu }\n",
+            ctmu_cal.current_pA[0], ctmu_cal.current_pA[1], ctmu_cal.current_pA[2],
+            ctmu_cal.itrim[0], ctmu_cal.itrim[1], ctmu_cal.itrim[2],
+            ctmu_cal.stray_pF);
+    Disp2String(msg);
 }
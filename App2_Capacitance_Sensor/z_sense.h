@@ -34,11 +34,74 @@
 #include <xc.h> // include processor files - each processor file is guarded.  
 
 
+// Single-shot (hardware edge) mode limits
+#define SINGLE_SHOT_TIMER1_TICKS_PER_US (4) // Fcy = 4 MHz, Timer1 1:1 prescale
+#define SINGLE_SHOT_MAX_CHARGE_TIME_US (16000) // PR1 is 16 bits
+#define SINGLE_SHOT_DISCHARGE_CYCLES (100) // 25 us of IDISSEN at 4 MIPS
+#define SINGLE_SHOT_DEFAULT_CHARGE_TIME_US (500) // 55 uA for 500 us is 27.5 nC: ~10 nF (ramp near VDD) to ~5 uF (5 mV ramp)
+#define SINGLE_SHOT_DEFAULT_AN_CHANNEL (11) // AN11/RB13, as set up by init_adc()
+#define SINGLE_SHOT_MIN_CHARGE_TIME_US (20) // edge 1 is software: keep its few cycles a small part of the window
+
+// Closed-form auto-ranging (c_sense_auto_range_pF)
+#define CTMU_PRECHARGE_MS (10) // "wait for CTMU to get going" before the start reading
+#define CTMU_TARGET_END_MV (2000UL) // aim for the ramp to end here, well below VDD
+#define CTMU_MIN_DELTA_MV (100) // smaller ramps are too coarse to trust
+#define CTMU_SATURATION_MARGIN_MV (300) // within this of VDD counts as saturated
+#define CTMU_SATURATED_RATE_FACTOR (4) // saturated: assume at least 4x the visible rate
+#define CTMU_CHARGE_TIME_MIN_MS (10)
+#define CTMU_CHARGE_TIME_MAX_MS (1000)
+#define CTMU_AUTO_RANGE_MAX_TRIES (4)
+#define CTMU_RAMP_MIN_PF (10000UL) // below ~4 nF the pre-charge saturates at 0.55 uA: single shots under this
+
+// CTMU current range and charge window; one is remembered per channel
+typedef struct {
+    int8_t ctmu_exp_val; // -1=0.55uA, 0=5.5uA, 1=55uA
+    uint16_t charge_time_ms;
+    uint16_t single_shot_us; // 0, or a cap too small for the ramp: a single shot this long instead
+} ctmu_range_t;
+
+// raw ramp of a c_sense_2_point_delta_pF_configurable() reading
+typedef struct {
+    uint16_t start_mV;
+    uint16_t end_mV;
+} ctmu_reading_t;
+
+// Capacitance pipeline coefficients: C [pF] = i [pA] * dt [us] / dV [mV] / 1000 - stray
+#define CTMU_RANGE_COUNT (3) // indexed by ctmu_exp_val + 1
+#define CTMU_CAL_SAMPLE_COUNT (16)
+
+typedef struct {
+    uint32_t current_pA[CTMU_RANGE_COUNT]; // effective current of each IRNG range, in pA (55 uA = 55000000)
+    int8_t itrim[CTMU_RANGE_COUNT]; // CTMUICON ITRIM for each IRNG range
+    uint32_t stray_pF; // pin + wiring capacitance, always in parallel
+} ctmu_cal_t;
+
+extern const ctmu_cal_t ctmu_cal_defaults;
+extern ctmu_cal_t ctmu_cal;
+
+void set_ctmu_current_range(int8_t current_value_exponent);
 void init_ctmu(int8_t current_value_exponent);
 
 
-// uint32_t c_sense_2_point_delta_pF_v1();
 uint32_t c_sense_2_point_delta_pF();
+uint32_t c_sense_auto_range_pF(ctmu_range_t* range);
+uint8_t ctmu_predict_range(uint32_t rate_uV_per_ms, ctmu_range_t* range);
+uint8_t ctmu_predict_single_shot(uint32_t rate_uV_per_us, ctmu_range_t* range);
+uint32_t c_sense_2_point_delta_pF_configurable(uint16_t charge_time_ms, int8_t ctmu_exp_val, ctmu_reading_t* reading);
+
+uint8_t ctmu_exp_to_range_idx(int8_t ctmu_exp_val);
+uint32_t ctmu_charge_to_pF(int8_t ctmu_exp_val, uint32_t charge_time_us, int32_t delta_mV);
+
+void ctmu_calibrate_stray_pF(void);
+void ctmu_calibrate_current_from_resistor(int8_t ctmu_exp_val, uint32_t resistance_ohms);
+void ctmu_calibrate_current_from_cap(uint32_t reference_pF);
+void ctmu_cal_report(void);
+uint32_t c_sense_single_shot_pF(uint16_t charge_time_us, int8_t ctmu_exp_val);
+uint16_t ctmu_single_shot_adc(uint8_t an_channel, uint16_t charge_time_us, int8_t ctmu_exp_val);
+void ctmu_single_shot_arm(uint8_t an_channel, uint16_t charge_time_us, int8_t ctmu_exp_val);
+void ctmu_single_shot_fire(void);
+uint16_t ctmu_single_shot_finish(void);
+uint32_t ctmu_single_shot_adc_to_pF(uint16_t end_adc_val, uint16_t charge_time_us, int8_t ctmu_exp_val);
 
 #endif	/* __INCLUDE_GUARD__Z_SENSE_H__ */
 
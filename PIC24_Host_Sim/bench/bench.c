@@ -0,0 +1,141 @@
+/*
+ * File:   bench.c
+ *
+ * Runs the cases of one project (bench_<project>.c) and prints, per case:
+ *   <project> <case> <cycles/call> <stack bytes> <pointer bits>
+ * which is also the format of bench/baselines.txt.
+ *
+ * Cycles are simulator cycles (sim.h), including any time spent waiting on
+ * peripherals. Stack is the deepest firmware frame (ISRs included) seen
+ * below the case, sampled at every basic block. It is in host bytes: use it
+ * to catch growth, not to size the PIC24 stack. Baselines are per pointer
+ * width, since -m32 and 64-bit builds use different amounts of stack; a
+ * project with no rows for the build's width is reported and not compared.
+ *
+ * Usage: bench_<project> [baselines.txt]
+ *   exits 1 if a case returns a wrong result, regresses past the tolerance
+ *   (BENCH_CYCLE_TOL_PCT, default 2; BENCH_STACK_TOL_PCT, default 10), or is
+ *   missing from rows recorded for its width.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+#include "bench.h"
+
+#define BENCH_DEFAULT_CYCLE_TOL_PCT (2)
+#define BENCH_DEFAULT_STACK_TOL_PCT (10)
+
+static int bench_failures = 0;
+
+// noinline: its frame is the fixed point the firmware's stack use is measured from
+static void __attribute__((noinline)) bench_run_case(const bench_case_t* bench_case, uint64_t* cycles_per_call, uint32_t* stack_bytes) {
+    if (bench_case->setup != NULL) {
+        bench_case->setup();
+    }
+    sim_advance_ps(0); // settle anything the setup left pending
+
+    const uintptr_t stack_top = (uintptr_t) __builtin_frame_address(0);
+    sim_stack_low = UINTPTR_MAX;
+    const uint64_t start_cycles = sim_cycle_count();
+    for (uint16_t i = 0; i < bench_case->iterations; i++) {
+        if (bench_case->run() != 0) {
+            bench_failures++;
+            printf("FAIL %s %s: wrong result\n", bench_project, bench_case->name);
+            break;
+        }
+    }
+    sim_advance_ps(0); // settle the last access and any block cycles
+    *cycles_per_call = (sim_cycle_count() - start_cycles) / bench_case->iterations;
+    *stack_bytes = (sim_stack_low < stack_top) ? (uint32_t) (stack_top - sim_stack_low) : 0;
+}
+
+// `name` NULL: any case of this project
+static int bench_find_baseline(FILE* f, const char* name, uint64_t* cycles, uint32_t* stack_bytes) {
+    char line[160];
+    rewind(f);
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char project[64], case_name[64];
+        unsigned long long base_cycles;
+        unsigned long base_stack;
+        unsigned pointer_bits;
+        if ((line[0] == '#') || (sscanf(line, "%63s %63s %llu %lu %u", project, case_name,
+                &base_cycles, &base_stack, &pointer_bits) != 5)) {
+            continue;
+        }
+        if ((strcmp(project, bench_project) == 0) && ((name == NULL) || (strcmp(case_name, name) == 0))
+                && (pointer_bits == sizeof(void*) * 8)) {
+            *cycles = base_cycles;
+            *stack_bytes = (uint32_t) base_stack;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t bench_env_pct(const char* name, uint32_t default_pct) {
+    const char* value = getenv(name);
+    return (value != NULL) ? (uint32_t) strtoul(value, NULL, 10) : default_pct;
+}
+
+int main(int argc, char** argv) {
+    sim_set_run_limit_ps(SIM_NEVER);
+    if (getenv("SIM_UART_OUT") == NULL) {
+        sim_uart_out = fopen("/dev/null", "wb"); // keep the firmware's prints out of the table
+    }
+
+    FILE* baselines = NULL;
+    if (argc > 1) {
+        baselines = fopen(argv[1], "r");
+        if (baselines == NULL) {
+            perror(argv[1]);
+            return 2;
+        }
+    }
+    const uint32_t cycle_tol_pct = bench_env_pct("BENCH_CYCLE_TOL_PCT", BENCH_DEFAULT_CYCLE_TOL_PCT);
+    const uint32_t stack_tol_pct = bench_env_pct("BENCH_STACK_TOL_PCT", BENCH_DEFAULT_STACK_TOL_PCT);
+
+    for (uint8_t i = 0; i < bench_case_count; i++) {
+        const bench_case_t* bench_case = &bench_cases[i];
+        uint64_t cycles;
+        uint32_t stack_bytes;
+        bench_run_case(bench_case, &cycles, &stack_bytes);
+        printf("%s %s %llu %lu %u\n", bench_project, bench_case->name,
+                (unsigned long long) cycles, (unsigned long) stack_bytes, (unsigned) (sizeof(void*) * 8));
+
+        uint64_t base_cycles;
+        uint32_t base_stack;
+        if (baselines == NULL) {
+            continue; // no check asked for
+        }
+        if (!bench_find_baseline(baselines, bench_case->name, &base_cycles, &base_stack)) {
+            if (!bench_find_baseline(baselines, NULL, &base_cycles, &base_stack)) {
+                // a build of another width (-m32 or not) than any recorded
+                printf("SKIP %s %s: no %u-bit baselines recorded, not compared; 'make bench-baseline' records them\n",
+                        bench_project, bench_case->name, (unsigned) (sizeof(void*) * 8));
+                continue;
+            }
+            // a new case: nothing checked, so don't pass
+            printf("FAIL %s %s: no %u-bit baseline, run 'make bench-baseline'\n", bench_project,
+                    bench_case->name, (unsigned) (sizeof(void*) * 8));
+            bench_failures++;
+            continue;
+        }
+        if (cycles * 100 > base_cycles * (100 + cycle_tol_pct)) {
+            printf("FAIL %s %s: %llu cycles/call, baseline %llu\n", bench_project, bench_case->name,
+                    (unsigned long long) cycles, (unsigned long long) base_cycles);
+            bench_failures++;
+        }
+        if ((uint64_t) stack_bytes * 100 > (uint64_t) base_stack * (100 + stack_tol_pct)) {
+            printf("FAIL %s %s: %lu stack bytes, baseline %lu\n", bench_project, bench_case->name,
+                    (unsigned long) stack_bytes, (unsigned long) base_stack);
+            bench_failures++;
+        }
+    }
+    if (baselines != NULL) {
+        fclose(baselines);
+    }
+    fflush(stdout);
+    exit((bench_failures > 0) ? 1 : 0); // sim_finish() runs from atexit()
+}
@@ -0,0 +1,25 @@
+/*
+ * File:   bench.h
+ *
+ * Cycle/stack benchmarks of firmware functions, run on the host simulator.
+ * Each bench_<project>.c lists its cases; bench.c runs them and checks the
+ * results against bench/baselines.txt.
+ */
+
+#ifndef __INCLUDE_GUARD__BENCH_H__
+#define	__INCLUDE_GUARD__BENCH_H__
+
+#include <stdint.h>
+
+typedef struct {
+    const char* name;
+    void (*setup)(void); // optional, run once before the timed calls
+    int (*run)(void); // one call of the function under test; non-zero = wrong result
+    uint16_t iterations;
+} bench_case_t;
+
+extern const char* const bench_project;
+extern const bench_case_t bench_cases[];
+extern const uint8_t bench_case_count;
+
+#endif	/* __INCLUDE_GUARD__BENCH_H__ */
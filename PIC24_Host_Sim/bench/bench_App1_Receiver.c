@@ -0,0 +1,59 @@
+/*
+ * File:   bench_App1_Receiver.c
+ */
+
+
+#include <string.h>
+#include "sim.h"
+#include "bench.h"
+#include "clock.h"
+#include "uart.h"
+#include "ir_receive.h"
+
+// same length and sample period (200 us) as main.c's carrier detect log
+#define BENCH_CARRIER_LOG_LEN (900)
+
+static uint8_t bench_carrier_log[BENCH_CARRIER_LOG_LEN];
+
+static uint32_t bench_log_run(uint32_t idx, uint8_t level, uint32_t count) {
+    for (uint32_t i = 0; (i < count) && (idx < BENCH_CARRIER_LOG_LEN); i++) {
+        bench_carrier_log[idx++] = level;
+    }
+    return idx;
+}
+
+// what the receiver logs for IR_CODE_POWER_ON_OFF
+static void bench_setup_carrier_log(void) {
+    memset(bench_carrier_log, 0, sizeof(bench_carrier_log));
+    uint32_t idx = 10;
+    idx = bench_log_run(idx, 1, 22); // start: 4500 us on, 4500 us off
+    idx = bench_log_run(idx, 0, 22);
+    for (int8_t bit_place = 31; bit_place >= 0; bit_place--) {
+        idx = bench_log_run(idx, 1, 3); // 560 us on
+        idx = bench_log_run(idx, 0, ((IR_CODE_POWER_ON_OFF >> bit_place) & 1) ? 8 : 3);
+    }
+    bench_log_run(idx, 1, 3); // stop bit
+}
+
+static int bench_parse_carrier_log(void) {
+    return parse_carrier_log_to_code(bench_carrier_log, BENCH_CARRIER_LOG_LEN) != IR_CODE_POWER_ON_OFF;
+}
+
+static void bench_setup_uart(void) {
+    set_clock_freq(8000);
+    InitUART2();
+}
+
+static int bench_disp2string(void) {
+    Disp2String("IR_CODE=0xE0E040BF POWER\n");
+    return 0;
+}
+
+const char* const bench_project = "App1_Receiver";
+
+const bench_case_t bench_cases[] = {
+    {"parse_carrier_log_to_code", bench_setup_carrier_log, bench_parse_carrier_log, 20},
+    {"Disp2String_25_chars", bench_setup_uart, bench_disp2string, 10},
+};
+
+const uint8_t bench_case_count = sizeof(bench_cases) / sizeof(bench_cases[0]);
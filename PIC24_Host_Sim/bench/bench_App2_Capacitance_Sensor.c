@@ -0,0 +1,43 @@
+/*
+ * File:   bench_App2_Capacitance_Sensor.c
+ */
+
+
+#include "sim.h"
+#include "bench.h"
+#include "clock.h"
+#include "uart.h"
+#include "adc.h"
+#include "z_sense.h"
+
+#define BENCH_AN11 (11)
+#define BENCH_LOAD_PF (1000000UL) // 1 uF
+
+extern const uint32_t FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE; // z_sense.c
+
+static void bench_setup_c_sense(void) {
+    set_clock_freq(8000);
+    InitUART2();
+    init_adc();
+    sim_analog_load(BENCH_AN11, BENCH_LOAD_PF, 0);
+}
+
+static int bench_c_sense_2_point(void) {
+    ctmu_reading_t reading;
+    const uint32_t cap_pF = c_sense_2_point_delta_pF_configurable(16, 0, &reading);
+    return (cap_pF == 0) || (cap_pF == FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE);
+}
+
+static int bench_disp2string(void) {
+    Disp2String("    REPORT_CAP_pF=1000\n");
+    return 0;
+}
+
+const char* const bench_project = "App2_Capacitance_Sensor";
+
+const bench_case_t bench_cases[] = {
+    {"c_sense_2_point_delta_pF_configurable", bench_setup_c_sense, bench_c_sense_2_point, 3},
+    {"Disp2String_23_chars", NULL, bench_disp2string, 10},
+};
+
+const uint8_t bench_case_count = sizeof(bench_cases) / sizeof(bench_cases[0]);
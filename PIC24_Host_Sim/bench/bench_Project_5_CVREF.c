@@ -0,0 +1,25 @@
+/*
+ * File:   bench_Project_5_CVREF.c
+ */
+
+
+#include "sim.h"
+#include "bench.h"
+#include "clock.h"
+#include "comparator.h"
+
+static void bench_setup_clock(void) {
+    set_clock_freq(8000);
+}
+
+static int bench_init_cvref(void) {
+    return init_cvref(1650) != 1650;
+}
+
+const char* const bench_project = "Project_5_CVREF";
+
+const bench_case_t bench_cases[] = {
+    {"init_cvref", bench_setup_clock, bench_init_cvref, 100},
+};
+
+const uint8_t bench_case_count = sizeof(bench_cases) / sizeof(bench_cases[0]);
@@ -0,0 +1,21 @@
+/*
+ * File:   libpic30.h
+ *
+ * Host-build stand-in for the XC16 delay helpers. Delays jump virtual time
+ * forward (running the peripherals and ISRs on the way) instead of spinning.
+ */
+
+#ifndef __INCLUDE_GUARD__SIM_LIBPIC30_H__
+#define	__INCLUDE_GUARD__SIM_LIBPIC30_H__
+
+#include <stdint.h>
+
+void sim_advance_cycles(uint64_t cycles);
+
+#define __delay32(cycles) sim_advance_cycles((uint64_t) (cycles))
+
+// like XC16, these need FCY defined before the include
+#define __delay_ms(d) __delay32((uint64_t) (((uint64_t) (d)) * (FCY) / 1000ULL))
+#define __delay_us(d) __delay32((uint64_t) (((uint64_t) (d)) * (FCY) / 1000000ULL))
+
+#endif	/* __INCLUDE_GUARD__SIM_LIBPIC30_H__ */
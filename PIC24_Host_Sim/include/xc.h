@@ -0,0 +1,849 @@
+/*
+ * File:   xc.h
+ *
+ * Host-build stand-in for the XC16 device header (PIC24F16KA102).
+ *
+ * Every SFR name expands to an lvalue in the simulator's register file,
+ * reached through sim_access(), so each access moves virtual time forward
+ * and gives the peripheral models a chance to react (see sim.h).
+ * Bit positions follow the PIC24F16KA102 datasheet for the registers the
+ * projects in this repo use.
+ */
+
+#ifndef __INCLUDE_GUARD__SIM_XC_H__
+#define	__INCLUDE_GUARD__SIM_XC_H__
+
+#include <stdint.h>
+
+#ifdef	__cplusplus
+extern "C" {
+#endif
+
+#define __PIC24F16KA102__ 1
+#define SIM_HOST_BUILD 1
+
+// register IDs, an index into sim_regs[]
+typedef enum {
+    SIM_REG_SR,
+    SIM_REG_OSCCON,
+    SIM_REG_CLKDIV,
+    SIM_REG_REFOCON,
+    SIM_REG_TRISA,
+    SIM_REG_PORTA,
+    SIM_REG_LATA,
+    SIM_REG_TRISB,
+    SIM_REG_PORTB,
+    SIM_REG_LATB,
+    SIM_REG_CNEN1,
+    SIM_REG_CNEN2,
+    SIM_REG_CNPU1,
+    SIM_REG_CNPU2,
+    SIM_REG_IFS0,
+    SIM_REG_IFS1,
+    SIM_REG_IEC0,
+    SIM_REG_IEC1,
+    SIM_REG_IPC0,
+    SIM_REG_IPC1,
+    SIM_REG_IPC2,
+    SIM_REG_IPC3,
+    SIM_REG_IPC4,
+    SIM_REG_IPC5,
+    SIM_REG_IPC7,
+    SIM_REG_T1CON,
+    SIM_REG_TMR1,
+    SIM_REG_PR1,
+    SIM_REG_T2CON,
+    SIM_REG_T3CON,
+    SIM_REG_TMR2,
+    SIM_REG_TMR3HLD,
+    SIM_REG_TMR3,
+    SIM_REG_PR2,
+    SIM_REG_PR3,
+    SIM_REG_U2MODE,
+    SIM_REG_U2STA,
+    SIM_REG_U2TXREG,
+    SIM_REG_U2RXREG,
+    SIM_REG_U2BRG,
+    SIM_REG_AD1CON1,
+    SIM_REG_AD1CON2,
+    SIM_REG_AD1CON3,
+    SIM_REG_AD1CHS,
+    SIM_REG_AD1PCFG,
+    SIM_REG_AD1CSSL,
+    SIM_REG_ADC1BUF0,
+    SIM_REG_CTMUCON,
+    SIM_REG_CTMUICON,
+    SIM_REG_CVRCON,
+    SIM_REG_CM1CON,
+    SIM_REG_CM2CON,
+    SIM_REG_CMSTAT,
+    SIM_REG_NVMCON,
+    SIM_REG_TBLPAG,
+    SIM_REG_DISICNT,
+    SIM_REG_SPLIM,
+    SIM_REG_WREG15,
+    SIM_REG_COUNT
+} sim_reg_t;
+
+#define SIM_REG_NAMES { \
+    "SR", \
+    "OSCCON", \
+    "CLKDIV", \
+    "REFOCON", \
+    "TRISA", \
+    "PORTA", \
+    "LATA", \
+    "TRISB", \
+    "PORTB", \
+    "LATB", \
+    "CNEN1", \
+    "CNEN2", \
+    "CNPU1", \
+    "CNPU2", \
+    "IFS0", \
+    "IFS1", \
+    "IEC0", \
+    "IEC1", \
+    "IPC0", \
+    "IPC1", \
+    "IPC2", \
+    "IPC3", \
+    "IPC4", \
+    "IPC5", \
+    "IPC7", \
+    "T1CON", \
+    "TMR1", \
+    "PR1", \
+    "T2CON", \
+    "T3CON", \
+    "TMR2", \
+    "TMR3HLD", \
+    "TMR3", \
+    "PR2", \
+    "PR3", \
+    "U2MODE", \
+    "U2STA", \
+    "U2TXREG", \
+    "U2RXREG", \
+    "U2BRG", \
+    "AD1CON1", \
+    "AD1CON2", \
+    "AD1CON3", \
+    "AD1CHS", \
+    "AD1PCFG", \
+    "AD1CSSL", \
+    "ADC1BUF0", \
+    "CTMUCON", \
+    "CTMUICON", \
+    "CVRCON", \
+    "CM1CON", \
+    "CM2CON", \
+    "CMSTAT", \
+    "NVMCON", \
+    "TBLPAG", \
+    "DISICNT", \
+    "SPLIM", \
+    "WREG15", \
+}
+
+typedef struct {
+    unsigned C:1;
+    unsigned Z:1;
+    unsigned OV:1;
+    unsigned N:1;
+    unsigned RA:1;
+    unsigned IPL:3;
+    unsigned DC:1;
+} SRBITS;
+
+typedef struct {
+    unsigned OSWEN:1;
+    unsigned SOSCEN:1;
+    unsigned POSCEN:1;
+    unsigned CF:1;
+    unsigned :1;
+    unsigned LOCK:1;
+    unsigned :1;
+    unsigned CLKLOCK:1;
+    unsigned NOSC:3;
+    unsigned :1;
+    unsigned COSC:3;
+} OSCCONBITS;
+
+typedef struct {
+    unsigned :8;
+    unsigned RCDIV:3;
+    unsigned DOZEN:1;
+    unsigned DOZE:3;
+    unsigned ROI:1;
+} CLKDIVBITS;
+
+typedef struct {
+    unsigned :8;
+    unsigned RODIV:4;
+    unsigned ROSEL:1;
+    unsigned ROSSLP:1;
+    unsigned :1;
+    unsigned ROEN:1;
+} REFOCONBITS;
+
+typedef struct {
+    unsigned TRISA0:1;
+    unsigned TRISA1:1;
+    unsigned TRISA2:1;
+    unsigned TRISA3:1;
+    unsigned TRISA4:1;
+    unsigned TRISA5:1;
+    unsigned TRISA6:1;
+    unsigned TRISA7:1;
+} TRISABITS;
+
+typedef struct {
+    unsigned RA0:1;
+    unsigned RA1:1;
+    unsigned RA2:1;
+    unsigned RA3:1;
+    unsigned RA4:1;
+    unsigned RA5:1;
+    unsigned RA6:1;
+    unsigned RA7:1;
+} PORTABITS;
+
+typedef struct {
+    unsigned LATA0:1;
+    unsigned LATA1:1;
+    unsigned LATA2:1;
+    unsigned LATA3:1;
+    unsigned LATA4:1;
+    unsigned LATA5:1;
+    unsigned LATA6:1;
+    unsigned LATA7:1;
+} LATABITS;
+
+typedef struct {
+    unsigned TRISB0:1;
+    unsigned TRISB1:1;
+    unsigned TRISB2:1;
+    unsigned TRISB3:1;
+    unsigned TRISB4:1;
+    unsigned TRISB5:1;
+    unsigned TRISB6:1;
+    unsigned TRISB7:1;
+    unsigned TRISB8:1;
+    unsigned TRISB9:1;
+    unsigned TRISB10:1;
+    unsigned TRISB11:1;
+    unsigned TRISB12:1;
+    unsigned TRISB13:1;
+    unsigned TRISB14:1;
+    unsigned TRISB15:1;
+} TRISBBITS;
+
+typedef struct {
+    unsigned RB0:1;
+    unsigned RB1:1;
+    unsigned RB2:1;
+    unsigned RB3:1;
+    unsigned RB4:1;
+    unsigned RB5:1;
+    unsigned RB6:1;
+    unsigned RB7:1;
+    unsigned RB8:1;
+    unsigned RB9:1;
+    unsigned RB10:1;
+    unsigned RB11:1;
+    unsigned RB12:1;
+    unsigned RB13:1;
+    unsigned RB14:1;
+    unsigned RB15:1;
+} PORTBBITS;
+
+typedef struct {
+    unsigned LATB0:1;
+    unsigned LATB1:1;
+    unsigned LATB2:1;
+    unsigned LATB3:1;
+    unsigned LATB4:1;
+    unsigned LATB5:1;
+    unsigned LATB6:1;
+    unsigned LATB7:1;
+    unsigned LATB8:1;
+    unsigned LATB9:1;
+    unsigned LATB10:1;
+    unsigned LATB11:1;
+    unsigned LATB12:1;
+    unsigned LATB13:1;
+    unsigned LATB14:1;
+    unsigned LATB15:1;
+} LATBBITS;
+
+typedef struct {
+    unsigned CN0IE:1;
+    unsigned CN1IE:1;
+    unsigned CN2IE:1;
+    unsigned CN3IE:1;
+    unsigned CN4IE:1;
+    unsigned CN5IE:1;
+    unsigned CN6IE:1;
+    unsigned CN7IE:1;
+    unsigned CN8IE:1;
+    unsigned CN9IE:1;
+    unsigned CN10IE:1;
+    unsigned CN11IE:1;
+    unsigned CN12IE:1;
+    unsigned CN13IE:1;
+    unsigned CN14IE:1;
+    unsigned CN15IE:1;
+} CNEN1BITS;
+
+typedef struct {
+    unsigned CN16IE:1;
+    unsigned CN17IE:1;
+    unsigned CN18IE:1;
+    unsigned CN19IE:1;
+    unsigned CN20IE:1;
+    unsigned CN21IE:1;
+    unsigned CN22IE:1;
+    unsigned CN23IE:1;
+    unsigned CN24IE:1;
+    unsigned CN25IE:1;
+    unsigned CN26IE:1;
+    unsigned CN27IE:1;
+    unsigned CN28IE:1;
+    unsigned CN29IE:1;
+    unsigned CN30IE:1;
+} CNEN2BITS;
+
+typedef struct {
+    unsigned CN0PUE:1;
+    unsigned CN1PUE:1;
+    unsigned CN2PUE:1;
+    unsigned CN3PUE:1;
+    unsigned CN4PUE:1;
+    unsigned CN5PUE:1;
+    unsigned CN6PUE:1;
+    unsigned CN7PUE:1;
+    unsigned CN8PUE:1;
+    unsigned CN9PUE:1;
+    unsigned CN10PUE:1;
+    unsigned CN11PUE:1;
+    unsigned CN12PUE:1;
+    unsigned CN13PUE:1;
+    unsigned CN14PUE:1;
+    unsigned CN15PUE:1;
+} CNPU1BITS;
+
+typedef struct {
+    unsigned CN16PUE:1;
+    unsigned CN17PUE:1;
+    unsigned CN18PUE:1;
+    unsigned CN19PUE:1;
+    unsigned CN20PUE:1;
+    unsigned CN21PUE:1;
+    unsigned CN22PUE:1;
+    unsigned CN23PUE:1;
+    unsigned CN24PUE:1;
+    unsigned CN25PUE:1;
+    unsigned CN26PUE:1;
+    unsigned CN27PUE:1;
+    unsigned CN28PUE:1;
+    unsigned CN29PUE:1;
+    unsigned CN30PUE:1;
+} CNPU2BITS;
+
+typedef struct {
+    unsigned INT0IF:1;
+    unsigned IC1IF:1;
+    unsigned OC1IF:1;
+    unsigned T1IF:1;
+    unsigned :1;
+    unsigned IC2IF:1;
+    unsigned OC2IF:1;
+    unsigned T2IF:1;
+    unsigned T3IF:1;
+    unsigned SPF1IF:1;
+    unsigned SPI1IF:1;
+    unsigned U1RXIF:1;
+    unsigned U1TXIF:1;
+    unsigned AD1IF:1;
+    unsigned :1;
+    unsigned NVMIF:1;
+} IFS0BITS;
+
+typedef struct {
+    unsigned SI2C1IF:1;
+    unsigned MI2C1IF:1;
+    unsigned CMIF:1;
+    unsigned CNIF:1;
+    unsigned INT1IF:1;
+    unsigned :8;
+    unsigned INT2IF:1;
+    unsigned U2RXIF:1;
+    unsigned U2TXIF:1;
+} IFS1BITS;
+
+typedef struct {
+    unsigned INT0IE:1;
+    unsigned IC1IE:1;
+    unsigned OC1IE:1;
+    unsigned T1IE:1;
+    unsigned :1;
+    unsigned IC2IE:1;
+    unsigned OC2IE:1;
+    unsigned T2IE:1;
+    unsigned T3IE:1;
+    unsigned SPF1IE:1;
+    unsigned SPI1IE:1;
+    unsigned U1RXIE:1;
+    unsigned U1TXIE:1;
+    unsigned AD1IE:1;
+    unsigned :1;
+    unsigned NVMIE:1;
+} IEC0BITS;
+
+typedef struct {
+    unsigned SI2C1IE:1;
+    unsigned MI2C1IE:1;
+    unsigned CMIE:1;
+    unsigned CNIE:1;
+    unsigned INT1IE:1;
+    unsigned :8;
+    unsigned INT2IE:1;
+    unsigned U2RXIE:1;
+    unsigned U2TXIE:1;
+} IEC1BITS;
+
+typedef struct {
+    unsigned INT0IP:3;
+    unsigned :1;
+    unsigned IC1IP:3;
+    unsigned :1;
+    unsigned OC1IP:3;
+    unsigned :1;
+    unsigned T1IP:3;
+} IPC0BITS;
+
+typedef struct {
+    unsigned :4;
+    unsigned IC2IP:3;
+    unsigned :1;
+    unsigned OC2IP:3;
+    unsigned :1;
+    unsigned T2IP:3;
+} IPC1BITS;
+
+typedef struct {
+    unsigned T3IP:3;
+    unsigned :1;
+    unsigned SPF1IP:3;
+    unsigned :1;
+    unsigned SPI1IP:3;
+    unsigned :1;
+    unsigned U1RXIP:3;
+} IPC2BITS;
+
+typedef struct {
+    unsigned U1TXIP:3;
+    unsigned :1;
+    unsigned AD1IP:3;
+} IPC3BITS;
+
+typedef struct {
+    unsigned SI2C1IP:3;
+    unsigned :1;
+    unsigned MI2C1IP:3;
+    unsigned :1;
+    unsigned CMIP:3;
+    unsigned :1;
+    unsigned CNIP:3;
+} IPC4BITS;
+
+typedef struct {
+    unsigned INT1IP:3;
+} IPC5BITS;
+
+typedef struct {
+    unsigned :8;
+    unsigned U2RXIP:3;
+    unsigned :1;
+    unsigned U2TXIP:3;
+} IPC7BITS;
+
+typedef struct {
+    unsigned :1;
+    unsigned TCS:1;
+    unsigned TSYNC:1;
+    unsigned :1;
+    unsigned TCKPS:2;
+    unsigned TGATE:1;
+    unsigned :6;
+    unsigned TSIDL:1;
+    unsigned :1;
+    unsigned TON:1;
+} T1CONBITS;
+
+typedef struct {
+    unsigned :1;
+    unsigned TCS:1;
+    unsigned :1;
+    unsigned T32:1;
+    unsigned TCKPS:2;
+    unsigned TGATE:1;
+    unsigned :6;
+    unsigned TSIDL:1;
+    unsigned :1;
+    unsigned TON:1;
+} T2CONBITS;
+
+typedef struct {
+    unsigned :1;
+    unsigned TCS:1;
+    unsigned :2;
+    unsigned TCKPS:2;
+    unsigned TGATE:1;
+    unsigned :6;
+    unsigned TSIDL:1;
+    unsigned :1;
+    unsigned TON:1;
+} T3CONBITS;
+
+typedef struct {
+    unsigned STSEL:1;
+    unsigned PDSEL:2;
+    unsigned BRGH:1;
+    unsigned RXINV:1;
+    unsigned ABAUD:1;
+    unsigned LPBACK:1;
+    unsigned WAKE:1;
+    unsigned UEN:2;
+    unsigned :1;
+    unsigned RTSMD:1;
+    unsigned IREN:1;
+    unsigned USIDL:1;
+    unsigned :1;
+    unsigned UARTEN:1;
+} U2MODEBITS;
+
+typedef struct {
+    unsigned URXDA:1;
+    unsigned OERR:1;
+    unsigned FERR:1;
+    unsigned PERR:1;
+    unsigned RIDLE:1;
+    unsigned ADDEN:1;
+    unsigned URXISEL:2;
+    unsigned TRMT:1;
+    unsigned UTXBF:1;
+    unsigned UTXEN:1;
+    unsigned UTXBRK:1;
+    unsigned :1;
+    unsigned UTXISEL0:1;
+    unsigned UTXINV:1;
+    unsigned UTXISEL1:1;
+} U2STABITS;
+
+typedef struct {
+    unsigned DONE:1;
+    unsigned SAMP:1;
+    unsigned ASAM:1;
+    unsigned :2;
+    unsigned SSRC:3;
+    unsigned FORM:2;
+    unsigned :3;
+    unsigned ADSIDL:1;
+    unsigned :1;
+    unsigned ADON:1;
+} AD1CON1BITS;
+
+typedef struct {
+    unsigned ALTS:1;
+    unsigned BUFM:1;
+    unsigned SMPI:4;
+    unsigned :1;
+    unsigned BUFS:1;
+    unsigned :2;
+    unsigned CSCNA:1;
+    unsigned :2;
+    unsigned VCFG:3;
+} AD1CON2BITS;
+
+typedef struct {
+    unsigned ADCS:8;
+    unsigned SAMC:5;
+    unsigned :2;
+    unsigned ADRC:1;
+} AD1CON3BITS;
+
+typedef struct {
+    unsigned CH0SA:4;
+    unsigned :3;
+    unsigned CH0NA:1;
+    unsigned CH0SB:4;
+    unsigned :3;
+    unsigned CH0NB:1;
+} AD1CHSBITS;
+
+typedef struct {
+    unsigned PCFG0:1;
+    unsigned PCFG1:1;
+    unsigned PCFG2:1;
+    unsigned PCFG3:1;
+    unsigned PCFG4:1;
+    unsigned PCFG5:1;
+    unsigned PCFG6:1;
+    unsigned PCFG7:1;
+    unsigned PCFG8:1;
+    unsigned PCFG9:1;
+    unsigned PCFG10:1;
+    unsigned PCFG11:1;
+    unsigned PCFG12:1;
+    unsigned PCFG13:1;
+    unsigned PCFG14:1;
+    unsigned PCFG15:1;
+} AD1PCFGBITS;
+
+typedef struct {
+    unsigned CSSL0:1;
+    unsigned CSSL1:1;
+    unsigned CSSL2:1;
+    unsigned CSSL3:1;
+    unsigned CSSL4:1;
+    unsigned CSSL5:1;
+    unsigned CSSL6:1;
+    unsigned CSSL7:1;
+    unsigned CSSL8:1;
+    unsigned CSSL9:1;
+    unsigned CSSL10:1;
+    unsigned CSSL11:1;
+    unsigned CSSL12:1;
+    unsigned CSSL13:1;
+    unsigned CSSL14:1;
+    unsigned CSSL15:1;
+} AD1CSSLBITS;
+
+typedef struct {
+    unsigned EDG1STAT:1;
+    unsigned EDG2STAT:1;
+    unsigned EDG1SEL:2;
+    unsigned EDG1POL:1;
+    unsigned EDG2SEL:2;
+    unsigned EDG2POL:1;
+    unsigned CTTRIG:1;
+    unsigned IDISSEN:1;
+    unsigned EDGSEQEN:1;
+    unsigned EDGEN:1;
+    unsigned TGEN:1;
+    unsigned CTMUSIDL:1;
+    unsigned :1;
+    unsigned CTMUEN:1;
+} CTMUCONBITS;
+
+typedef struct {
+    unsigned :8;
+    unsigned IRNG:2;
+    unsigned ITRIM:6;
+} CTMUICONBITS;
+
+typedef struct {
+    unsigned CVR:4;
+    unsigned CVRSS:1;
+    unsigned CVRR:1;
+    unsigned CVROE:1;
+    unsigned CVREN:1;
+} CVRCONBITS;
+
+typedef struct {
+    unsigned CCH:2;
+    unsigned :2;
+    unsigned CREF:1;
+    unsigned :1;
+    unsigned EVPOL:2;
+    unsigned COUT:1;
+    unsigned CEVT:1;
+    unsigned :2;
+    unsigned CLPWR:1;
+    unsigned CPOL:1;
+    unsigned COE:1;
+    unsigned CON:1;
+} CM1CONBITS;
+
+typedef struct {
+    unsigned CCH:2;
+    unsigned :2;
+    unsigned CREF:1;
+    unsigned :1;
+    unsigned EVPOL:2;
+    unsigned COUT:1;
+    unsigned CEVT:1;
+    unsigned :2;
+    unsigned CLPWR:1;
+    unsigned CPOL:1;
+    unsigned COE:1;
+    unsigned CON:1;
+} CM2CONBITS;
+
+typedef struct {
+    unsigned C1OUT:1;
+    unsigned C2OUT:1;
+    unsigned :6;
+    unsigned C1EVT:1;
+    unsigned C2EVT:1;
+    unsigned :5;
+    unsigned CMIDL:1;
+} CMSTATBITS;
+
+typedef struct {
+    unsigned NVMOP:6;
+    unsigned ERASE:1;
+    unsigned :5;
+    unsigned PGMONLY:1;
+    unsigned WRERR:1;
+    unsigned WREN:1;
+    unsigned WR:1;
+} NVMCONBITS;
+
+
+#define SR SIM_SFR(SIM_REG_SR)
+#define SRbits SIM_SFR_BITS(SIM_REG_SR, SRBITS)
+#define OSCCON SIM_SFR(SIM_REG_OSCCON)
+#define OSCCONbits SIM_SFR_BITS(SIM_REG_OSCCON, OSCCONBITS)
+#define CLKDIV SIM_SFR(SIM_REG_CLKDIV)
+#define CLKDIVbits SIM_SFR_BITS(SIM_REG_CLKDIV, CLKDIVBITS)
+#define REFOCON SIM_SFR(SIM_REG_REFOCON)
+#define REFOCONbits SIM_SFR_BITS(SIM_REG_REFOCON, REFOCONBITS)
+#define TRISA SIM_SFR_CELL(SIM_REG_TRISA)
+#define TRISAbits SIM_SFR_CELL_BITS(SIM_REG_TRISA, TRISABITS)
+#define PORTA SIM_SFR(SIM_REG_PORTA)
+#define PORTAbits SIM_SFR_BITS(SIM_REG_PORTA, PORTABITS)
+#define LATA SIM_SFR(SIM_REG_LATA)
+#define LATAbits SIM_SFR_BITS(SIM_REG_LATA, LATABITS)
+#define TRISB SIM_SFR_CELL(SIM_REG_TRISB)
+#define TRISBbits SIM_SFR_CELL_BITS(SIM_REG_TRISB, TRISBBITS)
+#define PORTB SIM_SFR(SIM_REG_PORTB)
+#define PORTBbits SIM_SFR_BITS(SIM_REG_PORTB, PORTBBITS)
+#define LATB SIM_SFR(SIM_REG_LATB)
+#define LATBbits SIM_SFR_BITS(SIM_REG_LATB, LATBBITS)
+#define CNEN1 SIM_SFR(SIM_REG_CNEN1)
+#define CNEN1bits SIM_SFR_BITS(SIM_REG_CNEN1, CNEN1BITS)
+#define CNEN2 SIM_SFR(SIM_REG_CNEN2)
+#define CNEN2bits SIM_SFR_BITS(SIM_REG_CNEN2, CNEN2BITS)
+#define CNPU1 SIM_SFR(SIM_REG_CNPU1)
+#define CNPU1bits SIM_SFR_BITS(SIM_REG_CNPU1, CNPU1BITS)
+#define CNPU2 SIM_SFR(SIM_REG_CNPU2)
+#define CNPU2bits SIM_SFR_BITS(SIM_REG_CNPU2, CNPU2BITS)
+#define IFS0 SIM_SFR(SIM_REG_IFS0)
+#define IFS0bits SIM_SFR_BITS(SIM_REG_IFS0, IFS0BITS)
+#define IFS1 SIM_SFR(SIM_REG_IFS1)
+#define IFS1bits SIM_SFR_BITS(SIM_REG_IFS1, IFS1BITS)
+#define IEC0 SIM_SFR(SIM_REG_IEC0)
+#define IEC0bits SIM_SFR_BITS(SIM_REG_IEC0, IEC0BITS)
+#define IEC1 SIM_SFR(SIM_REG_IEC1)
+#define IEC1bits SIM_SFR_BITS(SIM_REG_IEC1, IEC1BITS)
+#define IPC0 SIM_SFR(SIM_REG_IPC0)
+#define IPC0bits SIM_SFR_BITS(SIM_REG_IPC0, IPC0BITS)
+#define IPC1 SIM_SFR(SIM_REG_IPC1)
+#define IPC1bits SIM_SFR_BITS(SIM_REG_IPC1, IPC1BITS)
+#define IPC2 SIM_SFR(SIM_REG_IPC2)
+#define IPC2bits SIM_SFR_BITS(SIM_REG_IPC2, IPC2BITS)
+#define IPC3 SIM_SFR(SIM_REG_IPC3)
+#define IPC3bits SIM_SFR_BITS(SIM_REG_IPC3, IPC3BITS)
+#define IPC4 SIM_SFR(SIM_REG_IPC4)
+#define IPC4bits SIM_SFR_BITS(SIM_REG_IPC4, IPC4BITS)
+#define IPC5 SIM_SFR(SIM_REG_IPC5)
+#define IPC5bits SIM_SFR_BITS(SIM_REG_IPC5, IPC5BITS)
+#define IPC7 SIM_SFR(SIM_REG_IPC7)
+#define IPC7bits SIM_SFR_BITS(SIM_REG_IPC7, IPC7BITS)
+#define T1CON SIM_SFR(SIM_REG_T1CON)
+#define T1CONbits SIM_SFR_BITS(SIM_REG_T1CON, T1CONBITS)
+#define TMR1 SIM_SFR(SIM_REG_TMR1)
+#define PR1 SIM_SFR(SIM_REG_PR1)
+#define T2CON SIM_SFR(SIM_REG_T2CON)
+#define T2CONbits SIM_SFR_BITS(SIM_REG_T2CON, T2CONBITS)
+#define T3CON SIM_SFR(SIM_REG_T3CON)
+#define T3CONbits SIM_SFR_BITS(SIM_REG_T3CON, T3CONBITS)
+#define TMR2 SIM_SFR(SIM_REG_TMR2)
+#define TMR3HLD SIM_SFR(SIM_REG_TMR3HLD)
+#define TMR3 SIM_SFR(SIM_REG_TMR3)
+#define PR2 SIM_SFR(SIM_REG_PR2)
+#define PR3 SIM_SFR(SIM_REG_PR3)
+#define U2MODE SIM_SFR(SIM_REG_U2MODE)
+#define U2MODEbits SIM_SFR_BITS(SIM_REG_U2MODE, U2MODEBITS)
+#define U2STA SIM_SFR(SIM_REG_U2STA)
+#define U2STAbits SIM_SFR_BITS(SIM_REG_U2STA, U2STABITS)
+#define U2TXREG SIM_SFR(SIM_REG_U2TXREG)
+#define U2RXREG SIM_SFR(SIM_REG_U2RXREG)
+#define U2BRG SIM_SFR(SIM_REG_U2BRG)
+#define AD1CON1 SIM_SFR(SIM_REG_AD1CON1)
+#define AD1CON1bits SIM_SFR_BITS(SIM_REG_AD1CON1, AD1CON1BITS)
+#define AD1CON2 SIM_SFR(SIM_REG_AD1CON2)
+#define AD1CON2bits SIM_SFR_BITS(SIM_REG_AD1CON2, AD1CON2BITS)
+#define AD1CON3 SIM_SFR(SIM_REG_AD1CON3)
+#define AD1CON3bits SIM_SFR_BITS(SIM_REG_AD1CON3, AD1CON3BITS)
+#define AD1CHS SIM_SFR(SIM_REG_AD1CHS)
+#define AD1CHSbits SIM_SFR_BITS(SIM_REG_AD1CHS, AD1CHSBITS)
+#define AD1PCFG SIM_SFR(SIM_REG_AD1PCFG)
+#define AD1PCFGbits SIM_SFR_BITS(SIM_REG_AD1PCFG, AD1PCFGBITS)
+#define AD1CSSL SIM_SFR(SIM_REG_AD1CSSL)
+#define AD1CSSLbits SIM_SFR_BITS(SIM_REG_AD1CSSL, AD1CSSLBITS)
+#define ADC1BUF0 SIM_SFR(SIM_REG_ADC1BUF0)
+#define CTMUCON SIM_SFR(SIM_REG_CTMUCON)
+#define CTMUCONbits SIM_SFR_BITS(SIM_REG_CTMUCON, CTMUCONBITS)
+#define CTMUICON SIM_SFR(SIM_REG_CTMUICON)
+#define CTMUICONbits SIM_SFR_BITS(SIM_REG_CTMUICON, CTMUICONBITS)
+#define CVRCON SIM_SFR(SIM_REG_CVRCON)
+#define CVRCONbits SIM_SFR_BITS(SIM_REG_CVRCON, CVRCONBITS)
+#define CM1CON SIM_SFR(SIM_REG_CM1CON)
+#define CM1CONbits SIM_SFR_BITS(SIM_REG_CM1CON, CM1CONBITS)
+#define CM2CON SIM_SFR(SIM_REG_CM2CON)
+#define CM2CONbits SIM_SFR_BITS(SIM_REG_CM2CON, CM2CONBITS)
+#define CMSTAT SIM_SFR(SIM_REG_CMSTAT)
+#define CMSTATbits SIM_SFR_BITS(SIM_REG_CMSTAT, CMSTATBITS)
+#define NVMCON SIM_SFR(SIM_REG_NVMCON)
+#define NVMCONbits SIM_SFR_BITS(SIM_REG_NVMCON, NVMCONBITS)
+#define TBLPAG SIM_SFR(SIM_REG_TBLPAG)
+#define DISICNT SIM_SFR(SIM_REG_DISICNT)
+// the stack pointer and its limit read 0: there is no PIC24 stack to look at
+#define SPLIM SIM_SFR(SIM_REG_SPLIM)
+#define WREG15 SIM_SFR(SIM_REG_WREG15)
+
+volatile unsigned int* sim_access(sim_reg_t reg);
+
+#define SIM_SFR(reg) (*sim_access(reg))
+#define SIM_SFR_BITS(reg, type) (*(volatile type*) sim_access(reg))
+
+// TRIS registers are plain cells instead: firmware keeps &TRISx in const
+// tables, which needs an address constant. Their accesses cost no time.
+extern unsigned int sim_regs[];
+#define SIM_SFR_CELL(reg) (*(volatile unsigned int*) &sim_regs[reg])
+#define SIM_SFR_CELL_BITS(reg, type) (*(volatile type*) &sim_regs[reg])
+
+// compiler builtins used by the projects
+void sim_write_OSCCONH(uint8_t value);
+void sim_write_OSCCONL(uint8_t value);
+void sim_write_NVM(void);
+void sim_disi(uint16_t cycles);
+uint16_t sim_tblrdl(uint16_t offset);
+void sim_tblwtl(uint16_t offset, uint16_t value);
+uint16_t sim_tbloffset(const volatile void* p);
+void sim_idle(void);
+void sim_advance_cycles(uint64_t cycles);
+
+#define __builtin_write_OSCCONH(value) sim_write_OSCCONH(value)
+#define __builtin_write_OSCCONL(value) sim_write_OSCCONL(value)
+#define __builtin_write_NVM() sim_write_NVM()
+#define __builtin_disi(cycles) sim_disi(cycles)
+#define __builtin_tblrdl(offset) sim_tblrdl(offset)
+#define __builtin_tblwtl(offset, value) sim_tblwtl((offset), (value))
+#define __builtin_tblpage(p) ((void) (p), 0x7F) // data EEPROM is at 0x7FFE00
+#define __builtin_tbloffset(p) sim_tbloffset(p)
+
+#define Nop() sim_advance_cycles(1)
+#define ClrWdt() sim_advance_cycles(1)
+#define Idle() sim_idle()
+#define Sleep() sim_idle()
+
+#ifdef	__cplusplus
+}
+#endif
+
+#endif	/* __INCLUDE_GUARD__SIM_XC_H__ */
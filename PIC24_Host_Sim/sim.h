@@ -0,0 +1,88 @@
+/*
+ * File:   sim.h
+ *
+ * Host-side PIC24F16KA102 simulator: shared state of the core (sim_core.c),
+ * the peripheral models (sim_periph.c) and the stimulus player
+ * (sim_stimulus.c).
+ *
+ * Virtual time moves at SFR accesses, firmware function calls, basic blocks,
+ * delays and Idle(). Calls and blocks are charged flat estimates, so cycle
+ * counts are good for comparing builds, not for matching the target exactly.
+ */
+
+#ifndef __INCLUDE_GUARD__SIM_H__
+#define	__INCLUDE_GUARD__SIM_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include "xc.h"
+
+#define SIM_ACCESS_CYCLES (1) // charged per SFR access
+#define SIM_CALL_CYCLES (4) // charged per instrumented function call (call + return)
+#define SIM_ISR_LATENCY_CYCLES (5) // vector fetch, context save/restore
+#define SIM_BUILTIN_CYCLES (2)
+#define SIM_BLOCK_CYCLES (3) // estimate per firmware basic block (XC16 -O0 averages a few instructions)
+#define SIM_BLOCK_FLUSH_CYCLES (64) // block cycles are settled at least this often
+
+#define SIM_PS_PER_S (1000000000000ULL)
+#define SIM_PS_PER_MS (1000000000ULL)
+#define SIM_NEVER (UINT64_MAX)
+
+#define SIM_PORT_A (0)
+#define SIM_PORT_B (1)
+#define SIM_AN_COUNT (16)
+#define SIM_AN_VBG (15) // CH0SA code the firmware uses for the band gap
+
+#define SIM_VBG_MV (1200)
+#define SIM_DEFAULT_VDD_MV (3300)
+#define SIM_DEFAULT_PIN_CAP_PF (10) // pin + trace + ADC sample cap, no load
+
+// raw register file, for the models: no time passes
+extern unsigned int sim_regs[SIM_REG_COUNT];
+#define SIM_R(name) (sim_regs[SIM_REG_##name])
+#define SIM_RB(name) (*(name##BITS*) &sim_regs[SIM_REG_##name])
+
+extern uint64_t sim_now_ps;
+extern uint64_t sim_cycle_ps; // one instruction cycle at the current Fcy
+extern uint32_t sim_vdd_mV;
+extern FILE* sim_uart_out;
+extern uintptr_t sim_stack_low; // lowest host stack address seen in a firmware basic block
+
+// core
+void sim_commit(void);
+void sim_advance_ps(uint64_t duration_ps);
+void sim_clock_changed(void);
+uint64_t sim_cycle_count(void);
+void sim_set_run_limit_ps(uint64_t limit_ps); // SIM_NEVER: run until main() returns
+uint16_t sim_disi_remaining(void);
+void sim_disi_set_remaining(uint16_t cycles); // DISICNT write; 0 ends DISI
+void sim_fatal(const char* msg);
+
+// peripheral models (sim_periph.c)
+void periph_reset(void);
+void periph_step(void);
+uint64_t periph_next_event_ps(void);
+void periph_before_access(sim_reg_t reg);
+void periph_after_write(sim_reg_t reg, unsigned int old_val, unsigned int new_val);
+uint32_t periph_fcy_hz(void);
+void periph_eeprom_load(const char* path);
+void periph_eeprom_save(const char* path);
+uint16_t periph_nvm_read(uint16_t offset);
+void periph_nvm_latch(uint16_t offset, uint16_t value);
+void periph_nvm_start(void);
+
+// test hooks, used by the stimulus player
+void sim_pin_drive(uint8_t port, uint8_t bit, int8_t level); // level -1 = released
+void sim_analog_drive_mV(uint8_t an, int32_t mV); // mV < 0 = released
+void sim_analog_load(uint8_t an, uint32_t cap_pF, uint32_t res_ohms); // res 0 = open
+void sim_uart_rx_inject(const char* data, size_t len);
+void sim_uart_rx_break(void);
+void sim_nvm_power_cut(int32_t after_operations); // the next erase/write is torn, later ones lost; -1 = never
+extern void (*sim_call_hook)(void* fn); // on every firmware function entry, if set (unit tests count calls)
+
+// stimulus player (sim_stimulus.c)
+void stimulus_load(const char* path);
+void stimulus_apply_due(void);
+uint64_t stimulus_next_ps(void);
+
+#endif	/* __INCLUDE_GUARD__SIM_H__ */
@@ -0,0 +1,366 @@
+/*
+ * File:   sim_core.c
+ *
+ * Register file, virtual time, interrupt dispatch and run control.
+ *
+ * Run control is by environment variable, so the firmware's own main() runs
+ * untouched:
+ *   SIM_RUN_MS     virtual time to run before exiting (default 2000)
+ *   SIM_UART_OUT   file for UART2 TX bytes (default stdout)
+ *   SIM_STIMULUS   stimulus script, see sim_stimulus.c
+ *   SIM_EEPROM     data EEPROM image, loaded at start and saved at exit
+ *   SIM_VDD_MV     supply voltage (default 3300)
+ *   SIM_QUIET      set to skip the summary on stderr
+ *   SIM_TRACE      set to log every SFR write the firmware makes to stderr
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sim.h"
+
+unsigned int sim_regs[SIM_REG_COUNT];
+uint64_t sim_now_ps = 0;
+uint64_t sim_cycle_ps = 250000; // 4 MHz Fcy (FRC) out of reset
+uint32_t sim_vdd_mV = SIM_DEFAULT_VDD_MV;
+FILE* sim_uart_out = NULL;
+uintptr_t sim_stack_low = UINTPTR_MAX;
+
+static const char* const sim_reg_names[SIM_REG_COUNT] = SIM_REG_NAMES;
+
+static uint64_t sim_cycles = 0;
+static uint64_t sim_run_limit_ps = 2000ULL * SIM_PS_PER_MS;
+static uint64_t sim_disi_until_ps = 0;
+static const char* sim_eeprom_path = NULL;
+static int sim_quiet = 0;
+static int sim_trace = 0;
+static uint64_t sim_isr_count = 0;
+static uint32_t sim_block_cycles = 0; // charged, but not yet advanced
+static struct timespec sim_host_start;
+
+// the access in flight: its write lands when the next access comes in
+static int sim_pending_reg = -1;
+static unsigned int sim_pending_old_val = 0;
+
+// ISRs the firmware may define; weak, so missing ones are NULL
+#define SIM_ISR(name) extern void name(void) __attribute__((weak));
+SIM_ISR(_T1Interrupt)
+SIM_ISR(_T2Interrupt)
+SIM_ISR(_T3Interrupt)
+SIM_ISR(_ADC1Interrupt)
+SIM_ISR(_NVMInterrupt)
+SIM_ISR(_CompInterrupt)
+SIM_ISR(_CNInterrupt)
+SIM_ISR(_U2RXInterrupt)
+SIM_ISR(_U2TXInterrupt)
+
+typedef struct {
+    const char* name;
+    void (*handler)(void);
+    sim_reg_t ifs; // IFSx/IECx share the bit position
+    sim_reg_t iec;
+    uint8_t bit;
+    sim_reg_t ipc;
+    uint8_t ipc_shift;
+} sim_vector_t;
+
+// in natural (vector number) order, which breaks priority ties
+#define SIM_VECTOR_COUNT (9)
+static sim_vector_t sim_vectors[SIM_VECTOR_COUNT];
+
+static void sim_init_vectors(void) {
+    const sim_vector_t vectors[SIM_VECTOR_COUNT] = {
+        {"T1", _T1Interrupt, SIM_REG_IFS0, SIM_REG_IEC0, 3, SIM_REG_IPC0, 12},
+        {"T2", _T2Interrupt, SIM_REG_IFS0, SIM_REG_IEC0, 7, SIM_REG_IPC1, 12},
+        {"T3", _T3Interrupt, SIM_REG_IFS0, SIM_REG_IEC0, 8, SIM_REG_IPC2, 0},
+        {"ADC1", _ADC1Interrupt, SIM_REG_IFS0, SIM_REG_IEC0, 13, SIM_REG_IPC3, 4},
+        {"NVM", _NVMInterrupt, SIM_REG_IFS0, SIM_REG_IEC0, 15, SIM_REG_IPC3, 12},
+        {"Comp", _CompInterrupt, SIM_REG_IFS1, SIM_REG_IEC1, 2, SIM_REG_IPC4, 8},
+        {"CN", _CNInterrupt, SIM_REG_IFS1, SIM_REG_IEC1, 3, SIM_REG_IPC4, 12},
+        {"U2RX", _U2RXInterrupt, SIM_REG_IFS1, SIM_REG_IEC1, 14, SIM_REG_IPC7, 8},
+        {"U2TX", _U2TXInterrupt, SIM_REG_IFS1, SIM_REG_IEC1, 15, SIM_REG_IPC7, 12},
+    };
+    memcpy(sim_vectors, vectors, sizeof(vectors));
+}
+
+uint64_t sim_cycle_count(void) {
+    return sim_cycles;
+}
+
+void sim_set_run_limit_ps(uint64_t limit_ps) {
+    sim_run_limit_ps = limit_ps;
+}
+
+void sim_fatal(const char* msg) {
+    fprintf(stderr, "sim: %s (at %.3f ms)\n", msg, (double) sim_now_ps / SIM_PS_PER_MS);
+    exit(3);
+}
+
+static void sim_finish(void) {
+    fflush(sim_uart_out);
+    if (sim_eeprom_path != NULL) {
+        periph_eeprom_save(sim_eeprom_path);
+    }
+    if (!sim_quiet) {
+        struct timespec host_end;
+        clock_gettime(CLOCK_MONOTONIC, &host_end);
+        const double host_s = (host_end.tv_sec - sim_host_start.tv_sec)
+                + (host_end.tv_nsec - sim_host_start.tv_nsec) / 1e9;
+        const double virtual_s = (double) sim_now_ps / SIM_PS_PER_S;
+        fprintf(stderr, "sim: stopped at %.3f ms virtual, %llu cycles, %.3f s host (%.0fx real time)\n",
+                virtual_s * 1000.0, (unsigned long long) sim_cycles, host_s,
+                (host_s > 0) ? (virtual_s / host_s) : 0.0);
+    }
+}
+
+void sim_clock_changed(void) {
+    sim_cycle_ps = SIM_PS_PER_S / periph_fcy_hz();
+}
+
+// Lands the write (if any) of the access in flight
+void sim_commit(void) {
+    if (sim_pending_reg < 0) {
+        return;
+    }
+    const sim_reg_t reg = (sim_reg_t) sim_pending_reg;
+    sim_pending_reg = -1;
+    if (sim_trace && (sim_regs[reg] != sim_pending_old_val)) {
+        fprintf(stderr, "sim: %12.3f us %-8s %04X -> %04X\n", (double) sim_now_ps / 1e6,
+                sim_reg_names[reg], sim_pending_old_val & 0xFFFF, sim_regs[reg] & 0xFFFF);
+    }
+    periph_after_write(reg, sim_pending_old_val, sim_regs[reg]);
+}
+
+static uint8_t sim_cpu_ipl(void) {
+    return SIM_RB(SR).IPL;
+}
+
+static uint8_t sim_vector_priority(const sim_vector_t* v) {
+    return (sim_regs[v->ipc] >> v->ipc_shift) & 0b111;
+}
+
+static void sim_dispatch_interrupts(void) {
+    for (;;) {
+        const sim_vector_t* best = NULL;
+        uint8_t best_priority = sim_cpu_ipl();
+        for (uint8_t i = 0; i < SIM_VECTOR_COUNT; i++) {
+            const sim_vector_t* v = &sim_vectors[i];
+            const unsigned int mask = 1U << v->bit;
+            if (!(sim_regs[v->ifs] & mask) || !(sim_regs[v->iec] & mask)) {
+                continue;
+            }
+            const uint8_t priority = sim_vector_priority(v);
+            if ((priority < 7) && (sim_now_ps < sim_disi_until_ps)) {
+                continue; // DISI holds off levels 1-6
+            }
+            if (priority > best_priority) {
+                best = v;
+                best_priority = priority;
+            }
+        }
+        if (best == NULL) {
+            return;
+        }
+        if (best->handler == NULL) {
+            // the device would take _DefaultInterrupt and reset
+            char msg[80];
+            snprintf(msg, sizeof(msg), "interrupt %s enabled and raised, but no ISR", best->name);
+            sim_fatal(msg);
+        }
+
+        const uint8_t saved_ipl = sim_cpu_ipl();
+        SIM_RB(SR).IPL = best_priority;
+        sim_cycles += SIM_ISR_LATENCY_CYCLES;
+        sim_now_ps += SIM_ISR_LATENCY_CYCLES * sim_cycle_ps;
+        sim_isr_count++;
+        best->handler();
+        sim_commit();
+        SIM_RB(SR).IPL = saved_ipl;
+    }
+}
+
+// Runs the peripherals (and any ISRs they raise) up to now + duration_ps,
+// stopping at every peripheral event on the way
+void sim_advance_ps(uint64_t duration_ps) {
+    sim_commit();
+    duration_ps += sim_block_cycles * sim_cycle_ps;
+    sim_block_cycles = 0;
+    const uint64_t target_ps = sim_now_ps + duration_ps;
+    for (;;) {
+        periph_step();
+        sim_dispatch_interrupts();
+        if (sim_now_ps >= sim_run_limit_ps) {
+            exit(0); // sim_finish() runs from atexit()
+        }
+        if (sim_now_ps >= target_ps) {
+            return;
+        }
+
+        uint64_t next_ps = periph_next_event_ps();
+        if ((next_ps <= sim_now_ps) || (next_ps > target_ps)) {
+            next_ps = target_ps;
+        }
+        if (next_ps > sim_run_limit_ps) {
+            next_ps = sim_run_limit_ps;
+        }
+        sim_cycles += (next_ps - sim_now_ps) / sim_cycle_ps;
+        sim_now_ps = next_ps;
+    }
+}
+
+void sim_advance_cycles(uint64_t cycles) {
+    sim_advance_ps(cycles * sim_cycle_ps);
+}
+
+volatile unsigned int* sim_access(sim_reg_t reg) {
+    sim_advance_ps(SIM_ACCESS_CYCLES * sim_cycle_ps); // commits the last access first
+    periph_before_access(reg);
+    sim_pending_reg = reg;
+    sim_pending_old_val = sim_regs[reg];
+    return &sim_regs[reg];
+}
+
+// Idle(): sleep until some interrupt is taken
+void sim_idle(void) {
+    const uint64_t isr_count_before = sim_isr_count;
+    sim_advance_ps(0); // anything already pending
+    while (sim_isr_count == isr_count_before) {
+        const uint64_t next_ps = periph_next_event_ps();
+        if (next_ps == SIM_NEVER) {
+            sim_fatal("Idle() with no peripheral event left to wake it");
+        }
+        sim_advance_ps((next_ps > sim_now_ps) ? (next_ps - sim_now_ps) : 0);
+    }
+}
+
+// builtins
+
+void sim_write_OSCCONH(uint8_t value) {
+    sim_advance_cycles(SIM_BUILTIN_CYCLES);
+    SIM_RB(OSCCON).NOSC = value & 0b111;
+}
+
+void sim_write_OSCCONL(uint8_t value) {
+    sim_advance_cycles(SIM_BUILTIN_CYCLES);
+    const unsigned int old_val = SIM_R(OSCCON);
+    SIM_R(OSCCON) = (old_val & 0xFF00) | value;
+    periph_after_write(SIM_REG_OSCCON, old_val, SIM_R(OSCCON));
+}
+
+void sim_write_NVM(void) {
+    sim_advance_cycles(SIM_BUILTIN_CYCLES);
+    periph_nvm_start();
+}
+
+void sim_disi(uint16_t cycles) {
+    sim_advance_cycles(1);
+    sim_disi_until_ps = sim_now_ps + (((uint64_t) cycles) + 1) * sim_cycle_ps;
+}
+
+uint16_t sim_disi_remaining(void) {
+    if (sim_now_ps >= sim_disi_until_ps) {
+        return 0;
+    }
+    return (uint16_t) ((sim_disi_until_ps - sim_now_ps) / sim_cycle_ps);
+}
+
+void sim_disi_set_remaining(uint16_t cycles) {
+    sim_disi_until_ps = sim_now_ps + ((uint64_t) cycles) * sim_cycle_ps;
+}
+
+uint16_t sim_tblrdl(uint16_t offset) {
+    sim_advance_cycles(SIM_BUILTIN_CYCLES);
+    return periph_nvm_read(offset);
+}
+
+void sim_tblwtl(uint16_t offset, uint16_t value) {
+    sim_advance_cycles(SIM_BUILTIN_CYCLES);
+    periph_nvm_latch(offset, value);
+}
+
+// The only table-addressed object in these projects is the data EEPROM
+// array, which the linker puts at the start of data EEPROM
+uint16_t sim_tbloffset(const volatile void* p) {
+    (void) p;
+    return 0xFE00;
+}
+
+// -finstrument-functions: each firmware call costs cycles and is a point
+// where interrupts can be taken
+
+void __cyg_profile_func_enter(void* fn, void* call_site) __attribute__((no_instrument_function));
+void __cyg_profile_func_exit(void* fn, void* call_site) __attribute__((no_instrument_function));
+
+void (*sim_call_hook)(void* fn) = NULL;
+
+void __cyg_profile_func_enter(void* fn, void* call_site) {
+    (void) call_site;
+    sim_advance_cycles(SIM_CALL_CYCLES);
+    if (sim_call_hook != NULL) {
+        sim_call_hook(fn);
+    }
+}
+
+void __cyg_profile_func_exit(void* fn, void* call_site) {
+    (void) fn;
+    (void) call_site;
+}
+
+// -fsanitize-coverage=trace-pc: called on every firmware basic block, which
+// also lets ISRs in on RAM-only polling loops with no calls in them
+void __sanitizer_cov_trace_pc(void) __attribute__((no_instrument_function));
+
+void __sanitizer_cov_trace_pc(void) {
+    // this frame sits just below the firmware function's whole frame
+    const uintptr_t sp = (uintptr_t) __builtin_frame_address(0);
+    if (sp < sim_stack_low) {
+        sim_stack_low = sp;
+    }
+    sim_block_cycles += SIM_BLOCK_CYCLES;
+    if (sim_block_cycles >= SIM_BLOCK_FLUSH_CYCLES) {
+        sim_advance_ps(0);
+    }
+}
+
+static void sim_init(void) __attribute__((constructor));
+
+static void sim_init(void) {
+    clock_gettime(CLOCK_MONOTONIC, &sim_host_start);
+    sim_init_vectors();
+
+    const char* run_ms = getenv("SIM_RUN_MS");
+    if (run_ms != NULL) {
+        sim_run_limit_ps = (uint64_t) (strtod(run_ms, NULL) * SIM_PS_PER_MS);
+    }
+    const char* vdd_mV = getenv("SIM_VDD_MV");
+    if (vdd_mV != NULL) {
+        sim_vdd_mV = (uint32_t) strtoul(vdd_mV, NULL, 10);
+    }
+    sim_quiet = (getenv("SIM_QUIET") != NULL);
+    sim_trace = (getenv("SIM_TRACE") != NULL);
+
+    sim_uart_out = stdout;
+    const char* uart_out = getenv("SIM_UART_OUT");
+    if (uart_out != NULL) {
+        sim_uart_out = fopen(uart_out, "wb");
+        if (sim_uart_out == NULL) {
+            perror(uart_out);
+            exit(2);
+        }
+    }
+
+    periph_reset();
+    sim_clock_changed();
+
+    sim_eeprom_path = getenv("SIM_EEPROM");
+    if (sim_eeprom_path != NULL) {
+        periph_eeprom_load(sim_eeprom_path);
+    }
+    const char* stimulus = getenv("SIM_STIMULUS");
+    if (stimulus != NULL) {
+        stimulus_load(stimulus);
+    }
+
+    atexit(sim_finish);
+}
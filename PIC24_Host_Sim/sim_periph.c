@@ -0,0 +1,922 @@
+/*
+ * File:   sim_periph.c
+ *
+ * Behavioural models of the PIC24F16KA102 peripherals the projects use:
+ * clock switch, GPIO + change notification, Timer1/2/3, UART2, 10-bit ADC,
+ * CTMU, CVREF + comparators, and the data EEPROM (NVM).
+ *
+ * The models are event driven: periph_step() brings everything up to
+ * sim_now_ps, and periph_next_event_ps() tells the core how far it can jump
+ * before something has to happen (a timer match, a UART character, ...).
+ * Analog pins are RC nodes that the CTMU charges and pins/loads discharge,
+ * integrated exactly between steps.
+ */
+
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+#define SIM_LPRC_HZ (31000UL)
+#define SIM_FRC_HZ (8000000UL)
+#define SIM_LPFRC_HZ (500000UL)
+
+#define SIM_UART_FIFO_LEN (4)
+#define SIM_UART_RX_QUEUE_LEN (4096)
+#define SIM_ADC_SAMPLE_CAP_F (4.4e-12)
+#define SIM_ADC_CONVERSION_TAD (12)
+#define SIM_ADC_RC_TAD_PS (250000ULL) // ADRC = 1
+#define SIM_NVM_WRITE_PS (4ULL * SIM_PS_PER_MS)
+#define SIM_EEPROM_WORDS (256)
+#define SIM_EEPROM_OFFSET (0xFE00)
+
+static uint64_t periph_last_ps = 0;
+
+// ---- clock ----
+
+uint32_t periph_fcy_hz(void) {
+    uint32_t fosc_hz;
+    switch (SIM_RB(OSCCON).COSC) {
+        case 0b000: fosc_hz = SIM_FRC_HZ; break; // FRC
+        case 0b001: fosc_hz = SIM_FRC_HZ * 4; break; // FRC + PLL
+        case 0b101: fosc_hz = SIM_LPRC_HZ; break; // LPRC
+        case 0b110: fosc_hz = SIM_LPFRC_HZ; break; // 500 kHz LPFRC
+        case 0b111: fosc_hz = SIM_FRC_HZ >> SIM_RB(CLKDIV).RCDIV; break; // FRCDIV
+        default: fosc_hz = SIM_FRC_HZ; break; // no crystal modelled
+    }
+    return fosc_hz / 2;
+}
+
+static void clock_step(void) {
+    if (SIM_RB(OSCCON).OSWEN) {
+        SIM_RB(OSCCON).COSC = SIM_RB(OSCCON).NOSC;
+        SIM_RB(OSCCON).OSWEN = 0;
+        sim_clock_changed();
+    }
+}
+
+// ---- GPIO and change notification ----
+
+typedef struct {
+    uint8_t port;
+    uint8_t bit;
+} sim_pin_t;
+
+#define SIM_NO_PIN {0xFF, 0xFF}
+
+// analog input ANx -> pin (28-pin package)
+static const sim_pin_t an_pins[SIM_AN_COUNT] = {
+    {SIM_PORT_A, 0}, {SIM_PORT_A, 1}, {SIM_PORT_B, 0}, {SIM_PORT_B, 1},
+    {SIM_PORT_B, 2}, {SIM_PORT_B, 3}, SIM_NO_PIN, SIM_NO_PIN,
+    SIM_NO_PIN, {SIM_PORT_B, 15}, {SIM_PORT_B, 14}, {SIM_PORT_B, 13},
+    {SIM_PORT_B, 12}, SIM_NO_PIN, SIM_NO_PIN, SIM_NO_PIN,
+};
+
+typedef struct {
+    uint8_t cn;
+    sim_pin_t pin;
+} sim_cn_pin_t;
+
+static const sim_cn_pin_t cn_pins[] = {
+    {0, {SIM_PORT_A, 4}}, {1, {SIM_PORT_B, 4}}, {2, {SIM_PORT_A, 0}}, {3, {SIM_PORT_A, 1}},
+    {4, {SIM_PORT_B, 0}}, {5, {SIM_PORT_B, 1}}, {6, {SIM_PORT_B, 2}}, {7, {SIM_PORT_B, 3}},
+    {11, {SIM_PORT_B, 15}}, {12, {SIM_PORT_B, 14}}, {13, {SIM_PORT_B, 13}}, {14, {SIM_PORT_B, 12}},
+    {15, {SIM_PORT_B, 11}}, {16, {SIM_PORT_B, 10}}, {21, {SIM_PORT_B, 9}}, {22, {SIM_PORT_B, 8}},
+    {23, {SIM_PORT_B, 7}}, {24, {SIM_PORT_B, 6}}, {27, {SIM_PORT_B, 5}}, {29, {SIM_PORT_A, 3}},
+    {30, {SIM_PORT_A, 2}},
+};
+#define SIM_CN_PIN_COUNT (sizeof(cn_pins) / sizeof(cn_pins[0]))
+
+static int8_t pin_external[2][16]; // -1 = not driven from outside
+static int8_t pin_an_of[2][16]; // -1 = digital only
+static int8_t pin_cn_of[2][16]; // -1 = no CN (and no pull-up)
+static uint16_t cn_last_levels[2];
+
+static void pin_tables_init(void) {
+    memset(pin_an_of, -1, sizeof(pin_an_of));
+    memset(pin_cn_of, -1, sizeof(pin_cn_of));
+    for (uint8_t an = 0; an < SIM_AN_COUNT; an++) {
+        if (an_pins[an].port != 0xFF) {
+            pin_an_of[an_pins[an].port][an_pins[an].bit] = (int8_t) an;
+        }
+    }
+    for (uint8_t i = 0; i < SIM_CN_PIN_COUNT; i++) {
+        pin_cn_of[cn_pins[i].pin.port][cn_pins[i].pin.bit] = (int8_t) cn_pins[i].cn;
+    }
+}
+
+static uint8_t cn_is_bit_set(uint8_t cn, sim_reg_t low_reg, sim_reg_t high_reg) {
+    return (cn < 16) ? ((sim_regs[low_reg] >> cn) & 1) : ((sim_regs[high_reg] >> (cn - 16)) & 1);
+}
+
+static uint8_t pin_pullup(uint8_t port, uint8_t bit) {
+    const int8_t cn = pin_cn_of[port][bit];
+    return (cn >= 0) ? cn_is_bit_set((uint8_t) cn, SIM_REG_CNPU1, SIM_REG_CNPU2) : 0;
+}
+
+static uint16_t port_levels(uint8_t port) {
+    const unsigned int tris = (port == SIM_PORT_A) ? SIM_R(TRISA) : SIM_R(TRISB);
+    const unsigned int lat = (port == SIM_PORT_A) ? SIM_R(LATA) : SIM_R(LATB);
+    uint16_t levels = 0;
+    for (uint8_t bit = 0; bit < 16; bit++) {
+        uint8_t level;
+        const int8_t an = pin_an_of[port][bit];
+        if (!((tris >> bit) & 1)) {
+            level = (lat >> bit) & 1; // output
+        }
+        else if ((an >= 0) && !((SIM_R(AD1PCFG) >> an) & 1)) {
+            level = 0; // analog mode: the digital input reads 0
+        }
+        else if (pin_external[port][bit] >= 0) {
+            level = (uint8_t) pin_external[port][bit];
+        }
+        else {
+            level = pin_pullup(port, bit);
+        }
+        levels |= ((uint16_t) level) << bit;
+    }
+    return levels;
+}
+
+static void cn_step(void) {
+    if ((SIM_R(CNEN1) | SIM_R(CNEN2)) == 0) {
+        return; // levels are re-read when CNENx is written
+    }
+    for (uint8_t port = 0; port < 2; port++) {
+        const uint16_t levels = port_levels(port);
+        const uint16_t changed = levels ^ cn_last_levels[port];
+        cn_last_levels[port] = levels;
+        if (changed == 0) {
+            continue;
+        }
+        for (uint8_t i = 0; i < SIM_CN_PIN_COUNT; i++) {
+            if ((cn_pins[i].pin.port == port) && ((changed >> cn_pins[i].pin.bit) & 1)
+                    && cn_is_bit_set(cn_pins[i].cn, SIM_REG_CNEN1, SIM_REG_CNEN2)) {
+                SIM_RB(IFS1).CNIF = 1;
+            }
+        }
+    }
+}
+
+void sim_pin_drive(uint8_t port, uint8_t bit, int8_t level) {
+    pin_external[port & 1][bit & 0xF] = level;
+}
+
+// ---- analog nodes (pins), CTMU ----
+
+typedef struct {
+    double v;
+    double cap_F;
+    double res_ohms; // to ground; 0 = open
+    double source_v; // < 0: not driven
+} sim_node_t;
+
+static sim_node_t nodes[SIM_AN_COUNT];
+
+void sim_analog_drive_mV(uint8_t an, int32_t mV) {
+    nodes[an % SIM_AN_COUNT].source_v = (mV < 0) ? -1.0 : (mV / 1000.0);
+}
+
+void sim_analog_load(uint8_t an, uint32_t cap_pF, uint32_t res_ohms) {
+    nodes[an % SIM_AN_COUNT].cap_F = (SIM_DEFAULT_PIN_CAP_PF + cap_pF) * 1e-12;
+    nodes[an % SIM_AN_COUNT].res_ohms = res_ohms;
+}
+
+static double vdd_v(void) {
+    return sim_vdd_mV / 1000.0;
+}
+
+static double ctmu_current_A(void) {
+    static const double range_A[4] = {0.0, 0.55e-6, 5.5e-6, 55e-6};
+    const int8_t itrim = (int8_t) (SIM_RB(CTMUICON).ITRIM << 2) >> 2; // 6-bit signed
+    return range_A[SIM_RB(CTMUICON).IRNG] * (1.0 + 0.02 * itrim);
+}
+
+// the CTMU (current source and discharge switch) is wired to the ADC input
+static uint8_t ctmu_on_node(uint8_t an) {
+    return SIM_RB(CTMUCON).CTMUEN && (SIM_RB(AD1CHS).CH0SA == an);
+}
+
+static double node_v(uint8_t an) {
+    if (an == SIM_AN_VBG) {
+        return SIM_VBG_MV / 1000.0;
+    }
+    return nodes[an].v;
+}
+
+static void nodes_step(double dt_s) {
+    for (uint8_t an = 0; an < SIM_AN_COUNT; an++) {
+        sim_node_t* node = &nodes[an];
+        const sim_pin_t pin = an_pins[an];
+        if (pin.port == 0xFF) {
+            continue;
+        }
+        const unsigned int tris = (pin.port == SIM_PORT_A) ? SIM_R(TRISA) : SIM_R(TRISB);
+        const unsigned int lat = (pin.port == SIM_PORT_A) ? SIM_R(LATA) : SIM_R(LATB);
+        if (!((tris >> pin.bit) & 1)) {
+            node->v = ((lat >> pin.bit) & 1) ? vdd_v() : 0.0; // driven by the port
+            continue;
+        }
+        if (node->source_v >= 0) {
+            node->v = node->source_v;
+            continue;
+        }
+        if (ctmu_on_node(an) && SIM_RB(CTMUCON).IDISSEN) {
+            node->v = 0.0;
+            continue;
+        }
+
+        double current_A = 0.0;
+        if (ctmu_on_node(an) && (SIM_RB(CTMUCON).EDG1STAT != SIM_RB(CTMUCON).EDG2STAT)) {
+            current_A = ctmu_current_A();
+        }
+        double cap_F = node->cap_F;
+        if (SIM_RB(AD1CHS).CH0SA == an) {
+            cap_F += SIM_ADC_SAMPLE_CAP_F;
+        }
+        if (node->res_ohms > 0) {
+            const double v_final = current_A * node->res_ohms;
+            node->v = v_final + (node->v - v_final) * exp(-dt_s / (node->res_ohms * cap_F));
+        }
+        else {
+            node->v += current_A * dt_s / cap_F;
+        }
+        if (node->v > vdd_v()) {
+            node->v = vdd_v(); // current source runs out of headroom
+        }
+        if (node->v < 0) {
+            node->v = 0;
+        }
+    }
+}
+
+// ---- ADC ----
+
+typedef enum {
+    ADC_IDLE,
+    ADC_SAMPLING,
+    ADC_CONVERTING,
+} adc_phase_t;
+
+static adc_phase_t adc_phase = ADC_IDLE;
+static uint64_t adc_sample_end_ps = SIM_NEVER; // auto-convert (SSRC = 111) only
+static uint64_t adc_done_ps = SIM_NEVER;
+static double adc_sampled_v = 0;
+
+static uint64_t adc_tad_ps(void) {
+    if (SIM_RB(AD1CON3).ADRC) {
+        return SIM_ADC_RC_TAD_PS;
+    }
+    return (SIM_RB(AD1CON3).ADCS + 1ULL) * sim_cycle_ps;
+}
+
+static void adc_start_sampling(void) {
+    adc_phase = ADC_SAMPLING;
+    SIM_RB(AD1CON1).DONE = 0;
+    SIM_RB(AD1CON1).SAMP = 1;
+    const uint64_t samc = (SIM_RB(AD1CON3).SAMC == 0) ? 1 : SIM_RB(AD1CON3).SAMC;
+    adc_sample_end_ps = sim_now_ps + samc * adc_tad_ps();
+}
+
+static void adc_start_conversion(void) {
+    adc_sampled_v = node_v(SIM_RB(AD1CHS).CH0SA);
+    adc_phase = ADC_CONVERTING;
+    SIM_RB(AD1CON1).SAMP = 0;
+    adc_sample_end_ps = SIM_NEVER;
+    adc_done_ps = sim_now_ps + SIM_ADC_CONVERSION_TAD * adc_tad_ps();
+}
+
+static void adc_step(void) {
+    if (!SIM_RB(AD1CON1).ADON) {
+        adc_phase = ADC_IDLE;
+        return;
+    }
+    if ((adc_phase == ADC_SAMPLING) && (SIM_RB(AD1CON1).SSRC == 0b111) && (sim_now_ps >= adc_sample_end_ps)) {
+        adc_start_conversion();
+    }
+    if ((adc_phase == ADC_CONVERTING) && (sim_now_ps >= adc_done_ps)) {
+        long code = lround(adc_sampled_v / vdd_v() * 1024.0);
+        if (code > 1023) {
+            code = 1023;
+        }
+        if (code < 0) {
+            code = 0;
+        }
+        SIM_R(ADC1BUF0) = (unsigned int) code;
+        SIM_RB(AD1CON1).DONE = 1;
+        SIM_RB(IFS0).AD1IF = 1;
+        adc_phase = ADC_IDLE;
+        adc_done_ps = SIM_NEVER;
+        if (SIM_RB(AD1CON1).ASAM) {
+            adc_start_sampling();
+        }
+    }
+}
+
+static void adc_after_write(unsigned int old_val, unsigned int new_val) {
+    const AD1CON1BITS old_bits = *(AD1CON1BITS*) &old_val;
+    const AD1CON1BITS new_bits = *(AD1CON1BITS*) &new_val;
+    if (!new_bits.ADON) {
+        adc_phase = ADC_IDLE;
+        return;
+    }
+    if ((!old_bits.SAMP || !old_bits.ADON) && new_bits.SAMP) {
+        adc_start_sampling(); // SAMP set, or already set when the ADC comes on
+    }
+    else if (old_bits.SAMP && !new_bits.SAMP && (adc_phase == ADC_SAMPLING)) {
+        if (new_bits.SSRC == 0b000) {
+            adc_start_conversion(); // manual: clearing SAMP converts
+        }
+        else {
+            adc_phase = ADC_IDLE; // sampling abandoned
+        }
+    }
+}
+
+// CTMU edge with CTTRIG: ends sampling when SSRC = 100
+static void adc_ctmu_trigger(void) {
+    if ((adc_phase == ADC_SAMPLING) && SIM_RB(AD1CON1).ADON && (SIM_RB(AD1CON1).SSRC == 0b100)) {
+        adc_start_conversion();
+    }
+}
+
+static void ctmu_timer1_match(void) {
+    if (!SIM_RB(CTMUCON).CTMUEN || !SIM_RB(CTMUCON).EDGEN) {
+        return;
+    }
+    if (SIM_RB(CTMUCON).EDG1SEL == 0b00) {
+        SIM_RB(CTMUCON).EDG1STAT = 1;
+    }
+    if (SIM_RB(CTMUCON).EDG2SEL == 0b00) {
+        SIM_RB(CTMUCON).EDG2STAT = 1;
+        if (SIM_RB(CTMUCON).CTTRIG) {
+            adc_ctmu_trigger();
+        }
+    }
+}
+
+// ---- timers ----
+
+static uint64_t timer_acc_ps[3]; // partial tick carried between steps
+
+static uint64_t timer_tick_ps(uint8_t tckps) {
+    static const uint16_t prescale[4] = {1, 8, 64, 256};
+    return sim_cycle_ps * prescale[tckps & 0b11];
+}
+
+static uint64_t timer_ticks_to_match(uint32_t tmr, uint32_t pr, uint64_t modulus) {
+    return (tmr <= pr) ? ((uint64_t) pr - tmr + 1) : (modulus - tmr + pr + 1);
+}
+
+// Counts `ticks` on a period-match timer; returns 1 if it matched
+static uint8_t timer_count(uint32_t* tmr, uint32_t pr, uint64_t ticks, uint64_t modulus) {
+    const uint64_t to_match = timer_ticks_to_match(*tmr, pr, modulus);
+    if (ticks < to_match) {
+        *tmr = (uint32_t) ((*tmr + ticks) % modulus);
+        return 0;
+    }
+    ticks -= to_match;
+    *tmr = (uint32_t) (ticks % ((uint64_t) pr + 1));
+    return 1;
+}
+
+static uint64_t timer_take_ticks(uint8_t idx, uint8_t tckps, uint64_t dt_ps) {
+    const uint64_t tick_ps = timer_tick_ps(tckps);
+    timer_acc_ps[idx] += dt_ps;
+    const uint64_t ticks = timer_acc_ps[idx] / tick_ps;
+    timer_acc_ps[idx] %= tick_ps;
+    return ticks;
+}
+
+static uint8_t timer32_mode(void) {
+    return SIM_RB(T2CON).T32;
+}
+
+static void timers_step(uint64_t dt_ps) {
+    if (SIM_RB(T1CON).TON) {
+        uint32_t tmr = SIM_R(TMR1) & 0xFFFF;
+        if (timer_count(&tmr, SIM_R(PR1) & 0xFFFF, timer_take_ticks(0, SIM_RB(T1CON).TCKPS, dt_ps), 0x10000)) {
+            SIM_RB(IFS0).T1IF = 1;
+            ctmu_timer1_match();
+        }
+        SIM_R(TMR1) = tmr;
+    }
+
+    if (timer32_mode()) {
+        if (SIM_RB(T2CON).TON) {
+            uint32_t tmr = ((SIM_R(TMR3) & 0xFFFF) << 16) | (SIM_R(TMR2) & 0xFFFF);
+            const uint32_t pr = ((SIM_R(PR3) & 0xFFFF) << 16) | (SIM_R(PR2) & 0xFFFF);
+            if (timer_count(&tmr, pr, timer_take_ticks(1, SIM_RB(T2CON).TCKPS, dt_ps), 0x100000000ULL)) {
+                SIM_RB(IFS0).T3IF = 1;
+            }
+            SIM_R(TMR2) = tmr & 0xFFFF;
+            SIM_R(TMR3) = tmr >> 16;
+        }
+        return;
+    }
+    if (SIM_RB(T2CON).TON) {
+        uint32_t tmr = SIM_R(TMR2) & 0xFFFF;
+        if (timer_count(&tmr, SIM_R(PR2) & 0xFFFF, timer_take_ticks(1, SIM_RB(T2CON).TCKPS, dt_ps), 0x10000)) {
+            SIM_RB(IFS0).T2IF = 1;
+        }
+        SIM_R(TMR2) = tmr;
+    }
+    if (SIM_RB(T3CON).TON) {
+        uint32_t tmr = SIM_R(TMR3) & 0xFFFF;
+        if (timer_count(&tmr, SIM_R(PR3) & 0xFFFF, timer_take_ticks(2, SIM_RB(T3CON).TCKPS, dt_ps), 0x10000)) {
+            SIM_RB(IFS0).T3IF = 1;
+        }
+        SIM_R(TMR3) = tmr;
+    }
+}
+
+static uint64_t timer_next_ps(uint8_t idx, uint8_t tckps, uint32_t tmr, uint32_t pr, uint64_t modulus) {
+    const uint64_t ticks = timer_ticks_to_match(tmr, pr, modulus);
+    return periph_last_ps + ticks * timer_tick_ps(tckps) - timer_acc_ps[idx];
+}
+
+static uint64_t timers_next_ps(void) {
+    uint64_t next_ps = SIM_NEVER;
+    uint64_t t;
+    if (SIM_RB(T1CON).TON) {
+        t = timer_next_ps(0, SIM_RB(T1CON).TCKPS, SIM_R(TMR1) & 0xFFFF, SIM_R(PR1) & 0xFFFF, 0x10000);
+        next_ps = (t < next_ps) ? t : next_ps;
+    }
+    if (timer32_mode()) {
+        if (SIM_RB(T2CON).TON) {
+            const uint32_t tmr = ((SIM_R(TMR3) & 0xFFFF) << 16) | (SIM_R(TMR2) & 0xFFFF);
+            const uint32_t pr = ((SIM_R(PR3) & 0xFFFF) << 16) | (SIM_R(PR2) & 0xFFFF);
+            t = timer_next_ps(1, SIM_RB(T2CON).TCKPS, tmr, pr, 0x100000000ULL);
+            next_ps = (t < next_ps) ? t : next_ps;
+        }
+        return next_ps;
+    }
+    if (SIM_RB(T2CON).TON) {
+        t = timer_next_ps(1, SIM_RB(T2CON).TCKPS, SIM_R(TMR2) & 0xFFFF, SIM_R(PR2) & 0xFFFF, 0x10000);
+        next_ps = (t < next_ps) ? t : next_ps;
+    }
+    if (SIM_RB(T3CON).TON) {
+        t = timer_next_ps(2, SIM_RB(T3CON).TCKPS, SIM_R(TMR3) & 0xFFFF, SIM_R(PR3) & 0xFFFF, 0x10000);
+        next_ps = (t < next_ps) ? t : next_ps;
+    }
+    return next_ps;
+}
+
+// ---- UART2 ----
+
+static uint8_t uart_tx_fifo[SIM_UART_FIFO_LEN];
+static uint8_t uart_tx_count = 0;
+static uint8_t uart_tsr_busy = 0;
+static uint8_t uart_tsr_char = 0;
+static uint64_t uart_tsr_done_ps = SIM_NEVER;
+
+// RX bytes carry their framing error in bit 8 (a break arrives as 0x00 with FERR)
+#define UART_RX_FERR (0x100)
+static uint16_t uart_rx_fifo[SIM_UART_FIFO_LEN];
+static uint8_t uart_rx_count = 0;
+static uint16_t uart_rx_queue[SIM_UART_RX_QUEUE_LEN]; // bytes still "on the wire"
+static size_t uart_rx_queue_head = 0;
+static size_t uart_rx_queue_len = 0;
+static uint64_t uart_rx_next_ps = 0;
+
+static uint64_t uart_char_ps(void) {
+    const uint64_t clocks_per_bit = SIM_RB(U2MODE).BRGH ? 4 : 16;
+    const uint64_t bit_ps = sim_cycle_ps * clocks_per_bit * ((SIM_R(U2BRG) & 0xFFFF) + 1ULL);
+    const uint64_t data_bits = (SIM_RB(U2MODE).PDSEL == 0b11) ? 9 : ((SIM_RB(U2MODE).PDSEL == 0) ? 8 : 9);
+    return bit_ps * (1 + data_bits + (SIM_RB(U2MODE).STSEL ? 2 : 1));
+}
+
+static void uart_update_status(void) {
+    SIM_RB(U2STA).UTXBF = (uart_tx_count == SIM_UART_FIFO_LEN);
+    SIM_RB(U2STA).TRMT = (!uart_tsr_busy) && (uart_tx_count == 0);
+    SIM_RB(U2STA).URXDA = (uart_rx_count > 0);
+    SIM_RB(U2STA).FERR = (uart_rx_count > 0) && (uart_rx_fifo[0] & UART_RX_FERR); // for the char at the top of the FIFO
+    SIM_RB(U2STA).RIDLE = (uart_rx_queue_len == 0);
+}
+
+static uint8_t uart_txisel(void) {
+    return (SIM_RB(U2STA).UTXISEL1 << 1) | SIM_RB(U2STA).UTXISEL0;
+}
+
+static void uart_reset(void) {
+    uart_tx_count = 0;
+    uart_tsr_busy = 0;
+    uart_tsr_done_ps = SIM_NEVER;
+    uart_rx_count = 0;
+    SIM_RB(U2STA).OERR = 0;
+    uart_update_status();
+}
+
+static void uart_step(void) {
+    for (;;) {
+        if (uart_tsr_busy && (sim_now_ps >= uart_tsr_done_ps)) {
+            fputc(uart_tsr_char, sim_uart_out);
+            if (uart_tsr_char == '\n') {
+                fflush(sim_uart_out);
+            }
+            uart_tsr_busy = 0;
+            if ((uart_txisel() == 0b01) && (uart_tx_count == 0)) {
+                SIM_RB(IFS1).U2TXIF = 1; // last character shifted out
+            }
+        }
+        if (uart_tsr_busy || (uart_tx_count == 0)) {
+            break;
+        }
+        // FIFO -> shift register
+        uart_tsr_char = uart_tx_fifo[0];
+        memmove(uart_tx_fifo, uart_tx_fifo + 1, --uart_tx_count);
+        uart_tsr_busy = 1;
+        const uint64_t start_ps = (uart_tsr_done_ps != SIM_NEVER && uart_tsr_done_ps > sim_now_ps - uart_char_ps())
+                ? uart_tsr_done_ps : sim_now_ps;
+        uart_tsr_done_ps = ((start_ps > sim_now_ps) ? start_ps : sim_now_ps) + uart_char_ps();
+        // UTXISEL = 11 is reserved; treated like 00
+        if ((uart_txisel() != 0b01) && ((uart_txisel() != 0b10) || (uart_tx_count == 0))) {
+            SIM_RB(IFS1).U2TXIF = 1;
+        }
+    }
+
+    while ((uart_rx_queue_len > 0) && (sim_now_ps >= uart_rx_next_ps)) {
+        const uint16_t c = uart_rx_queue[uart_rx_queue_head];
+        uart_rx_queue_head = (uart_rx_queue_head + 1) % SIM_UART_RX_QUEUE_LEN;
+        uart_rx_queue_len--;
+        uart_rx_next_ps = sim_now_ps + uart_char_ps();
+        if (!SIM_RB(U2MODE).UARTEN || SIM_RB(U2STA).OERR) {
+            continue; // lost: receiver off, or stopped by an overrun
+        }
+        if (uart_rx_count == SIM_UART_FIFO_LEN) {
+            SIM_RB(U2STA).OERR = 1;
+            continue;
+        }
+        uart_rx_fifo[uart_rx_count++] = c;
+        const uint8_t rxisel = SIM_RB(U2STA).URXISEL;
+        if ((rxisel < 0b10) || ((rxisel == 0b10) && (uart_rx_count >= 3)) || (uart_rx_count == SIM_UART_FIFO_LEN)) {
+            SIM_RB(IFS1).U2RXIF = 1;
+        }
+    }
+    uart_update_status();
+}
+
+static uint64_t uart_next_ps(void) {
+    uint64_t next_ps = uart_tsr_busy ? uart_tsr_done_ps : SIM_NEVER;
+    if ((uart_rx_queue_len > 0) && (uart_rx_next_ps < next_ps)) {
+        next_ps = (uart_rx_next_ps > periph_last_ps) ? uart_rx_next_ps : periph_last_ps + sim_cycle_ps;
+    }
+    return next_ps;
+}
+
+static void uart_rx_queue_push(uint16_t c) {
+    if (uart_rx_queue_len == 0 && uart_rx_next_ps < sim_now_ps) {
+        uart_rx_next_ps = sim_now_ps;
+    }
+    if (uart_rx_queue_len < SIM_UART_RX_QUEUE_LEN) {
+        uart_rx_queue[(uart_rx_queue_head + uart_rx_queue_len) % SIM_UART_RX_QUEUE_LEN] = c;
+        uart_rx_queue_len++;
+    }
+}
+
+void sim_uart_rx_inject(const char* data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        uart_rx_queue_push((uint8_t) data[i]);
+    }
+}
+
+// a character time of line low: 0x00 with a framing error (no stop bit)
+void sim_uart_rx_break(void) {
+    uart_rx_queue_push(UART_RX_FERR);
+}
+
+// ---- CVREF and comparators ----
+
+static double cvref_v(void) {
+    if (!SIM_RB(CVRCON).CVREN) {
+        return 0.0;
+    }
+    const double cvr = SIM_RB(CVRCON).CVR;
+    if (SIM_RB(CVRCON).CVRR) {
+        return cvr / 24.0 * vdd_v();
+    }
+    return (vdd_v() / 4.0) + (cvr / 32.0 * vdd_v());
+}
+
+// modelled on these AN inputs: check the pin table for your package
+static const uint8_t comp_input_an[2][5] = {
+    // CxINA, CxINB, CxINC, CxIND (inverting CCH = 00..10 use B..D)
+    {5, 4, 3, 2}, // RB3, RB2, RB1, RB0
+    {3, 2, 5, 4}, // RB1, RB0, RB3, RB2
+};
+
+static void comparator_step_one(sim_reg_t con_reg, uint8_t idx) {
+    CM1CONBITS* con = (CM1CONBITS*) &sim_regs[con_reg];
+    if (!con->CON) {
+        con->COUT = 0;
+        return;
+    }
+    const double v_plus = con->CREF ? cvref_v() : node_v(comp_input_an[idx][0]);
+    const double v_minus = (con->CCH == 0b11) ? (SIM_VBG_MV / 2000.0) : node_v(comp_input_an[idx][1 + con->CCH]);
+    const uint8_t out = (uint8_t) ((v_plus > v_minus) ^ con->CPOL);
+    if (out == con->COUT) {
+        return;
+    }
+    con->COUT = out;
+    const uint8_t is_event = ((con->EVPOL == 0b11) || ((con->EVPOL == 0b01) && out) || ((con->EVPOL == 0b10) && !out));
+    if (is_event && !con->CEVT) {
+        con->CEVT = 1; // no more events until the firmware clears CEVT
+        SIM_RB(IFS1).CMIF = 1;
+    }
+}
+
+static void comparators_step(void) {
+    comparator_step_one(SIM_REG_CM1CON, 0);
+    comparator_step_one(SIM_REG_CM2CON, 1);
+    SIM_RB(CMSTAT).C1OUT = SIM_RB(CM1CON).COUT;
+    SIM_RB(CMSTAT).C2OUT = SIM_RB(CM2CON).COUT;
+    SIM_RB(CMSTAT).C1EVT = SIM_RB(CM1CON).CEVT;
+    SIM_RB(CMSTAT).C2EVT = SIM_RB(CM2CON).CEVT;
+}
+
+// ---- data EEPROM ----
+
+static uint16_t eeprom[SIM_EEPROM_WORDS];
+static uint16_t nvm_latch_offset = 0;
+static uint16_t nvm_latch_value = 0xFFFF;
+static uint64_t nvm_done_ps = SIM_NEVER;
+static int32_t nvm_ops_until_power_cut = -1; // -1: never
+static uint8_t nvm_power_lost = 0;
+
+static uint16_t eeprom_index(uint16_t offset) {
+    return ((uint16_t) (offset - SIM_EEPROM_OFFSET) >> 1) % SIM_EEPROM_WORDS;
+}
+
+uint16_t periph_nvm_read(uint16_t offset) {
+    return eeprom[eeprom_index(offset)];
+}
+
+void periph_nvm_latch(uint16_t offset, uint16_t value) {
+    nvm_latch_offset = offset;
+    nvm_latch_value = value;
+}
+
+void sim_nvm_power_cut(int32_t after_operations) {
+    nvm_ops_until_power_cut = after_operations;
+    nvm_power_lost = 0;
+}
+
+void periph_nvm_start(void) {
+    if (!SIM_RB(NVMCON).WREN) {
+        return;
+    }
+    const uint16_t idx = eeprom_index(nvm_latch_offset);
+    if (nvm_power_lost) {
+        // nothing reaches the array any more
+    }
+    else if (nvm_ops_until_power_cut == 0) {
+        // cut mid-operation: only half the word's cells changed
+        switch (SIM_R(NVMCON) & 0x7F) {
+            case 0x58: eeprom[idx] |= 0xFF00; break;
+            case 0x04: eeprom[idx] = nvm_latch_value | 0xFF00; break;
+            default: sim_fatal("power cut only modelled for word erase/write");
+        }
+        nvm_power_lost = 1;
+    }
+    else {
+        if (nvm_ops_until_power_cut > 0) {
+            nvm_ops_until_power_cut--;
+        }
+        switch (SIM_R(NVMCON) & 0x7F) { // ERASE + NVMOP
+            case 0x58: eeprom[idx] = 0xFFFF; break; // erase 1 word
+            case 0x59: for (uint16_t i = 0; i < 4; i++) eeprom[(idx & ~3) + i] = 0xFFFF; break;
+            case 0x5A: for (uint16_t i = 0; i < 8; i++) eeprom[(idx & ~7) + i] = 0xFFFF; break;
+            case 0x50: for (uint16_t i = 0; i < SIM_EEPROM_WORDS; i++) eeprom[i] = 0xFFFF; break;
+            case 0x04: eeprom[idx] = nvm_latch_value; break; // write 1 word
+            default: sim_fatal("unsupported NVMCON operation");
+        }
+    }
+    SIM_RB(NVMCON).WR = 1;
+    nvm_done_ps = sim_now_ps + SIM_NVM_WRITE_PS;
+}
+
+static void nvm_step(void) {
+    if (sim_now_ps >= nvm_done_ps) {
+        SIM_RB(NVMCON).WR = 0;
+        SIM_RB(IFS0).NVMIF = 1;
+        nvm_done_ps = SIM_NEVER;
+    }
+}
+
+void periph_eeprom_load(const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (f == NULL) {
+        return; // first run: erased
+    }
+    if (fread(eeprom, sizeof(eeprom), 1, f) != 1) {
+        memset(eeprom, 0xFF, sizeof(eeprom));
+    }
+    fclose(f);
+}
+
+void periph_eeprom_save(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (f == NULL) {
+        perror(path);
+        return;
+    }
+    fwrite(eeprom, sizeof(eeprom), 1, f);
+    fclose(f);
+}
+
+// ---- core interface ----
+
+void periph_reset(void) {
+    memset(sim_regs, 0, sizeof(sim_regs));
+    SIM_R(TRISA) = 0xFFFF;
+    SIM_R(TRISB) = 0xFFFF;
+    SIM_R(PR1) = 0xFFFF;
+    SIM_R(PR2) = 0xFFFF;
+    SIM_R(PR3) = 0xFFFF;
+    SIM_R(IPC0) = 0x4444; // every source at priority 4
+    SIM_R(IPC1) = 0x4444;
+    SIM_R(IPC2) = 0x4444;
+    SIM_R(IPC3) = 0x4444;
+    SIM_R(IPC4) = 0x4444;
+    SIM_R(IPC5) = 0x4444;
+    SIM_R(IPC7) = 0x4444;
+    SIM_R(CLKDIV) = 0x3000;
+    SIM_RB(OSCCON).COSC = 0b000; // FNOSC = FRC in every project
+    SIM_RB(OSCCON).NOSC = 0b000;
+
+    memset(pin_external, -1, sizeof(pin_external));
+    pin_tables_init();
+    for (uint8_t an = 0; an < SIM_AN_COUNT; an++) {
+        nodes[an].v = 0;
+        nodes[an].cap_F = SIM_DEFAULT_PIN_CAP_PF * 1e-12;
+        nodes[an].res_ohms = 0;
+        nodes[an].source_v = -1;
+    }
+    memset(eeprom, 0xFF, sizeof(eeprom));
+    uart_reset();
+    cn_last_levels[SIM_PORT_A] = port_levels(SIM_PORT_A);
+    cn_last_levels[SIM_PORT_B] = port_levels(SIM_PORT_B);
+    periph_last_ps = sim_now_ps;
+}
+
+void periph_step(void) {
+    const uint64_t dt_ps = sim_now_ps - periph_last_ps;
+    periph_last_ps = sim_now_ps;
+
+    stimulus_apply_due();
+    nodes_step(dt_ps / (double) SIM_PS_PER_S);
+    timers_step(dt_ps);
+    adc_step();
+    uart_step();
+    nvm_step();
+    comparators_step();
+    cn_step();
+    clock_step();
+}
+
+uint64_t periph_next_event_ps(void) {
+    uint64_t next_ps = timers_next_ps();
+    uint64_t t = uart_next_ps();
+    next_ps = (t < next_ps) ? t : next_ps;
+    if ((adc_phase == ADC_SAMPLING) && (SIM_RB(AD1CON1).SSRC == 0b111)) {
+        next_ps = (adc_sample_end_ps < next_ps) ? adc_sample_end_ps : next_ps;
+    }
+    if (adc_phase == ADC_CONVERTING) {
+        next_ps = (adc_done_ps < next_ps) ? adc_done_ps : next_ps;
+    }
+    next_ps = (nvm_done_ps < next_ps) ? nvm_done_ps : next_ps;
+    t = stimulus_next_ps();
+    next_ps = (t < next_ps) ? t : next_ps;
+    return next_ps;
+}
+
+// Reads with side effects happen here, before the firmware gets the pointer
+void periph_before_access(sim_reg_t reg) {
+    switch (reg) {
+        case SIM_REG_PORTA:
+            SIM_R(PORTA) = port_levels(SIM_PORT_A);
+            break;
+        case SIM_REG_PORTB:
+            SIM_R(PORTB) = port_levels(SIM_PORT_B);
+            break;
+        case SIM_REG_TMR2:
+            SIM_R(TMR3HLD) = SIM_R(TMR3); // reading TMR2 latches the MSW
+            break;
+        case SIM_REG_U2RXREG:
+            if (uart_rx_count > 0) {
+                SIM_R(U2RXREG) = uart_rx_fifo[0] & 0xFF;
+                memmove(uart_rx_fifo, uart_rx_fifo + 1, --uart_rx_count * sizeof(uart_rx_fifo[0]));
+                uart_update_status();
+            }
+            break;
+        case SIM_REG_U2TXREG:
+            SIM_R(U2TXREG) = 0xFFFF0000; // any write replaces this
+            break;
+        case SIM_REG_DISICNT:
+            SIM_R(DISICNT) = sim_disi_remaining();
+            break;
+        default:
+            break;
+    }
+}
+
+// Writes with side effects, and read-only bits put back
+void periph_after_write(sim_reg_t reg, unsigned int old_val, unsigned int new_val) {
+    switch (reg) {
+        case SIM_REG_PORTA:
+            if (new_val != old_val) {
+                SIM_R(LATA) = new_val; // writing PORT writes LAT
+                SIM_R(PORTA) = old_val;
+            }
+            break;
+        case SIM_REG_PORTB:
+            if (new_val != old_val) {
+                SIM_R(LATB) = new_val;
+                SIM_R(PORTB) = old_val;
+            }
+            break;
+        case SIM_REG_OSCCON:
+            // COSC is read-only; OSWEN completes the switch on the next step
+            SIM_R(OSCCON) = (new_val & ~0x7000U) | (old_val & 0x7000U);
+            break;
+        case SIM_REG_CLKDIV:
+            sim_clock_changed();
+            break;
+        case SIM_REG_CNEN1:
+        case SIM_REG_CNEN2:
+            cn_last_levels[SIM_PORT_A] = port_levels(SIM_PORT_A);
+            cn_last_levels[SIM_PORT_B] = port_levels(SIM_PORT_B);
+            break;
+        case SIM_REG_U2TXREG:
+            if (new_val != 0xFFFF0000) {
+                if (SIM_RB(U2MODE).UARTEN && SIM_RB(U2STA).UTXEN && (uart_tx_count < SIM_UART_FIFO_LEN)) {
+                    uart_tx_fifo[uart_tx_count++] = (uint8_t) new_val;
+                }
+                SIM_R(U2TXREG) = new_val & 0x1FF;
+                uart_update_status();
+            }
+            break;
+        case SIM_REG_U2MODE:
+            if (!(new_val & 0x8000)) {
+                uart_reset(); // UARTEN = 0 flushes both directions
+            }
+            break;
+        case SIM_REG_U2STA: {
+            const U2STABITS old_bits = *(U2STABITS*) &old_val;
+            if (!old_bits.UTXEN && SIM_RB(U2STA).UTXEN) {
+                SIM_RB(IFS1).U2TXIF = 1; // the transmit buffer is empty
+            }
+            if (old_bits.OERR && !SIM_RB(U2STA).OERR) {
+                uart_rx_count = 0; // clearing OERR resets the receive buffer
+            }
+            SIM_RB(U2STA).OERR = old_bits.OERR && SIM_RB(U2STA).OERR; // only clearable
+            uart_update_status();
+            break;
+        }
+        case SIM_REG_U2BRG:
+        case SIM_REG_U2RXREG:
+            break;
+        case SIM_REG_AD1CON1:
+            adc_after_write(old_val, new_val);
+            break;
+        case SIM_REG_CM1CON:
+        case SIM_REG_CM2CON:
+            // COUT is read-only
+            sim_regs[reg] = (new_val & ~0x0100U) | (old_val & 0x0100U);
+            comparators_step();
+            break;
+        case SIM_REG_CMSTAT:
+            sim_regs[reg] = old_val;
+            break;
+        case SIM_REG_ADC1BUF0:
+        case SIM_REG_TMR3HLD:
+        case SIM_REG_SPLIM:
+        case SIM_REG_WREG15:
+            sim_regs[reg] = old_val; // read-only
+            break;
+        case SIM_REG_DISICNT:
+            if (new_val != old_val) {
+                sim_disi_set_remaining((uint16_t) (new_val & 0x3FFF));
+            }
+            break;
+        case SIM_REG_T1CON:
+            if (!(old_val & 0x8000) && (new_val & 0x8000)) {
+                timer_acc_ps[0] = 0;
+            }
+            break;
+        case SIM_REG_T2CON:
+            if (!(old_val & 0x8000) && (new_val & 0x8000)) {
+                timer_acc_ps[1] = 0;
+            }
+            break;
+        case SIM_REG_T3CON:
+            if (!(old_val & 0x8000) && (new_val & 0x8000)) {
+                timer_acc_ps[2] = 0;
+            }
+            break;
+        default:
+            break;
+    }
+    sim_regs[reg] &= 0xFFFF;
+}
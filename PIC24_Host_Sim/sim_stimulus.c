@@ -0,0 +1,235 @@
+/*
+ * File:   sim_stimulus.c
+ *
+ * Plays a stimulus script against the pins, analog nodes and UART RX.
+ * One event per line, in time order, time in ms of virtual time:
+ *
+ *   # comment
+ *   0     load AN11 15            15 pF on the AN11 electrode (optional: ohms to ground)
+ *   10    pin RB7 0               drive RB7 low (1 = high, z = release)
+ *   20    analog AN4 900          hold AN4 at 900 mV (z = release)
+ *   30    ramp AN4 0 3000 100 50  0 -> 3000 mV over 100 ms in 50 steps
+ *   40    uart r\r\n              bytes into UART2 RX (\n \r \\ \xHH escapes)
+ *   45    uart_break              a break on UART2 RX (0x00 with a framing error)
+ *   50    vdd 3000                change the supply
+ */
+
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+#define STIMULUS_MAX_EVENTS (4096)
+#define STIMULUS_MAX_DATA (128)
+
+typedef enum {
+    STIM_PIN,
+    STIM_ANALOG,
+    STIM_LOAD,
+    STIM_UART,
+    STIM_UART_BREAK,
+    STIM_VDD,
+} stimulus_kind_t;
+
+typedef struct {
+    uint64_t at_ps;
+    stimulus_kind_t kind;
+    uint8_t port; // pin: port, analog/load: AN number
+    uint8_t bit;
+    int32_t value; // level, mV, pF
+    uint32_t value2; // load: ohms
+    char data[STIMULUS_MAX_DATA];
+    size_t data_len;
+} stimulus_event_t;
+
+static stimulus_event_t stimulus_events[STIMULUS_MAX_EVENTS];
+static size_t stimulus_count = 0;
+static size_t stimulus_next = 0;
+
+static void stimulus_error(const char* path, unsigned line_no, const char* what) {
+    fprintf(stderr, "%s:%u: %s\n", path, line_no, what);
+    exit(2);
+}
+
+static stimulus_event_t* stimulus_add(const char* path, unsigned line_no, double at_ms) {
+    if (stimulus_count == STIMULUS_MAX_EVENTS) {
+        stimulus_error(path, line_no, "too many events");
+    }
+    stimulus_event_t* ev = &stimulus_events[stimulus_count++];
+    memset(ev, 0, sizeof(*ev));
+    ev->at_ps = (uint64_t) (at_ms * SIM_PS_PER_MS);
+    return ev;
+}
+
+// "RB7" -> port B, bit 7
+static int stimulus_parse_pin(const char* s, uint8_t* port, uint8_t* bit) {
+    if ((toupper((unsigned char) s[0]) != 'R') || ((toupper((unsigned char) s[1]) != 'A') && (toupper((unsigned char) s[1]) != 'B'))) {
+        return 0;
+    }
+    const long n = strtol(s + 2, NULL, 10);
+    if ((n < 0) || (n > 15)) {
+        return 0;
+    }
+    *port = (toupper((unsigned char) s[1]) == 'A') ? SIM_PORT_A : SIM_PORT_B;
+    *bit = (uint8_t) n;
+    return 1;
+}
+
+// "AN11" -> 11
+static int stimulus_parse_an(const char* s, uint8_t* an) {
+    if ((toupper((unsigned char) s[0]) != 'A') || (toupper((unsigned char) s[1]) != 'N')) {
+        return 0;
+    }
+    const long n = strtol(s + 2, NULL, 10);
+    if ((n < 0) || (n >= SIM_AN_COUNT)) {
+        return 0;
+    }
+    *an = (uint8_t) n;
+    return 1;
+}
+
+static size_t stimulus_unescape(const char* s, char* out, size_t out_len) {
+    size_t len = 0;
+    while ((*s != '\0') && (*s != '\n') && (len < out_len)) {
+        char c = *s++;
+        if (c == '\\') {
+            switch (*s) {
+                case 'n': c = '\n'; s++; break;
+                case 'r': c = '\r'; s++; break;
+                case '\\': c = '\\'; s++; break;
+                case 'x': {
+                    char hex[3] = {s[1], (s[1] != '\0') ? s[2] : '\0', '\0'};
+                    c = (char) strtol(hex, NULL, 16);
+                    s += (s[1] != '\0' && s[2] != '\0') ? 3 : 1;
+                    break;
+                }
+                default: break;
+            }
+        }
+        out[len++] = c;
+    }
+    return len;
+}
+
+void stimulus_load(const char* path) {
+    FILE* f = fopen(path, "r");
+    if (f == NULL) {
+        perror(path);
+        exit(2);
+    }
+    char line[256];
+    unsigned line_no = 0;
+    double last_ms = 0;
+    while (fgets(line, sizeof(line), f) != NULL) {
+        line_no++;
+        char* p = line;
+        while (isspace((unsigned char) *p)) {
+            p++;
+        }
+        if ((*p == '#') || (*p == '\0')) {
+            continue;
+        }
+        double at_ms;
+        char kind[16], target[16], arg[32];
+        int used = 0;
+        if (sscanf(p, "%lf %15s %n", &at_ms, kind, &used) < 2) {
+            stimulus_error(path, line_no, "expected: <ms> <event> ...");
+        }
+        if (at_ms < last_ms) {
+            stimulus_error(path, line_no, "events must be in time order");
+        }
+        last_ms = at_ms;
+        const char* rest = p + used;
+
+        if (strcmp(kind, "uart") == 0) {
+            stimulus_event_t* ev = stimulus_add(path, line_no, at_ms);
+            ev->kind = STIM_UART;
+            ev->data_len = stimulus_unescape(rest, ev->data, sizeof(ev->data));
+        }
+        else if (strcmp(kind, "uart_break") == 0) {
+            stimulus_add(path, line_no, at_ms)->kind = STIM_UART_BREAK;
+        }
+        else if (strcmp(kind, "vdd") == 0) {
+            stimulus_event_t* ev = stimulus_add(path, line_no, at_ms);
+            ev->kind = STIM_VDD;
+            ev->value = (int32_t) strtol(rest, NULL, 10);
+        }
+        else if (strcmp(kind, "pin") == 0) {
+            stimulus_event_t* ev = stimulus_add(path, line_no, at_ms);
+            ev->kind = STIM_PIN;
+            if ((sscanf(rest, "%15s %31s", target, arg) != 2) || !stimulus_parse_pin(target, &ev->port, &ev->bit)) {
+                stimulus_error(path, line_no, "expected: pin R<A|B><n> <0|1|z>");
+            }
+            ev->value = (arg[0] == 'z') ? -1 : (arg[0] == '1');
+        }
+        else if (strcmp(kind, "analog") == 0) {
+            stimulus_event_t* ev = stimulus_add(path, line_no, at_ms);
+            ev->kind = STIM_ANALOG;
+            if ((sscanf(rest, "%15s %31s", target, arg) != 2) || !stimulus_parse_an(target, &ev->port)) {
+                stimulus_error(path, line_no, "expected: analog AN<n> <mV|z>");
+            }
+            ev->value = (arg[0] == 'z') ? -1 : (int32_t) strtol(arg, NULL, 10);
+        }
+        else if (strcmp(kind, "load") == 0) {
+            stimulus_event_t* ev = stimulus_add(path, line_no, at_ms);
+            ev->kind = STIM_LOAD;
+            unsigned long pF = 0, ohms = 0;
+            if ((sscanf(rest, "%15s %lu %lu", target, &pF, &ohms) < 2) || !stimulus_parse_an(target, &ev->port)) {
+                stimulus_error(path, line_no, "expected: load AN<n> <pF> [ohms]");
+            }
+            ev->value = (int32_t) pF;
+            ev->value2 = (uint32_t) ohms;
+        }
+        else if (strcmp(kind, "ramp") == 0) {
+            uint8_t an;
+            double from_mV, to_mV, dur_ms;
+            unsigned steps;
+            if ((sscanf(rest, "%15s %lf %lf %lf %u", target, &from_mV, &to_mV, &dur_ms, &steps) != 5)
+                    || !stimulus_parse_an(target, &an) || (steps == 0)) {
+                stimulus_error(path, line_no, "expected: ramp AN<n> <from mV> <to mV> <ms> <steps>");
+            }
+            for (unsigned i = 0; i <= steps; i++) {
+                stimulus_event_t* ev = stimulus_add(path, line_no, at_ms + dur_ms * i / steps);
+                ev->kind = STIM_ANALOG;
+                ev->port = an;
+                ev->value = (int32_t) (from_mV + (to_mV - from_mV) * i / steps);
+            }
+            last_ms = at_ms + dur_ms;
+        }
+        else {
+            stimulus_error(path, line_no, "unknown event");
+        }
+    }
+    fclose(f);
+}
+
+void stimulus_apply_due(void) {
+    while ((stimulus_next < stimulus_count) && (stimulus_events[stimulus_next].at_ps <= sim_now_ps)) {
+        const stimulus_event_t* ev = &stimulus_events[stimulus_next++];
+        switch (ev->kind) {
+            case STIM_PIN:
+                sim_pin_drive(ev->port, ev->bit, (int8_t) ev->value);
+                break;
+            case STIM_ANALOG:
+                sim_analog_drive_mV(ev->port, ev->value);
+                break;
+            case STIM_LOAD:
+                sim_analog_load(ev->port, (uint32_t) ev->value, ev->value2);
+                break;
+            case STIM_UART:
+                sim_uart_rx_inject(ev->data, ev->data_len);
+                break;
+            case STIM_UART_BREAK:
+                sim_uart_rx_break();
+                break;
+            case STIM_VDD:
+                sim_vdd_mV = (uint32_t) ev->value;
+                break;
+        }
+    }
+}
+
+uint64_t stimulus_next_ps(void) {
+    return (stimulus_next < stimulus_count) ? stimulus_events[stimulus_next].at_ps : SIM_NEVER;
+}
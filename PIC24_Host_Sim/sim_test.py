@@ -0,0 +1,131 @@
+import argparse
+import difflib
+import os
+import re
+import subprocess
+import sys
+from pathlib import Path
+
+# Whole-program scenarios: each stimulus/*.txt with a "# test:" line runs its
+# project's firmware in the simulator and compares the UART output with
+# stimulus/<name>.expected.
+#
+#   # test: App2_Capacitance_Sensor ENABLE_COMMANDS=1 run_ms=9000 runs=2
+#
+# The project, then any main.c feature flags to change (a "const uint8_t
+# NAME = ...;" line; the project is copied to build/test/<name>/ for that, the
+# tree is never edited), run_ms of virtual time, and optionally vdd_mv and
+# runs: with runs=2 the firmware restarts on the same data EEPROM, and each
+# run's output starts with "=== run <n> ===".
+#
+# The simulator is deterministic, so the output is compared exactly (with the
+# NULs of the idle UART removed). After a change that should alter it, re-record
+# with --update (make test-expected) and review the diff of the .expected files.
+#
+# Usage: python3 sim_test.py [--arch-flags=-m32] [--update] [STIMULUS...]
+
+HOST_SIM_DIR = Path(__file__).parent
+STIMULUS_DIR = HOST_SIM_DIR / "stimulus"
+TEST_LINE_RE = re.compile(r"^#\s*test:\s*(.+)$", re.MULTILINE)
+FLAG_RE = r"(const uint8_t {name} = )[^;]+;"
+
+def parse_test_line(stimulus: Path) -> dict | None:
+	match = TEST_LINE_RE.search(stimulus.read_text())
+	if match is None:
+		return None
+	project, *settings = match.group(1).split()
+	test = {"project": project, "flags": {}, "run_ms": None, "runs": 1, "vdd_mv": None}
+	for setting in settings:
+		name, _, value = setting.partition("=")
+		if name in ("run_ms", "runs", "vdd_mv"):
+			test[name] = int(value)
+		elif name.isupper():
+			test["flags"][name] = value
+		else:
+			raise SystemExit(f"{stimulus}: unknown test setting {setting}")
+	if test["run_ms"] is None:
+		raise SystemExit(f"{stimulus}: the test line needs run_ms=")
+	return test
+
+def write_if_changed(path: Path, text: str):
+	# keeps make from rebuilding a variant that didn't change
+	if not path.exists() or path.read_text() != text:
+		path.write_text(text)
+
+def build(stimulus: Path, test: dict, arch_flags: str) -> Path:
+	"""Builds the project (or its flag variant) and returns the executable."""
+	project = test["project"]
+	make = [os.environ.get("MAKE", "make"), "--no-print-directory", "-s", f"PROJECT={project}",
+		f"HOST_ARCH_FLAGS={arch_flags}"]
+	build_dir = Path("build") / project
+	if test["flags"]:
+		build_dir = Path("build") / "test" / stimulus.stem
+		source_dir = HOST_SIM_DIR / build_dir / "src"
+		source_dir.mkdir(parents=True, exist_ok=True)
+		sources = sorted((HOST_SIM_DIR.parent / project).glob("*.[ch]"))
+		# a file the project no longer has (moved to pic24_hal, say) goes too
+		for stale in set(source_dir.glob("*.[ch]")) - {source_dir / source.name for source in sources}:
+			stale.unlink()
+		for source in sources:
+			text = source.read_text()
+			if source.name == "main.c":
+				for name, value in test["flags"].items():
+					text, count = re.subn(FLAG_RE.format(name=name), rf"\g<1>{value};", text)
+					if count != 1:
+						raise SystemExit(f"{stimulus}: no single 'const uint8_t {name}' in {project}/main.c")
+			write_if_changed(source_dir / source.name, text)
+		make += [f"PROJECT_DIR={source_dir}", f"BUILD_DIR={build_dir}"]
+	subprocess.run(make, check=True, cwd=HOST_SIM_DIR, stdout=subprocess.DEVNULL)
+	return HOST_SIM_DIR / build_dir / project
+
+def run(stimulus: Path, test: dict, executable: Path) -> str:
+	eeprom = executable.parent / f"{stimulus.stem}.eeprom"
+	eeprom.unlink(missing_ok=True)
+	uart_out = executable.parent / f"{stimulus.stem}.uart"
+	env = dict(os.environ, SIM_STIMULUS=str(stimulus), SIM_RUN_MS=str(test["run_ms"]),
+		SIM_UART_OUT=str(uart_out), SIM_EEPROM=str(eeprom), SIM_QUIET="1")
+	if test["vdd_mv"] is not None:
+		env["SIM_VDD_MV"] = str(test["vdd_mv"])
+	output = ""
+	for run_no in range(1, test["runs"] + 1):
+		subprocess.run([str(executable)], check=True, env=env)
+		if test["runs"] > 1:
+			output += f"=== run {run_no} ===\n"
+		output += uart_out.read_bytes().replace(b"\0", b"").decode("latin-1")
+	return output
+
+def check(stimulus: Path, arch_flags: str, update: bool) -> bool:
+	test = parse_test_line(stimulus)
+	if test is None:
+		return True
+	output = run(stimulus, test, build(stimulus, test, arch_flags))
+	expected_path = stimulus.with_suffix(".expected")
+	if update:
+		write_if_changed(expected_path, output)
+		print(f"RECORDED {stimulus.name}")
+		return True
+	expected = expected_path.read_text() if expected_path.exists() else ""
+	if output == expected:
+		print(f"PASS {stimulus.name}")
+		return True
+	print(f"FAIL {stimulus.name}: UART output differs from {expected_path.name}")
+	diff = difflib.unified_diff(expected.splitlines(), output.splitlines(), "expected", "output", lineterm="")
+	for line in list(diff)[:40]:
+		print(f"    {line}")
+	return False
+
+def main():
+	parser = argparse.ArgumentParser(description="Run the stimulus scenarios and compare their UART output")
+	parser.add_argument("stimuli", nargs="*", type=Path, help="default: every stimulus/*.txt with a test line")
+	parser.add_argument("--arch-flags", default="-m32", help="flags picking the host ABI (default -m32)")
+	parser.add_argument("--update", action="store_true", help="re-record the .expected files")
+	args = parser.parse_args()
+
+	stimuli = [path.resolve() for path in args.stimuli] or sorted(STIMULUS_DIR.glob("*.txt"))
+	all_ok = True
+	for stimulus in stimuli:
+		all_ok &= check(stimulus, args.arch_flags, args.update)
+	sys.exit(0 if all_ok else 1)
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,155 @@
+import argparse
+import re
+import subprocess
+import sys
+import tempfile
+from pathlib import Path
+
+# Worst-case stack depth per project, from the compiler's own frame sizes.
+#
+# Each project's firmware is compiled for the host (against include/xc.h, at
+# -O0 like the MPLAB projects) with -fcallgraph-info=su, which gives every
+# function's frame size and its calls. The deepest chain from main(), plus
+# every ISR's deepest chain on top (any of them may nest), must leave at
+# least --min-headroom bytes of the 1.5 KB data RAM after static data.
+#
+# These are host frame sizes. With the default -m32 they are close to, and
+# mostly above, XC16's: int is 4 bytes instead of 2 and alignment pads more,
+# while char buffers, which are what fill the stack, are the same size.
+# Use the numbers to catch growth and plan buffers; the on-target figure
+# comes from stack_paint.c's high-water mark.
+#
+# Usage: python3 stack_check.py [--arch-flags=-m32] [--min-headroom 128] PROJECT...
+
+DATA_RAM_BYTES = 1536 # PIC24F16KA102
+
+# frames the call graph can't see: library calls (XC16's printf family
+# needs a lot), and VLAs, as "project:function" -> bytes
+LIBRARY_FRAME_BYTES = {"sprintf": 256, "snprintf": 256, "vsprintf": 256, "printf": 256}
+DEFAULT_LIBRARY_FRAME_BYTES = 32
+DYNAMIC_FRAME_BOUNDS: dict[str, int] = {}
+
+HOST_SIM_DIR = Path(__file__).parent
+HAL_DIR = HOST_SIM_DIR.parent / "pic24_hal"
+HAL_ITEM_RE = re.compile(r"<itemPath>\.\./pic24_hal/(\w+\.c)</itemPath>")
+# -fno-pic keeps const tables of pointers out of .data (XC16 puts const in
+# program memory); space(eedata) variables go to a section that isn't RAM
+CFLAGS = [
+	"-O0", "-std=gnu99", f"-I{HOST_SIM_DIR / 'include'}", "-Dinterrupt=__unused__",
+	"-Dno_auto_psv=__unused__", '-Dspace(x)=section(".eedata")', "-fno-pic", "-w",
+	"-fcallgraph-info=su",
+]
+
+NODE_RE = re.compile(r'node: \{ title: "([^"]+)" label: "[^\\]*\\n[^\\]*\\n(\d+) bytes \((\w+)\)')
+EDGE_RE = re.compile(r'edge: \{ sourcename: "([^"]+)" targetname: "([^"]+)"')
+
+def project_sources(project_dir: Path) -> list[Path]:
+	"""The project's own .c files, plus the shared drivers its MPLAB project
+	lists (only what the target links counts, as with the simulator's library).
+	"""
+	configurations = (project_dir / "nbproject" / "configurations.xml").read_text()
+	hal_sources = [HAL_DIR / name for name in HAL_ITEM_RE.findall(configurations)]
+	return sorted(project_dir.glob("*.c")) + hal_sources
+
+def compile_project(project: str, cc: str, arch_flags: list[str], build_dir: Path) -> tuple[dict, dict, int]:
+	"""Returns (frames, calls, static RAM bytes) for the project's firmware."""
+	frames: dict[str, tuple[int, str]] = {} # function -> (bytes, static/dynamic/bounded)
+	calls: dict[str, set[str]] = {}
+	static_ram = 0
+	project_dir = HOST_SIM_DIR.parent / project
+	for source in project_sources(project_dir):
+		obj = build_dir / (source.stem + ".o")
+		subprocess.run([cc, *arch_flags, *CFLAGS, f"-I{project_dir}", f"-I{HAL_DIR}", "-c", str(source), "-o", str(obj)],
+			check=True, cwd=build_dir)
+
+		callgraph = obj.with_suffix(".ci").read_text()
+		for name, size, kind in NODE_RE.findall(callgraph):
+			frames[name] = (int(size), kind)
+		for source_fn, target_fn in EDGE_RE.findall(callgraph):
+			calls.setdefault(source_fn, set()).add(target_fn)
+
+		sections = subprocess.run(["size", "-A", str(obj)], check=True, capture_output=True, text=True).stdout
+		for line in sections.splitlines():
+			fields = line.split()
+			if fields and re.match(r"\.(data|bss)", fields[0]):
+				static_ram += int(fields[1])
+	return frames, calls, static_ram
+
+def frame_bytes(project: str, function: str, frames: dict, problems: list[str]) -> int:
+	if function.startswith("sim_"):
+		return 0 # an SFR access or builtin: no call on the target
+	if function == "__indirect_call":
+		problems.append("indirect call: its target's stack is not counted")
+		return DEFAULT_LIBRARY_FRAME_BYTES
+	if function not in frames:
+		return LIBRARY_FRAME_BYTES.get(function, DEFAULT_LIBRARY_FRAME_BYTES)
+	size, kind = frames[function]
+	if kind == "static":
+		return size
+	bound = DYNAMIC_FRAME_BOUNDS.get(f"{project}:{function}")
+	if bound is None:
+		problems.append(f"{function}() has a variable-size frame; add a bound to DYNAMIC_FRAME_BOUNDS")
+		return size
+	return size + bound
+
+def deepest_chain(project: str, root: str, frames: dict, calls: dict, problems: list[str]) -> tuple[int, list[str]]:
+	memo: dict[str, tuple[int, list[str]]] = {}
+	on_path: set[str] = set()
+
+	def visit(function: str) -> tuple[int, list[str]]:
+		if function in memo:
+			return memo[function]
+		if function in on_path:
+			problems.append(f"recursion through {function}(): depth is unbounded")
+			return 0, [function]
+		on_path.add(function)
+		best_depth, best_chain = 0, []
+		for callee in sorted(calls.get(function, ())):
+			depth, chain = visit(callee)
+			if depth > best_depth:
+				best_depth, best_chain = depth, chain
+		on_path.discard(function)
+		memo[function] = (frame_bytes(project, function, frames, problems) + best_depth, [function] + best_chain)
+		return memo[function]
+
+	return visit(root)
+
+def check_project(project: str, cc: str, arch_flags: list[str], min_headroom: int, verbose: bool) -> bool:
+	with tempfile.TemporaryDirectory() as build_dir:
+		frames, calls, static_ram = compile_project(project, cc, arch_flags, Path(build_dir))
+
+	problems: list[str] = []
+	main_depth, main_chain = deepest_chain(project, "main", frames, calls, problems)
+	isr_depths = []
+	for isr in sorted(f for f in frames if re.fullmatch(r"_\w+Interrupt", f)):
+		isr_depths.append((isr,) + deepest_chain(project, isr, frames, calls, problems))
+	isr_total = sum(depth for _, depth, _ in isr_depths)
+
+	headroom = DATA_RAM_BYTES - static_ram - main_depth - isr_total
+	is_ok = (headroom >= min_headroom) and not problems
+	print(f"{project}: static RAM {static_ram} B, main {main_depth} B, ISRs {isr_total} B, "
+		f"headroom {headroom} B -> {'ok' if is_ok else 'FAIL'}")
+	print(f"    deepest: {' -> '.join(main_chain)}")
+	if verbose:
+		for isr, depth, chain in isr_depths:
+			print(f"    {isr}: {depth} B: {' -> '.join(chain)}")
+	for problem in sorted(set(problems)):
+		print(f"    problem: {problem}")
+	return is_ok
+
+def main():
+	parser = argparse.ArgumentParser(description="Worst-case stack depth per project")
+	parser.add_argument("projects", nargs="+")
+	parser.add_argument("--cc", default="cc")
+	parser.add_argument("--arch-flags", default="-m32", help="flags picking the host ABI (default -m32)")
+	parser.add_argument("--min-headroom", type=int, default=128, help="bytes of RAM that must stay free")
+	parser.add_argument("--verbose", action="store_true", help="also list each ISR's deepest chain")
+	args = parser.parse_args()
+
+	all_ok = True
+	for project in args.projects:
+		all_ok &= check_project(project, args.cc, args.arch_flags.split(), args.min_headroom, args.verbose)
+	sys.exit(0 if all_ok else 1)
+
+if __name__ == "__main__":
+	main()
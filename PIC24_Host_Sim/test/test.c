@@ -0,0 +1,39 @@
+/*
+ * File:   test.c
+ *
+ * Runs the cases of one project (test_<project>.c) and prints, per case:
+ *   PASS <project> <case>
+ * or the failed checks, then FAIL <project> <case>.
+ *
+ * The cases share one simulated chip, in order: each sets up the peripherals
+ * and loads it needs. Firmware prints go to SIM_UART_OUT (default /dev/null).
+ *
+ * Usage: test_<project>   exits 1 if any check failed
+ */
+
+
+#include <stdlib.h>
+#include "sim.h"
+#include "test.h"
+
+uint32_t test_check_failures = 0;
+
+int main(void) {
+    sim_set_run_limit_ps(SIM_NEVER);
+    if (getenv("SIM_UART_OUT") == NULL) {
+        sim_uart_out = fopen("/dev/null", "wb"); // keep the firmware's prints out of the report
+    }
+
+    uint8_t failed_cases = 0;
+    for (uint8_t i = 0; i < test_case_count; i++) {
+        test_check_failures = 0;
+        test_cases[i].run();
+        sim_advance_ps(0); // settle anything the case left pending
+        printf("%s %s %s\n", (test_check_failures == 0) ? "PASS" : "FAIL", test_project, test_cases[i].name);
+        if (test_check_failures > 0) {
+            failed_cases++;
+        }
+    }
+    fflush(stdout);
+    exit((failed_cases > 0) ? 1 : 0); // sim_finish() runs from atexit()
+}
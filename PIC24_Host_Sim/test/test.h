@@ -0,0 +1,36 @@
+/*
+ * File:   test.h
+ *
+ * Unit tests of firmware functions, run on the host simulator. Each
+ * test_<project>.c lists its cases; test.c runs them and reports the failed
+ * checks. Whole-program scenarios are in stimulus/ (see sim_test.py).
+ */
+
+#ifndef __INCLUDE_GUARD__TEST_H__
+#define	__INCLUDE_GUARD__TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+typedef struct {
+    const char* name;
+    void (*run)(void); // fails through TEST_CHECK()
+} test_case_t;
+
+extern const char* const test_project;
+extern const test_case_t test_cases[];
+extern const uint8_t test_case_count;
+
+extern uint32_t test_check_failures; // in the case running now
+
+// reports (and counts) a failed check with its own printf-style message; the case goes on
+#define TEST_CHECK(cond, ...) do { \
+        if (!(cond)) { \
+            test_check_failures++; \
+            printf("  %s:%d: %s: ", __FILE__, __LINE__, #cond); \
+            printf(__VA_ARGS__); \
+            printf("\n"); \
+        } \
+    } while (0)
+
+#endif	/* __INCLUDE_GUARD__TEST_H__ */
@@ -0,0 +1,993 @@
+/*
+ * File:   test_App2_Capacitance_Sensor.c
+ */
+
+
+#include <math.h>
+#include <string.h>
+#include "sim.h"
+#include "test.h"
+#include "clock.h"
+#include "uart.h"
+#include "uart_queue.h"
+#include "adc.h"
+#include "z_sense.h"
+#include "eeprom.h"
+#include "record_store.h"
+#include "cal_store.h"
+#include "params.h"
+#include "command.h"
+#include "touch.h"
+#include "stream.h"
+#include "telemetry.h"
+#include "crc16.h"
+
+#define TEST_AN11 (11)
+
+extern const uint32_t FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE; // z_sense.c
+extern uint8_t telemetry_seq; // telemetry.c
+
+// |a - b| <= b * pct / 100
+static int within_pct(uint32_t a, uint32_t b, uint32_t pct) {
+    const uint64_t diff = (a > b) ? (a - b) : (b - a);
+    return diff * 100 <= (uint64_t) b * pct;
+}
+
+// ITRIM 0: the CTMU sources exactly its nominal current in the model, so
+// readings can be checked against the physics with the default coefficients
+static void use_nominal_current(void) {
+    ctmu_cal = ctmu_cal_defaults;
+    for (uint8_t i = 0; i < CTMU_RANGE_COUNT; i++) {
+        ctmu_cal.itrim[i] = 0;
+    }
+}
+
+static void setup_chip(void) {
+    set_clock_freq(8000);
+    InitUART2();
+    init_adc();
+    sim_vdd_mV = SIM_DEFAULT_VDD_MV;
+    update_vdd_mV();
+}
+
+// VDD is measured against the band gap, and conversions follow it
+static void test_vdd_droop(void) {
+    setup_chip();
+    sim_analog_drive_mV(TEST_AN11, 1000);
+
+    static const uint16_t supplies_mV[] = {3300, 3000, 2700, 2400, 2000};
+    for (uint8_t i = 0; i < sizeof(supplies_mV) / sizeof(supplies_mV[0]); i++) {
+        sim_vdd_mV = supplies_mV[i];
+        const uint16_t stale_mV = adc_val_to_mV(read_adc_value());
+
+        // VBG is one of ~370-610 codes over this range: within a code of it
+        const uint16_t measured_vdd_mV = update_vdd_mV();
+        TEST_CHECK(within_pct(measured_vdd_mV, supplies_mV[i], 1), "VDD %u mV measured as %u mV",
+                supplies_mV[i], measured_vdd_mV);
+
+        const uint16_t input_mV = adc_val_to_mV(read_adc_value());
+        TEST_CHECK(within_pct(input_mV, 1000, 1), "1000 mV read as %u mV at VDD %u mV",
+                input_mV, supplies_mV[i]);
+        if (i > 0) { // the cache was for the previous supply
+            TEST_CHECK(!within_pct(stale_mV, 1000, 5), "without the update 1000 mV still read %u mV",
+                    stale_mV);
+        }
+    }
+
+    // the monitor measures once every VDD_MONITOR_INTERVAL polls
+    sim_vdd_mV = 3300;
+    update_vdd_mV();
+    sim_vdd_mV = 2500;
+    for (uint8_t i = 0; (i < VDD_MONITOR_INTERVAL) && (vdd_mV > 2600); i++) {
+        vdd_monitor_poll();
+    }
+    TEST_CHECK(vdd_mV <= 2600, "droop not seen in %u polls", VDD_MONITOR_INTERVAL);
+    sim_vdd_mV = 3300; // it just measured: the next ones reuse the cache
+    for (uint8_t i = 1; i < VDD_MONITOR_INTERVAL; i++) {
+        vdd_monitor_poll();
+    }
+    TEST_CHECK(vdd_mV <= 2600, "re-measured before the interval was up (%u mV)", vdd_mV);
+    vdd_monitor_poll();
+    TEST_CHECK(vdd_mV >= 3200, "not re-measured after %u polls (%u mV)", VDD_MONITOR_INTERVAL, vdd_mV);
+
+    sim_analog_drive_mV(TEST_AN11, -1);
+    sim_vdd_mV = SIM_DEFAULT_VDD_MV;
+    update_vdd_mV();
+}
+
+// a capacitance reading doesn't move with the supply
+static void test_vdd_droop_cap(void) {
+    setup_chip();
+    sim_analog_load(TEST_AN11, 1000000UL, 0); // 1 uF
+    const uint32_t nominal_pF = c_sense_2_point_delta_pF_configurable(16, 1, NULL);
+
+    static const uint16_t supplies_mV[] = {3000, 2700, 2400};
+    for (uint8_t i = 0; i < sizeof(supplies_mV) / sizeof(supplies_mV[0]); i++) {
+        sim_vdd_mV = supplies_mV[i];
+        update_vdd_mV();
+        const uint32_t cap_pF = c_sense_2_point_delta_pF_configurable(16, 1, NULL);
+        TEST_CHECK(within_pct(cap_pF, nominal_pF, 1), "%lu pF at VDD %u mV, %lu pF at 3300 mV",
+                (unsigned long) cap_pF, supplies_mV[i], (unsigned long) nominal_pF);
+    }
+
+    sim_vdd_mV = SIM_DEFAULT_VDD_MV;
+    update_vdd_mV();
+}
+
+// the charge window is timed in hardware, so one reading takes well under 1 ms
+static void test_single_shot_cap(void) {
+    setup_chip();
+    use_nominal_current();
+    static const uint32_t caps_pF[] = {22000, 47000, 100000};
+    for (uint8_t i = 0; i < sizeof(caps_pF) / sizeof(caps_pF[0]); i++) {
+        sim_analog_load(TEST_AN11, caps_pF[i], 0);
+        const uint64_t start_ps = sim_now_ps;
+        const uint32_t cap_pF = c_sense_single_shot_pF(SINGLE_SHOT_DEFAULT_CHARGE_TIME_US, 1);
+        const uint64_t took_us = (sim_now_ps - start_ps) / 1000000;
+        TEST_CHECK(within_pct(cap_pF, caps_pF[i], 2), "%lu pF read as %lu pF",
+                (unsigned long) caps_pF[i], (unsigned long) cap_pF);
+        TEST_CHECK(took_us < 1000, "%lu pF took %lu us", (unsigned long) caps_pF[i], (unsigned long) took_us);
+    }
+    ctmu_cal = ctmu_cal_defaults;
+}
+
+// A resistor across the cap leaks charge: V(t) = I R (1 - exp(-t / RC)).
+// The reading is I t / V(t), which the RC model gives in double precision.
+static void test_single_shot_rc_model(void) {
+    setup_chip();
+    use_nominal_current();
+    static const struct {
+        uint32_t cap_pF;
+        uint32_t res_ohms;
+    } loads[] = {
+        {100000, 1000000}, // RC = 100 ms: hardly any leak
+        {100000, 47000}, // RC = 4.7 ms
+        {100000, 10000}, // RC = 1 ms: the ramp bends in 0.5 ms
+        {47000, 22000},
+    };
+    const double i_A = 55e-6;
+    const double t_s = SINGLE_SHOT_DEFAULT_CHARGE_TIME_US * 1e-6;
+    for (uint8_t i = 0; i < sizeof(loads) / sizeof(loads[0]); i++) {
+        sim_analog_load(TEST_AN11, loads[i].cap_pF, loads[i].res_ohms);
+        const double c_F = (loads[i].cap_pF + SIM_DEFAULT_PIN_CAP_PF) * 1e-12;
+        const double v = i_A * loads[i].res_ohms * (1.0 - exp(-t_s / (loads[i].res_ohms * c_F)));
+        const uint32_t model_pF = (uint32_t) (i_A * t_s / v * 1e12);
+
+        const uint32_t cap_pF = c_sense_single_shot_pF(SINGLE_SHOT_DEFAULT_CHARGE_TIME_US, 1);
+        TEST_CHECK(within_pct(cap_pF, model_pF, 2), "%lu pF || %lu ohm read as %lu pF, model %lu pF",
+                (unsigned long) loads[i].cap_pF, (unsigned long) loads[i].res_ohms,
+                (unsigned long) cap_pF, (unsigned long) model_pF);
+    }
+    sim_analog_load(TEST_AN11, 0, 0);
+    ctmu_cal = ctmu_cal_defaults;
+}
+
+static uint16_t measurement_count = 0;
+
+static void count_measurements(void* fn) {
+    if ((fn == (void*) c_sense_2_point_delta_pF_configurable) || (fn == (void*) ctmu_single_shot_adc)) {
+        measurement_count++;
+    }
+}
+
+// The trial-and-error ranging the closed-form predictor replaced: step the
+// current up or down a range per retry, then double/halve the charge time
+static uint32_t trial_and_error_pF(void) {
+    int8_t ctmu_exp_val = 0;
+    uint16_t charge_time_ms = 16;
+    uint32_t cap_pF = 0;
+    for (uint8_t retry_num = 0; retry_num < 15; retry_num++) {
+        cap_pF = c_sense_2_point_delta_pF_configurable(charge_time_ms, ctmu_exp_val, NULL);
+        if (cap_pF == FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE) {
+            if (ctmu_exp_val < 1) {
+                ctmu_exp_val++;
+            }
+            else if ((charge_time_ms * 2) < 1000) {
+                charge_time_ms *= 2;
+            }
+            else {
+                break;
+            }
+        }
+        else if (cap_pF <= 10) {
+            if (ctmu_exp_val > -1) {
+                ctmu_exp_val--;
+            }
+            else if ((charge_time_ms / 2) > 1) {
+                charge_time_ms /= 2;
+            }
+            else {
+                break;
+            }
+        }
+        else {
+            break;
+        }
+    }
+    return cap_pF;
+}
+
+// 1 pF to 100 uF, a decade at a time: every load reads within 3% (the ones
+// below ~10 nF through single shots). Measurements per reading for the old
+// trial-and-error ranging and for c_sense_auto_range_pF(), first on a new cap
+// (from the {0, 16} start) and again with the remembered range, averaged
+// over every load (trial and error spends its retries on the small ones and
+// still gets no reading)
+static void test_auto_range_sweep(void) {
+    setup_chip();
+    use_nominal_current();
+    sim_call_hook = count_measurements;
+
+    uint32_t before_total = 0, cold_total = 0, warm_total = 0;
+    uint8_t cap_count = 0;
+    printf("  %10s %12s %7s %5s %5s %12s\n", "load pF", "before pF", "before", "cold", "warm", "after pF");
+    for (uint32_t load_pF = 1; load_pF <= 100000000UL; load_pF *= 10) {
+        sim_analog_load(TEST_AN11, load_pF, 0);
+        // what the CTMU charges: the load, the pin, and the ADC's sample cap
+        const uint32_t node_pF = load_pF + SIM_DEFAULT_PIN_CAP_PF + 4;
+
+        measurement_count = 0;
+        const uint32_t before_pF = trial_and_error_pF();
+        const uint16_t before_count = measurement_count;
+
+        ctmu_range_t range = {0, 16};
+        measurement_count = 0;
+        c_sense_auto_range_pF(&range);
+        const uint16_t cold_count = measurement_count;
+        measurement_count = 0;
+        const uint32_t after_pF = c_sense_auto_range_pF(&range);
+        const uint16_t warm_count = measurement_count;
+
+        if (before_pF == FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE) {
+            printf("  %10lu %12s %7u %5u %5u %12lu\n", (unsigned long) load_pF, "no reading",
+                    before_count, cold_count, warm_count, (unsigned long) after_pF);
+        }
+        else {
+            printf("  %10lu %12lu %7u %5u %5u %12lu\n", (unsigned long) load_pF, (unsigned long) before_pF,
+                    before_count, cold_count, warm_count, (unsigned long) after_pF);
+        }
+        before_total += before_count;
+        cold_total += cold_count;
+        warm_total += warm_count;
+        cap_count++;
+
+        TEST_CHECK(within_pct(after_pF, node_pF, 3), "%lu pF read as %lu pF", (unsigned long) node_pF,
+                (unsigned long) after_pF);
+        TEST_CHECK(warm_count == 1, "%lu pF took %u measurements with its range remembered",
+                (unsigned long) load_pF, warm_count);
+        TEST_CHECK(cold_count <= CTMU_AUTO_RANGE_MAX_TRIES, "%lu pF took %u measurements",
+                (unsigned long) load_pF, cold_count);
+    }
+    printf("  average measurements per reading: before %u.%02u, after %u.%02u (new cap), %u.%02u (same cap)\n",
+            before_total / cap_count, (before_total * 100 / cap_count) % 100,
+            cold_total / cap_count, (cold_total * 100 / cap_count) % 100,
+            warm_total / cap_count, (warm_total * 100 / cap_count) % 100);
+    TEST_CHECK(cold_total < before_total, "no fewer measurements than trial and error");
+
+    sim_call_hook = NULL;
+    sim_analog_load(TEST_AN11, 0, 0);
+    ctmu_cal = ctmu_cal_defaults;
+}
+
+// C [pF] = i [pA] * t [us] / dV [mV] / 1000 - stray in 64-bit integers,
+// against double over every corner of the inputs: no overflow, no lost range
+static void test_charge_to_pF_full_range(void) {
+    static const uint32_t currents_pA[] = {1, 550000, 5500000, 55000000, 71500000, UINT32_MAX};
+    static const uint32_t charge_times_us[] = {1, 10, SINGLE_SHOT_DEFAULT_CHARGE_TIME_US,
+            SINGLE_SHOT_MAX_CHARGE_TIME_US, (CTMU_PRECHARGE_MS + CTMU_CHARGE_TIME_MAX_MS) * 1000UL, UINT32_MAX};
+    static const int32_t deltas_mV[] = {-5, 0, 1, 2, 6, 100, 1000, 3300, 3600, 65535};
+    static const uint32_t strays_pF[] = {0, 15, 1000000};
+
+    uint32_t checked = 0;
+    for (uint8_t s = 0; s < sizeof(strays_pF) / sizeof(strays_pF[0]); s++) {
+        for (uint8_t c = 0; c < sizeof(currents_pA) / sizeof(currents_pA[0]); c++) {
+            ctmu_cal = ctmu_cal_defaults;
+            ctmu_cal.current_pA[ctmu_exp_to_range_idx(1)] = currents_pA[c];
+            ctmu_cal.stray_pF = strays_pF[s];
+            for (uint8_t t = 0; t < sizeof(charge_times_us) / sizeof(charge_times_us[0]); t++) {
+                for (uint8_t d = 0; d < sizeof(deltas_mV) / sizeof(deltas_mV[0]); d++) {
+                    const uint32_t cap_pF = ctmu_charge_to_pF(1, charge_times_us[t], deltas_mV[d]);
+
+                    double expected = (double) FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE;
+                    if (deltas_mV[d] > 0) {
+                        expected = floor((double) currents_pA[c] * charge_times_us[t] / deltas_mV[d] / 1000.0)
+                                - strays_pF[s];
+                        expected = (expected < 0) ? 0 : expected;
+                        expected = (expected > FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE)
+                                ? FAKE_CAPACITANCE_TO_INDICATE_OVER_RANGE : expected;
+                    }
+                    // double carries 53 bits; the largest products need ~65
+                    const double tolerance = (expected * 1e-12 > 1.0) ? expected * 1e-12 : 1.0;
+                    TEST_CHECK(fabs(cap_pF - expected) <= tolerance,
+                            "%lu pA for %lu us over %ld mV (stray %lu pF): %lu pF, double says %.0f",
+                            (unsigned long) currents_pA[c], (unsigned long) charge_times_us[t],
+                            (long) deltas_mV[d], (unsigned long) strays_pF[s], (unsigned long) cap_pF, expected);
+                    checked++;
+                }
+            }
+        }
+    }
+    TEST_CHECK(checked == 1080, "%lu combinations checked", (unsigned long) checked);
+    ctmu_cal = ctmu_cal_defaults;
+}
+
+// Calibration finds the current the part really sources (uncalibrated
+// ITRIM 0b01111 is +30% in the model), and readings then come out right
+static void test_calibrate_current(void) {
+    setup_chip();
+    const uint32_t actual_pA = 55000000UL * 130 / 100;
+
+    // a resistor per range (1M, 100k, 10k): the current settles at V / R
+    ctmu_cal = ctmu_cal_defaults;
+    for (int8_t exp_val = -1; exp_val <= 1; exp_val++) {
+        const uint32_t res_ohms = (exp_val == -1) ? 1000000UL : ((exp_val == 0) ? 100000UL : 10000UL);
+        sim_analog_load(TEST_AN11, 0, res_ohms);
+        ctmu_calibrate_current_from_resistor(exp_val, res_ohms);
+        const uint32_t range_pA = actual_pA / ((exp_val == -1) ? 100 : ((exp_val == 0) ? 10 : 1));
+        TEST_CHECK(within_pct(ctmu_cal.current_pA[exp_val + 1], range_pA, 1), "from %lu ohms: %lu pA, sourcing %lu pA",
+                (unsigned long) res_ohms, (unsigned long) ctmu_cal.current_pA[exp_val + 1], (unsigned long) range_pA);
+    }
+
+    // from a cold start, whichever range it ends on
+    sim_analog_load(TEST_AN11, 2200000UL, 0);
+    ctmu_range_t range = {1, 100};
+    uint32_t cap_pF = c_sense_auto_range_pF(&range);
+    TEST_CHECK(within_pct(cap_pF, 2200000UL, 2), "2.2 uF read as %lu pF after the resistor calibration",
+            (unsigned long) cap_pF);
+
+    // a 1 uF reference: the 55 uA current, from the ramp
+    ctmu_cal = ctmu_cal_defaults;
+    sim_analog_load(TEST_AN11, 1000000UL, 0);
+    ctmu_calibrate_current_from_cap(1000000UL);
+    TEST_CHECK(within_pct(ctmu_cal.current_pA[2], actual_pA, 1), "from 1 uF: %lu pA, sourcing %lu pA",
+            (unsigned long) ctmu_cal.current_pA[2], (unsigned long) actual_pA);
+
+    // on the range it calibrated (the others keep their nominal currents)
+    sim_analog_load(TEST_AN11, 2200000UL, 0);
+    range = (ctmu_range_t) {1, 50};
+    cap_pF = c_sense_auto_range_pF(&range);
+    TEST_CHECK(within_pct(cap_pF, 2200000UL, 2), "2.2 uF read as %lu pF after the cap calibration",
+            (unsigned long) cap_pF);
+
+    // the smallest reference main() suggests, and a 1 nF one (single shots)
+    // after the stray calibration: whichever range each ends on
+    static const uint32_t references_pF[] = {10000, 1000};
+    for (uint8_t i = 0; i < sizeof(references_pF) / sizeof(references_pF[0]); i++) {
+        ctmu_cal = ctmu_cal_defaults;
+        sim_analog_load(TEST_AN11, 0, 0);
+        ctmu_calibrate_stray_pF();
+        sim_analog_load(TEST_AN11, references_pF[i], 0);
+        ctmu_calibrate_current_from_cap(references_pF[i]);
+        uint8_t changed = 0;
+        for (int8_t exp_val = -1; exp_val <= 1; exp_val++) {
+            const uint32_t cal_pA = ctmu_cal.current_pA[exp_val + 1];
+            if (cal_pA != ctmu_cal_defaults.current_pA[exp_val + 1]) {
+                const uint32_t range_pA = actual_pA / ((exp_val == -1) ? 100 : ((exp_val == 0) ? 10 : 1));
+                TEST_CHECK(within_pct(cal_pA, range_pA, 2), "from %lu pF: %lu pA, sourcing %lu pA",
+                        (unsigned long) references_pF[i], (unsigned long) cal_pA, (unsigned long) range_pA);
+                changed++;
+            }
+        }
+        TEST_CHECK(changed == 1, "from %lu pF: %u ranges calibrated", (unsigned long) references_pF[i], changed);
+    }
+
+    // a reference it can't charge (held at the rail) is refused, not zeroed
+    ctmu_cal = ctmu_cal_defaults;
+    sim_analog_drive_mV(TEST_AN11, SIM_DEFAULT_VDD_MV);
+    ctmu_calibrate_current_from_cap(10000);
+    TEST_CHECK(memcmp(ctmu_cal.current_pA, ctmu_cal_defaults.current_pA, sizeof(ctmu_cal.current_pA)) == 0,
+            "a refused reference changed the currents to %lu, %lu, %lu pA", (unsigned long) ctmu_cal.current_pA[0],
+            (unsigned long) ctmu_cal.current_pA[1], (unsigned long) ctmu_cal.current_pA[2]);
+    sim_analog_drive_mV(TEST_AN11, -1);
+
+    sim_analog_load(TEST_AN11, 0, 0);
+    ctmu_cal = ctmu_cal_defaults;
+}
+
+// With nothing on AN11 the stray calibration finds the pin and the ADC's
+// sample cap (single shots: it is far below the ramp's range), and small
+// loads then read as themselves; a pin it can't charge is an error that
+// keeps the previous value
+static void test_calibrate_stray(void) {
+    setup_chip();
+    use_nominal_current();
+    const uint32_t model_pF = SIM_DEFAULT_PIN_CAP_PF + 4; // 4.4 pF sample cap
+
+    ctmu_cal.stray_pF = 1234; // a stale value
+    sim_analog_load(TEST_AN11, 0, 0);
+    ctmu_calibrate_stray_pF();
+    TEST_CHECK((ctmu_cal.stray_pF >= model_pF - 1) && (ctmu_cal.stray_pF <= model_pF + 1),
+            "stray calibrated to %lu pF, the model has %lu pF", (unsigned long) ctmu_cal.stray_pF,
+            (unsigned long) model_pF);
+
+    static const uint32_t loads_pF[] = {100, 470, 2200};
+    for (uint8_t i = 0; i < sizeof(loads_pF) / sizeof(loads_pF[0]); i++) {
+        sim_analog_load(TEST_AN11, loads_pF[i], 0);
+        const uint32_t cap_pF = c_sense_2_point_delta_pF();
+        TEST_CHECK(within_pct(cap_pF, loads_pF[i], 2), "%lu pF read as %lu pF after the stray calibration",
+                (unsigned long) loads_pF[i], (unsigned long) cap_pF);
+    }
+
+    const uint32_t stray_pF = ctmu_cal.stray_pF;
+    sim_analog_load(TEST_AN11, 0, 0);
+    sim_analog_drive_mV(TEST_AN11, SIM_DEFAULT_VDD_MV); // held at the rail: saturates every window
+    ctmu_calibrate_stray_pF();
+    TEST_CHECK(ctmu_cal.stray_pF == stray_pF, "a failed calibration left %lu pF, not %lu pF",
+            (unsigned long) ctmu_cal.stray_pF, (unsigned long) stray_pF);
+
+    sim_analog_drive_mV(TEST_AN11, -1);
+    ctmu_cal = ctmu_cal_defaults;
+}
+
+static void erase_eeprom_words(uint16_t first_word, uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) {
+        eeprom_write_word(first_word + i, 0xFFFF);
+    }
+}
+
+// Power lost after every possible number of erase/writes of a save (the last
+// one torn): at the next boot the store holds the previous record or the new
+// one, whole, and never anything else
+static void test_cal_store_power_loss(void) {
+    setup_chip();
+    const uint16_t store_words = CAL_STORE_SLOT_COUNT * CAL_STORE_SLOT_WORDS;
+    const int32_t max_operations = 2 * CAL_STORE_SLOT_WORDS;
+    int32_t cut = 0;
+    for (; cut <= max_operations; cut++) {
+        erase_eeprom_words(CAL_STORE_FIRST_WORD, store_words);
+        ctmu_cal = ctmu_cal_defaults;
+        TEST_CHECK(!cal_store_load(), "a record loaded from erased EEPROM");
+        ctmu_cal.stray_pF = 15;
+        vdd_mV = 3000;
+        cal_store_save();
+
+        ctmu_cal.stray_pF = 1000000 + cut;
+        vdd_mV = 2400;
+        sim_nvm_power_cut(cut);
+        cal_store_save();
+        sim_nvm_power_cut(-1);
+
+        ctmu_cal.stray_pF = UINT32_MAX; // reboot
+        vdd_mV = 0;
+        const uint8_t loaded = cal_store_load();
+        const uint8_t is_old = (ctmu_cal.stray_pF == 15) && (vdd_mV == 3000);
+        const uint8_t is_new = (ctmu_cal.stray_pF == 1000000 + cut) && (vdd_mV == 2400);
+        TEST_CHECK(loaded && (is_old || is_new), "cut after %ld operations: loaded %u, stray %lu pF, %u mV",
+                (long) cut, loaded, (unsigned long) ctmu_cal.stray_pF, vdd_mV);
+        if (is_new) {
+            break; // the whole save fit before the cut
+        }
+    }
+    // an erase and a write per word, except those already erased to 0xFFFF
+    TEST_CHECK((cut > (int32_t) (sizeof(cal_record_t) / 2)) && (cut <= max_operations),
+            "the save completed after %ld operations", (long) cut);
+
+    erase_eeprom_words(CAL_STORE_FIRST_WORD, store_words);
+    cal_store_load(); // forget the erased slots
+    ctmu_cal = ctmu_cal_defaults;
+    update_vdd_mV();
+}
+
+typedef struct {
+    record_header_t header;
+    uint16_t value;
+    uint16_t crc;
+} test_record_t;
+
+#define TEST_STORE_MAGIC_VERSION (0x7E01)
+#define TEST_STORE_SLOT_WORDS (4)
+#define TEST_STORE_SLOT_COUNT (4)
+
+// Saves rotate through every slot, and the newest record still wins when
+// the sequence number wraps through 0xFFFF
+static void test_record_store_rotation_and_wrap(void) {
+    setup_chip();
+    erase_eeprom_words(CAL_STORE_FIRST_WORD, TEST_STORE_SLOT_COUNT * TEST_STORE_SLOT_WORDS);
+    record_store_t store = RECORD_STORE_INIT(CAL_STORE_FIRST_WORD, TEST_STORE_SLOT_WORDS,
+            TEST_STORE_SLOT_COUNT, TEST_STORE_MAGIC_VERSION, test_record_t);
+    store.newest_slot = TEST_STORE_SLOT_COUNT - 1; // as if after 65533 saves
+    store.newest_sequence = 0xFFFC;
+
+    test_record_t record;
+    for (uint16_t i = 1; i <= 3 * TEST_STORE_SLOT_COUNT; i++) {
+        record.value = i;
+        record_store_save(&store, &record);
+
+        record_store_t rebooted = RECORD_STORE_INIT(CAL_STORE_FIRST_WORD, TEST_STORE_SLOT_WORDS,
+                TEST_STORE_SLOT_COUNT, TEST_STORE_MAGIC_VERSION, test_record_t);
+        test_record_t loaded;
+        TEST_CHECK(record_store_load(&rebooted, &loaded) && (loaded.value == i), "save %u: loaded %u", i,
+                loaded.value);
+        TEST_CHECK(rebooted.newest_slot == (int8_t) ((i - 1) % TEST_STORE_SLOT_COUNT), "save %u went to slot %d",
+                i, rebooted.newest_slot);
+        TEST_CHECK(loaded.header.sequence == (uint16_t) (0xFFFC + i), "save %u: sequence %u", i,
+                loaded.header.sequence);
+    }
+    for (uint8_t slot = 0; slot < TEST_STORE_SLOT_COUNT; slot++) {
+        const uint16_t magic_version = eeprom_read_word(CAL_STORE_FIRST_WORD + slot * TEST_STORE_SLOT_WORDS);
+        TEST_CHECK(magic_version == TEST_STORE_MAGIC_VERSION, "slot %u never written", slot);
+    }
+
+    erase_eeprom_words(CAL_STORE_FIRST_WORD, TEST_STORE_SLOT_COUNT * TEST_STORE_SLOT_WORDS);
+    cal_store_load();
+    ctmu_cal = ctmu_cal_defaults;
+    update_vdd_mV();
+}
+
+static const uint8_t touch_an_channels[TOUCH_CHANNEL_COUNT] = {0, 1, 4, 5, 9, 10, 11, 12}; // touch.c's electrodes
+#define TEST_ELECTRODE_PF (15) // a pad and its trace
+#define TEST_FINGER_PF (15)
+
+static uint32_t electrode_pF[TOUCH_CHANNEL_COUNT];
+
+// every electrode at `pF`, plus a finger on those in `touched_mask`
+static void set_electrodes(uint32_t pF, uint16_t touched_mask) {
+    for (uint8_t channel = 0; channel < TOUCH_CHANNEL_COUNT; channel++) {
+        electrode_pF[channel] = pF + (((touched_mask >> channel) & 1) ? TEST_FINGER_PF : 0);
+        sim_analog_load(touch_an_channels[channel], electrode_pF[channel], 0);
+    }
+}
+
+// scans `count` times; returns the events as press/release masks
+static void scan_touch(uint16_t count, uint16_t* pressed_mask, uint16_t* released_mask) {
+    *pressed_mask = 0;
+    *released_mask = 0;
+    for (uint16_t scan = 0; scan < count; scan++) {
+        touch_scan();
+    }
+    touch_event_t event;
+    while (touch_get_event(&event)) {
+        if (event.is_press) {
+            *pressed_mask |= (1U << event.channel);
+        }
+        else {
+            *released_mask |= (1U << event.channel);
+        }
+    }
+}
+
+static void setup_touch(void) {
+    setup_chip();
+    use_nominal_current();
+    params_reset();
+    set_electrodes(TEST_ELECTRODE_PF, 0);
+    touch_init();
+}
+
+static void release_touch(void) {
+    for (uint8_t channel = 0; channel < TOUCH_CHANNEL_COUNT; channel++) {
+        sim_analog_load(touch_an_channels[channel], 0, 0);
+    }
+    ctmu_cal = ctmu_cal_defaults;
+}
+
+// Presses and releases on several electrodes at once are reported after the
+// debounce, each once; a one-scan glitch isn't, and a long press isn't absorbed
+// into the baseline
+static void test_touch_press_release(void) {
+    setup_touch();
+    uint16_t pressed, released;
+    scan_touch(10, &pressed, &released);
+    TEST_CHECK((pressed == 0) && (released == 0) && (touch_state_mask() == 0),
+            "untouched: pressed 0x%02x, released 0x%02x, state 0x%02x", pressed, released, touch_state_mask());
+
+    set_electrodes(TEST_ELECTRODE_PF, 0x24); // electrodes 2 and 5
+    scan_touch(TOUCH_DEBOUNCE_SCANS - 1, &pressed, &released);
+    TEST_CHECK((pressed == 0) && (touch_state_mask() == 0), "pressed 0x%02x before the debounce", pressed);
+    scan_touch(1, &pressed, &released);
+    TEST_CHECK((pressed == 0x24) && (released == 0) && (touch_state_mask() == 0x24),
+            "pressed 0x%02x, released 0x%02x, state 0x%02x (delta %u)", pressed, released, touch_state_mask(),
+            touch_get_delta(2));
+
+    scan_touch(500, &pressed, &released); // a long press
+    TEST_CHECK((pressed == 0) && (released == 0) && (touch_state_mask() == 0x24),
+            "long press: pressed 0x%02x, released 0x%02x, state 0x%02x", pressed, released, touch_state_mask());
+
+    set_electrodes(TEST_ELECTRODE_PF, 0x04); // lift off 5
+    scan_touch(TOUCH_DEBOUNCE_SCANS, &pressed, &released);
+    TEST_CHECK((pressed == 0) && (released == 0x20) && (touch_state_mask() == 0x04),
+            "pressed 0x%02x, released 0x%02x, state 0x%02x", pressed, released, touch_state_mask());
+
+    set_electrodes(TEST_ELECTRODE_PF, 0x84); // a one-scan brush of 7
+    scan_touch(1, &pressed, &released);
+    set_electrodes(TEST_ELECTRODE_PF, 0x04);
+    scan_touch(10, &pressed, &released);
+    TEST_CHECK((pressed == 0) && (released == 0) && (touch_state_mask() == 0x04),
+            "glitch: pressed 0x%02x, released 0x%02x, state 0x%02x", pressed, released, touch_state_mask());
+
+    set_electrodes(TEST_ELECTRODE_PF, 0);
+    scan_touch(TOUCH_DEBOUNCE_SCANS, &pressed, &released);
+    TEST_CHECK((pressed == 0) && (released == 0x04) && (touch_state_mask() == 0),
+            "pressed 0x%02x, released 0x%02x, state 0x%02x", pressed, released, touch_state_mask());
+    release_touch();
+}
+
+// Temperature drift: every electrode creeps 10 pF up and back, 1 pF per 20
+// scans. As a step that would be a press; as a drift the baselines follow it,
+// and touches on top of it are still seen.
+static void test_touch_drift(void) {
+    setup_touch();
+    uint16_t pressed, released;
+    for (int8_t step = 1; step <= 20; step++) {
+        const uint32_t pF = TEST_ELECTRODE_PF + ((step <= 10) ? step : (20 - step));
+        set_electrodes(pF, 0);
+        scan_touch(20, &pressed, &released);
+        TEST_CHECK((pressed == 0) && (released == 0), "at %lu pF: pressed 0x%02x, released 0x%02x",
+                (unsigned long) pF, pressed, released);
+
+        if (step == 10) { // warmest: touch 0 and 7
+            set_electrodes(pF, 0x81);
+            scan_touch(TOUCH_DEBOUNCE_SCANS, &pressed, &released);
+            TEST_CHECK(pressed == 0x81, "at %lu pF: pressed 0x%02x (delta %u)", (unsigned long) pF, pressed,
+                    touch_get_delta(0));
+            set_electrodes(pF, 0);
+            scan_touch(TOUCH_DEBOUNCE_SCANS, &pressed, &released);
+            TEST_CHECK(released == 0x81, "at %lu pF: released 0x%02x", (unsigned long) pF, released);
+        }
+    }
+
+    set_electrodes(TEST_ELECTRODE_PF + 10, 0); // the same change as a step is a press everywhere
+    scan_touch(TOUCH_DEBOUNCE_SCANS, &pressed, &released);
+    TEST_CHECK(pressed == 0xFF, "a 10 pF step pressed 0x%02x (delta %u)", pressed, touch_get_delta(0));
+    release_touch();
+}
+
+static uint16_t report_count = 0;
+static uint16_t sample_count = 0;
+
+static void count_reports(void* fn) {
+    if (fn == (void*) uart_tx_enqueue_bytes) { // text reports too, through uart_tx_enqueue()
+        report_count++;
+    }
+    else if (fn == (void*) _ADC1Interrupt) {
+        sample_count++;
+    }
+}
+
+// Reports and samples per second of virtual time: the blocking loop main runs
+// without ENABLE_STREAMING (avg readings, then a Disp2String report), and
+// streaming, whose reports go out while the next samples charge
+static void test_stream_throughput(void) {
+    setup_chip();
+    sim_analog_load(TEST_AN11, 22000, 0); // 1.25 V after the default 500 us at 55 uA
+    const uint8_t avg_count = 3; // PARAM_AVG_COUNT's default
+    c_sense_2_point_delta_pF(); // find the range, as main's first report does
+
+    const uint64_t blocking_start_ps = sim_now_ps;
+    uint32_t c_pF = 0;
+    for (uint8_t i = 0; i < avg_count; i++) {
+        c_pF += c_sense_2_point_delta_pF();
+    }
+    char msg[40];
+    sprintf(msg, "    REPORT_CAP_pF=%lu\n", (unsigned long) (c_pF / avg_count));
+    Disp2String(msg);
+    const uint32_t blocking_reports = (uint32_t) (SIM_PS_PER_S / (sim_now_ps - blocking_start_ps));
+    printf("  blocking: %lu reports/s, %lu samples/s\n", (unsigned long) blocking_reports,
+            (unsigned long) blocking_reports * avg_count);
+
+    for (uint8_t binary = 0; binary <= 1; binary++) {
+        TEST_CHECK(stream_start(SINGLE_SHOT_DEFAULT_CHARGE_TIME_US, 1, STREAM_DEFAULT_PERIOD_US, binary),
+                "rejected the default settings");
+        sim_call_hook = count_reports;
+        report_count = 0;
+        sample_count = 0;
+        const uint64_t end_ps = sim_now_ps + SIM_PS_PER_S;
+        while (sim_now_ps < end_ps) {
+            stream_poll();
+        }
+        sim_call_hook = NULL;
+        stream_stop();
+        uart_tx_flush();
+
+        // every report averages the samples since the last one
+        printf("  streaming %s: %u reports/s, %u samples/s, %u dropped\n", binary ? "frames" : "text",
+                report_count, sample_count, stream_dropped_count());
+        TEST_CHECK((sample_count >= 1000000UL / STREAM_DEFAULT_PERIOD_US - 1) && (stream_dropped_count() == 0),
+                "%u samples, %u dropped", sample_count, stream_dropped_count());
+        TEST_CHECK(report_count >= 3 * blocking_reports, "%u reports/s streaming, %lu blocking", report_count,
+                (unsigned long) blocking_reports);
+    }
+    sim_analog_load(TEST_AN11, 0, 0);
+}
+
+// a shot must finish within the period, or every other one would be dropped
+static void test_stream_limits(void) {
+    setup_chip();
+    TEST_CHECK(!stream_start(STREAM_DEFAULT_PERIOD_US, 1, STREAM_DEFAULT_PERIOD_US, 0),
+            "started with the charge as long as the period");
+    TEST_CHECK(!stream_start(STREAM_DEFAULT_PERIOD_US - STREAM_SHOT_OVERHEAD_US + 1, 1, STREAM_DEFAULT_PERIOD_US, 0),
+            "started without room for the discharge and ISRs");
+    TEST_CHECK(stream_start(STREAM_DEFAULT_PERIOD_US - STREAM_SHOT_OVERHEAD_US, 1, STREAM_DEFAULT_PERIOD_US, 0),
+            "rejected a charge that just fits");
+    stream_stop();
+    // longer periods are clamped to what PR2 can hold
+    TEST_CHECK(!stream_start(STREAM_MAX_PERIOD_US, 1, UINT16_MAX, 0), "started a charge longer than PR2 allows");
+}
+
+// COBS back to the raw frame; returns its length, or 0 if `frame` isn't valid
+static uint8_t cobs_decode(const uint8_t* frame, uint8_t len, uint8_t* raw) {
+    uint8_t raw_len = 0;
+    uint8_t idx = 0;
+    while (idx < len) {
+        const uint8_t code = frame[idx];
+        if ((code == 0) || ((idx + code) > len)) {
+            return 0;
+        }
+        for (uint8_t i = 1; i < code; i++) {
+            raw[raw_len++] = frame[idx + i];
+        }
+        idx += code;
+        if ((code < 0xFF) && (idx < len)) {
+            raw[raw_len++] = 0;
+        }
+    }
+    return raw_len;
+}
+
+// Every frame telemetry_encode() builds ends in its only 0x00, fits
+// TELEMETRY_MAX_FRAME_LEN, and decodes back to the header, data and CRC put in;
+// payloads of zeros, 0xFF and mixed bytes at every length
+static void test_telemetry_frames(void) {
+    uint8_t data[TELEMETRY_MAX_DATA_LEN];
+    uint8_t frame[TELEMETRY_MAX_FRAME_LEN];
+    uint8_t raw[TELEMETRY_MAX_FRAME_LEN];
+    telemetry_seq = 250; // through the wrap
+
+    for (uint8_t fill = 0; fill < 3; fill++) {
+        for (uint8_t data_len = 0; data_len <= TELEMETRY_MAX_DATA_LEN; data_len++) {
+            for (uint8_t i = 0; i < data_len; i++) {
+                data[i] = (fill == 0) ? 0x00 : ((fill == 1) ? 0xFF : (uint8_t) (i * 37 % 5)); // 0s among the rest
+            }
+            const uint32_t timestamp = (fill == 0) ? 0 : (0x01000000UL * data_len + 0xFF00);
+            const uint8_t seq = telemetry_seq;
+            const uint8_t frame_len = telemetry_encode(TELEMETRY_TYPE_CAP_PF, timestamp, data, data_len, frame);
+
+            uint8_t zero_count = 0;
+            for (uint8_t i = 0; i < frame_len; i++) {
+                zero_count += (frame[i] == 0);
+            }
+            TEST_CHECK((frame_len <= TELEMETRY_MAX_FRAME_LEN) && (frame[frame_len - 1] == 0) && (zero_count == 1),
+                    "fill %u, %u bytes: %u-byte frame with %u zeros", fill, data_len, frame_len, zero_count);
+
+            const uint8_t raw_len = cobs_decode(frame, frame_len - 1, raw);
+            const uint16_t crc = crc16_ccitt(CRC16_CCITT_INIT, raw, raw_len - TELEMETRY_CRC_LEN);
+            TEST_CHECK((raw_len == TELEMETRY_HEADER_LEN + data_len + TELEMETRY_CRC_LEN)
+                    && (raw[0] == TELEMETRY_TYPE_CAP_PF) && (raw[1] == seq)
+                    && ((raw[2] | (raw[3] << 8) | ((uint32_t) raw[4] << 16) | ((uint32_t) raw[5] << 24)) == timestamp)
+                    && (memcmp(raw + TELEMETRY_HEADER_LEN, data, data_len) == 0)
+                    && ((raw[raw_len - 2] | (raw[raw_len - 1] << 8)) == crc),
+                    "fill %u, %u bytes: decoded to %u bytes, seq %u", fill, data_len, raw_len, raw[1]);
+        }
+    }
+    TEST_CHECK(telemetry_seq == (uint8_t) (250 + 3 * (TELEMETRY_MAX_DATA_LEN + 1)), "seq at %u", telemetry_seq);
+
+    // the CAP_PF frame both the blocking and the queued sends use: LE32 pF
+    const uint8_t raw_len = cobs_decode(frame, telemetry_encode_cap_pF(0x12003400UL, frame) - 1, raw);
+    TEST_CHECK((raw_len == TELEMETRY_HEADER_LEN + 4 + TELEMETRY_CRC_LEN) && (raw[0] == TELEMETRY_TYPE_CAP_PF)
+            && (memcmp(raw + TELEMETRY_HEADER_LEN, "\x00\x34\x00\x12", 4) == 0), "CAP_PF frame decoded to %u bytes",
+            raw_len);
+}
+
+// bytes waiting in the RX ring, oldest first
+static uint8_t drain_rx(uint8_t* out) {
+    uint8_t count = 0;
+    while ((count < UART_RX_BUF_LEN) && uart_rx_getc(&out[count])) {
+        count++;
+    }
+    return count;
+}
+
+// Back-to-back bytes at 9600 baud, with main() not reading: the ring keeps
+// the first UART_RX_BUF_LEN - 1 in order and counts the rest as dropped; a
+// masked RX interrupt lets the 4-deep FIFO overrun, a break is a framing
+// error, and each gap shows up as one UART_RX_LOST before the next byte
+static void test_uart_rx_burst(void) {
+    setup_chip();
+    uart_rx_start();
+    const uint64_t burst_ps = 250 * (SIM_PS_PER_S / 1000); // 240 chars at 9600 baud
+    char sent[100];
+    uint8_t got[UART_RX_BUF_LEN];
+    for (uint8_t i = 0; i < sizeof(sent); i++) {
+        sent[i] = (char) ('!' + i % 90);
+    }
+
+    sim_uart_rx_inject(sent, UART_RX_BUF_LEN - 1);
+    sim_advance_ps(burst_ps);
+    uint8_t count = drain_rx(got);
+    TEST_CHECK((count == UART_RX_BUF_LEN - 1) && (memcmp(got, sent, count) == 0) && (uart_rx_dropped_count == 0)
+            && (uart_rx_overrun_count == 0), "a full ring: %u bytes, %u dropped, %u overruns", count,
+            uart_rx_dropped_count, uart_rx_overrun_count);
+
+    sim_uart_rx_inject(sent, sizeof(sent));
+    sim_advance_ps(burst_ps);
+    count = drain_rx(got);
+    TEST_CHECK((count == UART_RX_BUF_LEN - 1) && (memcmp(got, sent, count) == 0)
+            && (uart_rx_dropped_count == sizeof(sent) - count) && (uart_rx_overrun_count == 0),
+            "overfilled: %u bytes, %u dropped, %u overruns", count, uart_rx_dropped_count, uart_rx_overrun_count);
+    sim_uart_rx_inject("a\n", 2);
+    sim_advance_ps(burst_ps);
+    count = drain_rx(got);
+    TEST_CHECK((count == 3) && (got[0] == UART_RX_LOST) && (got[1] == 'a') && (got[2] == '\n'),
+            "after the drops: %u bytes, first 0x%02X", count, got[0]);
+
+    IEC1bits.U2RXIE = 0; // as if a higher-priority ISR held the CPU for the whole burst
+    sim_uart_rx_inject(sent, 10);
+    sim_advance_ps(burst_ps);
+    IEC1bits.U2RXIE = 1;
+    sim_advance_ps(burst_ps);
+    sim_uart_rx_inject("b", 1);
+    sim_advance_ps(burst_ps);
+    count = drain_rx(got);
+    TEST_CHECK((count == 6) && (memcmp(got, sent, 4) == 0) && (got[4] == UART_RX_LOST) && (got[5] == 'b')
+            && (uart_rx_overrun_count == 1), "overrun: %u bytes, %u overruns", count, uart_rx_overrun_count);
+
+    sim_uart_rx_break();
+    sim_uart_rx_inject("c", 1);
+    sim_advance_ps(burst_ps);
+    count = drain_rx(got);
+    TEST_CHECK((count == 2) && (got[0] == UART_RX_LOST) && (got[1] == 'c') && (uart_rx_framing_error_count == 1),
+            "break: %u bytes, %u framing errors", count, uart_rx_framing_error_count);
+    TEST_CHECK((uart_rx_overrun_count == 1) && (uart_rx_dropped_count == sizeof(sent) - (UART_RX_BUF_LEN - 1)),
+            "counters moved: %u overruns, %u dropped", uart_rx_overrun_count, uart_rx_dropped_count);
+}
+
+// Every parameter takes its min and max, refuses one past either end without
+// changing, and is found by name; touch_release stays below touch_press
+static void test_params_bounds(void) {
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        const param_info_t* info = &param_info[id];
+        params_reset();
+        TEST_CHECK(params_find(info->name) == id, "%s not found", info->name);
+        if (id == PARAM_TOUCH_PRESS_DELTA) {
+            TEST_CHECK(params_set(PARAM_TOUCH_RELEASE_DELTA, 0), "touch_release 0 refused"); // so press can reach 1
+        }
+        const int32_t before = params_get(id);
+        TEST_CHECK(!params_set(id, info->min - 1) && !params_set(id, info->max + 1) && (params_get(id) == before),
+                "%s: out of %ld..%ld accepted, now %ld", info->name, (long) info->min, (long) info->max,
+                (long) params_get(id));
+        // touch_release's top is one below touch_press (the default, 40), not its own max
+        const int32_t top = (id == PARAM_TOUCH_RELEASE_DELTA) ? (int32_t) PARAM_U16(PARAM_TOUCH_PRESS_DELTA) - 1 : info->max;
+        TEST_CHECK(params_set(id, info->min) && (params_get(id) == info->min)
+                && params_set(id, top) && (params_get(id) == top),
+                "%s: %ld..%ld not both accepted, now %ld", info->name, (long) info->min, (long) top,
+                (long) params_get(id));
+    }
+    TEST_CHECK(params_find("nothing") == PARAM_COUNT, "found a parameter called nothing");
+
+    params_reset();
+    const uint16_t press = PARAM_U16(PARAM_TOUCH_PRESS_DELTA);
+    const uint16_t release = PARAM_U16(PARAM_TOUCH_RELEASE_DELTA);
+    TEST_CHECK(!params_set(PARAM_TOUCH_RELEASE_DELTA, press) && !params_set(PARAM_TOUCH_PRESS_DELTA, release)
+            && (PARAM_U16(PARAM_TOUCH_PRESS_DELTA) == press) && (PARAM_U16(PARAM_TOUCH_RELEASE_DELTA) == release),
+            "touch deltas put out of order: press %u, release %u", PARAM_U16(PARAM_TOUCH_PRESS_DELTA),
+            PARAM_U16(PARAM_TOUCH_RELEASE_DELTA));
+    TEST_CHECK(params_set(PARAM_TOUCH_PRESS_DELTA, release + 1) && params_set(PARAM_TOUCH_RELEASE_DELTA, 0),
+            "touch deltas refused in order");
+    params_reset();
+}
+
+// PARAM_PERSIST values survive a save and a reboot, across more saves than
+// there are slots; debug doesn't; a save cut short by power loss leaves the
+// previous values or the new ones; a stored touch pair out of order (written
+// around params_set()) loads as the defaults
+static void test_params_persistence(void) {
+    setup_chip();
+    const uint16_t store_words = PARAM_STORE_SLOT_COUNT * PARAM_STORE_SLOT_WORDS;
+    erase_eeprom_words(PARAM_STORE_FIRST_WORD, store_words);
+    TEST_CHECK(!params_load() && (PARAM_U16(PARAM_AVG_COUNT) == param_info[PARAM_AVG_COUNT].default_value),
+            "a record loaded from erased EEPROM");
+
+    for (uint16_t save = 1; save <= 3 * PARAM_STORE_SLOT_COUNT; save++) {
+        params_set(PARAM_AVG_COUNT, save);
+        params_set(PARAM_CTMU_RANGE, -1);
+        params_set(PARAM_DEBUG, 1);
+        params_save();
+        params_reset(); // reboot
+        TEST_CHECK(params_load() && (PARAM_U16(PARAM_AVG_COUNT) == save) && (PARAM_I16(PARAM_CTMU_RANGE) == -1)
+                && (PARAM_U16(PARAM_DEBUG) == 0), "save %u: avg %u, range %d, debug %u", save,
+                PARAM_U16(PARAM_AVG_COUNT), PARAM_I16(PARAM_CTMU_RANGE), PARAM_U16(PARAM_DEBUG));
+    }
+
+    int32_t cut = 0;
+    for (; cut <= 2 * PARAM_STORE_SLOT_WORDS; cut++) {
+        erase_eeprom_words(PARAM_STORE_FIRST_WORD, store_words);
+        params_load(); // forget the erased slots
+        params_set(PARAM_AVG_COUNT, 7);
+        params_save();
+        params_set(PARAM_AVG_COUNT, 100 + cut);
+        sim_nvm_power_cut(cut);
+        params_save();
+        sim_nvm_power_cut(-1);
+        params_reset(); // reboot
+        const uint8_t loaded = params_load();
+        const uint16_t avg = PARAM_U16(PARAM_AVG_COUNT);
+        TEST_CHECK(loaded && ((avg == 7) || (avg == 100 + cut)), "cut after %ld operations: loaded %u, avg %u",
+                (long) cut, loaded, avg);
+        if (avg == 100 + cut) {
+            break; // the whole save fit before the cut
+        }
+    }
+    TEST_CHECK(cut <= 2 * PARAM_STORE_SLOT_WORDS, "the save never completed");
+
+    params_reset();
+    param_values[PARAM_TOUCH_PRESS_DELTA] = 10;
+    param_values[PARAM_TOUCH_RELEASE_DELTA] = 30;
+    params_set(PARAM_AVG_COUNT, 9);
+    params_save();
+    params_reset();
+    TEST_CHECK(params_load() && (PARAM_U16(PARAM_TOUCH_PRESS_DELTA) == param_info[PARAM_TOUCH_PRESS_DELTA].default_value)
+            && (PARAM_U16(PARAM_TOUCH_RELEASE_DELTA) == param_info[PARAM_TOUCH_RELEASE_DELTA].default_value)
+            && (PARAM_U16(PARAM_AVG_COUNT) == 9), "out-of-order pair loaded as press %u, release %u (avg %u)",
+            PARAM_U16(PARAM_TOUCH_PRESS_DELTA), PARAM_U16(PARAM_TOUCH_RELEASE_DELTA), PARAM_U16(PARAM_AVG_COUNT));
+
+    erase_eeprom_words(PARAM_STORE_FIRST_WORD, store_words);
+    params_load();
+}
+
+// Every reply command_poll() can give, with each parameter at both ends of
+// its range and the read-only counters at their largest, fits the reply
+// buffer whole (ends in its \n) and writes nothing past it
+static void test_command_replies_fit(void) {
+    setup_chip();
+    uart_rx_start();
+    char lines[1024] = "list\nget rx_overrun\nset rx_overrun 1\nget\nset avg\nfoo\nget nothing\nsave\ndefaults\n"
+            "set touch_release 1023\nset period_us 1\nset charge_us 1x\nset touch_debounce_scans_x 1\n";
+    for (uint8_t id = 0; id < PARAM_COUNT; id++) {
+        const param_info_t* info = &param_info[id];
+        sprintf(lines + strlen(lines), "set %s %ld\nset %s %ld\n", info->name, (long) info->min, info->name,
+                (long) info->max);
+    }
+    uart_rx_overrun_count = 0xFFFF;
+    uart_rx_framing_error_count = 0xFFFF;
+    uart_rx_dropped_count = 0xFFFF;
+    uint16_t replies = 0;
+    const char* next = lines;
+    while (*next != '\0') {
+        // a line at a time, as the ring only holds so much
+        const char* end = strchr(next, '\n') + 1;
+        sim_uart_rx_inject(next, (uint16_t) (end - next));
+        sim_advance_ps(50 * (SIM_PS_PER_S / 1000));
+        next = end;
+        char reply[COMMAND_REPLY_MAX_LEN + 4];
+        memset(reply, '#', sizeof(reply));
+        while (command_poll(reply)) {
+            const size_t len = strnlen(reply, sizeof(reply));
+            TEST_CHECK((len < COMMAND_REPLY_MAX_LEN) && (reply[len - 1] == '\n')
+                    && (memcmp(reply + COMMAND_REPLY_MAX_LEN, "####", 4) == 0), "reply cut short or overrun: %.*s",
+                    (int) COMMAND_REPLY_MAX_LEN, reply);
+            replies++;
+            memset(reply, '#', sizeof(reply));
+        }
+    }
+    TEST_CHECK(replies == (PARAM_COUNT + 3) + 12 + 2 * PARAM_COUNT, "%u replies", replies);
+    uart_rx_overrun_count = 0;
+    uart_rx_framing_error_count = 0;
+    uart_rx_dropped_count = 0;
+    params_reset();
+}
+
+const char* const test_project = "App2_Capacitance_Sensor";
+
+const test_case_t test_cases[] = {
+    {"vdd_droop", test_vdd_droop},
+    {"vdd_droop_cap", test_vdd_droop_cap},
+    {"single_shot_cap", test_single_shot_cap},
+    {"single_shot_rc_model", test_single_shot_rc_model},
+    {"auto_range_sweep", test_auto_range_sweep},
+    {"charge_to_pF_full_range", test_charge_to_pF_full_range},
+    {"calibrate_current", test_calibrate_current},
+    {"calibrate_stray", test_calibrate_stray},
+    {"cal_store_power_loss", test_cal_store_power_loss},
+    {"record_store_rotation_and_wrap", test_record_store_rotation_and_wrap},
+    {"touch_press_release", test_touch_press_release},
+    {"touch_drift", test_touch_drift},
+    {"stream_throughput", test_stream_throughput},
+    {"stream_limits", test_stream_limits},
+    {"telemetry_frames", test_telemetry_frames},
+    {"uart_rx_burst", test_uart_rx_burst},
+    {"params_bounds", test_params_bounds},
+    {"params_persistence", test_params_persistence},
+    {"command_replies_fit", test_command_replies_fit},
+};
+
+const uint8_t test_case_count = sizeof(test_cases) / sizeof(test_cases[0]);
@@ -0,0 +1,230 @@
+/*
+ * File:   test_Project_5_CVREF.c
+ */
+
+
+#include <math.h>
+#include "sim.h"
+#include "test.h"
+#include "clock.h"
+#include "comparator.h"
+#include "timebase.h"
+
+// the ladder, from the datasheet's formulas rather than the table
+static double ladder_mV(uint8_t code, double vdd_mV) {
+    const double cvr = CVREF_CODE_CVR(code);
+    return CVREF_CODE_CVRR(code) ? (cvr / 24.0 * vdd_mV) : ((vdd_mV / 4.0) + (cvr / 32.0 * vdd_mV));
+}
+
+// Every target from 0 to 3300 mV picks a level no further from it than the
+// nearest of the 32 ladder voltages (within the table's 0.5 mV rounding)
+static void test_cvref_nearest_level(void) {
+    for (uint8_t i = 0; i < CVREF_LEVEL_COUNT; i++) {
+        const double exact_mV = ladder_mV(cvref_levels[i].code, CVREF_SUPPLY_MV);
+        TEST_CHECK(fabs(cvref_levels[i].mV - exact_mV) <= 0.5 + 1e-9, "level %u: %u mV, the ladder gives %.2f mV",
+                i, cvref_levels[i].mV, exact_mV);
+        TEST_CHECK((i == 0) || (cvref_levels[i - 1].mV <= cvref_levels[i].mV), "level %u out of order", i);
+    }
+    for (uint8_t cvrr = 0; cvrr <= 1; cvrr++) { // each code exactly once
+        for (uint8_t cvr = 0; cvr < 16; cvr++) {
+            uint8_t found = 0;
+            for (uint8_t i = 0; i < CVREF_LEVEL_COUNT; i++) {
+                found += (cvref_levels[i].code == CVREF_CODE(cvrr, cvr));
+            }
+            TEST_CHECK(found == 1, "CVRR=%u CVR=%u in the table %u times", cvrr, cvr, found);
+        }
+    }
+
+    for (uint16_t target_mV = 0; target_mV <= CVREF_SUPPLY_MV; target_mV++) {
+        double nearest_mV = 1e9;
+        for (uint8_t cvrr = 0; cvrr <= 1; cvrr++) {
+            for (uint8_t cvr = 0; cvr < 16; cvr++) {
+                const double mV = ladder_mV(CVREF_CODE(cvrr, cvr), CVREF_SUPPLY_MV);
+                nearest_mV = (fabs(mV - target_mV) < fabs(nearest_mV - target_mV)) ? mV : nearest_mV;
+            }
+        }
+        const uint8_t level_index = cvref_nearest_level(target_mV);
+        const double picked_mV = ladder_mV(cvref_levels[level_index].code, CVREF_SUPPLY_MV);
+        TEST_CHECK(fabs(picked_mV - target_mV) <= fabs(nearest_mV - target_mV) + 1.0,
+                "%u mV: picked %.2f mV, %.2f mV is nearer", target_mV, picked_mV, nearest_mV);
+    }
+}
+
+// init_cvref() sets the registers of the level it picked and returns its voltage
+static void test_init_cvref(void) {
+    set_clock_freq(8000);
+    for (uint16_t target_mV = 0; target_mV <= CVREF_SUPPLY_MV; target_mV += 50) {
+        const cvref_level_t* level = &cvref_levels[cvref_nearest_level(target_mV)];
+        const uint16_t set_mV = init_cvref(target_mV);
+        TEST_CHECK((set_mV == level->mV) && CVRCONbits.CVREN && CVRCONbits.CVROE && !CVRCONbits.CVRSS
+                && (CVRCONbits.CVRR == CVREF_CODE_CVRR(level->code)) && (CVRCONbits.CVR == CVREF_CODE_CVR(level->code)),
+                "%u mV: returned %u mV, CVRR=%u CVR=%u", target_mV, set_mV, CVRCONbits.CVRR, CVRCONbits.CVR);
+    }
+}
+
+#define TEST_C1INB_AN (4)
+#define TEST_C2INA_AN (3)
+#define TEST_STEP_US (5) // the waveforms change in steps this long
+#define TEST_LATENCY_US (10) // comparator to timestamp: interrupt entry, context save, the first read
+
+typedef struct {
+    uint32_t time_us; // from the start of the waveform
+    uint8_t comparator;
+    uint8_t is_above;
+    uint8_t zone;
+} expected_crossing_t;
+
+// Drives a triangle wave, 0 -> peak_mV -> 0 every period_us, onto C1INB and
+// C2INA, and checks the queued events against `expected`: each timestamp
+// must land between the exact crossing time and a step plus the latency after it
+static void check_triangle_crossings(uint16_t peak_mV, uint32_t period_us, uint8_t periods,
+        const expected_crossing_t* expected, uint8_t expected_count) {
+    sim_analog_drive_mV(TEST_C1INB_AN, 0);
+    sim_analog_drive_mV(TEST_C2INA_AN, 0);
+    comp_event_t event;
+    while (comparator_get_event(&event)); // whatever the setup stirred up
+
+    const uint32_t start_ticks = timebase_now();
+    const uint64_t start_ps = sim_now_ps;
+    for (uint32_t t_us = 0; t_us < period_us * periods; t_us += TEST_STEP_US) {
+        const uint32_t phase_us = t_us % period_us;
+        const uint32_t rising_us = (phase_us < period_us / 2) ? phase_us : (period_us - phase_us);
+        const int32_t mV = (int32_t) (((uint64_t) peak_mV * rising_us * 2) / period_us);
+        sim_analog_drive_mV(TEST_C1INB_AN, mV);
+        sim_analog_drive_mV(TEST_C2INA_AN, mV);
+        while (sim_now_ps < start_ps + (uint64_t) (t_us + TEST_STEP_US) * 1000000) {
+            timebase_now(); // firmware time passes; the comparator interrupt can run
+        }
+    }
+
+    uint8_t count = 0;
+    while (comparator_get_event(&event)) {
+        if (count < expected_count) {
+            const expected_crossing_t* want = &expected[count];
+            const int32_t late_ticks = (int32_t) (event.timestamp - start_ticks - want->time_us * TIMEBASE_TICKS_PER_US);
+            TEST_CHECK((event.comparator == want->comparator) && (event.is_above == want->is_above)
+                    && (event.zone == want->zone), "event %u: C%u %s zone %u, expected C%u %s zone %u", count,
+                    event.comparator, event.is_above ? "UP" : "DOWN", event.zone, want->comparator,
+                    want->is_above ? "UP" : "DOWN", want->zone);
+            TEST_CHECK((late_ticks >= 0) && (late_ticks <= (TEST_STEP_US + TEST_LATENCY_US) * TIMEBASE_TICKS_PER_US),
+                    "event %u: %ld ticks after the crossing at %lu us", count, (long) late_ticks,
+                    (unsigned long) want->time_us);
+        }
+        count++;
+    }
+    TEST_CHECK(count == expected_count, "%u events, expected %u", count, expected_count);
+    TEST_CHECK(comparator_dropped_count() == 0, "%u events dropped", comparator_dropped_count());
+}
+
+// when a 0 -> peak -> 0 triangle over period_us first reaches threshold_mV (it
+// comes back down through it that long before the end of the period)
+static uint32_t rising_crossing_us(double threshold_mV, uint16_t peak_mV, uint32_t period_us) {
+    return (uint32_t) ceil(threshold_mV / peak_mV * (period_us / 2.0));
+}
+
+// One threshold: a crossing each way per period, timestamped to within a
+// waveform step plus the interrupt latency
+static void test_comparator_threshold_crossings(void) {
+    set_clock_freq(8000);
+    const uint16_t threshold_mV = comparator_init_threshold(1650);
+    const uint16_t peak_mV = 3300;
+    const uint32_t period_us = 2000;
+    const uint32_t up_us = rising_crossing_us(threshold_mV, peak_mV, period_us);
+    expected_crossing_t expected[6];
+    for (uint8_t period = 0; period < 3; period++) {
+        expected[2 * period] = (expected_crossing_t) {period * period_us + up_us, 1, 1, COMP_ZONE_ABOVE};
+        expected[2 * period + 1] = (expected_crossing_t) {(period + 1) * period_us - up_us, 1, 0, COMP_ZONE_BELOW};
+    }
+    check_triangle_crossings(peak_mV, period_us, 3, expected, 6);
+    comparator_stop();
+}
+
+// Window: C2 against VBG/2 below, C1 against CVREF above, and the zone the
+// signal is in after each crossing
+static void test_comparator_window_crossings(void) {
+    set_clock_freq(8000);
+    const uint16_t high_mV = comparator_init_window(2000);
+    TEST_CHECK(high_mV == 1959, "window top at %u mV", high_mV);
+    const uint16_t peak_mV = 3300;
+    const uint32_t period_us = 4000;
+    // C2 only sees the signal above VBG/2 once it is strictly above it
+    const uint32_t low_up_us = rising_crossing_us(SIM_VBG_MV / 2.0 + 1, peak_mV, period_us);
+    const uint32_t low_down_us = period_us - rising_crossing_us(SIM_VBG_MV / 2.0, peak_mV, period_us);
+    const uint32_t high_up_us = rising_crossing_us(high_mV, peak_mV, period_us);
+    const expected_crossing_t expected[] = {
+        {low_up_us, 2, 1, COMP_ZONE_INSIDE},
+        {high_up_us, 1, 1, COMP_ZONE_ABOVE},
+        {period_us - high_up_us, 1, 0, COMP_ZONE_INSIDE},
+        {low_down_us, 2, 0, COMP_ZONE_BELOW},
+    };
+    check_triangle_crossings(peak_mV, period_us, 1, expected, sizeof(expected) / sizeof(expected[0]));
+
+    TEST_CHECK(comparator_init_window(COMP_WINDOW_LOW_MV) == 0, "a window top at the bottom threshold");
+    TEST_CHECK(comparator_init_window(3000) == 0, "a window top above the ladder");
+    comparator_stop();
+}
+
+// Synthetic inputs every 3 mV from 0 to VDD, at two supplies: five comparisons
+// bracket each between the ladder voltages just below and above it, and the
+// result matches a search over the ladder in double
+static void test_comparator_sar_synthetic(void) {
+    set_clock_freq(8000);
+    static const uint16_t supplies_mV[] = {3300, 3000};
+    for (uint8_t s = 0; s < sizeof(supplies_mV) / sizeof(supplies_mV[0]); s++) {
+        sim_vdd_mV = supplies_mV[s];
+        cvref_vdd_mV = supplies_mV[s]; // as main would after measuring it
+        comparator_sar_init();
+        uint32_t readings = 0;
+        uint64_t slowest_ps = 0;
+        for (uint16_t input_mV = 0; input_mV <= supplies_mV[s]; input_mV += 3) {
+            // the highest ladder voltage at or below the input, and the next one up
+            double below_mV = 0, above_mV = supplies_mV[s];
+            uint8_t too_close = 0; // within the table's rounding of a level
+            for (uint8_t i = 0; i < CVREF_LEVEL_COUNT; i++) {
+                const double mV = ladder_mV(cvref_levels[i].code, supplies_mV[s]);
+                below_mV = ((mV <= input_mV) && (mV > below_mV)) ? mV : below_mV;
+                above_mV = ((mV > input_mV) && (mV < above_mV)) ? mV : above_mV;
+                too_close |= (fabs(mV - input_mV) < 1.0);
+            }
+            if (too_close) {
+                continue;
+            }
+
+            sim_analog_drive_mV(TEST_C1INB_AN, input_mV);
+            const uint64_t start_ps = sim_now_ps;
+            comp_sar_result_t result;
+            comparator_sar_measure(&result);
+            slowest_ps = ((sim_now_ps - start_ps) > slowest_ps) ? (sim_now_ps - start_ps) : slowest_ps;
+            readings++;
+
+            TEST_CHECK((fabs(result.low_mV - below_mV) <= 1.0) && (fabs(result.high_mV - above_mV) <= 1.0),
+                    "%u mV at VDD %u mV: %u..%u mV, the ladder brackets it %.1f..%.1f mV", input_mV,
+                    supplies_mV[s], result.low_mV, result.high_mV, below_mV, above_mV);
+            TEST_CHECK((result.low_mV <= input_mV) && (input_mV <= result.high_mV)
+                    && (result.mV == (result.low_mV + result.high_mV) / 2), "%u mV: read %u mV (%u..%u)",
+                    input_mV, result.mV, result.low_mV, result.high_mV);
+            TEST_CHECK(cvref_level_mV(result.level_index) == result.low_mV, "%u mV: level %u is %u mV, not %u",
+                    input_mV, result.level_index, cvref_level_mV(result.level_index), result.low_mV);
+        }
+        printf("  VDD %u mV: %lu readings, slowest %lu us\n", supplies_mV[s], (unsigned long) readings,
+                (unsigned long) (slowest_ps / 1000000));
+        TEST_CHECK(slowest_ps < (uint64_t) COMP_SAR_STEPS * (COMP_SAR_SETTLE_US + 10) * 1000000,
+                "a reading took %lu us", (unsigned long) (slowest_ps / 1000000));
+    }
+    sim_analog_drive_mV(TEST_C1INB_AN, -1);
+    sim_vdd_mV = SIM_DEFAULT_VDD_MV;
+    cvref_vdd_mV = CVREF_SUPPLY_MV;
+    comparator_stop();
+}
+
+const char* const test_project = "Project_5_CVREF";
+
+const test_case_t test_cases[] = {
+    {"cvref_nearest_level", test_cvref_nearest_level},
+    {"init_cvref", test_init_cvref},
+    {"comparator_threshold_crossings", test_comparator_threshold_crossings},
+    {"comparator_window_crossings", test_comparator_window_crossings},
+    {"comparator_sar_synthetic", test_comparator_sar_synthetic},
+};
+
+const uint8_t test_case_count = sizeof(test_cases) / sizeof(test_cases[0]);
@@ -0,0 +1,144 @@
+/*
+ * File:   test_Project_6_CTMU.c
+ */
+
+
+#include <math.h>
+#include "sim.h"
+#include "test.h"
+#include "stats.h"
+
+// deterministic noise for the sample sequences
+static uint32_t lcg_state = 1;
+
+static uint32_t lcg_next(void) {
+    lcg_state = lcg_state * 1664525UL + 1013904223UL;
+    return lcg_state >> 8;
+}
+
+typedef uint16_t (*sample_fn_t)(uint32_t i);
+
+static uint16_t constant_samples(uint32_t i) {
+    (void) i;
+    return 700;
+}
+
+static uint16_t quiet_samples(uint32_t i) { // a steady reading: +-1 count around 1000
+    (void) i;
+    return (uint16_t) (999 + lcg_next() % 3);
+}
+
+static uint16_t noisy_samples(uint32_t i) {
+    (void) i;
+    return (uint16_t) (500 + lcg_next() % 41);
+}
+
+static uint16_t full_range_samples(uint32_t i) {
+    (void) i;
+    return (uint16_t) (lcg_next() % 1024);
+}
+
+static uint16_t rail_samples(uint32_t i) { // 0 and 1023, alternating
+    return (i & 1) ? 1023 : 0;
+}
+
+static uint16_t drifting_samples(uint32_t i) { // a slow ramp across the range
+    return (uint16_t) ((i / 64) % 1024);
+}
+
+// Welford in integers against a two-pass mean and sample standard deviation in
+// double, over sequences from a handful of samples up to the 65535 it counts
+static void test_stats_vs_double(void) {
+    static const struct {
+        const char* name;
+        sample_fn_t next;
+    } sequences[] = {
+        {"constant", constant_samples},
+        {"quiet", quiet_samples},
+        {"noisy", noisy_samples},
+        {"full_range", full_range_samples},
+        {"rail", rail_samples},
+        {"drifting", drifting_samples},
+    };
+    static const uint32_t lengths[] = {1, 2, 3, 10, 100, 1000, 10000, 65535};
+    static uint16_t samples[UINT16_MAX];
+
+    for (uint8_t s = 0; s < sizeof(sequences) / sizeof(sequences[0]); s++) {
+        for (uint8_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+            const uint32_t count = lengths[l];
+            lcg_state = 1;
+            sample_stats_t stats;
+            stats_reset(&stats);
+            double sum = 0;
+            uint16_t min = UINT16_MAX, max = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                samples[i] = sequences[s].next(i);
+                stats_add(&stats, samples[i]);
+                sum += samples[i];
+                min = (samples[i] < min) ? samples[i] : min;
+                max = (samples[i] > max) ? samples[i] : max;
+            }
+            const double mean = sum / count;
+            double m2 = 0;
+            for (uint32_t i = 0; i < count; i++) {
+                m2 += (samples[i] - mean) * (samples[i] - mean);
+            }
+            const double std = (count < 2) ? 0 : sqrt(m2 / (count - 1));
+
+            // the mean to 1/256 count; the standard deviation to 1/256 count
+            // or 0.1%, whichever is larger (the Q16 rounding of each step)
+            const double mean_q8 = stats_mean_q8(&stats);
+            const double std_q8 = stats_std_q8(&stats);
+            const double std_tolerance_q8 = (std * 256 * 0.001 > 1.0) ? std * 256 * 0.001 : 1.0;
+            TEST_CHECK(fabs(mean_q8 - mean * 256) <= 1.0, "%s x %lu: mean %.2f/256, double says %.2f/256",
+                    sequences[s].name, (unsigned long) count, mean_q8, mean * 256);
+            TEST_CHECK(fabs(std_q8 - std * 256) <= std_tolerance_q8, "%s x %lu: std %.2f/256, double says %.2f/256",
+                    sequences[s].name, (unsigned long) count, std_q8, std * 256);
+            TEST_CHECK((stats.count == count) && (stats.min == min) && (stats.max == max),
+                    "%s x %lu: count %u, min %u, max %u", sequences[s].name, (unsigned long) count,
+                    stats.count, stats.min, stats.max);
+        }
+    }
+
+    // once full, further samples are ignored rather than wrapping the count
+    sample_stats_t stats;
+    stats_reset(&stats);
+    for (uint32_t i = 0; i < UINT16_MAX; i++) {
+        stats_add(&stats, 100);
+    }
+    stats_add(&stats, 1023);
+    TEST_CHECK((stats.count == UINT16_MAX) && (stats_mean_q8(&stats) == 100 * 256) && (stats.max == 100),
+            "past full: count %u, mean %lu/256, max %u", stats.count, (unsigned long) stats_mean_q8(&stats),
+            stats.max);
+}
+
+// floor(sqrt()) exactly, at perfect squares, just below them, and at the top
+static void test_isqrt64(void) {
+    static const uint64_t roots[] = {0, 1, 2, 3, 255, 256, 65535, 65536, 1000003, 4294967295ULL};
+    for (uint8_t r = 0; r < sizeof(roots) / sizeof(roots[0]); r++) {
+        const uint64_t square = roots[r] * roots[r];
+        TEST_CHECK(isqrt64(square) == roots[r], "isqrt64(%llu) = %lu", (unsigned long long) square,
+                (unsigned long) isqrt64(square));
+        if (square > 0) {
+            TEST_CHECK(isqrt64(square - 1) == roots[r] - 1, "isqrt64(%llu) = %lu",
+                    (unsigned long long) (square - 1), (unsigned long) isqrt64(square - 1));
+        }
+    }
+    TEST_CHECK(isqrt64(UINT64_MAX) == 4294967295UL, "isqrt64(UINT64_MAX) = %lu", (unsigned long) isqrt64(UINT64_MAX));
+    lcg_state = 1;
+    for (uint16_t i = 0; i < 1000; i++) {
+        const uint64_t val = (((uint64_t) lcg_next()) << 40) ^ (((uint64_t) lcg_next()) << 16) ^ lcg_next();
+        const uint64_t root = isqrt64(val);
+        TEST_CHECK((root * root <= val) && ((root + 1) * (root + 1) > val), "isqrt64(%llu) = %llu",
+                (unsigned long long) val, (unsigned long long) root);
+    }
+}
+
+const char* const test_project = "Project_6_CTMU";
+
+const test_case_t test_cases[] = {
+    {"stats_vs_double", test_stats_vs_double},
+    {"isqrt64", test_isqrt64},
+};
+
+const uint8_t test_case_count = sizeof(test_cases) / sizeof(test_cases[0]);
@@ -0,0 +1,169 @@
+import serial
+import serial.tools.list_ports # important
+import easygui
+from loguru import logger
+import argparse
+import re
+import sys
+import time
+from pathlib import Path
+
+# pip install pyserial loguru easygui
+
+# Decodes the binary frames that pic24_hal/profile.c sends over UART2
+# (mixed in with the normal text output), pairs the PROFILE_START/PROFILE_STOP
+# records, and prints min/mean/max/p99 per section.
+#
+# Usage:
+#   python decode_profile.py                       # pick a serial port, Ctrl+C to stop
+#   python decode_profile.py --file capture.bin    # a saved capture (or the host simulator's SIM_UART_OUT)
+
+FRAME_SYNC = bytes([0xA5, 0x5A])
+FRAME_HEADER_LEN = 3 # count, dropped (LE16)
+RECORD_LEN = 5 # tag, lsw (LE16), msw (LE16)
+DEFAULT_HEADER = Path(__file__).parent.parent / "Project_5_CVREF" / "profile_sections.h"
+
+def load_section_names(header_path: Path) -> list[str]:
+	"""Section names in enum order, from a project's profile_section_t enum (profile_sections.h)."""
+	text = header_path.read_text()
+	names = re.findall(r"^\s*PROFILE_SECTION_(\w+)\s*,", text, flags=re.MULTILINE)
+	return [name for name in names if name != "COUNT"]
+
+def prompt_for_serial_port():
+	port_list = serial.tools.list_ports.comports()
+	port_list_str: list[str] = [port.device for port in port_list]
+	logger.info(f"Available ports: {port_list_str}")
+
+	if not port_list:
+		logger.error("No serial ports found. Exiting...")
+		sys.exit(1)
+
+	if len(port_list_str) == 1:
+		logger.info(f"Only one port found: {port_list_str[0]}")
+		return port_list_str[0]
+
+	port = easygui.choicebox("Select the serial port", choices=[port.device for port in port_list])
+
+	if not port:
+		logger.error("No port selected. Exiting...")
+		sys.exit(1)
+
+	return port
+
+class ProfileDecoder:
+	def __init__(self, section_names: list[str]):
+		self.section_names = section_names
+		self.buffer = bytearray()
+		self.open_starts: dict[int, int] = {} # section -> start timestamp
+		self.durations: dict[int, list[int]] = {} # section -> ticks
+		self.frame_count = 0
+		self.bad_frame_count = 0
+		self.dropped_records = 0
+		self.unpaired_records = 0
+
+	def feed(self, data: bytes) -> None:
+		self.buffer += data
+		while True:
+			sync_idx = self.buffer.find(FRAME_SYNC)
+			if sync_idx < 0:
+				del self.buffer[:-1] # keep a possible first sync byte
+				return
+			del self.buffer[:sync_idx]
+
+			if len(self.buffer) < 2 + FRAME_HEADER_LEN:
+				return
+			count = self.buffer[2]
+			frame_len = 2 + FRAME_HEADER_LEN + count * RECORD_LEN + 1
+			if len(self.buffer) < frame_len:
+				return
+
+			body = self.buffer[2:frame_len - 1]
+			if (sum(body) & 0xFF) != self.buffer[frame_len - 1]:
+				# sync bytes that weren't a frame (or a corrupted one): skip past them
+				self.bad_frame_count += 1
+				del self.buffer[:2]
+				continue
+
+			self.frame_count += 1
+			self.dropped_records += body[1] | (body[2] << 8)
+			for record_idx in range(count):
+				record = body[FRAME_HEADER_LEN + record_idx * RECORD_LEN:][:RECORD_LEN]
+				timestamp = record[1] | (record[2] << 8) | (record[3] << 16) | (record[4] << 24)
+				self.add_record(record[0], timestamp)
+			del self.buffer[:frame_len]
+
+	def add_record(self, tag: int, timestamp: int) -> None:
+		section = tag >> 1
+		is_stop = tag & 1
+		if not is_stop:
+			if section in self.open_starts:
+				self.unpaired_records += 1 # its stop was dropped
+			self.open_starts[section] = timestamp
+			return
+
+		start = self.open_starts.pop(section, None)
+		if start is None:
+			self.unpaired_records += 1 # its start was dropped
+			return
+		ticks = (timestamp - start) & 0xFFFFFFFF # the timebase wraps
+		self.durations.setdefault(section, []).append(ticks)
+
+	def section_name(self, section: int) -> str:
+		if section < len(self.section_names):
+			return self.section_names[section]
+		return f"SECTION_{section}"
+
+	def summary(self, ticks_per_us: float) -> str:
+		lines = [f"{'section':<20} {'n':>7} {'min_us':>10} {'mean_us':>10} {'max_us':>10} {'p99_us':>10}"]
+		for section in sorted(self.durations):
+			ticks = sorted(self.durations[section])
+			p99 = ticks[min(len(ticks) - 1, (99 * len(ticks) + 99) // 100 - 1)] # nearest rank
+			lines.append(
+				f"{self.section_name(section):<20} {len(ticks):>7} "
+				f"{ticks[0] / ticks_per_us:>10.2f} {sum(ticks) / len(ticks) / ticks_per_us:>10.2f} "
+				f"{ticks[-1] / ticks_per_us:>10.2f} {p99 / ticks_per_us:>10.2f}"
+			)
+		lines.append(
+			f"frames={self.frame_count} bad_frames={self.bad_frame_count} "
+			f"dropped_records={self.dropped_records} unpaired_records={self.unpaired_records}"
+		)
+		return "\n".join(lines)
+
+def read_serial_data(port: str, decoder: ProfileDecoder, baud: int, ticks_per_us: float) -> None:
+	logger.info(f"Starting reading data. Press Ctrl+C to stop...")
+
+	with serial.Serial(port, baud, timeout=1) as ser:
+		last_print_msg_time = time.time()
+		try:
+			while True:
+				decoder.feed(ser.read(ser.in_waiting or 1))
+
+				if time.time() - last_print_msg_time > 5:
+					logger.info(f"So far:\n{decoder.summary(ticks_per_us)}")
+					last_print_msg_time = time.time()
+
+		except KeyboardInterrupt:
+			logger.info("Got keyboard interrupt. Exiting...")
+
+def main():
+	parser = argparse.ArgumentParser(description="Per-section timings from the firmware's profile frames")
+	parser.add_argument("--file", type=Path, help="decode a capture file instead of a serial port")
+	parser.add_argument("--port", help="serial port (default: prompt)")
+	parser.add_argument("--baud", type=int, default=9600)
+	parser.add_argument("--header", type=Path, default=DEFAULT_HEADER, help="the project's profile_sections.h, for the section names")
+	parser.add_argument("--ticks-per-us", type=float, default=4.0, help="timebase rate (Fcy in MHz)")
+	args = parser.parse_args()
+
+	decoder = ProfileDecoder(load_section_names(args.header))
+
+	if args.file:
+		decoder.feed(args.file.read_bytes())
+	else:
+		port = args.port or prompt_for_serial_port()
+		logger.info(f"Selected port: {port}")
+		read_serial_data(port, decoder, args.baud, args.ticks_per_us)
+
+	print(decoder.summary(args.ticks_per_us))
+
+if __name__ == "__main__":
+	main()
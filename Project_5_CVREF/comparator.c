@@ -8,82 +8,275 @@
 
 #include "xc.h"
 #include "comparator.h"
-#include "uart.h"
+#include "timebase.h"
+#include "delay.h"
 
-#include <string.h>
-#include <stdio.h>
-#include <math.h> // for ceil/floor
+// Every CVREF output at VDD = CVREF_SUPPLY_MV, sorted by mV:
+//   CVRR = 1: CVR/24 * VDD (0 to 2063 mV, 137.5 mV steps)
+//   CVRR = 0: VDD/4 + CVR/32 * VDD (825 to 2372 mV, 103.1 mV steps)
+// Four voltages are reachable both ways; either code is fine.
+const cvref_level_t cvref_levels[CVREF_LEVEL_COUNT] = {
+    {0, CVREF_CODE(1, 0)},
+    {138, CVREF_CODE(1, 1)},
+    {275, CVREF_CODE(1, 2)},
+    {413, CVREF_CODE(1, 3)},
+    {550, CVREF_CODE(1, 4)},
+    {688, CVREF_CODE(1, 5)},
+    {825, CVREF_CODE(0, 0)},
+    {825, CVREF_CODE(1, 6)},
+    {928, CVREF_CODE(0, 1)},
+    {963, CVREF_CODE(1, 7)},
+    {1031, CVREF_CODE(0, 2)},
+    {1100, CVREF_CODE(1, 8)},
+    {1134, CVREF_CODE(0, 3)},
+    {1238, CVREF_CODE(0, 4)},
+    {1238, CVREF_CODE(1, 9)},
+    {1341, CVREF_CODE(0, 5)},
+    {1375, CVREF_CODE(1, 10)},
+    {1444, CVREF_CODE(0, 6)},
+    {1513, CVREF_CODE(1, 11)},
+    {1547, CVREF_CODE(0, 7)},
+    {1650, CVREF_CODE(0, 8)},
+    {1650, CVREF_CODE(1, 12)},
+    {1753, CVREF_CODE(0, 9)},
+    {1788, CVREF_CODE(1, 13)},
+    {1856, CVREF_CODE(0, 10)},
+    {1925, CVREF_CODE(1, 14)},
+    {1959, CVREF_CODE(0, 11)},
+    {2063, CVREF_CODE(0, 12)},
+    {2063, CVREF_CODE(1, 15)},
+    {2166, CVREF_CODE(0, 13)},
+    {2269, CVREF_CODE(0, 14)},
+    {2372, CVREF_CODE(0, 15)},
+};
 
-void init_cvref(float vref) {
-    // Sets the Pin 17 CVREF value (recall, total 20 pins)
-    const float rsrc_val = 3.3; // supply voltage
-    
-    // Choose CVRR based on vref
-    uint8_t cvrr_val = 0; // 1 bit (0 or 1)
-    uint8_t cvr_val = 10; // 4 bits (values 0-15)
+// The table is for VDD = CVREF_SUPPLY_MV; the ladder scales with VDD, so set
+// this to the measured supply to correct every level at once
+uint16_t cvref_vdd_mV = CVREF_SUPPLY_MV;
+
+uint16_t cvref_level_mV(uint8_t level_index) {
+    return (uint16_t) ((((uint32_t) cvref_levels[level_index].mV) * cvref_vdd_mV + (CVREF_SUPPLY_MV / 2)) / CVREF_SUPPLY_MV);
+}
+
+// Index of the level closest to `target_mV` (binary search, 5 steps)
+uint8_t cvref_nearest_level(uint16_t target_mV) {
+    // find the first level >= target
+    uint8_t low = 0;
+    uint8_t high = CVREF_LEVEL_COUNT;
+    while (low < high) {
+        const uint8_t mid = (low + high) / 2;
+        if (cvref_levels[mid].mV < target_mV) {
+            low = mid + 1;
+        }
+        else {
+            high = mid;
+        }
+    }
     
-    // Calculate CVR3:0 to get the correct voltage references
+    if (low == CVREF_LEVEL_COUNT) {
+        return CVREF_LEVEL_COUNT - 1; // above the top level
+    }
+    if ((low > 0) && ((target_mV - cvref_levels[low - 1].mV) < (cvref_levels[low].mV - target_mV))) {
+        return low - 1; // the level below is closer
+    }
+    return low;
+}
+
+// code = CVREF_CODE(CVRR, CVR)
+void cvref_set_code(uint8_t code) {
+    // Output the voltage reference to Cvref (PIN17) on the PIC 24F
+    // (verify with scope or multimeter)
+    CVRCONbits.CVREN = 1;
+    CVRCONbits.CVROE = 1;
+    CVRCONbits.CVRR = CVREF_CODE_CVRR(code);
+    CVRCONbits.CVRSS = 0;
+    CVRCONbits.CVR = CVREF_CODE_CVR(code);
+}
+
+// Sets the Pin 17 CVREF value (recall, total 20 pins) to the closest level,
+// and returns the voltage actually set
+uint16_t init_cvref(uint16_t vref_mV) {
+    const cvref_level_t* level = &cvref_levels[cvref_nearest_level(vref_mV)];
+    cvref_set_code(level->code);
+    return level->mV;
+}
+
+comp_event_t comp_event_queue[COMP_EVENT_QUEUE_LEN];
+volatile uint8_t comp_event_head = 0; // next to write
+volatile uint8_t comp_event_tail = 0; // next to read
+volatile uint16_t comp_events_dropped = 0;
+
+uint8_t comp_window_enabled = 0;
+
+// C1: non-inverting input = CVREF, inverting input = the signal on C1INB.
+// The raw output is 1 when the signal is BELOW the threshold, so CPOL flips it
+// to read 1 = above.
+void comparator_config_c1(void) {
+    CM1CONbits.CON = 0;
+    CM1CONbits.COE = 0; // output stays internal
+    CM1CONbits.CPOL = 1; // 1 = signal above CVREF
+    CM1CONbits.CREF = 1; // non-inverting input = CVREF
+    CM1CONbits.CCH = 0b00; // inverting input = C1INB
+    CM1CONbits.EVPOL = 0b11; // event on both edges
+    CM1CONbits.CEVT = 0;
+    CM1CONbits.CON = 1;
+}
+
+// C2: non-inverting input = the signal on C2INA, inverting input = VBG/2,
+// so the output is already 1 = above
+void comparator_config_c2(void) {
+    CM2CONbits.CON = 0;
+    CM2CONbits.COE = 0;
+    CM2CONbits.CPOL = 0;
+    CM2CONbits.CREF = 0; // non-inverting input = C2INA
+    CM2CONbits.CCH = 0b11; // inverting input = VBG/2
+    CM2CONbits.EVPOL = 0b11;
+    CM2CONbits.CEVT = 0;
+    CM2CONbits.CON = 1;
+}
+
+void comparator_start(void) {
+    comp_event_head = 0;
+    comp_event_tail = 0;
+    comp_events_dropped = 0;
     
-    // Method:
-    //   1. Calculate the closest/best value for CVR for each CVRR case
-    //   2. Calculate the theoretical CVREF output value for that scenario
-    //   3. Pick whichever is closer to vref
-    // Notation:
-    //   1. case0: cvrr_val = 0
-    //   2. case1: cvrr_val = 1
+    TRISBbits.TRISB2 = 1; // C1INB as input
+    AD1PCFG &= ~(1U << COMP_C1INB_PCFG_BIT); // analog mode
     
-    const float cvr_case0_f = (vref - (rsrc_val / 4.0)) * 32.0 / rsrc_val;
-    const float cvr_case1_f = (vref * 24.0 / rsrc_val);
+    timebase_start();
     
-    // round the values: int n = (d - floor(d) > 0.5) ? ceil(d) : floor(d);
-    const uint8_t cvr_case0 = (cvr_case0_f - floor(cvr_case0_f) > 0.5) ? ceil(cvr_case0_f) : floor(cvr_case0_f);
-    const uint8_t cvr_case1 = (cvr_case1_f - floor(cvr_case1_f) > 0.5) ? ceil(cvr_case1_f) : floor(cvr_case1_f);
+    IFS1bits.CMIF = 0;
+    IPC4bits.CMIP = COMP_INTERRUPT_PRIORITY;
+    IEC1bits.CMIE = 1;
+}
+
+// One threshold: events whenever the signal crosses CVREF in either direction.
+// Returns the threshold actually set.
+uint16_t comparator_init_threshold(uint16_t threshold_mV) {
+    comp_window_enabled = 0;
+    CM2CONbits.CON = 0;
     
-    const float vref_set_case0 = (rsrc_val / 4.0) + ((float)cvr_case0 / 32.0 * rsrc_val);
-    const float vref_set_case1 = ((float)cvr_case1 / 24.0) * rsrc_val;
+    const uint16_t set_mV = init_cvref(threshold_mV);
+    comparator_config_c1();
+    comparator_start();
+    return set_mV;
+}
+
+// Window: events when the signal enters or leaves COMP_WINDOW_LOW_MV..high_mV.
+// Wire the signal to C2INA as well. Returns the upper threshold actually set,
+// or 0 (nothing configured) if high_mV is beyond the top CVREF level, or its
+// nearest level isn't above the fixed lower threshold.
+uint16_t comparator_init_window(uint16_t high_mV) {
+    const cvref_level_t* level = &cvref_levels[cvref_nearest_level(high_mV)];
+    if ((high_mV > cvref_levels[CVREF_LEVEL_COUNT - 1].mV) || (level->mV <= COMP_WINDOW_LOW_MV)) {
+        return 0;
+    }
+    comp_window_enabled = 1;
     
-    if (cvr_case1 > 15) {
-        // have to force case0, which is capable of approximating a little higher
-        cvrr_val = 0; // case0
-        cvr_val = cvr_case0;
+    cvref_set_code(level->code);
+    TRISBbits.TRISB1 = 1; // C2INA as input
+    AD1PCFG &= ~(1U << COMP_C2INA_PCFG_BIT); // analog mode
+    comparator_config_c1();
+    comparator_config_c2();
+    comparator_start();
+    return level->mV;
+}
+
+void comparator_stop(void) {
+    IEC1bits.CMIE = 0;
+    CM1CONbits.CON = 0;
+    CM2CONbits.CON = 0;
+    if (comp_window_enabled) {
+        AD1PCFG |= (1U << COMP_C2INA_PCFG_BIT); // RB1 digital again, for U2RX
     }
-    else if (fabs(vref_set_case0 - vref) < fabs(vref_set_case1 - vref)) {
-        // case0 wins
-        cvrr_val = 0; // case0
-        cvr_val = cvr_case0;
+}
+
+uint8_t comparator_get_zone(void) {
+    if (CMSTATbits.C1OUT) {
+        return COMP_ZONE_ABOVE;
     }
-    else {
-        // case0 wins
-        cvrr_val = 1; // case1
-        cvr_val = cvr_case1;
+    if (comp_window_enabled && CMSTATbits.C2OUT) {
+        return COMP_ZONE_INSIDE;
     }
-    
-    // restrict the max value
-    if (cvr_val > 15) {
-        cvr_val = 15;
+    return COMP_ZONE_BELOW;
+}
+
+void comparator_push_event(uint32_t timestamp, uint8_t comparator, uint8_t is_above, uint8_t zone) {
+    const uint8_t next_head = (comp_event_head + 1) % COMP_EVENT_QUEUE_LEN;
+    if (next_head == comp_event_tail) {
+        comp_events_dropped++;
+        return;
     }
+    comp_event_queue[comp_event_head].timestamp = timestamp;
+    comp_event_queue[comp_event_head].comparator = comparator;
+    comp_event_queue[comp_event_head].is_above = is_above;
+    comp_event_queue[comp_event_head].zone = zone;
+    comp_event_head = next_head;
+}
+
+void __attribute__ ((interrupt, no_auto_psv)) _CompInterrupt(void) {
+    const uint32_t timestamp = timebase_now(); // first, before anything else
+    const uint8_t zone = comparator_get_zone();
     
-    // Output the voltage reference to Cvref (PIN17) on the PIC 24F
-    // (verify with scope or multimeter)
-    CVRCONbits.CVREN = 1;
-    CVRCONbits.CVROE = 1;
-    CVRCONbits.CVRR = cvrr_val;
-    CVRCONbits.CVRSS = 0;
-    CVRCONbits.CVR = cvr_val;
-    
-    // forwards-calculate the cvref_set again, just to confirm
-    float cvref_set = -1;
-    if (cvrr_val == 1) {
-        cvref_set = ((float)cvr_val / 24.0) * rsrc_val;
+    // CEVT must be cleared, or that comparator stops raising events
+    if (CMSTATbits.C1EVT) {
+        CM1CONbits.CEVT = 0;
+        comparator_push_event(timestamp, 1, CMSTATbits.C1OUT, zone);
+    }
+    if (CMSTATbits.C2EVT) {
+        CM2CONbits.CEVT = 0;
+        comparator_push_event(timestamp, 2, CMSTATbits.C2OUT, zone);
     }
-    else if (cvrr_val == 0) {
-        cvref_set = (rsrc_val / 4.0) + ((float)cvr_val / 32.0 * rsrc_val);
+    IFS1bits.CMIF = 0;
+}
+
+uint8_t comparator_get_event(comp_event_t* event) {
+    // returns 1 and fills `event` if one was queued
+    if (comp_event_tail == comp_event_head) {
+        return 0;
     }
+    *event = comp_event_queue[comp_event_tail];
+    comp_event_tail = (comp_event_tail + 1) % COMP_EVENT_QUEUE_LEN;
+    return 1;
+}
+
+uint16_t comparator_dropped_count(void) {
+    return comp_events_dropped;
+}
+
+// C1 against CVREF as in threshold mode, but polled: no events while the
+// ladder steps around
+void comparator_sar_init(void) {
+    comparator_stop();
+    comp_window_enabled = 0;
     
-    // Display the CVR and CVRR value selected by your code on the PC terminal.
-    char msg[200];
-    sprintf(msg, "init_cvref(vref_target=%f) -> CVR=%d, CVRR=%d -> vref_set=%f\n",
-            vref, cvr_val, cvrr_val, cvref_set);
-    Disp2String(msg);
+    TRISBbits.TRISB2 = 1; // C1INB as input
+    AD1PCFG &= ~(1U << COMP_C1INB_PCFG_BIT); // analog mode
+    comparator_config_c1();
 }
 
+// ~COMP_SAR_STEPS * COMP_SAR_SETTLE_US per reading. The levels are sorted, so
+// a bitwise binary search over the table index works like a SAR ADC; the
+// duplicate voltages just cost some resolution, not correctness.
+void comparator_sar_measure(comp_sar_result_t* result) {
+    uint8_t level_index = 0;
+    for (uint8_t bit = (CVREF_LEVEL_COUNT >> 1); bit != 0; bit >>= 1) {
+        const uint8_t trial_index = level_index | bit;
+        cvref_set_code(cvref_levels[trial_index].code);
+        delay32_us(COMP_SAR_SETTLE_US);
+        if (CMSTATbits.C1OUT) { // signal above this level
+            level_index = trial_index;
+        }
+    }
+    
+    // level 0 is 0 V, so the signal is always at or above level_index
+    result->level_index = level_index;
+    result->low_mV = cvref_level_mV(level_index);
+    if (level_index < (CVREF_LEVEL_COUNT - 1)) {
+        result->high_mV = cvref_level_mV(level_index + 1);
+    }
+    else {
+        result->high_mV = cvref_vdd_mV; // above the top of the ladder
+    }
+    result->mV = (result->low_mV + result->high_mV) / 2;
+}
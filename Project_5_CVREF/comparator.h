@@ -32,8 +32,76 @@
 #define	__INCLUDE_GUARD__COMPARATOR_H__
 
 #include <xc.h>
+#include <stdint.h>
 
-void init_cvref(float vref);
+#define CVREF_SUPPLY_MV (3300) // CVRSS = 0: the ladder runs off AVDD
+#define CVREF_LEVEL_COUNT (32) // 16 CVR steps in each of the 2 CVRR ranges
+
+// One byte for both register fields: CVRR in bit 4, CVR in bits 3:0
+#define CVREF_CODE(cvrr, cvr) ((uint8_t) (((cvrr) << 4) | (cvr)))
+#define CVREF_CODE_CVRR(code) (((code) >> 4) & 0b1)
+#define CVREF_CODE_CVR(code) ((code) & 0b1111)
+
+typedef struct {
+    uint16_t mV; // at VDD = CVREF_SUPPLY_MV
+    uint8_t code;
+} cvref_level_t;
+
+extern const cvref_level_t cvref_levels[CVREF_LEVEL_COUNT];
+
+extern uint16_t cvref_vdd_mV;
+
+uint8_t cvref_nearest_level(uint16_t target_mV);
+uint16_t cvref_level_mV(uint8_t level_index);
+void cvref_set_code(uint8_t code);
+uint16_t init_cvref(uint16_t vref_mV);
+
+// Threshold crossings, by comparator interrupt instead of ADC polling.
+// The signal goes to C1INB (AN4/RB2, Pin 6). C1 compares it against CVREF.
+// In window mode C2 also compares it (on C2INA, AN3/RB1, Pin 5) against VBG/2
+// as the lower threshold. C2INA is also U2RX, so window mode gives up UART
+// receive; transmit (RB0) is unaffected.
+#define COMP_C1INB_PCFG_BIT (4) // AN4
+#define COMP_C2INA_PCFG_BIT (3) // AN3
+#define COMP_WINDOW_LOW_MV (600) // VBG/2, nominal
+#define COMP_EVENT_QUEUE_LEN (32)
+#define COMP_INTERRUPT_PRIORITY (5) // above the UART, timestamps must be prompt
+
+// where the signal is relative to the thresholds
+#define COMP_ZONE_BELOW (0)
+#define COMP_ZONE_INSIDE (1) // window mode only
+#define COMP_ZONE_ABOVE (2)
+
+typedef struct {
+    uint32_t timestamp; // timebase_now() ticks
+    uint8_t comparator; // 1 or 2
+    uint8_t is_above; // that comparator's output after the crossing
+    uint8_t zone; // COMP_ZONE_x after the crossing
+} comp_event_t;
+
+uint16_t comparator_init_threshold(uint16_t threshold_mV);
+uint16_t comparator_init_window(uint16_t high_mV);
+void comparator_stop(void);
+uint8_t comparator_get_zone(void);
+uint8_t comparator_get_event(comp_event_t* event);
+uint16_t comparator_dropped_count(void);
+
+void __attribute__ ((interrupt, no_auto_psv)) _CompInterrupt(void);
+
+// Slow second "ADC": successive approximation of the C1INB voltage against the
+// CVREF ladder, one comparison per bit of the 32-level table
+#define COMP_SAR_SETTLE_US (10) // CVREF settling + comparator response time
+#define COMP_SAR_STEPS (5) // log2(CVREF_LEVEL_COUNT)
+
+typedef struct {
+    uint8_t level_index; // highest level at or below the signal
+    uint16_t low_mV; // the signal is between low_mV and high_mV
+    uint16_t high_mV;
+    uint16_t mV; // best estimate: middle of the bracket
+} comp_sar_result_t;
+
+void comparator_sar_init(void);
+void comparator_sar_measure(comp_sar_result_t* result);
 
 #endif	/* __INCLUDE_GUARD__COMPARATOR_H__ */
 
@@ -4,6 +4,7 @@
 #include "uart.h"
 #include "delay.h"
 #include "comparator.h"
+#include "profile_sections.h"
 
 #include <string.h>
 #include <stdint.h>
@@ -53,19 +54,79 @@ int main(void) {
     uint16_t loop_count = 0;
     
     const uint8_t ENABLE_DEBUG = 1;
+    const uint8_t ENABLE_COMPARATOR_EVENTS = 0; // signal on C1INB (Pin 6)
+    const uint8_t ENABLE_COMPARATOR_SAR = 0; // measures C1INB (Pin 6)
+    const uint8_t ENABLE_PROFILING = PROFILE_ENABLED; // binary frames on the UART; set it in profile_sections.h
     
     
 //    if (ENABLE_DEBUG)
     Disp2String("DEBUG: Starting while(1)\n");
     
     // set CVREF
-    init_cvref(0.5);
+    init_cvref(500);
+    
+    if (ENABLE_PROFILING) {
+        profile_init();
+    }
+    
+    if (ENABLE_COMPARATOR_EVENTS) {
+        comparator_init_threshold(1650);
+    }
+    else if (ENABLE_COMPARATOR_SAR) {
+        comparator_sar_init();
+    }
     
     while (1) {
+        if (ENABLE_PROFILING) {
+            profile_poll();
+        }
+        
+        if (ENABLE_COMPARATOR_EVENTS) {
+            comp_event_t event;
+            while (comparator_get_event(&event)) {
+                PROFILE_START(PROFILE_SECTION_EVENT_REPORT);
+                char msg[60];
+                sprintf(msg, "COMP_EVENT t=%lu C%u %s zone=%u\n",
+                        event.timestamp, event.comparator, event.is_above ? "UP" : "DOWN", event.zone);
+                Disp2String(msg);
+                PROFILE_STOP(PROFILE_SECTION_EVENT_REPORT);
+            }
+            continue;
+        }
+        
+        if (ENABLE_COMPARATOR_SAR) {
+            comp_sar_result_t result;
+            PROFILE_START(PROFILE_SECTION_SAR_MEASURE);
+            comparator_sar_measure(&result);
+            PROFILE_STOP(PROFILE_SECTION_SAR_MEASURE);
+            
+            char msg[60];
+            sprintf(msg, "SAR_mV=%u (%u..%u) level=%u\n",
+                    result.mV, result.low_mV, result.high_mV, result.level_index);
+            Disp2String(msg);
+            delay32_ms(100);
+            continue;
+        }
+        
          Disp2String("DEBUG: Top of while(1)\n");
          
-        for (float i = 0; i < 2.38; i += 0.05) {
-            init_cvref(i);
+        for (uint16_t vref_target_mV = 0; vref_target_mV < 2380; vref_target_mV += 50) {
+            PROFILE_START(PROFILE_SECTION_INIT_CVREF);
+            const uint16_t vref_set_mV = init_cvref(vref_target_mV);
+            PROFILE_STOP(PROFILE_SECTION_INIT_CVREF);
+            
+            // Display the CVR and CVRR value selected on the PC terminal.
+            if (ENABLE_DEBUG) {
+                PROFILE_START(PROFILE_SECTION_DEBUG_PRINT);
+                char msg[80];
+                sprintf(msg, "init_cvref(vref_target=%umV) -> CVR=%d, CVRR=%d -> vref_set=%umV\n",
+                        vref_target_mV, CVRCONbits.CVR, CVRCONbits.CVRR, vref_set_mV);
+                Disp2String(msg);
+                PROFILE_STOP(PROFILE_SECTION_DEBUG_PRINT);
+            }
+            if (ENABLE_PROFILING) {
+                profile_poll();
+            }
             delay32_ms(500);
         }
         
@@ -28,29 +28,24 @@
 
 // This is a guard condition so that contents of this file are not included
 // more than once.  
-#ifndef __INCLUDE_GUARD_TIMER_H__
-#define	__INCLUDE_GUARD_TIMER_H__
+#ifndef __INCLUDE_GUARD__PROFILE_SECTIONS_H__
+#define	__INCLUDE_GUARD__PROFILE_SECTIONS_H__
 
-#include <xc.h> // include processor files - each processor file is guarded.  
+// This project's use of the section profiler (pic24_hal/profile.h)
 
+#define PROFILE_ENABLED (0) // main.c's ENABLE_PROFILING follows it
+#define PROFILE_SCOPE_PIN_ENABLED (0)
 
-#ifdef	__cplusplus
-extern "C" {
-#endif /* __cplusplus */
+#include "profile.h"
 
-    // TODO If C++ is being used, regular C code needs function names to have C 
-    // linkage so the functions can be used by the c code. 
-
-#ifdef	__cplusplus
-}
-#endif /* __cplusplus */
-
-extern uint16_t active_clk_freq_khz;
-extern uint16_t active_clk_freq_MHz;
-
-void delay_us(uint16_t delay_time_us);
-void delay_ms(uint16_t delay_time_ms);
-void delay_sec(uint16_t delay_time_sec);
-
-#endif	/* __INCLUDE_GUARD_TIMER_H__ */
+// Sections. Profile_Python_Decoder reads the names from this enum, so keep
+// the PROFILE_SECTION_ prefix and the implicit numbering.
+typedef enum {
+    PROFILE_SECTION_INIT_CVREF,
+    PROFILE_SECTION_SAR_MEASURE,
+    PROFILE_SECTION_EVENT_REPORT,
+    PROFILE_SECTION_DEBUG_PRINT,
+    PROFILE_SECTION_COUNT // must stay last; at most 128 sections
+} profile_section_t;
 
+#endif	/* __INCLUDE_GUARD__PROFILE_SECTIONS_H__ */
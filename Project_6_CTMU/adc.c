@@ -45,18 +45,3 @@ void init_adc(void) {
     // was in ADC scan, but not here
     AD1CSSLbits.CSSL11 = 0; // analog channel omitted from input scan
 }
-
-uint16_t read_adc_value(void) {
-    // Enable ADC module
-    AD1CON1bits.ADON = 1;
-    
-    AD1CON1bits.SAMP = 1; // Start sampling
-    while (!AD1CON1bits.DONE); // Wait for conversion to complete // not needed for CTMU mode (SSRC=0b000), maybe
-    
-    const uint16_t adc_value = ADC1BUF0;
-    
-    AD1CON1bits.SAMP = 0; // End sampling
-    AD1CON1bits.ADON = 0; // Turn off ADC - saves power
-    
-    return adc_value;
-}
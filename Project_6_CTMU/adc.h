@@ -32,9 +32,9 @@
 #define	__INCLUDE_GUARD__ADC_H__
 
 #include <xc.h> // include processor files - each processor file is guarded.  
+#include "adc_vdd.h" // read_adc_value(), vdd_mV, ...
 
 void init_adc(void);
-uint16_t read_adc_value(void);
 
 #endif	/* __INCLUDE_GUARD__ADC_H__ */
 
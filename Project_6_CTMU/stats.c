@@ -0,0 +1,75 @@
+/*
+ * File:   stats.c
+ */
+
+
+#include "stats.h"
+
+void stats_reset(sample_stats_t* stats) {
+    stats->count = 0;
+    stats->min = UINT16_MAX;
+    stats->max = 0;
+    stats->mean_q16 = 0;
+    stats->m2_q16 = 0;
+}
+
+void stats_add(sample_stats_t* stats, uint16_t sample) {
+    if (stats->count == UINT16_MAX) {
+        return; // full; the result so far is still valid
+    }
+    stats->count++;
+    if (sample < stats->min) {
+        stats->min = sample;
+    }
+    if (sample > stats->max) {
+        stats->max = sample;
+    }
+    
+    // Welford: the M2 update uses the difference to the mean both before and
+    // after this sample, so there's no big sum of squares to overflow or cancel.
+    // The mean is kept at 1/65536 count, and each step rounded to nearest, so
+    // rounding doesn't pile up over thousands of samples (truncating would pull
+    // a drifting mean the same way every step).
+    const int32_t sample_q16 = ((int32_t) sample) << 16;
+    const int32_t delta_before = sample_q16 - stats->mean_q16;
+    const int32_t half_count = (int32_t) (stats->count / 2);
+    stats->mean_q16 += (delta_before + ((delta_before < 0) ? -half_count : half_count)) / (int32_t) stats->count;
+    const int32_t delta_after = sample_q16 - stats->mean_q16;
+    
+    // both deltas have the same sign; back to Q16 before summing
+    stats->m2_q16 += (uint64_t) ((((int64_t) delta_before) * delta_after) >> 16);
+}
+
+// Mean, in 1/256 ADC counts
+uint32_t stats_mean_q8(const sample_stats_t* stats) {
+    return (uint32_t) ((stats->mean_q16 + (1L << 7)) >> 8);
+}
+
+// Sample standard deviation (n - 1), in 1/256 ADC counts
+uint32_t stats_std_q8(const sample_stats_t* stats) {
+    if (stats->count < 2) {
+        return 0;
+    }
+    return isqrt64(stats->m2_q16 / (stats->count - 1));
+}
+
+// floor(sqrt(val)), one result bit per iteration
+uint32_t isqrt64(uint64_t val) {
+    uint64_t root = 0;
+    uint64_t bit = ((uint64_t) 1) << 62; // highest power of 4 that fits
+    
+    while (bit > val) {
+        bit >>= 2;
+    }
+    while (bit != 0) {
+        if (val >= root + bit) {
+            val -= root + bit;
+            root = (root >> 1) + bit;
+        }
+        else {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return (uint32_t) root;
+}
@@ -28,24 +28,29 @@
 
 // This is a guard condition so that contents of this file are not included
 // more than once.  
-#ifndef __INCLUDE_GUARD_CLOCK_H__
-#define	__INCLUDE_GUARD_CLOCK_H__
+#ifndef __INCLUDE_GUARD__STATS_H__
+#define	__INCLUDE_GUARD__STATS_H__
 
 #include <xc.h> // include processor files - each processor file is guarded.  
 #include <stdint.h>
 
-
-#ifdef	__cplusplus
-extern "C" {
-#endif /* __cplusplus */
-
-    // TODO If C++ is being used, regular C code needs function names to have C 
-    // linkage so the functions can be used by the c code. 
-
-#ifdef	__cplusplus
-}
-#endif /* __cplusplus */
-
-void set_clock_freq(uint16_t clk_freq_khz);
-
-#endif	/* __INCLUDE_GUARD_CLOCK_H__ */
+// Running statistics over 10-bit ADC readings, integer-only (Welford's method), so a
+// whole run costs a few integer ops per sample and no floats.
+// The mean and standard deviation are reported in fixed point: 1/256 ADC count.
+#define STATS_Q_BITS (8)
+
+typedef struct {
+    uint16_t count;
+    uint16_t min;
+    uint16_t max;
+    int32_t mean_q16; // ADC counts << 16
+    uint64_t m2_q16; // sum of squared differences from the mean, << 16
+} sample_stats_t;
+
+void stats_reset(sample_stats_t* stats);
+void stats_add(sample_stats_t* stats, uint16_t sample);
+uint32_t stats_mean_q8(const sample_stats_t* stats);
+uint32_t stats_std_q8(const sample_stats_t* stats);
+uint32_t isqrt64(uint64_t val);
+
+#endif	/* __INCLUDE_GUARD__STATS_H__ */
@@ -10,6 +10,7 @@
 #include "z_sense.h"
 #include "uart.h"
 #include "adc.h"
+#include "stats.h"
 
 // Output is on Pin 16/AN11/RB13
 
@@ -50,34 +51,66 @@ void init_ctmu(int8_t current_value_exponent) {
     AD1CON1bits.SAMP = 1; // Start sampling
 }
 
-void r_sense_and_log(int8_t current_value_exponent, uint32_t resistance_ohms, uint16_t sample_count) {
-    init_ctmu(current_value_exponent);
-    
-    double current_source_value_uA = 0; //  = pow(5.5, current_value_exponent);
+// Nominal source current per range, in nA
+uint32_t ctmu_nominal_current_nA(int8_t current_value_exponent) {
     if (current_value_exponent == -1) {
-        current_source_value_uA = 0.55;
+        return 550; // 0.55 uA
     }
     else if (current_value_exponent == 0) {
-        current_source_value_uA = 5.5;
-    }
-    else if (current_value_exponent == 1) {
-        current_source_value_uA = 55.0;
+        return 5500; // 5.5 uA
     }
+    return 55000; // 55 uA
+}
+
+// ADC counts (<< STATS_Q_BITS) to uV, ratiometric to the measured VDD
+uint32_t adc_q8_to_uV(uint32_t adc_q8) {
+    return (uint32_t) ((((uint64_t) adc_q8) * vdd_mV * 1000) >> (10 + STATS_Q_BITS));
+}
+
+// Prints a Q8 value as "123.45"
+void format_q8(char* buf, uint32_t val_q8) {
+    const uint32_t hundredths = ((val_q8 * 100) + (1 << (STATS_Q_BITS - 1))) >> STATS_Q_BITS;
+    sprintf(buf, "%lu.%02lu", hundredths / 100, hundredths % 100);
+}
+
+// Collects `sample_count` readings of the CTMU current through a resistor
+// into `stats`
+void r_sense_measure(int8_t current_value_exponent, uint16_t sample_count, sample_stats_t* stats) {
+    update_vdd_mV(); // once per run; VDD won't move much within one run
+    init_ctmu(current_value_exponent);
     
+    stats_reset(stats);
     for (uint16_t i = 0; i < sample_count; i++) {
-        char msg[255];
-        
-        // read the ADC value
-        // Disp2String("Start read_adc_value");
-        const uint16_t adc_value = read_adc_value();
-        // Disp2String("Done read_adc_value");
-        const double adc_v = adc_value * 3.3 / 1023.0;
-        const double current_read_value_uA = (adc_v / ((double)(resistance_ohms))) * 1000000.0;
-        
-        sprintf(msg, "current_source_value_uA=%f, R=%ld, adc_value=%d, adc_volts=%3f, current_read_value_uA=%3f\n",
-                current_source_value_uA, resistance_ohms, adc_value, adc_v, current_read_value_uA);
-        
-        Disp2String(msg);
+        stats_add(stats, read_adc_value());
     }
 }
 
+// Measures, then sends one summary line per run instead of one line per
+// sample:
+// R_STATS exp=1 R=10000 n=100 adc=512.34 min=510 max=515 sd=0.84 uV=1651095 sd_uV=2707 I_nA=165109 I_src_nA=55000
+// I_nA is what actually flowed (V/R); compare it to the nominal I_src_nA to
+// characterize the current source, or use it to find R with a known current.
+void r_sense_and_log(int8_t current_value_exponent, uint32_t resistance_ohms, uint16_t sample_count) {
+    sample_stats_t stats;
+    r_sense_measure(current_value_exponent, sample_count, &stats);
+    
+    const uint32_t mean_q8 = stats_mean_q8(&stats);
+    const uint32_t std_q8 = stats_std_q8(&stats);
+    const uint32_t mean_uV = adc_q8_to_uV(mean_q8);
+    const uint32_t std_uV = adc_q8_to_uV(std_q8);
+    const uint32_t current_nA = (resistance_ohms == 0) ? 0
+            : (uint32_t) ((((uint64_t) mean_uV) * 1000) / resistance_ohms);
+    
+    char mean_str[12];
+    char std_str[12];
+    format_q8(mean_str, mean_q8);
+    format_q8(std_str, std_q8);
+    
+    char msg[150];
+    sprintf(msg, "R_STATS exp=%d R=%lu n=%u adc=%s min=%u max=%u sd=%s uV=%lu sd_uV=%lu I_nA=%lu I_src_nA=%lu\n",
+            current_value_exponent, resistance_ohms, stats.count,
+            mean_str, stats.min, stats.max, std_str,
+            mean_uV, std_uV, current_nA,
+            ctmu_nominal_current_nA(current_value_exponent));
+    Disp2String(msg);
+}
@@ -32,7 +32,7 @@
 #define	__INCLUDE_GUARD__Z_SENSE_H__
 
 #include <xc.h> // include processor files - each processor file is guarded.  
-
+#include "stats.h"
 
 void init_ctmu(int8_t current_value_exponent);
 
@@ -41,6 +41,9 @@ void r_sense_and_log(
     uint32_t resistance_ohms,
     uint16_t sample_count);
 
+void r_sense_measure(int8_t current_value_exponent, uint16_t sample_count, sample_stats_t* stats);
+uint32_t ctmu_nominal_current_nA(int8_t current_value_exponent);
+
 
 
 #endif	/* __INCLUDE_GUARD__Z_SENSE_H__ */
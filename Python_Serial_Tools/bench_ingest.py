@@ -0,0 +1,115 @@
+from loguru import logger
+import argparse
+import re
+import sys
+import time
+from pathlib import Path
+
+import numpy as np
+import polars as pl
+
+from serial_ingest import IngestParser, encode_frame, TYPE_HELLO, TYPE_ADC_BATCH, TYPE_CAP_PF
+from raw_capture import RawCaptureReader, is_raw_capture
+
+# Replays a byte stream through IngestParser in serial-read-sized chunks and
+# reports the throughput, next to the old readline()/re.search()/list-of-dicts
+# loop the loggers used to run, so a parser change can be checked against a
+# real capture before it goes near hardware.
+#
+# Usage:
+#   python bench_ingest.py --file run.p24raw.gz             # a --record capture, in the reads it was recorded in
+#   python bench_ingest.py --file capture.bin               # or a plain byte dump (the host simulator's SIM_UART_OUT)
+#   python bench_ingest.py --synthetic binary --mbytes 8    # or: text
+# Exits with 1 if the new parser can't keep up with --min-baud.
+
+ADC_BATCH_LEN = 8 # ADC_Driver_Project's TELEMETRY_ADC_BATCH_LEN
+UART_BITS_PER_BYTE = 10 # start + 8 data + stop
+
+def synthetic_stream(kind: str, n_bytes: int) -> bytes:
+	"""A stream like the firmware sends: text reports, or ADC_BATCH + CAP_PF frames."""
+	rng = np.random.default_rng(0)
+	out = bytearray()
+	if kind == "text":
+		while len(out) < n_bytes:
+			for value in rng.integers(0, 1024, 1000):
+				out += f"ADC Value: {value:04d}  VDD_mV: 3300  \n\x00".encode()
+				out += f"    REPORT_CAP_pF={value * 37}\n\x00".encode()
+		return bytes(out[:out.rindex(b"\x00") + 1])
+
+	out += b"DEBUG: Starting while(1)\n\x00"
+	out += encode_frame(TYPE_HELLO, 0, 0, (4000000).to_bytes(4, "little") + (64).to_bytes(2, "little") + b"\x01")
+	seq = 1
+	ticks = 0
+	while len(out) < n_bytes:
+		values = rng.integers(0, 1024, ADC_BATCH_LEN).astype("<u2")
+		out += encode_frame(TYPE_ADC_BATCH, seq, ticks, (3300).to_bytes(2, "little") + values.tobytes())
+		seq += 1
+		if seq % 16 == 0:
+			out += encode_frame(TYPE_CAP_PF, seq, ticks, int(values[0] * 37).to_bytes(4, "little"))
+			seq += 1
+		ticks += 250
+	return bytes(out)
+
+def bench_ingest(chunks: list[bytes]) -> tuple[float, IngestParser]:
+	parser = IngestParser()
+	start = time.perf_counter()
+	for chunk in chunks:
+		parser.feed(chunk, time.perf_counter() - start)
+	parser.samples.to_polars()
+	return time.perf_counter() - start, parser
+
+def bench_legacy(stream: bytes) -> tuple[float, int]:
+	"""The old per-line loop from make_adc_plot.py / make_capacitance_plot.py (text only)."""
+	start = time.perf_counter()
+	data: list[dict] = []
+	for line in stream.split(b"\n"):
+		line = line.decode("utf-8", errors='ignore').strip()
+		adc_value_search = re.search(r"ADC Value: (\d+)", line)
+		if adc_value_search:
+			vdd_search = re.search(r"VDD_mV: (\d+)", line)
+			data.append({
+				"timestamp": time.perf_counter() - start,
+				"adc_value": int(adc_value_search.group(1)),
+				"vdd_mV": int(vdd_search.group(1)) if vdd_search else 3300,
+			})
+		cap_value_search = re.search(r"REPORT_CAP_pF=(\d+)", line)
+		if cap_value_search:
+			data.append({"timestamp": time.perf_counter() - start, "cap_value": int(cap_value_search.group(1))})
+	pl.DataFrame(data)
+	return time.perf_counter() - start, len(data)
+
+def main():
+	parser = argparse.ArgumentParser(description="Throughput of the chunked serial ingest")
+	source = parser.add_mutually_exclusive_group()
+	source.add_argument("--file", type=Path, help="replay a capture file")
+	source.add_argument("--synthetic", choices=["text", "binary"], default="binary")
+	parser.add_argument("--mbytes", type=float, default=4.0, help="size of the synthetic stream")
+	parser.add_argument("--chunk-bytes", type=int, default=4096, help="bytes per feed(), like one serial read (not for --record captures)")
+	parser.add_argument("--min-baud", type=float, default=1_000_000)
+	args = parser.parse_args()
+
+	if args.file and is_raw_capture(args.file):
+		chunks = [data for _, data in RawCaptureReader(args.file)]
+		stream = b"".join(chunks)
+		logger.info(f"Replaying {len(stream)} bytes in the {len(chunks)} reads they were recorded in")
+	else:
+		stream = args.file.read_bytes() if args.file else synthetic_stream(args.synthetic, int(args.mbytes * 1e6))
+		chunks = [stream[offset:offset + args.chunk_bytes] for offset in range(0, len(stream), args.chunk_bytes)]
+		logger.info(f"Replaying {len(stream)} bytes in {args.chunk_bytes}-byte reads")
+
+	elapsed, ingest = bench_ingest(chunks)
+	baud = len(stream) * UART_BITS_PER_BYTE / elapsed
+	print(f"ingest: {elapsed:.3f} s, {len(stream) / elapsed / 1e6:.2f} MB/s, {baud / 1e6:.2f} Mbaud equivalent, "
+		f"{len(ingest.samples) / elapsed / 1e6:.2f} M samples/s")
+	print(f"        {ingest.summary()}")
+
+	legacy_elapsed, legacy_samples = bench_legacy(stream)
+	print(f"legacy: {legacy_elapsed:.3f} s, {len(stream) / legacy_elapsed / 1e6:.2f} MB/s "
+		f"({legacy_samples} text samples)")
+
+	if baud < args.min_baud:
+		logger.error(f"Below {args.min_baud / 1e6:.2f} Mbaud")
+		sys.exit(1)
+
+if __name__ == "__main__":
+	main()
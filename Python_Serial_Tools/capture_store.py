@@ -0,0 +1,218 @@
+from loguru import logger
+import argparse
+import json
+import resource
+import time
+from pathlib import Path
+
+import numpy as np
+import polars as pl
+import pyarrow as pa
+import pyarrow.parquet as pq
+
+from serial_ingest import SampleColumns, KIND_ADC, KIND_NAMES
+
+# Samples on disk, for runs too long to keep in RAM: CaptureWriter streams
+# ingest batches into one Parquet file, a row group at a time, so memory stays
+# at one row group however long it runs. Run details (port, baud, clock, CTMU
+# range, Timer3 rate, ...) go into the file's key/value metadata as JSON.
+# Read it back lazily with scan_capture(), e.g.
+#   scan_capture("run.parquet").filter(pl.col("kind") == KIND_CAP_PF).group_by(...).collect()
+#
+# Usage:
+#   python make_capacitance_plot.py --save run.parquet --meta ctmu_range=1
+#   python capture_store.py info run.parquet                  # metadata, counts, per-minute means
+#   python capture_store.py bench --samples 10000000          # write + re-read a synthetic run
+
+METADATA_KEY = "pic24_capture"
+FORMAT_VERSION = 3 # 2: aligned_time, 3: seq is uint16 (SEQ_NONE for text, was int16 -1)
+DEFAULT_ROW_GROUP_ROWS = 1_000_000 # ~31 MB of columns in RAM while writing
+BENCH_BATCH_SAMPLES = 4096
+
+# serial_ingest.sample_times(), for lazy frames
+SAMPLE_TIME = pl.col("aligned_time").fill_nan(pl.col("host_time"))
+
+def capture_schema(columns: dict) -> pa.Schema:
+	return pa.schema([(name, pa.from_numpy_dtype(dtype)) for name, dtype in columns.items()])
+
+class CaptureWriter:
+	def __init__(self, path: Path, metadata: dict, row_group_rows: int = DEFAULT_ROW_GROUP_ROWS, compression: str = "zstd",
+			columns: dict = SampleColumns.COLUMNS):
+		"""`columns`: SampleColumns.COLUMNS, plus any the caller adds to every batch."""
+		self.path = Path(path)
+		self.metadata = {"format_version": FORMAT_VERSION, "created_unix_s": time.time(), **metadata}
+		self.row_group_rows = row_group_rows
+		self.buffer = SampleColumns(row_group_rows, columns)
+		self.schema = capture_schema(columns)
+		self.rows_written = 0
+		self.writer = pq.ParquetWriter(self.path, self.schema, compression=compression)
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, *exc):
+		self.close()
+
+	def write(self, batch: dict[str, np.ndarray]) -> None:
+		"""Adds a batch (as from IngestParser.feed()); full row groups go to disk."""
+		offset = 0
+		count = len(batch["value"])
+		while offset < count:
+			take = min(count - offset, self.row_group_rows - len(self.buffer))
+			self.buffer.append({name: column[offset:offset + take] for name, column in batch.items()})
+			offset += take
+			if len(self.buffer) == self.row_group_rows:
+				self.flush()
+
+	def flush(self) -> None:
+		if len(self.buffer) == 0:
+			return
+		table = pa.table({name: self.buffer.column(name) for name in self.schema.names}, schema=self.schema)
+		self.writer.write_table(table, row_group_size=self.row_group_rows)
+		self.rows_written += len(self.buffer)
+		self.buffer.clear()
+
+	def close(self, extra_metadata: dict | None = None) -> None:
+		"""Flushes the last row group and writes the metadata. `extra_metadata`
+		is for what's only known at the end (the Timer3 rate, drop counts).
+		"""
+		if self.writer is None:
+			return
+		self.flush()
+		self.metadata.update(extra_metadata or {})
+		self.metadata["rows"] = self.rows_written
+		self.writer.add_key_value_metadata({METADATA_KEY: json.dumps(self.metadata)})
+		self.writer.close()
+		self.writer = None
+
+def ingest_metadata(parser) -> dict:
+	"""What an IngestParser learned during the run, for CaptureWriter.close()."""
+	return {
+		"timer_hz": parser.timer_hz,
+		"bytes": parser.byte_count,
+		"frames": parser.frame_count,
+		"bad_frames": parser.bad_frame_count,
+		"dropped_frames": parser.dropped_frames,
+	}
+
+def read_capture_metadata(path: Path) -> dict:
+	key_values = pq.ParquetFile(path).metadata.metadata or {}
+	return json.loads(key_values.get(METADATA_KEY.encode(), b"{}"))
+
+def sort_capture(src: Path, dst: Path, by: str | pl.Expr = SAMPLE_TIME) -> None:
+	"""Rewrites a capture sorted by `by` (stable, so same-time samples keep their
+	order), metadata included. Runs on polars' streaming engine.
+	"""
+	metadata = {METADATA_KEY: json.dumps(read_capture_metadata(src))}
+	scan_capture(src).sort(by, maintain_order=True).sink_parquet(dst, metadata=metadata, row_group_size=DEFAULT_ROW_GROUP_ROWS)
+
+def scan_capture(path: Path | str) -> pl.LazyFrame:
+	"""All samples, lazily; `path` may be a glob over several runs."""
+	return pl.scan_parquet(path)
+
+def parse_meta_args(pairs: list[str]) -> dict:
+	"""["ctmu_range=1", "note=bench A"] -> {"ctmu_range": 1, "note": "bench A"}"""
+	metadata = {}
+	for pair in pairs:
+		key, _, value = pair.partition("=")
+		try:
+			metadata[key] = json.loads(value)
+		except json.JSONDecodeError:
+			metadata[key] = value
+	return metadata
+
+def print_info(path: Path) -> None:
+	print(json.dumps(read_capture_metadata(path), indent=2))
+	lf = scan_capture(path)
+	by_port = ["port"] if "port" in lf.collect_schema().names() else [] # multi_logger captures
+	per_kind = lf.group_by(*by_port, "kind").agg(
+		n = pl.len(),
+		first_s = SAMPLE_TIME.min(),
+		last_s = SAMPLE_TIME.max(),
+		# how late reads were, by the clock fit (frames only)
+		latency_ms = (pl.col("host_time") - pl.col("aligned_time")).filter(pl.col("aligned_time").is_not_nan()).median() * 1e3,
+		mean = pl.col("value").mean(),
+		min = pl.col("value").min(),
+		max = pl.col("value").max(),
+	).sort(*by_port, "kind").collect()
+	print(per_kind.with_columns(pl.col("kind").replace_strict(KIND_NAMES, return_dtype=pl.String)))
+
+	# one row per frame (an ADC_BATCH frame is several samples), then the seq gaps, per port
+	# (either version's text marker is out of range)
+	frames = lf.filter(pl.col("seq").is_between(0, 0xFF)).select(*by_port, pl.col("seq").cast(pl.Int32), "device_ticks")
+	if by_port:
+		frames = frames.sort("port", maintain_order=True)
+	new_frame = (pl.col("seq") != pl.col("seq").shift()) | (pl.col("device_ticks") != pl.col("device_ticks").shift()) | pl.col("seq").shift().is_null()
+	gaps = (pl.col("seq").diff() + 255) % 256
+	if by_port:
+		new_frame = new_frame.over("port")
+		gaps = gaps.over("port")
+	dropped = frames.filter(new_frame).select(gaps.sum()).collect().item()
+	print(f"dropped frames (seq gaps): {dropped or 0}")
+
+	per_minute = (
+		lf.with_columns(minute = (SAMPLE_TIME // 60).cast(pl.Int64))
+		.group_by(*by_port, "kind", "minute")
+		.agg(n = pl.len(), mean = pl.col("value").mean(), std = pl.col("value").std())
+		.sort(*by_port, "kind", "minute")
+		.collect()
+	)
+	with pl.Config(tbl_rows=30):
+		print(per_minute)
+
+def synthetic_batches(n_samples: int):
+	"""Batches like a long binary ADC run: 8 samples per frame, slow drift plus noise."""
+	rng = np.random.default_rng(0)
+	done = 0
+	while done < n_samples:
+		count = min(BENCH_BATCH_SAMPLES, n_samples - done)
+		idx = done + np.arange(count)
+		yield {
+			"host_time": idx / 30000.0,
+			"aligned_time": idx // 8 * 8 / 30000.0,
+			"device_ticks": idx // 8 * 500,
+			"seq": (idx // 8 % 256).astype(np.uint16),
+			"kind": np.full(count, KIND_ADC, dtype=np.uint8),
+			"value": (512 + 100 * np.sin(idx / 1e6) + rng.normal(0, 4, count)).astype(np.int64),
+			"vdd_mV": np.full(count, 3300, dtype=np.int32),
+		}
+		done += count
+
+def run_bench(n_samples: int, path: Path) -> None:
+	start = time.perf_counter()
+	value_sum = 0
+	with CaptureWriter(path, {"source": "synthetic", "baud": 1000000}) as writer:
+		for batch in synthetic_batches(n_samples):
+			value_sum += int(batch["value"].sum())
+			writer.write(batch)
+	write_s = time.perf_counter() - start
+	size = path.stat().st_size
+	peak_rss_mb = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024
+	print(f"write: {n_samples} samples in {write_s:.2f} s ({n_samples / write_s / 1e6:.2f} M samples/s), "
+		f"{size / 1e6:.1f} MB ({size / n_samples:.2f} B/sample), peak RSS {peak_rss_mb:.0f} MB")
+
+	start = time.perf_counter()
+	check = scan_capture(path).select(n = pl.len(), value_sum = pl.col("value").sum()).collect()
+	read_s = time.perf_counter() - start
+	print(f"read:  {check['n'][0]} samples in {read_s:.2f} s (lazy scan), metadata rows={read_capture_metadata(path).get('rows')}")
+	if check["n"][0] != n_samples or check["value_sum"][0] != value_sum:
+		logger.error("Read back something other than what was written")
+		raise SystemExit(1)
+
+def main():
+	parser = argparse.ArgumentParser(description="Inspect or benchmark Parquet captures")
+	commands = parser.add_subparsers(dest="command", required=True)
+	info = commands.add_parser("info", help="metadata, per-kind counts and per-minute means")
+	info.add_argument("path", type=Path)
+	bench = commands.add_parser("bench", help="write and re-read a synthetic run")
+	bench.add_argument("--samples", type=int, default=10_000_000)
+	bench.add_argument("--path", type=Path, default=Path("bench_capture.parquet"))
+	args = parser.parse_args()
+
+	if args.command == "info":
+		print_info(args.path)
+	else:
+		run_bench(args.samples, args.path)
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,201 @@
+from loguru import logger
+import argparse
+import sys
+
+import numpy as np
+
+# Puts device timestamps (the Timer3 ticks in every telemetry frame) on the
+# host clock. A read's host time is when its chunk came out of the OS, late by
+# the UART, the USB-serial adapter's latency timer and scheduling, always
+# positively and by a jittery amount; the ticks aren't. So ClockSync fits
+#   host_time = offset + slope * ticks
+# to the lower envelope of the (ticks, arrival) points: per BIN_S of host time
+# it keeps the point that arrived soonest for its ticks, least-squares fits the
+# slope through those (the FRC-driven Timer3 is only good to a couple of
+# percent, and drifts with temperature), and puts the offset on the soonest
+# of the last few. What is left is the constant minimum latency, which one-way
+# timestamps can't see.
+#
+# IngestParser runs one per stream and fills the aligned_time column with it.
+#
+# Usage:
+#   python clock_sync.py --drift-ppm 15000 --minutes 10    # simulated drifting clock, bursty reads
+# Exits with 1 if the p99 error (after warm-up) is over --max-error-ms.
+
+TICKS_WRAP = 1 << 32
+BIN_S = 1.0
+WINDOW_BINS = 60 # slope over the last minute: enough bins to average out, short enough to follow temperature drift
+OFFSET_BINS = 10 # offset from the soonest point in the last 10 s...
+OFFSET_READS = 200 # ...or as far back as it takes to have this many reads (slow streams)
+MIN_FIT_BINS = 3
+
+class ClockSync:
+	def __init__(self, bin_s: float = BIN_S, window_bins: int = WINDOW_BINS):
+		self.bin_s = bin_s
+		self.window_bins = window_bins
+		self.reset()
+
+	def reset(self) -> None:
+		"""Starts over, for a device restart (HELLO, or ticks going backwards)."""
+		self.last_raw_ticks: int | None = None
+		self.wrap_offset = 0
+		self.bins: dict[int, tuple[int, float]] = {} # host time bin -> (ticks, host_time) that arrived soonest
+		self.bin_reads: dict[int, int] = {} # host time bin -> reads seen in it
+		self.first_point: tuple[int, float] | None = None
+		self.ref_ticks = 0
+		self.slope: float | None = None # host seconds per tick
+		self.offset: float | None = None # host time at ref_ticks
+
+	def update(self, ticks: np.ndarray, host_time: float, nominal_hz: float | None = None) -> np.ndarray:
+		"""Takes the ticks of the frames in one read (stream order) and when the
+		read returned; gives back their host times (NaN until there's a fit).
+		`nominal_hz` (from HELLO) is the slope to start from.
+		"""
+		ticks = np.asarray(ticks, dtype=np.int64)
+		if len(ticks) == 0:
+			return np.empty(0)
+		prev = np.concatenate(([ticks[0] if self.last_raw_ticks is None else self.last_raw_ticks], ticks[:-1]))
+		backward = ticks < prev
+		wrapped = backward & (prev >= 3 * TICKS_WRAP // 4) & (ticks < TICKS_WRAP // 4)
+		restarts = np.flatnonzero(backward & ~wrapped)
+		if len(restarts):
+			first = restarts[0]
+			before = self.update(ticks[:first], host_time, nominal_hz)
+			self.reset()
+			return np.concatenate([before, self.update(ticks[first:], host_time, nominal_hz)])
+
+		unwrapped = ticks + self.wrap_offset + TICKS_WRAP * np.cumsum(wrapped)
+		self.wrap_offset += TICKS_WRAP * int(wrapped.sum())
+		self.last_raw_ticks = int(ticks[-1])
+		# only the newest frame was sent just before the read; the rest waited in buffers
+		self.add_point(int(unwrapped[-1]), host_time, nominal_hz)
+		return self.to_host(unwrapped)
+
+	def to_host(self, unwrapped_ticks: np.ndarray) -> np.ndarray:
+		if self.slope is None:
+			return np.full(len(unwrapped_ticks), np.nan)
+		return self.offset + self.slope * (unwrapped_ticks - self.ref_ticks).astype(np.float64)
+
+	def slope_guess(self, ticks: int, host_time: float, nominal_hz: float | None) -> float | None:
+		if self.slope is not None:
+			return self.slope
+		if nominal_hz:
+			return 1.0 / nominal_hz
+		if self.first_point and ticks > self.first_point[0]:
+			return (host_time - self.first_point[1]) / (ticks - self.first_point[0])
+		return None
+
+	def add_point(self, ticks: int, host_time: float, nominal_hz: float | None) -> None:
+		if self.first_point is None:
+			self.first_point = (ticks, host_time)
+		slope = self.slope_guess(ticks, host_time, nominal_hz)
+		if slope is None:
+			return
+		key = int(host_time // self.bin_s)
+		self.bin_reads[key] = self.bin_reads.get(key, 0) + 1
+		best = self.bins.get(key)
+		if best is not None and host_time - slope * ticks >= best[1] - slope * best[0]:
+			return
+		new_bin = best is None
+		self.bins[key] = (ticks, host_time)
+		if new_bin:
+			for old in [old for old in self.bins if old <= key - self.window_bins]:
+				del self.bins[old]
+				self.bin_reads.pop(old, None)
+			self.fit(slope)
+		elif self.slope is not None:
+			# a sooner point in the current bin can only lower the envelope
+			self.offset = min(self.offset, host_time - self.slope * (ticks - self.ref_ticks))
+
+	def fit(self, slope_guess: float) -> None:
+		points = np.array(list(self.bins.values()), dtype=np.float64)
+		ref_ticks = int(min(ticks for ticks, _ in self.bins.values()))
+		x = points[:, 0] - ref_ticks
+		y = points[:, 1]
+		slope = slope_guess
+		if len(points) >= MIN_FIT_BINS and np.ptp(x) > 0:
+			slope = least_squares_slope(x, y)
+			# then again through the lower half only: a bin of a slow stream may hold
+			# a single read, which is no nearer the envelope than any other
+			residual = y - slope * x
+			low = residual <= np.median(residual)
+			if np.count_nonzero(low) >= MIN_FIT_BINS and np.ptp(x[low]) > 0:
+				slope = least_squares_slope(x[low], y[low])
+		self.ref_ticks = ref_ticks
+		self.slope = slope
+		reads = np.array([self.bin_reads.get(key, 0) for key in self.bins])
+		recent = max(OFFSET_BINS, int(np.searchsorted(np.cumsum(reads[::-1]), OFFSET_READS)) + 1)
+		self.offset = float(np.min((y - slope * x)[-recent:]))
+
+	def drift_ppm(self, nominal_hz: float) -> float:
+		"""How fast the device clock runs against `nominal_hz`, by the current fit."""
+		return (1.0 / (self.slope * nominal_hz) - 1.0) * 1e6 if self.slope else float("nan")
+
+def least_squares_slope(x: np.ndarray, y: np.ndarray) -> float:
+	x_mean = x.mean()
+	return float(np.dot(x - x_mean, y - y.mean()) / np.dot(x - x_mean, x - x_mean))
+
+def simulate(drift_ppm: float, minutes: float, frame_rate_hz: float, bursty: bool, seed: int = 0) -> dict:
+	"""Runs ClockSync over a made-up run: a device clock off by `drift_ppm` (and
+	wandering a little), frames read by a host that polls every ~16 ms (the
+	USB-serial latency timer) with scheduling jitter and, if `bursty`, stalls
+	of up to a quarter second. Errors are against send time + minimum latency.
+	"""
+	rng = np.random.default_rng(seed)
+	nominal_hz = 62500.0
+	min_latency_s = 0.002
+	duration_s = minutes * 60
+	send_s = np.arange(0, duration_s, 1 / frame_rate_hz)
+	# a slow wander on top of the fixed drift, like a warming board
+	rate = 1 + drift_ppm * 1e-6 + 50e-6 * np.sin(2 * np.pi * send_s / duration_s)
+	device_s = np.concatenate(([0.0], np.cumsum(np.diff(send_s) * rate[1:])))
+	start_ticks = TICKS_WRAP - int(60 * nominal_hz) # wraps a minute in
+	ticks = (start_ticks + np.round(device_s * nominal_hz).astype(np.int64)) % TICKS_WRAP
+
+	gaps = 0.016 + rng.exponential(0.004, int(duration_s / 0.01) + 100)
+	if bursty:
+		stalls = rng.random(len(gaps)) < 0.01
+		gaps[stalls] += rng.uniform(0.05, 0.25, int(stalls.sum()))
+	read_s = np.cumsum(gaps)
+	arrive_s = send_s + min_latency_s
+	read_idx = np.searchsorted(read_s, arrive_s) # each frame comes out in the first read after it arrives
+
+	clock = ClockSync()
+	aligned = np.empty(len(send_s))
+	bounds = np.flatnonzero(np.diff(read_idx)) + 1
+	for chunk in np.split(np.arange(len(send_s)), bounds):
+		aligned[chunk] = clock.update(ticks[chunk], read_s[read_idx[chunk[0]]], nominal_hz)
+
+	warm = send_s > 30.0
+	aligned_error = np.abs(aligned[warm] - arrive_s[warm]) * 1e3
+	raw_error = (read_s[read_idx[warm]] - arrive_s[warm]) * 1e3
+	return {
+		"frames": len(send_s),
+		"reads": len(bounds) + 1,
+		"drift_ppm_fit": clock.drift_ppm(nominal_hz),
+		"drift_ppm_true": float((rate[-1] - 1) * 1e6),
+		"raw_ms": np.percentile(raw_error, [50, 99, 100]),
+		"aligned_ms": np.percentile(aligned_error, [50, 99, 100]),
+	}
+
+def main():
+	parser = argparse.ArgumentParser(description="Check ClockSync against a simulated drifting clock")
+	parser.add_argument("--drift-ppm", type=float, default=15000.0, help="device clock error (the FRC is good to ~2%%)")
+	parser.add_argument("--minutes", type=float, default=10.0)
+	parser.add_argument("--frame-rate", type=float, default=250.0, help="frames per second")
+	parser.add_argument("--steady", action="store_true", help="no read stalls")
+	parser.add_argument("--max-error-ms", type=float, default=1.0, help="p99 error to pass")
+	args = parser.parse_args()
+
+	result = simulate(args.drift_ppm, args.minutes, args.frame_rate, bursty=not args.steady)
+	print(f"{result['frames']} frames in {result['reads']} reads; drift fit {result['drift_ppm_fit']:.1f} ppm "
+		f"(true {result['drift_ppm_true']:.1f} ppm at the end)")
+	for name in ("raw", "aligned"):
+		p50, p99, worst = result[f"{name}_ms"]
+		print(f"{name:>8}: error p50 {p50:.3f} ms, p99 {p99:.3f} ms, max {worst:.3f} ms")
+	if result["aligned_ms"][1] > args.max_error_ms:
+		logger.error(f"p99 error over {args.max_error_ms} ms")
+		sys.exit(1)
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,226 @@
+from loguru import logger
+import argparse
+import threading
+import time
+from pathlib import Path
+
+import numpy as np
+
+from serial_ingest import IngestParser, SampleColumns, sample_times, KIND_ADC, KIND_CAP_PF, KIND_NAMES
+from serial_sources import SyntheticSerial, RecordingSerial, open_source, read_available
+from raw_capture import RawCaptureWriter
+from capture_store import CaptureWriter, ingest_metadata, parse_meta_args
+
+# Live dashboard for the loggers: a reader thread feeds IngestParser into a
+# fixed-size ring of the most recent samples (so memory stays flat however
+# long it runs), and the page redraws a min/max-decimated view of the ring
+# plus rolling statistics a few times a second.
+#
+# Usage:
+#   python make_adc_plot.py --live                     # from the loggers
+#   python live_view.py --synthetic --kind adc --baud 1000000   # no board needed
+
+DEFAULT_WINDOW_SAMPLES = 200_000
+DISPLAY_BINS = 1000 # two points (min, max) per bin
+UPDATE_PERIOD_MS = 250
+
+class SampleRing:
+	"""The last `capacity` samples, in the same columns as SampleColumns."""
+
+	def __init__(self, capacity: int = DEFAULT_WINDOW_SAMPLES):
+		self.capacity = capacity
+		self.arrays = {name: np.empty(capacity, dtype=dtype) for name, dtype in SampleColumns.COLUMNS.items()}
+		self.head = 0 # next slot to write
+		self.count = 0
+		self.total = 0 # samples ever appended
+
+	def __len__(self) -> int:
+		return self.count
+
+	def append(self, batch: dict[str, np.ndarray]) -> None:
+		n = len(batch["value"])
+		if n == 0:
+			return
+		self.total += n
+		skip = max(0, n - self.capacity) # only the newest `capacity` can survive
+		n -= skip
+		first = min(n, self.capacity - self.head)
+		for name, array in self.arrays.items():
+			column = batch[name][skip:]
+			array[self.head:self.head + first] = column[:first]
+			array[:n - first] = column[first:]
+		self.head = (self.head + n) % self.capacity
+		self.count = min(self.capacity, self.count + n)
+
+	def snapshot(self) -> dict[str, np.ndarray]:
+		"""Copies of the columns, oldest first."""
+		start = (self.head - self.count) % self.capacity
+		idx = (start + np.arange(self.count)) % self.capacity
+		return {name: array[idx] for name, array in self.arrays.items()}
+
+def minmax_decimate(x: np.ndarray, y: np.ndarray, n_bins: int = DISPLAY_BINS) -> tuple[np.ndarray, np.ndarray]:
+	"""Keeps the min and the max of each of `n_bins` equal slices, in time order,
+	so spikes survive however many points are squeezed into the plot.
+	"""
+	n = len(y)
+	if n <= 2 * n_bins:
+		return x, y
+	per_bin = n // n_bins
+	used = per_bin * n_bins
+	bins = y[:used].reshape(n_bins, per_bin)
+	offsets = np.arange(n_bins)[:, None] * per_bin
+	lo = bins.argmin(axis=1)[:, None]
+	hi = bins.argmax(axis=1)[:, None]
+	idx = (offsets + np.sort(np.hstack([lo, hi]), axis=1)).ravel()
+	if used < n: # leftover samples, kept as-is (fewer than per_bin)
+		tail = np.arange(used, n)
+		idx = np.concatenate([idx, [tail[y[tail].argmin()], tail[y[tail].argmax()]]])
+		idx = np.unique(idx)
+	return x[idx], y[idx]
+
+def rolling_stats(snapshot: dict[str, np.ndarray], kind: int, window_s: float) -> dict[str, float]:
+	"""Stats over the last `window_s` seconds of one kind of sample."""
+	mask = snapshot["kind"] == kind
+	times = sample_times(snapshot)[mask]
+	values = snapshot["value"][mask]
+	if len(values) == 0:
+		return {"n": 0}
+	recent = times >= times[-1] - window_s
+	values = values[recent].astype(np.float64)
+	span = times[recent][-1] - times[recent][0]
+	return {
+		"n": len(values),
+		"rate_hz": (len(values) - 1) / span if span > 0 else 0.0,
+		"last": values[-1],
+		"mean": values.mean(),
+		"std": values.std(),
+		"min": values.min(),
+		"max": values.max(),
+	}
+
+class LiveIngest(threading.Thread):
+	"""Reads `ser` into a SampleRing (and `writer`, if given) until stop() is
+	called or a replay runs out.
+	"""
+
+	def __init__(self, ser, window_samples: int = DEFAULT_WINDOW_SAMPLES, writer: CaptureWriter | None = None):
+		super().__init__(daemon=True)
+		self.ser = ser
+		self.writer = writer
+		self.parser = IngestParser(keep_samples=False)
+		self.ring = SampleRing(window_samples)
+		self.lock = threading.Lock()
+		self.running = True
+		self.start_time = time.time()
+
+	def run(self) -> None:
+		while self.running:
+			chunk = read_available(self.ser, self.start_time)
+			if chunk is None:
+				logger.info(f"Replay finished: {self.parser.summary()}")
+				break
+			if not chunk[0]:
+				continue
+			batch = self.parser.feed(*chunk)
+			if self.writer:
+				self.writer.write(batch)
+			with self.lock:
+				self.ring.append(batch)
+
+	def stop(self) -> None:
+		self.running = False
+
+	def snapshot(self) -> dict[str, np.ndarray]:
+		with self.lock:
+			return self.ring.snapshot()
+
+	def bytes_per_s(self) -> float:
+		return self.parser.byte_count / max(time.time() - self.start_time, 1e-9)
+
+def format_stats(stats: dict[str, float], ingest: LiveIngest, unit: str) -> str:
+	parser = ingest.parser
+	lines = [
+		f"**samples** {parser.sample_count} (window {len(ingest.ring)}) &nbsp; **link** {ingest.bytes_per_s():.0f} B/s",
+		f"**frames** {parser.frame_count} &nbsp; **bad** {parser.bad_frame_count} &nbsp; **dropped** {parser.dropped_frames}",
+	]
+	if stats["n"]:
+		lines.append(
+			f"**last** {stats['last']:.0f} {unit} &nbsp; **mean** {stats['mean']:.1f} &nbsp; **std** {stats['std']:.2f} &nbsp; "
+			f"**min** {stats['min']:.0f} &nbsp; **max** {stats['max']:.0f} &nbsp; **rate** {stats['rate_hz']:.1f} Hz"
+		)
+	return "\n\n".join(lines)
+
+def run_dashboard(ser, kind: int, title: str, y_label: str, unit: str,
+		window_samples: int = DEFAULT_WINDOW_SAMPLES, stats_window_s: float = 10.0, writer: CaptureWriter | None = None) -> None:
+	"""Serves the live page (opens a browser) until Ctrl+C. Closes `writer` at the end."""
+	import holoviews as hv
+	import panel as pn
+	from holoviews.streams import Pipe
+
+	hv.extension("bokeh")
+	ingest = LiveIngest(ser, window_samples, writer)
+	ingest.start()
+
+	def build_page():
+		pipe = Pipe(data=(np.empty(0), np.empty(0)))
+		plot = hv.DynamicMap(
+			lambda data: hv.Curve(data, kdims=["Time (s)"], vdims=[y_label]).opts(
+				title=title, responsive=True, height=400, framewise=True),
+			streams=[pipe],
+		)
+		stats_pane = pn.pane.Markdown("waiting for data...")
+
+		def update():
+			snapshot = ingest.snapshot()
+			mask = snapshot["kind"] == kind
+			pipe.send(minmax_decimate(sample_times(snapshot)[mask], snapshot["value"][mask]))
+			stats_pane.object = format_stats(rolling_stats(snapshot, kind, stats_window_s), ingest, unit)
+
+		pn.state.add_periodic_callback(update, period=UPDATE_PERIOD_MS)
+		return pn.Column(pn.pane.HoloViews(plot, sizing_mode="stretch_width"), stats_pane, sizing_mode="stretch_width")
+
+	logger.info(f"Serving the live view. Press Ctrl+C to stop...")
+	try:
+		pn.serve(build_page, show=True, title=title)
+	except KeyboardInterrupt:
+		logger.info("Got keyboard interrupt. Exiting...")
+	finally:
+		ingest.stop()
+		ingest.join()
+		logger.info(f"Ingest: {ingest.parser.summary()}")
+		if writer:
+			writer.close(ingest_metadata(ingest.parser))
+			logger.info(f"Saved {writer.rows_written} samples to {writer.path}")
+
+def main():
+	parser = argparse.ArgumentParser(description="Live view of a board's ADC or capacitance stream")
+	parser.add_argument("--port", help="serial port (default: prompt)")
+	parser.add_argument("--synthetic", action="store_true", help="made-up data instead of a port")
+	parser.add_argument("--text", action="store_true", help="synthetic: text reports instead of binary frames")
+	parser.add_argument("--kind", choices=[KIND_NAMES[KIND_ADC], KIND_NAMES[KIND_CAP_PF]], default="adc")
+	parser.add_argument("--baud", type=int, default=9600)
+	parser.add_argument("--window", type=int, default=DEFAULT_WINDOW_SAMPLES, help="samples kept for the plot")
+	parser.add_argument("--save", type=Path, help="also write every sample to this Parquet file")
+	parser.add_argument("--meta", action="append", default=[], help="KEY=VALUE stored with --save (clock_khz, ctmu_range, ...)")
+	parser.add_argument("--record", type=Path, help="also write the raw bytes, with arrival times, to this capture (.gz to compress)")
+	parser.add_argument("--replay", type=Path, help="read a --record capture instead of a port")
+	parser.add_argument("--replay-speed", type=float, default=1.0, help="replay pace, 0 for as fast as possible")
+	args = parser.parse_args()
+
+	kind = KIND_ADC if args.kind == "adc" else KIND_CAP_PF
+	title, y_label, unit = ("ADC Value", "ADC Value (0-1023)", "counts") if kind == KIND_ADC else ("Capacitance", "Capacitance (pF)", "pF")
+	metadata = {"logger": "live_view", "baud": args.baud, **parse_meta_args(args.meta)}
+	if args.synthetic:
+		ser = SyntheticSerial(args.kind, binary=not args.text, baud=args.baud)
+		if args.record:
+			ser = RecordingSerial(ser, RawCaptureWriter(args.record, {"port": ser.port, **metadata}))
+	else:
+		ser = open_source(args.port, args.baud, args.record, args.replay, args.replay_speed, metadata)
+	writer = None
+	if args.save:
+		writer = CaptureWriter(args.save, {**metadata, "port": getattr(ser, "port", None), **getattr(ser, "metadata", {})})
+	with ser:
+		run_dashboard(ser, kind, title, y_label, unit, args.window, writer=writer)
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,211 @@
+import serial
+import serial.tools.list_ports # important
+from loguru import logger
+import argparse
+import queue
+import re
+import threading
+import time
+from pathlib import Path
+
+import numpy as np
+import polars as pl
+
+from serial_ingest import IngestParser, SampleColumns, KIND_NAMES
+from serial_sources import SyntheticSerial, RecordingSerial, open_source, read_available, prompt_for_serial_ports
+from raw_capture import RawCaptureWriter
+from capture_store import CaptureWriter, parse_meta_args, sort_capture
+
+# Logs several boards at once: a thread per port runs its own IngestParser, so
+# each stream is told apart by what's in it (ADC reports or ADC_BATCH frames,
+# capacitance, App1_Receiver's IR codes) rather than by which script opened it.
+# Every sample goes into one Parquet capture with a `port` column; host_time
+# and aligned_time are on one clock for all ports (seconds since origin_unix_s
+# in the metadata) and the file is sorted by them when the run ends.
+#
+# Usage:
+#   python multi_logger.py --port /dev/ttyUSB0 --port /dev/ttyUSB1@115200 --save bench.parquet
+#   python multi_logger.py --all-ports --record-dir raw/     # every port, raw captures too
+#   python multi_logger.py --replay a.p24raw.gz --replay b.p24raw.gz --replay-speed 0
+#   python multi_logger.py --synthetic adc --synthetic cap_pF --synthetic ir_code   # no boards needed
+
+MULTI_COLUMNS = {**SampleColumns.COLUMNS, "port": np.uint8} # index into the metadata's "ports"
+QUEUE_BATCHES = 1024 # a reader waits (and its port backs up) if the writer falls this far behind
+STATS_PERIOD_S = 2.0
+
+class PortReader(threading.Thread):
+	"""Reads one source until stop() or the end of a replay, handing every
+	batch (tagged with `index`) to `out`.
+	"""
+
+	def __init__(self, index: int, name: str, ser, out: queue.Queue, origin: float):
+		super().__init__(daemon=True, name=f"port-{name}")
+		self.index = index
+		self.name = name
+		self.ser = ser
+		self.out = out
+		self.origin = origin
+		# recordings and replays count time from their own start
+		self.time_offset = getattr(ser, "capture_start", origin) - origin
+		self.parser = IngestParser(keep_samples=False)
+		self.kind_counts = np.zeros(len(KIND_NAMES), dtype=np.int64)
+		self.running = True
+		self.error: str | None = None
+		self.start_time = time.time()
+		self.end_time: float | None = None
+
+	def run(self) -> None:
+		try:
+			with self.ser:
+				while self.running:
+					chunk = read_available(self.ser, self.origin)
+					if chunk is None:
+						break
+					data, host_time = chunk
+					if not data:
+						continue
+					batch = self.parser.feed(data, host_time + self.time_offset)
+					if len(batch["value"]) == 0:
+						continue
+					batch["port"] = np.full(len(batch["value"]), self.index, dtype=np.uint8)
+					self.kind_counts += np.bincount(batch["kind"], minlength=len(KIND_NAMES))
+					self.out.put(batch)
+		except (serial.SerialException, OSError) as e:
+			self.error = str(e)
+			logger.error(f"{self.name}: {e}")
+		finally:
+			self.end_time = time.time()
+
+	def stop(self) -> None:
+		self.running = False
+
+	def detected(self) -> str:
+		"""What this port turned out to be sending, e.g. "adc (binary)"."""
+		kinds = [KIND_NAMES[kind] for kind in np.flatnonzero(self.kind_counts)]
+		if not kinds:
+			return "unknown"
+		return "+".join(kinds) + (" (binary)" if self.parser.frame_count else " (text)")
+
+	def stats(self) -> dict:
+		elapsed = max((self.end_time or time.time()) - self.start_time, 1e-9)
+		parser = self.parser
+		return {
+			"port": self.name,
+			"detected": self.detected(),
+			"bytes": parser.byte_count,
+			"bytes_per_s": round(parser.byte_count / elapsed, 1),
+			"samples": parser.sample_count,
+			"samples_per_s": round(parser.sample_count / elapsed, 1),
+			"frames": parser.frame_count,
+			"bad_frames": parser.bad_frame_count,
+			"dropped_frames": parser.dropped_frames,
+			"timer_hz": parser.timer_hz,
+			"drift_ppm": round(parser.clock.drift_ppm(parser.timer_hz), 1) if parser.timer_hz else None,
+			"error": self.error,
+		}
+
+def split_port_spec(spec: str, default_baud: int) -> tuple[str, int]:
+	""""/dev/ttyUSB1@115200" -> ("/dev/ttyUSB1", 115200)"""
+	match = re.fullmatch(r"(.+)@(\d+)", spec)
+	return (match.group(1), int(match.group(2))) if match else (spec, default_baud)
+
+def record_path(record_dir: Path, name: str) -> Path:
+	return record_dir / (re.sub(r"[^\w.-]+", "_", name).strip("_") + ".p24raw.gz")
+
+def open_sources(args, metadata: dict) -> list[tuple[str, object]]:
+	"""[(name, serial-like source)] for everything asked for on the command line."""
+	specs = list(args.port)
+	if args.all_ports:
+		specs += [port.device for port in serial.tools.list_ports.comports()]
+	if not (specs or args.replay or args.synthetic):
+		specs = prompt_for_serial_ports()
+
+	sources = []
+	for spec in specs:
+		port, baud = split_port_spec(spec, args.baud)
+		record = record_path(args.record_dir, port) if args.record_dir else None
+		sources.append((port, open_source(port, baud, record, metadata=metadata)))
+	for path in args.replay:
+		sources.append((str(path), open_source(None, args.baud, replay=path, replay_speed=args.replay_speed)))
+	for i, kind in enumerate(args.synthetic):
+		name = f"synthetic-{i}-{kind}"
+		ser = SyntheticSerial(kind, binary=not args.text, baud=args.baud, seed=i)
+		if args.record_dir:
+			ser = RecordingSerial(ser, RawCaptureWriter(record_path(args.record_dir, name), {"port": name, **metadata}))
+		sources.append((name, ser))
+	return sources
+
+def log_stats(readers: list[PortReader]) -> None:
+	for reader in readers:
+		stats = reader.stats()
+		logger.info(f"{stats['port']}: {stats['detected']}, {stats['bytes_per_s']:.0f} B/s, {stats['samples']} samples "
+			f"({stats['samples_per_s']:.0f}/s), bad={stats['bad_frames']} dropped={stats['dropped_frames']}"
+			+ (f", error: {stats['error']}" if stats["error"] else ""))
+
+def run(sources: list[tuple[str, object]], save: Path, metadata: dict, stop: threading.Event | None = None) -> list[dict]:
+	"""Logs until Ctrl+C, `stop` is set, or every source has ended; returns the per-port stats."""
+	origin = min([getattr(ser, "capture_start", time.time()) for _, ser in sources])
+	out: queue.Queue = queue.Queue(maxsize=QUEUE_BATCHES)
+	readers = [PortReader(i, name, ser, out, origin) for i, (name, ser) in enumerate(sources)]
+	unsorted_path = save.with_name(save.stem + ".unsorted.parquet")
+	writer = CaptureWriter(unsorted_path, {**metadata, "ports": [name for name, _ in sources], "origin_unix_s": origin},
+		columns=MULTI_COLUMNS)
+
+	for reader in readers:
+		reader.start()
+	logger.info(f"Logging {len(readers)} ports to {save}. Press Ctrl+C to stop...")
+	last_stats_time = time.time()
+	try:
+		while (any(reader.is_alive() for reader in readers) or not out.empty()) and not (stop and stop.is_set()):
+			try:
+				writer.write(out.get(timeout=0.2))
+			except queue.Empty:
+				pass
+			if time.time() - last_stats_time > STATS_PERIOD_S:
+				log_stats(readers)
+				last_stats_time = time.time()
+	except KeyboardInterrupt:
+		logger.info("Got keyboard interrupt. Exiting...")
+
+	for reader in readers:
+		reader.stop()
+	while any(reader.is_alive() for reader in readers) or not out.empty():
+		try:
+			writer.write(out.get(timeout=0.05)) # also unblocks a reader waiting on a full queue
+		except queue.Empty:
+			pass
+	for reader in readers:
+		reader.join()
+
+	port_stats = [reader.stats() for reader in readers]
+	writer.close({"port_stats": port_stats})
+	sort_capture(unsorted_path, save)
+	unsorted_path.unlink()
+	logger.info(f"Saved {writer.rows_written} samples to {save}")
+	return port_stats
+
+def main():
+	parser = argparse.ArgumentParser(description="Log several boards at once into one time-aligned capture")
+	parser.add_argument("--port", action="append", default=[], help="serial port, optionally PORT@BAUD (repeat for more)")
+	parser.add_argument("--all-ports", action="store_true", help="every serial port on this machine")
+	parser.add_argument("--replay", type=Path, action="append", default=[], help="a raw capture as one more port (repeat for more)")
+	parser.add_argument("--replay-speed", type=float, default=1.0, help="replay pace, 0 for as fast as possible")
+	parser.add_argument("--synthetic", choices=list(KIND_NAMES.values()), action="append", default=[], help="a made-up board (repeat for more)")
+	parser.add_argument("--text", action="store_true", help="synthetic: text reports instead of binary frames")
+	parser.add_argument("--baud", type=int, default=9600, help="for ports given without @BAUD")
+	parser.add_argument("--save", type=Path, default=Path(time.strftime("multi_%Y%m%d_%H%M%S.parquet")))
+	parser.add_argument("--record-dir", type=Path, help="also keep each port's raw bytes, as PORT.p24raw.gz in this directory")
+	parser.add_argument("--meta", action="append", default=[], help="KEY=VALUE stored in the capture")
+	args = parser.parse_args()
+
+	metadata = {"logger": "multi_logger", **parse_meta_args(args.meta)}
+	if args.record_dir:
+		args.record_dir.mkdir(parents=True, exist_ok=True)
+	sources = open_sources(args, metadata)
+	port_stats = run(sources, args.save, metadata)
+
+	with pl.Config(tbl_cols=-1, tbl_width_chars=200):
+		print(pl.DataFrame(port_stats).drop("timer_hz"))
+
+if __name__ == "__main__":
+	main()
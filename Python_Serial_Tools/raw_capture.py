@@ -0,0 +1,200 @@
+from loguru import logger
+import argparse
+import gzip
+import json
+import time
+from pathlib import Path
+
+from serial_ingest import IngestParser
+from capture_store import CaptureWriter, ingest_metadata, parse_meta_args
+
+# Raw serial captures: every read the logger made, byte for byte, with the
+# host time it arrived at, so a run can be parsed again later (a parser fix,
+# a new plot) or replayed through the loggers with serial_sources.ReplaySerial.
+#
+# File layout (little endian), gzip-compressed if the name ends in .gz:
+#   MAGIC, u32 metadata length, metadata JSON (port, baud, start time, --meta)
+#   records: microseconds since the previous record, length, bytes; the two
+#            numbers as LEB128 varints (a small read at a high baud rate costs
+#            2-3 bytes of header, not 8)
+# Records are appended as they come, so a capture cut short by a crash still
+# reads up to its last whole record.
+#
+# Usage:
+#   python make_adc_plot.py --record run.p24raw.gz          # capture while logging
+#   python make_adc_plot.py --replay run.p24raw.gz          # then feed it back (--replay-speed 0: no waiting)
+#   python raw_capture.py info run.p24raw.gz
+#   python raw_capture.py parse run.p24raw.gz --save run.parquet   # re-run the parser offline
+#   python raw_capture.py import sim_uart.bin --baud 115200 --out sim.p24raw   # wrap a plain byte dump
+
+MAGIC = b"PIC24RAW\x01"
+READ_BLOCK_BYTES = 1 << 20
+UART_BITS_PER_BYTE = 10 # start + 8 data + stop
+IMPORT_CHUNK_BYTES = 4096
+
+def encode_varint(value: int) -> bytes:
+	out = bytearray()
+	while value >= 0x80:
+		out.append((value & 0x7F) | 0x80)
+		value >>= 7
+	out.append(value)
+	return bytes(out)
+
+def decode_varint(buf: bytes | bytearray, pos: int) -> tuple[int, int] | None:
+	"""(value, position after it), or None if `buf` ends inside it."""
+	value = 0
+	shift = 0
+	while pos < len(buf):
+		byte = buf[pos]
+		pos += 1
+		value |= (byte & 0x7F) << shift
+		if byte < 0x80:
+			return value, pos
+		shift += 7
+	return None
+
+def open_capture_file(path: Path, mode: str):
+	return gzip.open(path, mode, compresslevel=6) if Path(path).suffix == ".gz" else open(path, mode)
+
+class RawCaptureWriter:
+	def __init__(self, path: Path, metadata: dict):
+		self.path = Path(path)
+		self.start_time = time.time()
+		self.metadata = {"created_unix_s": self.start_time, **metadata}
+		self.file = open_capture_file(self.path, "wb")
+		header = json.dumps(self.metadata).encode()
+		self.file.write(MAGIC + len(header).to_bytes(4, "little") + header)
+		self.last_us = 0
+		self.record_count = 0
+		self.byte_count = 0
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, *exc):
+		self.close()
+
+	def write(self, host_time: float, data: bytes) -> float:
+		"""`host_time` in seconds since start_time. Returns it as stored (to
+		the microsecond), which is what a replay will hand back.
+		"""
+		now_us = max(self.last_us, round(host_time * 1e6))
+		self.file.write(encode_varint(now_us - self.last_us) + encode_varint(len(data)) + data)
+		self.last_us = now_us
+		self.record_count += 1
+		self.byte_count += len(data)
+		return now_us / 1e6
+
+	def close(self) -> None:
+		if not self.file.closed:
+			self.file.close()
+
+class RawCaptureReader:
+	"""Iterates (host_time, bytes) records, in the order they were read."""
+
+	def __init__(self, path: Path):
+		self.path = Path(path)
+		with open_capture_file(self.path, "rb") as f:
+			if f.read(len(MAGIC)) != MAGIC:
+				raise ValueError(f"{self.path} is not a raw serial capture")
+			header_len = int.from_bytes(f.read(4), "little")
+			self.metadata = json.loads(f.read(header_len))
+			self.data_offset = len(MAGIC) + 4 + header_len
+
+	def __iter__(self):
+		with open_capture_file(self.path, "rb") as f:
+			f.seek(self.data_offset)
+			now_us = 0
+			buf = b""
+			pos = 0
+			while True:
+				block = f.read(READ_BLOCK_BYTES)
+				if not block:
+					if pos < len(buf):
+						logger.warning(f"{self.path}: last record cut short, ignoring it")
+					return
+				buf = buf[pos:] + block
+				pos = 0
+				while True:
+					delta = decode_varint(buf, pos)
+					length = delta and decode_varint(buf, delta[1])
+					if not length or length[1] + length[0] > len(buf):
+						break # the rest of this record is in the next block
+					now_us += delta[0]
+					pos = length[1] + length[0]
+					yield now_us / 1e6, buf[length[1]:pos]
+
+def is_raw_capture(path: Path) -> bool:
+	with open_capture_file(path, "rb") as f:
+		try:
+			return f.read(len(MAGIC)) == MAGIC
+		except OSError: # a plain file named .gz
+			return False
+
+def import_byte_dump(stream: bytes, baud: int, path: Path, metadata: dict) -> None:
+	"""Wraps a plain byte dump (a terminal log, the simulator's SIM_UART_OUT) as a
+	capture, in reads of IMPORT_CHUNK_BYTES timed as if they came at `baud`.
+	"""
+	bytes_per_s = baud / UART_BITS_PER_BYTE
+	with RawCaptureWriter(path, {"source": "import", "baud": baud, **metadata}) as writer:
+		for offset in range(0, len(stream), IMPORT_CHUNK_BYTES):
+			chunk = stream[offset:offset + IMPORT_CHUNK_BYTES]
+			writer.write((offset + len(chunk)) / bytes_per_s, chunk)
+
+def print_info(path: Path) -> None:
+	reader = RawCaptureReader(path)
+	print(json.dumps(reader.metadata, indent=2))
+	records = 0
+	total = 0
+	largest = 0
+	last_time = 0.0
+	for host_time, data in reader:
+		records += 1
+		total += len(data)
+		largest = max(largest, len(data))
+		last_time = host_time
+	rate = total / last_time if last_time > 0 else 0.0
+	print(f"{records} reads, {total} bytes over {last_time:.1f} s ({rate:.0f} B/s), largest read {largest} B, "
+		f"file {path.stat().st_size} B")
+
+def parse_capture(path: Path, save: Path | None) -> IngestParser:
+	"""Feeds a capture through IngestParser read by read, with the recorded host times."""
+	reader = RawCaptureReader(path)
+	parser = IngestParser(keep_samples=save is None)
+	writer = CaptureWriter(save, {**reader.metadata, "raw_capture": str(path)}) if save else None
+	for host_time, data in reader:
+		batch = parser.feed(data, host_time)
+		if writer:
+			writer.write(batch)
+	if writer:
+		writer.close(ingest_metadata(parser))
+		logger.info(f"Saved {writer.rows_written} samples to {writer.path}")
+	return parser
+
+def main():
+	parser = argparse.ArgumentParser(description="Inspect, re-parse or import raw serial captures")
+	commands = parser.add_subparsers(dest="command", required=True)
+	info = commands.add_parser("info", help="metadata and read/byte counts")
+	info.add_argument("path", type=Path)
+	parse = commands.add_parser("parse", help="run the capture through IngestParser")
+	parse.add_argument("path", type=Path)
+	parse.add_argument("--save", type=Path, help="write the samples to this Parquet file")
+	imp = commands.add_parser("import", help="wrap a plain byte dump as a capture")
+	imp.add_argument("path", type=Path)
+	imp.add_argument("--out", type=Path, required=True)
+	imp.add_argument("--baud", type=int, default=9600)
+	imp.add_argument("--meta", action="append", default=[], help="KEY=VALUE stored in the capture")
+	args = parser.parse_args()
+
+	if args.command == "info":
+		print_info(args.path)
+	elif args.command == "parse":
+		start = time.perf_counter()
+		ingest = parse_capture(args.path, args.save)
+		logger.info(f"Parsed in {time.perf_counter() - start:.2f} s: {ingest.summary()}")
+	else:
+		import_byte_dump(args.path.read_bytes(), args.baud, args.out, {"imported_from": args.path.name, **parse_meta_args(args.meta)})
+		print_info(args.out)
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,345 @@
+import numpy as np
+import polars as pl
+import re
+from collections import deque
+
+from clock_sync import ClockSync
+
+# Chunked, vectorized parser for everything the boards send over UART2:
+#   * text lines: "ADC Value: 0512  VDD_mV: 3300", "    REPORT_CAP_pF=1234" and
+#     App1_Receiver's "Received code: 0x20DF10EF"
+#   * binary telemetry frames (ENABLE_BINARY_TELEMETRY, see pic24_hal/telemetry.h, used by
+#     App2_Capacitance_Sensor / ADC_Driver_Project)
+# Disp2String() sends a NUL after every string, and every telemetry frame ends
+# in 0x00, so the stream splits into chunks at the zeros. Chunks of the same
+# length are decoded together as one 2D NumPy array (COBS, CRC, fields), and
+# whatever isn't a valid frame is searched for text reports.
+#
+# Usage:
+#   parser = IngestParser()
+#   parser.feed(ser.read(...), host_time)  # as often as data arrives
+#   df = parser.samples.to_polars()
+
+HEADER_LEN = 6 # type, seq, timestamp (LE32)
+CRC_LEN = 2
+MIN_FRAME_LEN = 1 + HEADER_LEN + CRC_LEN # COBS code byte + raw frame with no data
+MAX_FRAME_LEN = 255 # longer than any frame the firmware can send
+MAX_TEXT_TAIL = 4096 # text without any NUL (other firmware): parse up to the last '\n' past this
+TEXT_LINES_KEPT = 100
+
+TYPE_HELLO = 0x01
+TYPE_TEXT = 0x02
+TYPE_CAP_PF = 0x10
+TYPE_ADC_BATCH = 0x11
+
+SEQ_NONE = 0xFFFF # seq column for text rows: outside the 8-bit frame counter
+
+KIND_ADC = 0
+KIND_CAP_PF = 1
+KIND_IR_CODE = 2
+KIND_NAMES = {KIND_ADC: "adc", KIND_CAP_PF: "cap_pF", KIND_IR_CODE: "ir_code"}
+
+PRINTABLE = np.zeros(256, dtype=bool)
+PRINTABLE[0x20:0x7F] = True
+PRINTABLE[[0x09, 0x0A, 0x0D]] = True
+
+TEXT_REPORT_RE = re.compile(rb"ADC Value: (\d+)(?:\s+VDD_mV: (\d+))?|REPORT_CAP_pF=(\d+)|Received code: 0x([0-9A-Fa-f]{8})")
+
+def make_crc16_table() -> np.ndarray:
+	"""Byte-at-a-time table for CRC-16/CCITT-FALSE (poly 0x1021), as in pic24_hal/crc16.c."""
+	table = np.zeros(256, dtype=np.uint16)
+	for byte in range(256):
+		crc = byte << 8
+		for _ in range(8):
+			crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+		table[byte] = crc & 0xFFFF
+	return table
+
+CRC16_TABLE = make_crc16_table()
+
+def crc16_rows(rows: np.ndarray) -> np.ndarray:
+	"""CRC-16/CCITT-FALSE of every row of a 2D uint8 array; loops over columns, not rows."""
+	crc = np.full(rows.shape[0], 0xFFFF, dtype=np.uint16)
+	for col in range(rows.shape[1]):
+		crc = (crc << np.uint16(8)) ^ CRC16_TABLE[(crc >> np.uint16(8)) ^ rows[:, col]]
+	return crc
+
+def cobs_decode_rows(rows: np.ndarray) -> tuple[np.ndarray, np.ndarray]:
+	"""COBS-decodes every row of a 2D uint8 array (no trailing 0x00).
+
+	Returns (raw, valid): raw has one column fewer than `rows`. Follows the
+	chain of code bytes in all rows at once, so it loops once per zero in the
+	longest frame rather than once per byte.
+	"""
+	n_rows, n_cols = rows.shape
+	raw = rows[:, 1:].copy()
+	valid = np.ones(n_rows, dtype=bool)
+	row_idx = np.arange(n_rows)
+	pos = np.zeros(n_rows, dtype=np.int64) # index of the current code byte
+	active = np.ones(n_rows, dtype=bool)
+	while active.any():
+		code = rows[row_idx[active], pos[active]].astype(np.int64)
+		next_pos = pos[active] + code
+		overrun = next_pos > n_cols
+		valid[row_idx[active][overrun]] = False
+
+		inside = next_pos < n_cols
+		# a code below 0xFF stands for a zero at the next code byte's place
+		zero_rows = row_idx[active][inside & (code < 0xFF)]
+		raw[zero_rows, next_pos[inside & (code < 0xFF)] - 1] = 0
+
+		pos[active] = next_pos
+		active_idx = row_idx[active]
+		active[active_idx[~inside]] = False
+	return raw, valid
+
+def cobs_encode(data: bytes) -> bytes:
+	"""COBS-encodes `data` (without the trailing 0x00)."""
+	out = bytearray([0])
+	code_idx = 0
+	for byte in data:
+		if byte == 0:
+			out[code_idx] = len(out) - code_idx
+			code_idx = len(out)
+			out.append(0)
+			continue
+		out.append(byte)
+		if len(out) - code_idx == 0xFF:
+			out[code_idx] = 0xFF
+			code_idx = len(out)
+			out.append(0)
+	out[code_idx] = len(out) - code_idx
+	return bytes(out)
+
+def encode_frame(record_type: int, seq: int, timestamp: int, data: bytes) -> bytes:
+	"""A complete frame, like telemetry_encode() builds; for synthetic streams."""
+	raw = bytes([record_type, seq & 0xFF]) + (timestamp & 0xFFFFFFFF).to_bytes(4, "little") + data
+	crc = int(crc16_rows(np.frombuffer(raw, dtype=np.uint8)[None, :])[0])
+	return cobs_encode(raw + crc.to_bytes(2, "little")) + b"\x00"
+
+class SampleColumns:
+	"""Growable columnar sample store: preallocated NumPy arrays, doubled when full."""
+	COLUMNS = {
+		"host_time": np.float64, # seconds, when the chunk holding the sample arrived
+		"aligned_time": np.float64, # seconds on the same clock, from device_ticks via ClockSync (NaN for text)
+		"device_ticks": np.int64, # Timer3 ticks from the frame (-1 for text)
+		"seq": np.uint16, # frame sequence number, 0..255 as sent (SEQ_NONE for text)
+		"kind": np.uint8, # KIND_ADC, KIND_CAP_PF, KIND_IR_CODE
+		"value": np.int64, # ADC counts, pF or the 32-bit IR code
+		"vdd_mV": np.int32, # -1 when not reported
+	}
+
+	def __init__(self, capacity: int = 1 << 16, columns: dict | None = None):
+		"""`columns`: COLUMNS plus any extra ones (multi_logger's port index)."""
+		self.length = 0
+		self.columns = columns or self.COLUMNS
+		self.arrays = {name: np.empty(capacity, dtype=dtype) for name, dtype in self.columns.items()}
+
+	def __len__(self) -> int:
+		return self.length
+
+	def append(self, batch: dict[str, np.ndarray]) -> None:
+		count = len(batch["value"])
+		if count == 0:
+			return
+		capacity = len(self.arrays["value"])
+		if self.length + count > capacity:
+			new_capacity = max(capacity * 2, self.length + count)
+			for name, array in self.arrays.items():
+				grown = np.empty(new_capacity, dtype=array.dtype)
+				grown[:self.length] = array[:self.length]
+				self.arrays[name] = grown
+		for name, array in self.arrays.items():
+			array[self.length:self.length + count] = batch[name]
+		self.length += count
+
+	def clear(self) -> None:
+		self.length = 0
+
+	def column(self, name: str) -> np.ndarray:
+		return self.arrays[name][:self.length]
+
+	def to_polars(self) -> pl.DataFrame:
+		return pl.DataFrame({name: self.column(name) for name in self.columns})
+
+def sample_times(columns: dict[str, np.ndarray]) -> np.ndarray:
+	"""aligned_time where there is one (frames, once the clock fit has started), else host_time."""
+	return np.where(np.isnan(columns["aligned_time"]), columns["host_time"], columns["aligned_time"])
+
+def empty_batch() -> dict[str, np.ndarray]:
+	return {name: np.empty(0, dtype=dtype) for name, dtype in SampleColumns.COLUMNS.items()}
+
+class IngestParser:
+	def __init__(self, keep_samples: bool = True):
+		"""keep_samples=False: only return each batch from feed(), for callers that keep their own (bounded) store."""
+		self.tail = b"" # bytes after the last 0x00, waiting for the rest of their chunk
+		self.keep_samples = keep_samples
+		self.sample_count = 0
+		self.samples = SampleColumns()
+		self.timer_hz: float | None = None # Timer3 ticks per second, from HELLO
+		self.clock = ClockSync()
+		self.last_seq: int | None = None
+		self.byte_count = 0
+		self.frame_count = 0
+		self.bad_frame_count = 0 # looked like a frame (not text), failed COBS or CRC
+		self.dropped_frames = 0 # seq gaps
+		self.text_lines: deque[str] = deque(maxlen=TEXT_LINES_KEPT) # latest TEXT frames, for logging
+
+	def feed(self, data: bytes, host_time: float) -> dict[str, np.ndarray]:
+		"""Parses `data`, appends the samples to self.samples, and returns just the new ones (in stream order)."""
+		self.byte_count += len(data)
+		buf = self.tail + data
+		arr = np.frombuffer(buf, dtype=np.uint8)
+		zeros = np.flatnonzero(arr == 0)
+		if len(zeros) == 0:
+			if len(buf) <= MAX_TEXT_TAIL or b"\n" not in buf:
+				self.tail = buf
+				return empty_batch()
+			end = buf.rindex(b"\n") + 1
+			self.tail = buf[end:]
+			text_groups = self.parse_text(buf, end, np.array([end]), np.zeros(1, dtype=bool))
+			batch = self.merge([], text_groups, host_time)
+			self.store(batch)
+			return batch
+
+		self.tail = buf[zeros[-1] + 1:]
+		starts = np.concatenate(([0], zeros[:-1] + 1))
+		ends = zeros
+		lengths = ends - starts
+
+		is_frame = np.zeros(len(starts), dtype=bool)
+		frame_groups = self.parse_frames(arr, starts, lengths, is_frame)
+		text_groups = self.parse_text(buf, int(zeros[-1]), ends, is_frame)
+		batch = self.merge(frame_groups, text_groups, host_time)
+		self.store(batch)
+		return batch
+
+	def store(self, batch: dict[str, np.ndarray]) -> None:
+		self.sample_count += len(batch["value"])
+		if self.keep_samples:
+			self.samples.append(batch)
+
+	def parse_frames(self, arr: np.ndarray, starts: np.ndarray, lengths: np.ndarray, is_frame: np.ndarray) -> list[tuple]:
+		"""Decodes every chunk that is a valid frame, marking it in `is_frame`.
+		Returns [(chunk_idx, record_type, seq, ticks, raw data rows)] per length group, for merge().
+		"""
+		groups = []
+		# a COBS code byte never points past the end of its chunk
+		candidates = (lengths >= MIN_FRAME_LEN) & (lengths <= MAX_FRAME_LEN)
+		candidates[candidates] &= arr[starts[candidates]] <= lengths[candidates]
+		for length in np.unique(lengths[candidates]):
+			chunk_idx = np.flatnonzero(candidates & (lengths == length))
+			rows = arr[starts[chunk_idx, None] + np.arange(length)]
+			# every record type is a control character, so text lines can be skipped before the COBS/CRC work
+			printable = np.all(PRINTABLE[rows], axis=1)
+			chunk_idx = chunk_idx[~printable]
+			rows = rows[~printable]
+			if len(rows) == 0:
+				continue
+			raw, valid = cobs_decode_rows(rows)
+			crc_ok = crc16_rows(raw[:, :-CRC_LEN]) == (raw[:, -2].astype(np.uint16) | (raw[:, -1].astype(np.uint16) << np.uint16(8)))
+			valid &= crc_ok
+			self.bad_frame_count += int(np.count_nonzero(~valid))
+			if not valid.any():
+				continue
+			chunk_idx = chunk_idx[valid]
+			raw = raw[valid]
+			is_frame[chunk_idx] = True
+			ticks = np.ascontiguousarray(raw[:, 2:6]).view("<u4").ravel().astype(np.int64)
+			groups.append((chunk_idx, raw[:, 0], raw[:, 1], ticks, raw[:, HEADER_LEN:-CRC_LEN]))
+		return groups
+
+	def parse_text(self, buf: bytes, end: int, ends: np.ndarray, is_frame: np.ndarray) -> list[tuple]:
+		"""Finds text reports in buf[:end], outside the valid frames. Returns [("text", chunk_idx, kind, value, vdd_mV)]."""
+		matches = [match.groups() + (match.start(),) for match in TEXT_REPORT_RE.finditer(buf, 0, end)]
+		chunk_idx = np.searchsorted(ends, np.array([match[4] for match in matches], dtype=np.int64))
+		keep = ~is_frame[np.minimum(chunk_idx, len(is_frame) - 1)] if len(is_frame) else np.ones(len(matches), dtype=bool)
+		if not keep.all():
+			matches = [match for match, kept in zip(matches, keep) if kept]
+			chunk_idx = chunk_idx[keep]
+		kind = np.array([KIND_ADC if adc_value is not None else KIND_CAP_PF if cap_pF is not None else KIND_IR_CODE
+			for adc_value, _, cap_pF, _, _ in matches], dtype=np.uint8)
+		value = np.array([int(adc_value) if adc_value is not None else int(cap_pF) if cap_pF is not None else int(ir_code, 16)
+			for adc_value, _, cap_pF, ir_code, _ in matches], dtype=np.int64)
+		vdd = np.array([-1 if vdd_mV is None else int(vdd_mV) for _, vdd_mV, _, _, _ in matches], dtype=np.int32)
+		return [("text", chunk_idx, kind, value, vdd)]
+
+	def merge(self, frame_groups: list[tuple], text_groups: list[tuple], host_time: float) -> dict[str, np.ndarray]:
+		"""Turns decoded frames and text matches into one sample batch in stream order."""
+		order_keys, columns = [], {name: [] for name in ("device_ticks", "seq", "kind", "value", "vdd_mV")}
+
+		# sequence numbers, in stream order across all frame lengths
+		if frame_groups:
+			chunk_idx = np.concatenate([group[0] for group in frame_groups])
+			record_type = np.concatenate([group[1] for group in frame_groups])
+			seq = np.concatenate([group[2] for group in frame_groups]).astype(np.int64)
+			order = np.argsort(chunk_idx, kind="stable")
+			self.count_drops(record_type[order], seq[order])
+			self.frame_count += len(chunk_idx)
+
+		for chunk_idx, record_type, seq, ticks, data in frame_groups:
+			self.handle_special_frames(record_type, data)
+
+			cap = record_type == TYPE_CAP_PF
+			if cap.any() and data.shape[1] >= 4:
+				values = np.ascontiguousarray(data[cap, 0:4]).view("<u4").ravel()
+				order_keys.append(chunk_idx[cap] << 8)
+				self.add_columns(columns, ticks[cap], seq[cap], KIND_CAP_PF, values, np.full(len(values), -1))
+
+			adc = record_type == TYPE_ADC_BATCH
+			if adc.any() and data.shape[1] >= 4:
+				vdd = np.ascontiguousarray(data[adc, 0:2]).view("<u2").ravel()
+				values = np.ascontiguousarray(data[adc, 2:2 + ((data.shape[1] - 2) // 2) * 2]).view("<u2")
+				per_frame = values.shape[1]
+				order_keys.append(((chunk_idx[adc] << 8)[:, None] + np.arange(per_frame)).ravel())
+				self.add_columns(columns, np.repeat(ticks[adc], per_frame), np.repeat(seq[adc], per_frame),
+					KIND_ADC, values.ravel(), np.repeat(vdd, per_frame))
+
+		for _, chunk_idx, kind, value, vdd in text_groups:
+			if len(value) == 0:
+				continue
+			order_keys.append(chunk_idx << 8)
+			self.add_columns(columns, np.full(len(value), -1), np.full(len(value), SEQ_NONE), kind, value, vdd)
+
+		if not order_keys:
+			return empty_batch()
+		order = np.argsort(np.concatenate(order_keys), kind="stable")
+		batch = {name: np.concatenate(columns[name]).astype(dtype)[order] for name, dtype in SampleColumns.COLUMNS.items() if name in columns}
+		batch["host_time"] = np.full(len(order), host_time)
+		batch["aligned_time"] = np.full(len(order), np.nan)
+		from_frames = batch["seq"] != SEQ_NONE
+		if from_frames.any():
+			batch["aligned_time"][from_frames] = self.clock.update(batch["device_ticks"][from_frames], host_time, self.timer_hz)
+		return batch
+
+	def add_columns(self, columns: dict, ticks, seq, kind, values, vdd) -> None:
+		columns["device_ticks"].append(np.asarray(ticks, dtype=np.int64))
+		columns["seq"].append(np.asarray(seq, dtype=np.uint16))
+		columns["kind"].append(np.broadcast_to(np.asarray(kind, dtype=np.uint8), len(values)))
+		columns["value"].append(np.asarray(values, dtype=np.int64))
+		columns["vdd_mV"].append(np.asarray(vdd, dtype=np.int32))
+
+	def handle_special_frames(self, record_type: np.ndarray, data: np.ndarray) -> None:
+		# rare, so a plain loop is fine
+		for row in np.flatnonzero(record_type == TYPE_HELLO):
+			if data.shape[1] >= 7:
+				fcy_hz = int.from_bytes(bytes(data[row, 0:4]), "little")
+				prescale = int.from_bytes(bytes(data[row, 4:6]), "little")
+				self.timer_hz = fcy_hz / prescale
+				self.clock.reset() # the board (re)started
+		for row in np.flatnonzero(record_type == TYPE_TEXT):
+			self.text_lines.append(bytes(data[row]).decode("ascii", errors="replace"))
+
+	def count_drops(self, record_type: np.ndarray, seq: np.ndarray) -> None:
+		"""Adds up the seq gaps; a HELLO (firmware restart) starts over."""
+		prev = np.concatenate(([self.last_seq if self.last_seq is not None else -1], seq[:-1]))
+		gaps = (seq - prev - 1) & 0xFF
+		gaps[(prev < 0) | (record_type == TYPE_HELLO)] = 0
+		self.dropped_frames += int(gaps.sum())
+		self.last_seq = int(seq[-1])
+
+	def summary(self) -> str:
+		return (
+			f"bytes={self.byte_count} samples={self.sample_count} frames={self.frame_count} "
+			f"bad_frames={self.bad_frame_count} dropped_frames={self.dropped_frames}"
+		)
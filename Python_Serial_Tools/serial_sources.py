@@ -0,0 +1,267 @@
+import serial
+import serial.tools.list_ports # important
+import easygui
+from loguru import logger
+import numpy as np
+import sys
+import time
+from pathlib import Path
+
+from serial_ingest import encode_frame, TYPE_HELLO, TYPE_ADC_BATCH, TYPE_CAP_PF
+from raw_capture import RawCaptureReader, RawCaptureWriter
+
+# Byte sources that look enough like serial.Serial (read(n), in_waiting,
+# close(), a context manager) for the loggers to use them in place of a board.
+
+UART_BITS_PER_BYTE = 10 # start + 8 data + stop
+ADC_BATCH_LEN = 8 # ADC_Driver_Project's TELEMETRY_ADC_BATCH_LEN
+SYNTHETIC_FCY_HZ = 4000000
+SYNTHETIC_TIMER_PRESCALE = 64
+IR_CODES = { # App1_Receiver's ir_receive.h
+	0xE0E040BF: "POWER_ON_OFF", 0xE0E048B7: "CHANNEL_UP", 0xE0E008F7: "CHANNEL_DOWN",
+	0xE0E0E01F: "VOLUME_UP", 0xE0E0D02F: "VOLUME_DOWN",
+}
+IR_CODES_PER_S = 2
+READ_CHUNK_BYTES = 65536
+READ_TIMEOUT_S = 0.05
+
+def prompt_for_serial_port():
+	port_list = serial.tools.list_ports.comports()
+	port_list_str: list[str] = [port.device for port in port_list]
+	logger.info(f"Available ports: {port_list_str}")
+
+	if not port_list:
+		logger.error("No serial ports found. Exiting...")
+		sys.exit(1)
+
+	if len(port_list_str) == 1:
+		logger.info(f"Only one port found: {port_list_str[0]}")
+		return port_list_str[0]
+
+	port = easygui.choicebox("Select the serial port", choices=[port.device for port in port_list])
+
+	if not port:
+		logger.error("No port selected. Exiting...")
+		sys.exit(1)
+
+	return port
+
+def prompt_for_serial_ports() -> list[str]:
+	"""Like prompt_for_serial_port(), but any number of ports."""
+	port_list_str = [port.device for port in serial.tools.list_ports.comports()]
+	logger.info(f"Available ports: {port_list_str}")
+
+	if not port_list_str:
+		logger.error("No serial ports found. Exiting...")
+		sys.exit(1)
+
+	if len(port_list_str) == 1:
+		return port_list_str
+
+	ports = easygui.multchoicebox("Select the serial ports", choices=port_list_str)
+
+	if not ports:
+		logger.error("No port selected. Exiting...")
+		sys.exit(1)
+
+	return ports
+
+def open_source(port: str | None, baud: int, record: Path | None = None, replay: Path | None = None,
+		replay_speed: float = 1.0, metadata: dict | None = None):
+	"""The board on `port` (prompting if None), or a capture from `replay`;
+	with `record`, every read is also written to a raw capture.
+	"""
+	if replay:
+		ser = ReplaySerial(replay, replay_speed)
+		logger.info(f"Replaying {replay} ({ser.metadata.get('port')}, {ser.metadata.get('baud')} baud) at "
+			+ ("full speed" if replay_speed == 0 else f"{replay_speed}x"))
+	else:
+		port = port or prompt_for_serial_port()
+		logger.info(f"Selected port: {port}")
+		ser = serial.Serial(port, baud, timeout=READ_TIMEOUT_S)
+	if record:
+		ser = RecordingSerial(ser, RawCaptureWriter(record, {"port": port, "baud": baud, **(metadata or {})}))
+	return ser
+
+def read_available(ser, start_time: float) -> tuple[bytes, float] | None:
+	"""One read of whatever has arrived, and when (seconds since `start_time`,
+	or the recorded time when replaying). None once a replay has run out.
+	"""
+	data = ser.read(max(1, min(ser.in_waiting, READ_CHUNK_BYTES)))
+	if not data and getattr(ser, "eof", False):
+		return None
+	host_time = getattr(ser, "capture_time", None)
+	return data, (time.time() - start_time if host_time is None else host_time)
+
+class RecordingSerial:
+	"""Passes `ser` through, writing every read to a RawCaptureWriter."""
+
+	def __init__(self, ser, writer: RawCaptureWriter):
+		self.ser = ser
+		self.writer = writer
+		self.capture_time = 0.0
+		self.capture_start = writer.start_time # unix time capture_time counts from
+
+	def __getattr__(self, name):
+		return getattr(self.ser, name)
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, *exc):
+		self.close()
+
+	def close(self) -> None:
+		self.ser.close()
+		self.writer.close()
+		logger.info(f"Recorded {self.writer.byte_count} bytes in {self.writer.record_count} reads to {self.writer.path}")
+
+	def read(self, size: int = 1) -> bytes:
+		data = self.ser.read(size)
+		self.capture_time = time.time() - self.writer.start_time
+		if data:
+			self.capture_time = self.writer.write(self.capture_time, data)
+		return data
+
+class ReplaySerial:
+	"""Plays a raw capture back read by read, as the logger first saw it: at the
+	recorded pace times `speed`, or with no waiting when `speed` is 0.
+	capture_time is the recorded host time of the last read, counted from
+	capture_start (the unix time the recording began).
+	"""
+
+	def __init__(self, path: Path, speed: float = 1.0):
+		reader = RawCaptureReader(path)
+		self.metadata = {**reader.metadata, "replayed_from": str(path)}
+		self.capture_start = reader.metadata.get("created_unix_s", 0.0)
+		self.records = iter(reader)
+		self.speed = speed
+		self.start = time.monotonic()
+		self.current = b"" # rest of the record being read
+		self.next_time = 0.0
+		self.capture_time = 0.0
+		self.eof = False
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, *exc):
+		self.close()
+
+	def close(self) -> None:
+		pass
+
+	@property
+	def in_waiting(self) -> int:
+		if not self.current and not self.eof:
+			record = next(self.records, None)
+			if record is None:
+				self.eof = True
+			else:
+				self.next_time, self.current = record
+		if self.speed and (time.monotonic() - self.start) * self.speed < self.next_time:
+			return 0
+		return len(self.current)
+
+	def read(self, size: int = 1) -> bytes:
+		# never past the end of a record, so the parser gets the same chunks it got live
+		available = self.in_waiting
+		if available == 0:
+			# like a read timeout: a read(1) that waited for the record would split it
+			if not self.eof:
+				time.sleep(max(0.0, min(READ_TIMEOUT_S, self.next_time / self.speed - (time.monotonic() - self.start))))
+			return b""
+		out = self.current[:min(size, available)]
+		self.current = self.current[len(out):]
+		if out:
+			self.capture_time = self.next_time
+		return out
+
+class SyntheticSerial:
+	"""Makes up a board's output, paced at `baud`: a slow sine plus noise, as
+	text reports or binary telemetry frames (ADC_BATCH for "adc", CAP_PF for "cap_pF");
+	"ir_code" is App1_Receiver's text report of a received code, a couple a second.
+	"""
+	port = "synthetic"
+
+	def __init__(self, kind: str = "adc", binary: bool = True, baud: int = 115200, sample_rate_hz: float | None = None, seed: int = 0):
+		self.kind = kind
+		self.binary = binary
+		self.bytes_per_s = baud / UART_BITS_PER_BYTE
+		self.rng = np.random.default_rng(seed)
+		self.start = time.monotonic()
+		self.sent = 0 # bytes handed out so far
+		self.pending = bytearray()
+		self.seq = 0
+		self.sample_idx = 0
+		# as fast as the link allows, unless asked for less
+		bytes_per_sample = 3.5 if (binary and kind == "adc") else (14 if binary else 30)
+		self.sample_rate_hz = sample_rate_hz or (IR_CODES_PER_S if kind == "ir_code" else self.bytes_per_s / bytes_per_sample)
+		if binary and kind != "ir_code":
+			hello = SYNTHETIC_FCY_HZ.to_bytes(4, "little") + SYNTHETIC_TIMER_PRESCALE.to_bytes(2, "little") + b"\x01"
+			self.pending += self.frame(TYPE_HELLO, 0, hello)
+
+	def __enter__(self):
+		return self
+
+	def __exit__(self, *exc):
+		self.close()
+
+	def close(self) -> None:
+		pass
+
+	def frame(self, record_type: int, ticks: int, data: bytes) -> bytes:
+		out = encode_frame(record_type, self.seq, ticks, data)
+		self.seq = (self.seq + 1) & 0xFF
+		return out
+
+	def next_values(self, count: int) -> np.ndarray:
+		t = (self.sample_idx + np.arange(count)) / self.sample_rate_hz
+		signal = 512 + 300 * np.sin(2 * np.pi * 0.2 * t) + self.rng.normal(0, 8, count)
+		if self.kind == "cap_pF":
+			signal = signal * 4
+		return np.clip(signal, 0, 1023 if self.kind == "adc" else None).astype(np.int64)
+
+	def generate(self) -> None:
+		ticks = int(self.sample_idx / self.sample_rate_hz * SYNTHETIC_FCY_HZ / SYNTHETIC_TIMER_PRESCALE)
+		if self.kind == "adc":
+			values = self.next_values(ADC_BATCH_LEN)
+			self.sample_idx += ADC_BATCH_LEN
+			if self.binary:
+				self.pending += self.frame(TYPE_ADC_BATCH, ticks, (3300).to_bytes(2, "little") + values.astype("<u2").tobytes())
+			else:
+				for value in values:
+					self.pending += f"ADC Value: {value:04d}  VDD_mV: 3300  \n\x00".encode()
+			return
+
+		if self.kind == "ir_code":
+			self.sample_idx += 1
+			code = list(IR_CODES)[self.rng.integers(len(IR_CODES))]
+			self.pending += f"Carrier was detected in >25 samples...\n\x00Received code: 0x{code:08X}\x00 ({IR_CODES[code]})\x00\n\n\x00".encode()
+			return
+
+		value = int(self.next_values(1)[0])
+		self.sample_idx += 1
+		if self.binary:
+			self.pending += self.frame(TYPE_CAP_PF, ticks, value.to_bytes(4, "little"))
+		else:
+			self.pending += f"    REPORT_CAP_pF={value}\n\x00".encode()
+
+	@property
+	def in_waiting(self) -> int:
+		due = int((time.monotonic() - self.start) * self.bytes_per_s) - self.sent
+		# the board makes samples at its own rate; the link only carries what it can
+		while len(self.pending) < due and self.sample_idx < (time.monotonic() - self.start) * self.sample_rate_hz:
+			self.generate()
+		return max(0, min(due, len(self.pending)))
+
+	def read(self, size: int = 1) -> bytes:
+		available = self.in_waiting
+		if available == 0:
+			time.sleep(0.01) # like a read timeout with nothing on the line
+			available = self.in_waiting
+		count = min(size, available)
+		out = bytes(self.pending[:count])
+		del self.pending[:count]
+		self.sent += count
+		return out
@@ -0,0 +1,71 @@
+import json
+
+import numpy as np
+import polars as pl
+import pyarrow.parquet as pq
+
+from capture_store import (CaptureWriter, scan_capture, read_capture_metadata, synthetic_batches, print_info,
+	ingest_metadata, FORMAT_VERSION, SAMPLE_TIME)
+from serial_ingest import IngestParser, encode_frame, SampleColumns, SEQ_NONE, TYPE_HELLO, TYPE_ADC_BATCH, KIND_ADC, KIND_CAP_PF
+
+# Captures written and read back: a 10 M-sample run at constant memory, and
+# what the parser puts in them.
+
+def test_10m_sample_round_trip(tmp_path):
+	n_samples = 10_000_000
+	row_group_rows = 1_000_000
+	path = tmp_path / "run.parquet"
+	value_sum = 0
+	seq_sum = 0
+	with CaptureWriter(path, {"source": "synthetic", "baud": 1000000, "ctmu_range": 1}, row_group_rows) as writer:
+		buffer_arrays = writer.buffer.arrays
+		for batch in synthetic_batches(n_samples):
+			value_sum += int(batch["value"].sum())
+			seq_sum += int(batch["seq"].sum())
+			writer.write(batch)
+			assert len(writer.buffer) < row_group_rows
+		# one row group in RAM, never grown
+		assert all(writer.buffer.arrays[name] is buffer_arrays[name] for name in buffer_arrays)
+	assert writer.rows_written == n_samples
+
+	metadata = read_capture_metadata(path)
+	assert metadata["rows"] == n_samples
+	assert metadata["format_version"] == FORMAT_VERSION
+	assert metadata["ctmu_range"] == 1 and metadata["baud"] == 1000000
+	assert pq.ParquetFile(path).metadata.num_row_groups == n_samples // row_group_rows
+
+	lf = scan_capture(path)
+	assert lf.collect_schema() == SampleColumns(1).to_polars().schema
+	totals = lf.select(n = pl.len(), value_sum = pl.col("value").sum(), seq_sum = pl.col("seq").cast(pl.Int64).sum(),
+		first = SAMPLE_TIME.min(), last = SAMPLE_TIME.max()).collect()
+	assert totals.row(0) == (n_samples, value_sum, seq_sum, 0.0, (n_samples - 8) / 30000.0)
+	# a lazy query reads back the same samples as were written, here the last second
+	tail = lf.filter(pl.col("host_time") >= (n_samples - 30000) / 30000.0).select("device_ticks", "value").collect()
+	for expected in synthetic_batches(n_samples):
+		pass # the last batch
+	assert len(tail) == 30000
+	assert tail["device_ticks"][-len(expected["value"]):].to_list() == expected["device_ticks"].tolist()
+	assert tail["value"][-len(expected["value"]):].to_list() == expected["value"].tolist()
+
+def test_parser_output_round_trip(tmp_path, capsys):
+	hello = encode_frame(TYPE_HELLO, 0, 0, (4000000).to_bytes(4, "little") + (64).to_bytes(2, "little") + b"\x01")
+	frames = [encode_frame(TYPE_ADC_BATCH, seq, seq * 250, (3300).to_bytes(2, "little") + np.full(8, seq, "<u2").tobytes())
+		for seq in range(1, 600) if seq not in (100, 101, 300)]
+	stream = hello + b"".join(frames) + b"    REPORT_CAP_pF=1234\n\x00"
+	parser = IngestParser()
+	path = tmp_path / "parsed.parquet"
+	with CaptureWriter(path, {"port": "test"}, row_group_rows=1000) as writer:
+		for offset in range(0, len(stream), 512):
+			writer.write(parser.feed(stream[offset:offset + 512], offset / 1e4))
+		writer.close(ingest_metadata(parser))
+
+	df = scan_capture(path).collect()
+	assert df.equals(parser.samples.to_polars())
+	assert df.filter(pl.col("kind") == KIND_CAP_PF)["seq"].to_list() == [SEQ_NONE]
+	assert df.filter(pl.col("kind") == KIND_ADC)["seq"].max() == 0xFF
+	metadata = read_capture_metadata(path)
+	assert metadata["dropped_frames"] == 3 and metadata["timer_hz"] == 4000000 / 64
+	assert json.loads(json.dumps(metadata)) == metadata
+
+	print_info(path)
+	assert "dropped frames (seq gaps): 3" in capsys.readouterr().out
@@ -0,0 +1,104 @@
+import time
+
+import numpy as np
+import pytest
+
+from live_view import SampleRing, LiveIngest, minmax_decimate, rolling_stats, format_stats
+from serial_ingest import SampleColumns, sample_times, KIND_ADC, KIND_CAP_PF
+from serial_sources import SyntheticSerial
+
+# The live view's data path, without a browser: the ring, the decimation and
+# the stats, and a LiveIngest thread reading a SyntheticSerial in real time.
+
+def make_batch(first: int, count: int) -> dict[str, np.ndarray]:
+	idx = np.arange(first, first + count)
+	return {
+		"host_time": idx / 1000.0,
+		"aligned_time": np.full(count, np.nan),
+		"device_ticks": idx,
+		"seq": (idx & 0xFF).astype(np.uint16),
+		"kind": np.full(count, KIND_ADC, dtype=np.uint8),
+		"value": idx,
+		"vdd_mV": np.full(count, 3300, dtype=np.int32),
+	}
+
+@pytest.mark.parametrize("batch_sizes", [[1] * 50, [7, 3, 13, 1, 30, 2], [25, 25, 25], [100], [3, 60, 4]])
+def test_ring_keeps_the_newest(batch_sizes):
+	ring = SampleRing(25)
+	arrays = ring.arrays
+	total = 0
+	for size in batch_sizes:
+		ring.append(make_batch(total, size))
+		total += size
+		snapshot = ring.snapshot()
+		assert list(snapshot["value"]) == list(range(max(0, total - 25), total))
+		assert set(snapshot) == set(SampleColumns.COLUMNS)
+	assert ring.total == total and len(ring) == min(total, 25)
+	# nothing is reallocated, however much goes through it
+	assert all(ring.arrays[name] is arrays[name] for name in arrays)
+
+def test_minmax_decimate_keeps_spikes():
+	rng = np.random.default_rng(0)
+	n = 1_000_003
+	x = np.arange(n) / 1000.0
+	y = rng.normal(512, 4, n)
+	spikes = [17, 400_000, 999_999, n - 1]
+	y[spikes[:2]] = 1023
+	y[spikes[2:]] = 0
+	dx, dy = minmax_decimate(x, y, 1000)
+	assert len(dx) <= 2 * 1000 + 2
+	assert np.all(np.diff(dx) > 0) # still in time order
+	assert set(np.round(x[spikes] * 1000).astype(int)) <= set(np.round(dx * 1000).astype(int))
+	assert dy.max() == 1023 and dy.min() == 0
+
+def test_minmax_decimate_passes_short_data_through():
+	x = np.arange(100.0)
+	dx, dy = minmax_decimate(x, x * 2, 1000)
+	assert dx is x and list(dy) == list(x * 2)
+
+def test_rolling_stats_window():
+	snapshot = make_batch(0, 20000) # 1 kHz for 20 s, value == index
+	snapshot["kind"][::2] = KIND_CAP_PF
+	stats = rolling_stats(snapshot, KIND_ADC, 5.0)
+	recent = np.arange(14999, 20000, 2) # ADC samples in the last 5 s, both ends included
+	assert stats["n"] == len(recent)
+	assert stats["last"] == 19999 and stats["min"] == recent[0] and stats["max"] == 19999
+	assert stats["mean"] == pytest.approx(recent.mean())
+	assert stats["rate_hz"] == pytest.approx(500.0, rel=1e-3)
+	assert rolling_stats(snapshot, 2, 5.0) == {"n": 0}
+
+@pytest.mark.parametrize("kind, binary", [("adc", True), ("adc", False), ("cap_pF", True)])
+def test_live_ingest_from_synthetic_serial(kind, binary):
+	window = 2000
+	ser = SyntheticSerial(kind, binary=binary, baud=1_000_000)
+	ingest = LiveIngest(ser, window)
+	ingest.start()
+	try:
+		deadline = time.monotonic() + 10.0
+		while ingest.ring.total < 3 * window and time.monotonic() < deadline:
+			time.sleep(0.05)
+			# what the page's periodic callback does
+			snapshot = ingest.snapshot()
+			plot_kind = KIND_ADC if kind == "adc" else KIND_CAP_PF
+			mask = snapshot["kind"] == plot_kind
+			dx, dy = minmax_decimate(sample_times(snapshot)[mask], snapshot["value"][mask], 500)
+			assert len(dx) <= 2 * 500 + 2
+			format_stats(rolling_stats(snapshot, plot_kind, 1.0), ingest, "counts")
+	finally:
+		ingest.stop()
+		ingest.join(timeout=5.0)
+	assert not ingest.is_alive()
+	assert ingest.ring.total >= 3 * window
+	assert len(ingest.ring) == window # bounded, however long it ran
+	parser = ingest.parser
+	assert len(parser.samples) == 0 # the ring is the only store
+	assert parser.sample_count == ingest.ring.total
+	assert parser.bad_frame_count == 0 and parser.dropped_frames == 0
+	snapshot = ingest.snapshot()
+	assert np.all(np.diff(snapshot["host_time"]) >= 0)
+	stats = rolling_stats(snapshot, KIND_ADC if kind == "adc" else KIND_CAP_PF, 1.0)
+	assert stats["n"] > 0 and 0 <= stats["min"] <= stats["mean"] <= stats["max"]
+	if binary:
+		# frame samples are placed by the clock fit; it has the synthetic board's Timer3 rate
+		assert parser.timer_hz == 4000000 / 64
+		assert not np.isnan(snapshot["aligned_time"]).all()
@@ -0,0 +1,102 @@
+import argparse
+import os
+import threading
+import time
+
+import numpy as np
+import polars as pl
+import pytest
+
+from capture_store import scan_capture, read_capture_metadata, SAMPLE_TIME
+from multi_logger import open_sources, run, split_port_spec, record_path
+from raw_capture import parse_capture
+from serial_ingest import encode_frame, SEQ_NONE, TYPE_HELLO, TYPE_ADC_BATCH, KIND_ADC, KIND_CAP_PF, KIND_IR_CODE
+
+# multi_logger against pseudo-terminal pairs: the logger opens the pty's
+# slave end as a serial port, the test writes a board's output to the master.
+
+pytestmark = pytest.mark.skipif(not hasattr(os, "openpty"), reason="needs pseudo-terminals")
+
+def adc_board() -> tuple[bytes, list[int]]:
+	"""Binary ADC_BATCH frames at 62.5 kHz Timer3 ticks, frame 50 lost on the way."""
+	out = bytearray(b"DEBUG: Starting while(1)\n\x00")
+	out += encode_frame(TYPE_HELLO, 0, 0, (4000000).to_bytes(4, "little") + (64).to_bytes(2, "little") + b"\x01")
+	values = []
+	for seq in range(1, 401):
+		batch = [(seq * 8 + idx) % 1024 for idx in range(8)]
+		if seq != 50:
+			out += encode_frame(TYPE_ADC_BATCH, seq, seq * 500, (3300).to_bytes(2, "little") + np.array(batch, "<u2").tobytes())
+			values += batch
+	return bytes(out), values
+
+def cap_board() -> tuple[bytes, list[int]]:
+	values = [1000 + idx * 3 for idx in range(300)]
+	return b"".join(f"    REPORT_CAP_pF={value}\n\x00".encode() for value in values), values
+
+def ir_board() -> tuple[bytes, list[int]]:
+	codes = [0xE0E040BF, 0xE0E048B7, 0xE0E008F7, 0xE0E0E01F] * 5
+	return b"".join(f"Carrier was detected in >25 samples...\n\x00Received code: 0x{code:08X}\x00 (X)\x00\n\n\x00".encode()
+		for code in codes), codes
+
+def feed(master: int, stream: bytes, chunk: int, pause_s: float) -> None:
+	for offset in range(0, len(stream), chunk):
+		view = memoryview(stream)[offset:offset + chunk]
+		while view:
+			view = view[os.write(master, view):]
+		time.sleep(pause_s)
+
+def test_split_port_spec_and_record_path(tmp_path):
+	assert split_port_spec("/dev/ttyUSB1@115200", 9600) == ("/dev/ttyUSB1", 115200)
+	assert split_port_spec("COM3", 9600) == ("COM3", 9600)
+	assert record_path(tmp_path, "/dev/ttyUSB0").name == "dev_ttyUSB0.p24raw.gz"
+
+def test_three_boards_on_ptys(tmp_path):
+	boards = [adc_board(), cap_board(), ir_board()]
+	ptys = [os.openpty() for _ in boards]
+	names = [os.ttyname(slave) for _, slave in ptys]
+	args = argparse.Namespace(port=[f"{names[0]}@1000000"] + names[1:], all_ports=False, replay=[], synthetic=[],
+		text=False, baud=115200, record_dir=tmp_path / "raw", replay_speed=1.0)
+	args.record_dir.mkdir()
+	save = tmp_path / "bench.parquet"
+	stop = threading.Event()
+	try:
+		sources = open_sources(args, {"logger": "test"})
+		feeders = [threading.Thread(target=feed, args=(master, stream, chunk, 0.002))
+			for (master, _), (stream, _), chunk in zip(ptys, boards, [512, 61, 97])]
+
+		def finish():
+			for feeder in feeders:
+				feeder.join()
+			time.sleep(0.5) # for the last reads to reach the writer
+			stop.set()
+
+		for thread in feeders + [threading.Thread(target=finish)]:
+			thread.start()
+		port_stats = run(sources, save, {"logger": "test"}, stop)
+	finally:
+		for master, slave in ptys:
+			os.close(master)
+			os.close(slave)
+
+	assert [stats["port"] for stats in port_stats] == names
+	assert [stats["detected"] for stats in port_stats] == ["adc (binary)", "cap_pF (text)", "ir_code (text)"]
+	assert [stats["bytes"] for stats in port_stats] == [len(stream) for stream, _ in boards]
+	assert [stats["dropped_frames"] for stats in port_stats] == [1, 0, 0]
+	assert all(stats["bad_frames"] == 0 and stats["error"] is None for stats in port_stats)
+	assert port_stats[0]["timer_hz"] == 4000000 / 64
+
+	df = scan_capture(save).collect()
+	metadata = read_capture_metadata(save)
+	assert metadata["ports"] == names and metadata["rows"] == len(df)
+	# one file, every port's samples in arrival order, sorted on the shared clock
+	assert df.select((SAMPLE_TIME.diff().drop_nulls() >= 0).all()).item()
+	for port, ((_, values), kind) in enumerate(zip(boards, [KIND_ADC, KIND_CAP_PF, KIND_IR_CODE])):
+		port_df = df.filter(pl.col("port") == port)
+		assert set(port_df["kind"]) == {kind}
+		assert port_df.sort("device_ticks", maintain_order=True)["value"].to_list() == values
+	assert (df.filter(pl.col("port") > 0)["seq"] == SEQ_NONE).all()
+
+	# and each port's raw capture parses to the same samples
+	for port, name in enumerate(names):
+		parsed = parse_capture(record_path(args.record_dir, name), None)
+		assert list(parsed.samples.column("value")) == boards[port][1]
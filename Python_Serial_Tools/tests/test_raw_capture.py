@@ -0,0 +1,132 @@
+import gzip
+import time
+
+import numpy as np
+import pytest
+
+from raw_capture import (RawCaptureWriter, RawCaptureReader, encode_varint, decode_varint, import_byte_dump,
+	is_raw_capture, parse_capture, MAGIC, IMPORT_CHUNK_BYTES)
+from serial_ingest import IngestParser
+from serial_sources import SyntheticSerial, RecordingSerial, ReplaySerial, read_available
+
+# Raw captures: the file format, and recording a source then replaying it
+# through the same read loop the loggers use.
+
+def record_synthetic(path, reads: int, baud: int = 115200) -> tuple[list[tuple[bytes, float]], IngestParser]:
+	"""Records `reads` non-empty reads of a SyntheticSerial, parsing them as a logger would."""
+	ser = RecordingSerial(SyntheticSerial("adc", baud=baud), RawCaptureWriter(path, {"port": "synthetic", "baud": baud}))
+	parser = IngestParser()
+	seen = []
+	with ser:
+		while len(seen) < reads:
+			data, host_time = read_available(ser, 0.0)
+			if data:
+				seen.append((data, host_time))
+				parser.feed(data, host_time)
+	return seen, parser
+
+def replay_all(path, speed: float = 0) -> tuple[list[tuple[bytes, float]], IngestParser]:
+	parser = IngestParser()
+	reads = []
+	with ReplaySerial(path, speed) as ser:
+		while (chunk := read_available(ser, 0.0)) is not None:
+			if chunk[0]:
+				reads.append(chunk)
+				parser.feed(*chunk)
+	return reads, parser
+
+@pytest.mark.parametrize("value", [0, 1, 0x7F, 0x80, 0x3FFF, 0x4000, 1 << 32, (1 << 63) - 1])
+def test_varint_round_trip(value):
+	encoded = encode_varint(value)
+	assert decode_varint(b"\x01" + encoded + b"\x05", 1) == (value, 1 + len(encoded))
+	assert decode_varint(encoded[:-1], 0) is None
+
+@pytest.mark.parametrize("name", ["run.p24raw", "run.p24raw.gz"])
+def test_writer_reader_round_trip(tmp_path, name):
+	rng = np.random.default_rng(0)
+	records = []
+	host_time = 0.0
+	for idx in range(3000):
+		host_time += float(rng.exponential(0.01)) if idx % 100 else 3.5 # a long pause now and then
+		size = int(rng.choice([1, 2, 17, 300, 4096, 70000]))
+		records.append((host_time, rng.integers(0, 256, size, dtype=np.uint8).tobytes()))
+	path = tmp_path / name
+	with RawCaptureWriter(path, {"port": "/dev/ttyUSB0", "baud": 115200}) as writer:
+		stored = [writer.write(host_time, data) for host_time, data in records]
+	assert is_raw_capture(path)
+	reader = RawCaptureReader(path)
+	assert reader.metadata["port"] == "/dev/ttyUSB0" and reader.metadata["baud"] == 115200
+	read_back = list(reader)
+	assert [data for _, data in read_back] == [data for _, data in records]
+	# to the microsecond, and what write() said a replay would hand back
+	assert [t for t, _ in read_back] == stored
+	assert max(abs(t - host_time) for (t, _), (host_time, _) in zip(read_back, records)) <= 0.5e-6
+
+def test_cut_short_capture_reads_up_to_the_last_whole_record(tmp_path):
+	path = tmp_path / "cut.p24raw"
+	with RawCaptureWriter(path, {}) as writer:
+		for idx in range(10):
+			writer.write(idx * 0.1, bytes([idx]) * (idx + 1))
+	whole = path.read_bytes()
+	path.write_bytes(whole[:-3]) # the last record (10 bytes) loses its end
+	assert [data for _, data in RawCaptureReader(path)] == [bytes([idx]) * (idx + 1) for idx in range(9)]
+
+def test_not_a_capture(tmp_path):
+	plain = tmp_path / "dump.bin"
+	plain.write_bytes(b"ADC Value: 0512\n\x00" * 10)
+	named_gz = tmp_path / "dump.gz"
+	named_gz.write_bytes(b"not gzip")
+	assert not is_raw_capture(plain) and not is_raw_capture(named_gz)
+	with pytest.raises(ValueError):
+		RawCaptureReader(plain)
+	gz = tmp_path / "ok.gz"
+	gz.write_bytes(gzip.compress(MAGIC + (2).to_bytes(4, "little") + b"{}"))
+	assert is_raw_capture(gz) and list(RawCaptureReader(gz)) == []
+
+def test_record_then_replay_is_the_same_stream(tmp_path):
+	path = tmp_path / "run.p24raw.gz"
+	recorded, live = record_synthetic(path, 50)
+	replayed, offline = replay_all(path)
+	# the same reads at the same times, so the parser sees exactly what it saw live
+	assert replayed == recorded
+	assert offline.samples.to_polars().equals(live.samples.to_polars())
+	assert offline.summary() == live.summary()
+	assert parse_capture(path, None).samples.to_polars().equals(live.samples.to_polars())
+
+def test_replay_paces_at_the_recorded_speed(tmp_path):
+	path = tmp_path / "paced.p24raw"
+	with RawCaptureWriter(path, {}) as writer:
+		for idx in range(11):
+			writer.write(idx * 0.05, b"ADC Value: 0512\n\x00")
+	start = time.monotonic()
+	reads, parser = replay_all(path, speed=1.0)
+	elapsed = time.monotonic() - start
+	assert len(reads) == 11 and len(parser.samples) == 11
+	assert 0.45 <= elapsed < 1.5
+	start = time.monotonic()
+	replay_all(path, speed=5.0)
+	assert time.monotonic() - start < 0.3
+	start = time.monotonic()
+	replay_all(path, speed=0)
+	assert time.monotonic() - start < 0.1
+
+def test_replay_never_merges_reads(tmp_path):
+	path = tmp_path / "small.p24raw"
+	chunks = [b"ADC Val", b"ue: 0512\n\x00", b"ADC Value: 0", b"513\n\x00"]
+	with RawCaptureWriter(path, {}) as writer:
+		for idx, chunk in enumerate(chunks):
+			writer.write(idx * 0.001, chunk)
+	with ReplaySerial(path, 0) as ser:
+		assert [ser.read(4096) for _ in chunks] == chunks
+		assert ser.read(4096) == b"" and ser.eof
+
+def test_import_byte_dump(tmp_path):
+	stream = b"".join(f"    REPORT_CAP_pF={idx}\n\x00".encode() for idx in range(2000))
+	path = tmp_path / "sim.p24raw"
+	import_byte_dump(stream, 115200, path, {"imported_from": "sim_uart.bin"})
+	records = list(RawCaptureReader(path))
+	assert b"".join(data for _, data in records) == stream
+	assert all(len(data) <= IMPORT_CHUNK_BYTES for _, data in records)
+	# timed as if at 115200 baud
+	assert records[-1][0] == pytest.approx(len(stream) * 10 / 115200, abs=1e-6)
+	assert list(parse_capture(path, None).samples.column("value")) == list(range(2000))
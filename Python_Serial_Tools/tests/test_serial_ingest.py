@@ -0,0 +1,181 @@
+import numpy as np
+import pytest
+
+from bench_ingest import bench_ingest, synthetic_stream, UART_BITS_PER_BYTE
+from serial_ingest import (IngestParser, encode_frame, SEQ_NONE, MAX_TEXT_TAIL,
+	TYPE_HELLO, TYPE_TEXT, TYPE_CAP_PF, TYPE_ADC_BATCH, KIND_ADC, KIND_CAP_PF, KIND_IR_CODE)
+from serial_sources import SyntheticSerial, read_available
+
+# IngestParser against streams whose contents are known: whole, in random
+# read-sized chunks, with damaged frames, and for throughput.
+# Run with: python -m pytest Python_Serial_Tools/tests
+
+HELLO = encode_frame(TYPE_HELLO, 0, 0, (4000000).to_bytes(4, "little") + (64).to_bytes(2, "little") + b"\x01")
+
+def feed_chunks(stream: bytes, seed: int | None = None, max_chunk: int = 300) -> IngestParser:
+	"""A parser fed `stream` whole (seed None) or in random 1..max_chunk byte reads."""
+	parser = IngestParser()
+	if seed is None:
+		parser.feed(stream, 0.0)
+		return parser
+	rng = np.random.default_rng(seed)
+	offset = 0
+	while offset < len(stream):
+		size = int(rng.integers(1, max_chunk + 1))
+		parser.feed(stream[offset:offset + size], offset / 1e5)
+		offset += size
+	return parser
+
+def adc_batch(seq: int, ticks: int, values: list[int], vdd_mV: int = 3300) -> bytes:
+	return encode_frame(TYPE_ADC_BATCH, seq, ticks, vdd_mV.to_bytes(2, "little") + np.array(values, dtype="<u2").tobytes())
+
+def text_stream() -> tuple[bytes, list[tuple[int, int, int]]]:
+	"""Every text report the boards send, with (kind, value, vdd_mV) for each."""
+	out = bytearray(b"DEBUG: Starting while(1)\n\x00")
+	expected = []
+	for idx in range(200):
+		out += f"ADC Value: {idx * 5:04d}  VDD_mV: {3300 - idx}  \n\x00".encode()
+		expected.append((KIND_ADC, idx * 5, 3300 - idx))
+		if idx % 4 == 0:
+			out += f"ADC Value: {idx}\n\x00".encode() # before VDD_mV was added
+			expected.append((KIND_ADC, idx, -1))
+		if idx % 5 == 0:
+			out += f"    REPORT_CAP_pF={idx * 7919}\n\x00".encode()
+			expected.append((KIND_CAP_PF, idx * 7919, -1))
+		if idx % 50 == 0:
+			out += b"Carrier was detected in >25 samples...\n\x00Received code: 0xE0E040BF\x00 (POWER_ON_OFF)\x00\n\n\x00"
+			expected.append((KIND_IR_CODE, 0xE0E040BF, -1))
+	return bytes(out), expected
+
+def binary_stream(frames: int = 300) -> tuple[bytes, list[tuple[int, int, int, int, int]]]:
+	"""HELLO, ADC_BATCH, CAP_PF and TEXT frames (seq wrapping past 255) with text
+	reports in between; (kind, value, vdd_mV, seq, ticks) for each sample.
+	"""
+	out = bytearray(b"DEBUG: Starting while(1)\n\x00" + HELLO)
+	expected = []
+	rng = np.random.default_rng(1)
+	for seq in range(1, frames + 1):
+		ticks = seq * 250 + (0x100 if seq % 3 else 0) # some with a 0x00 byte in them
+		if seq % 40 == 0:
+			out += encode_frame(TYPE_TEXT, seq, ticks, b"cal saved")
+			out += b"    REPORT_CAP_pF=1234\n\x00"
+			expected.append((KIND_CAP_PF, 1234, -1, SEQ_NONE, -1))
+		elif seq % 7 == 0:
+			cap_pF = int(rng.integers(0, 1 << 32))
+			out += encode_frame(TYPE_CAP_PF, seq, ticks, cap_pF.to_bytes(4, "little"))
+			expected.append((KIND_CAP_PF, cap_pF, -1, seq & 0xFF, ticks))
+		else:
+			values = [int(v) for v in rng.integers(0, 1024, 8)]
+			values[0] = 0
+			out += adc_batch(seq, ticks, values, 3300 - seq)
+			expected += [(KIND_ADC, value, 3300 - seq, seq & 0xFF, ticks) for value in values]
+	return bytes(out), expected
+
+def samples_of(parser: IngestParser) -> list[tuple]:
+	df = parser.samples.to_polars()
+	return list(zip(df["kind"], df["value"], df["vdd_mV"]))
+
+@pytest.mark.parametrize("seed", [None, 0, 1, 2])
+def test_text_reports(seed):
+	stream, expected = text_stream()
+	parser = feed_chunks(stream, seed)
+	assert samples_of(parser) == expected
+	df = parser.samples.to_polars()
+	assert (df["seq"] == SEQ_NONE).all()
+	assert (df["device_ticks"] == -1).all()
+	assert df["aligned_time"].is_nan().all()
+	assert parser.frame_count == 0 and parser.bad_frame_count == 0
+
+def test_text_without_nul_is_parsed_by_line():
+	# firmware that doesn't send a NUL after each string
+	lines = b"".join(f"ADC Value: {idx % 1024:04d}  VDD_mV: 3300\n".encode() for idx in range(1000))
+	parser = IngestParser()
+	for offset in range(0, len(lines), 1000):
+		parser.feed(lines[offset:offset + 1000], 0.0)
+	assert len(lines) > 2 * MAX_TEXT_TAIL
+	values = parser.samples.column("value")
+	# everything up to the last newline once MAX_TEXT_TAIL has built up
+	assert list(values) == [idx % 1024 for idx in range(len(values))]
+	assert len(values) >= 1000 - MAX_TEXT_TAIL // len(b"ADC Value: 0000  VDD_mV: 3300\n") - 1
+
+@pytest.mark.parametrize("seed", [None, 0, 1, 2])
+def test_binary_frames(seed):
+	stream, expected = binary_stream()
+	parser = feed_chunks(stream, seed)
+	df = parser.samples.to_polars()
+	assert list(zip(df["kind"], df["value"], df["vdd_mV"], df["seq"], df["device_ticks"])) == expected
+	assert parser.timer_hz == 4000000 / 64
+	assert parser.bad_frame_count == 0 and parser.dropped_frames == 0
+	assert list(parser.text_lines) == ["cal saved"] * 7
+	assert df["seq"].dtype.is_unsigned_integer()
+
+def test_seq_gaps_and_wrap():
+	frames = {seq: adc_batch(seq, seq * 250, [seq % 1024] * 8) for seq in range(1, 1000)}
+	lost = {5, 6, 255, 256, 700}
+	stream = HELLO + b"".join(frame for seq, frame in frames.items() if seq not in lost)
+	parser = feed_chunks(stream, 3)
+	assert parser.dropped_frames == len(lost)
+	assert parser.frame_count == 1 + len(frames) - len(lost)
+	assert int(parser.samples.column("seq").max()) <= 0xFF
+
+def test_restart_resets_seq():
+	# a HELLO (the board restarted) is not a gap, whatever seq it starts from
+	stream = HELLO + adc_batch(1, 250, [1] * 8) + adc_batch(2, 500, [2] * 8) + HELLO + adc_batch(1, 250, [3] * 8)
+	parser = feed_chunks(stream)
+	assert parser.dropped_frames == 0
+	assert list(parser.samples.column("value")) == [1] * 8 + [2] * 8 + [3] * 8
+
+@pytest.mark.parametrize("damage", ["flip", "drop", "insert"])
+def test_damaged_frames_are_dropped(damage):
+	rng = np.random.default_rng(4)
+	out = bytearray(HELLO)
+	kept = []
+	damaged = 0
+	for seq in range(1, 402): # ends on an undamaged frame, which shows the last gap
+		values = [int(v) for v in rng.integers(1, 1024, 8)]
+		frame = bytearray(adc_batch(seq, seq * 250, values))
+		if seq % 5 == 0:
+			pos = int(rng.integers(1, len(frame) - 1))
+			if damage == "flip":
+				frame[pos] ^= 1 << int(rng.integers(0, 8))
+			elif damage == "drop":
+				del frame[pos]
+			else:
+				frame.insert(pos, int(rng.integers(1, 256)))
+			damaged += 1
+		else:
+			kept += values
+		out += frame
+	parser = feed_chunks(bytes(out), 5)
+	assert list(parser.samples.column("value")) == kept
+	assert parser.bad_frame_count == damaged
+	assert parser.dropped_frames == damaged
+
+@pytest.mark.parametrize("kind", ["text", "binary"])
+def test_sustains_1_mbaud(kind):
+	stream = synthetic_stream(kind, 400_000)
+	chunks = [stream[offset:offset + 4096] for offset in range(0, len(stream), 4096)]
+	elapsed, parser = bench_ingest(chunks)
+	assert parser.bad_frame_count == 0 and parser.dropped_frames == 0
+	assert len(parser.samples) > 0
+	assert len(stream) * UART_BITS_PER_BYTE / elapsed >= 1_000_000
+
+@pytest.mark.parametrize("kind", ["adc", "cap_pF"])
+@pytest.mark.parametrize("binary", [True, False])
+def test_synthetic_serial_at_1_mbaud(kind, binary):
+	ser = SyntheticSerial(kind, binary=binary, baud=1_000_000)
+	ser.start -= 0.5 # as if it had been running for half a second
+	parser = IngestParser()
+	while parser.byte_count < 40_000:
+		data, host_time = read_available(ser, 0.0)
+		parser.feed(data, host_time)
+	df = parser.samples.to_polars()
+	assert len(df) > 1000
+	assert set(df["kind"]) == {KIND_ADC if kind == "adc" else KIND_CAP_PF}
+	assert df["value"].min() >= 0 and (kind != "adc" or df["value"].max() <= 1023)
+	assert parser.bad_frame_count == 0 and parser.dropped_frames == 0
+	if binary:
+		assert parser.timer_hz == 4000000 / 64
+		assert (df["seq"] <= 0xFF).all()
+	else:
+		assert (df["seq"] == SEQ_NONE).all()
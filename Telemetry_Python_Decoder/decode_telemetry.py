@@ -0,0 +1,254 @@
+import serial
+import serial.tools.list_ports # important
+import easygui
+from loguru import logger
+import argparse
+import csv
+import sys
+import time
+from pathlib import Path
+
+# pip install pyserial loguru easygui
+
+# Decodes the binary telemetry frames from App2_Capacitance_Sensor and
+# ADC_Driver_Project (ENABLE_BINARY_TELEMETRY = 1, see pic24_hal/telemetry.h).
+# Each frame is COBS-encoded and ends in 0x00; inside is
+#   type (1), seq (1), timestamp (LE32), data, CRC-16/CCITT-FALSE (LE16)
+# Text that the firmware sends in between (Disp2String() lines, which also end
+# in a 0x00) is passed through as TEXT. A gap in `seq` counts as dropped frames.
+#
+# Usage:
+#   python decode_telemetry.py                            # pick a serial port, Ctrl+C to stop
+#   python decode_telemetry.py --file capture.bin         # a saved capture (or the host simulator's SIM_UART_OUT)
+#   python decode_telemetry.py --file capture.bin --csv samples.csv
+
+HEADER_LEN = 6 # type, seq, timestamp (LE32)
+CRC_LEN = 2
+
+TYPE_HELLO = 0x01
+TYPE_TEXT = 0x02
+TYPE_CAP_PF = 0x10
+TYPE_ADC_BATCH = 0x11
+TYPE_NAMES = {
+	TYPE_HELLO: "HELLO",
+	TYPE_TEXT: "TEXT",
+	TYPE_CAP_PF: "CAP_PF",
+	TYPE_ADC_BATCH: "ADC_BATCH",
+}
+
+def prompt_for_serial_port():
+	port_list = serial.tools.list_ports.comports()
+	port_list_str: list[str] = [port.device for port in port_list]
+	logger.info(f"Available ports: {port_list_str}")
+
+	if not port_list:
+		logger.error("No serial ports found. Exiting...")
+		sys.exit(1)
+
+	if len(port_list_str) == 1:
+		logger.info(f"Only one port found: {port_list_str[0]}")
+		return port_list_str[0]
+
+	port = easygui.choicebox("Select the serial port", choices=[port.device for port in port_list])
+
+	if not port:
+		logger.error("No port selected. Exiting...")
+		sys.exit(1)
+
+	return port
+
+def crc16_ccitt(data: bytes) -> int:
+	"""CRC-16/CCITT-FALSE, the same as crc16_ccitt() in pic24_hal/crc16.c."""
+	crc = 0xFFFF
+	for byte in data:
+		crc ^= byte << 8
+		for _ in range(8):
+			crc = ((crc << 1) ^ 0x1021) if (crc & 0x8000) else (crc << 1)
+			crc &= 0xFFFF
+	return crc
+
+def cobs_decode(data: bytes) -> bytes | None:
+	"""Undoes COBS (without the trailing 0x00). None if `data` isn't valid COBS."""
+	out = bytearray()
+	idx = 0
+	while idx < len(data):
+		code = data[idx]
+		if code == 0 or idx + code > len(data):
+			return None
+		out += data[idx + 1:idx + code]
+		idx += code
+		if code < 0xFF and idx < len(data):
+			out.append(0)
+	return bytes(out)
+
+def cobs_encode(data: bytes) -> bytes:
+	"""COBS-encodes `data` (without adding the trailing 0x00)."""
+	out = bytearray([0])
+	code_idx = 0
+	for byte in data:
+		if byte == 0:
+			out[code_idx] = len(out) - code_idx
+			code_idx = len(out)
+			out.append(0)
+			continue
+		out.append(byte)
+		if len(out) - code_idx == 0xFF:
+			out[code_idx] = 0xFF
+			code_idx = len(out)
+			out.append(0)
+	out[code_idx] = len(out) - code_idx
+	return bytes(out)
+
+def encode_frame(record_type: int, seq: int, timestamp: int, data: bytes) -> bytes:
+	"""Builds a frame like telemetry_encode() does; handy for feeding the decoder known input."""
+	raw = bytes([record_type, seq & 0xFF]) + (timestamp & 0xFFFFFFFF).to_bytes(4, "little") + data
+	raw += crc16_ccitt(raw).to_bytes(2, "little")
+	return cobs_encode(raw) + b"\x00"
+
+def is_text(chunk: bytes) -> bool:
+	return all((0x20 <= byte < 0x7F) or byte in b"\r\n\t" for byte in chunk)
+
+class TelemetryDecoder:
+	def __init__(self):
+		self.buffer = bytearray()
+		self.timer_hz: float | None = None # Timer3 ticks per second, from HELLO
+		self.last_seq: int | None = None
+		self.frame_count = 0
+		self.bad_frame_count = 0 # failed COBS or CRC, and didn't look like text
+		self.dropped_frames = 0 # seq gaps
+		self.frame_bytes = 0
+		self.sample_count = 0
+
+	def feed(self, data: bytes) -> list[dict]:
+		"""Returns the records completed by `data`."""
+		self.buffer += data
+		records: list[dict] = []
+		while True:
+			end_idx = self.buffer.find(b"\x00")
+			if end_idx < 0:
+				return records
+			chunk = bytes(self.buffer[:end_idx])
+			del self.buffer[:end_idx + 1]
+			if chunk:
+				record = self.decode_chunk(chunk)
+				if record is not None:
+					records.append(record)
+
+	def decode_chunk(self, chunk: bytes) -> dict | None:
+		raw = cobs_decode(chunk)
+		if raw is None or len(raw) < HEADER_LEN + CRC_LEN or crc16_ccitt(raw[:-CRC_LEN]) != int.from_bytes(raw[-CRC_LEN:], "little"):
+			if is_text(chunk):
+				return {"type": "TEXT", "seq": None, "timestamp": None, "time_s": None, "text": chunk.decode("ascii")}
+			self.bad_frame_count += 1
+			return None
+
+		record_type, seq = raw[0], raw[1]
+		timestamp = int.from_bytes(raw[2:6], "little")
+		data = raw[HEADER_LEN:-CRC_LEN]
+		self.frame_count += 1
+		self.frame_bytes += len(chunk) + 1
+
+		if record_type == TYPE_HELLO:
+			self.last_seq = None # the firmware (re)started
+		if self.last_seq is not None:
+			self.dropped_frames += (seq - self.last_seq - 1) & 0xFF
+		self.last_seq = seq
+
+		record = {
+			"type": TYPE_NAMES.get(record_type, f"TYPE_0x{record_type:02X}"),
+			"seq": seq,
+			"timestamp": timestamp,
+			"time_s": None,
+		}
+		if record_type == TYPE_HELLO and len(data) >= 7:
+			fcy_hz = int.from_bytes(data[0:4], "little")
+			prescale = int.from_bytes(data[4:6], "little")
+			self.timer_hz = fcy_hz / prescale
+			record.update(fcy_hz=fcy_hz, prescale=prescale, version=data[6])
+		elif record_type == TYPE_TEXT:
+			record["text"] = data.decode("ascii", errors="replace")
+		elif record_type == TYPE_CAP_PF and len(data) >= 4:
+			record["cap_pF"] = int.from_bytes(data[0:4], "little")
+			self.sample_count += 1
+		elif record_type == TYPE_ADC_BATCH and len(data) >= 2:
+			record["vdd_mV"] = int.from_bytes(data[0:2], "little")
+			record["adc_values"] = [int.from_bytes(data[idx:idx + 2], "little") for idx in range(2, len(data) - 1, 2)]
+			self.sample_count += len(record["adc_values"])
+		else:
+			record["data"] = data.hex()
+
+		if self.timer_hz:
+			record["time_s"] = timestamp / self.timer_hz
+		return record
+
+	def summary(self) -> str:
+		bytes_per_sample = (self.frame_bytes / self.sample_count) if self.sample_count else 0
+		return (
+			f"frames={self.frame_count} bad_frames={self.bad_frame_count} dropped_frames={self.dropped_frames} "
+			f"samples={self.sample_count} bytes_per_sample={bytes_per_sample:.1f}"
+		)
+
+def record_to_rows(record: dict) -> list[dict]:
+	"""One CSV row per sample."""
+	if record["type"] == "CAP_PF":
+		return [{"seq": record["seq"], "timestamp": record["timestamp"], "time_s": record["time_s"], "kind": "cap_pF", "value": record["cap_pF"], "vdd_mV": None}]
+	if record["type"] == "ADC_BATCH":
+		return [
+			{"seq": record["seq"], "timestamp": record["timestamp"], "time_s": record["time_s"], "kind": "adc", "value": value, "vdd_mV": record["vdd_mV"]}
+			for value in record["adc_values"]
+		]
+	return []
+
+def handle_records(records: list[dict], csv_writer: csv.DictWriter | None) -> None:
+	for record in records:
+		if record["type"] == "TEXT":
+			logger.debug(f"Received: {record['text'].strip()}")
+			continue
+		logger.info(f"{record}")
+		if csv_writer:
+			csv_writer.writerows(record_to_rows(record))
+
+def read_serial_data(port: str, decoder: TelemetryDecoder, baud: int, csv_writer: csv.DictWriter | None) -> None:
+	logger.info(f"Starting reading data. Press Ctrl+C to stop...")
+
+	with serial.Serial(port, baud, timeout=1) as ser:
+		last_print_msg_time = time.time()
+		try:
+			while True:
+				handle_records(decoder.feed(ser.read(ser.in_waiting or 1)), csv_writer)
+
+				if time.time() - last_print_msg_time > 5:
+					logger.info(f"So far: {decoder.summary()}")
+					last_print_msg_time = time.time()
+
+		except KeyboardInterrupt:
+			logger.info("Got keyboard interrupt. Exiting...")
+
+def main():
+	parser = argparse.ArgumentParser(description="Decode the firmware's COBS/CRC-16 telemetry frames")
+	parser.add_argument("--file", type=Path, help="decode a capture file instead of a serial port")
+	parser.add_argument("--port", help="serial port (default: prompt)")
+	parser.add_argument("--baud", type=int, default=9600)
+	parser.add_argument("--csv", type=Path, help="also write one row per sample here")
+	args = parser.parse_args()
+
+	decoder = TelemetryDecoder()
+	csv_file = args.csv.open("w", newline="") if args.csv else None
+	csv_writer = None
+	if csv_file:
+		csv_writer = csv.DictWriter(csv_file, fieldnames=["seq", "timestamp", "time_s", "kind", "value", "vdd_mV"])
+		csv_writer.writeheader()
+
+	if args.file:
+		handle_records(decoder.feed(args.file.read_bytes()), csv_writer)
+	else:
+		port = args.port or prompt_for_serial_port()
+		logger.info(f"Selected port: {port}")
+		read_serial_data(port, decoder, args.baud, csv_writer)
+
+	if csv_file:
+		csv_file.close()
+	print(decoder.summary())
+
+if __name__ == "__main__":
+	main()
@@ -0,0 +1,11 @@
+import sys
+import types
+from pathlib import Path
+
+# the tests import decode_telemetry from the directory above; easygui only
+# picks the serial port, so a stand-in will do where it isn't installed
+sys.path.insert(0, str(Path(__file__).parents[1]))
+try:
+	import easygui # noqa: F401
+except ImportError:
+	sys.modules["easygui"] = types.ModuleType("easygui")
@@ -0,0 +1,149 @@
+import random
+from pathlib import Path
+
+import pytest
+
+from decode_telemetry import (TelemetryDecoder, cobs_decode, cobs_encode, crc16_ccitt, encode_frame,
+	TYPE_HELLO, TYPE_TEXT, TYPE_CAP_PF, TYPE_ADC_BATCH)
+
+# Round trips through the framing, and what corruption on the wire does to it.
+# Run with: python -m pytest Telemetry_Python_Decoder/tests
+
+# App2_Capacitance_Sensor with ENABLE_BINARY_TELEMETRY = 1 and 1 uF on AN11,
+# 4 s in the host simulator (PIC24_Host_Sim, SIM_UART_OUT): the firmware's
+# own encoder, for the decoder to agree with
+SIM_CAPTURE = Path(__file__).parent / "app2_sim_capture.bin"
+
+def hello_frame(seq: int = 0) -> bytes:
+	data = (4000000).to_bytes(4, "little") + (64).to_bytes(2, "little") + bytes([1])
+	return encode_frame(TYPE_HELLO, seq, 0, data)
+
+def cap_frames(count: int, first_seq: int = 1) -> list[tuple[int, int, int, bytes]]:
+	"""(seq, timestamp, cap_pF, frame) for `count` CAP_PF frames, some with 0x00 in them."""
+	frames = []
+	for idx in range(count):
+		seq = (first_seq + idx) & 0xFF
+		timestamp = idx * 6586 + (0x100 if idx % 3 else 0)
+		cap_pF = ([0, 1000, 0x01000000, 767022, 0xFFFFFFFF][idx % 5] + idx) & 0xFFFFFFFF
+		frames.append((seq, timestamp, cap_pF, encode_frame(TYPE_CAP_PF, seq, timestamp, cap_pF.to_bytes(4, "little"))))
+	return frames
+
+def cap_records(records: list[dict]) -> list[tuple[int, int, int]]:
+	return [(r["seq"], r["timestamp"], r["cap_pF"]) for r in records if r["type"] == "CAP_PF"]
+
+def test_crc16_check_value():
+	assert crc16_ccitt(b"123456789") == 0x29B1 # CRC-16/CCITT-FALSE
+
+@pytest.mark.parametrize("length", [0, 1, 2, 253, 254, 255, 256, 508, 509, 1000])
+@pytest.mark.parametrize("fill", ["zeros", "ones", "random"])
+def test_cobs_round_trip(length, fill):
+	rng = random.Random(length)
+	data = {
+		"zeros": bytes(length),
+		"ones": b"\xff" * length,
+		"random": bytes(rng.choice([0, 0, 1, 0x7F, 0xFF, rng.randrange(256)]) for _ in range(length)),
+	}[fill]
+	encoded = cobs_encode(data)
+	assert 0 not in encoded
+	assert len(encoded) <= length + 1 + length // 254
+	assert cobs_decode(encoded) == data
+
+def test_cobs_rejects_bad_codes():
+	assert cobs_decode(b"\x05ab") is None # runs past the end
+	assert cobs_decode(b"\x02a\x00b") is None # a 0x00 inside
+
+def test_frames_round_trip_in_any_chunking():
+	frames = cap_frames(300) # seq wraps
+	stream = hello_frame() + b"".join(frame for *_, frame in frames)
+	expected = [(seq, timestamp, cap_pF) for seq, timestamp, cap_pF, _ in frames]
+	rng = random.Random(1)
+	for chunking in ("whole", "bytes", "random"):
+		decoder = TelemetryDecoder()
+		records = []
+		if chunking == "whole":
+			records += decoder.feed(stream)
+		elif chunking == "bytes":
+			for idx in range(len(stream)):
+				records += decoder.feed(stream[idx:idx + 1])
+		else:
+			idx = 0
+			while idx < len(stream):
+				step = rng.randrange(1, 64)
+				records += decoder.feed(stream[idx:idx + step])
+				idx += step
+		assert cap_records(records) == expected, chunking
+		assert (decoder.bad_frame_count, decoder.dropped_frames, decoder.sample_count) == (0, 0, 300)
+		assert records[0]["type"] == "HELLO" and records[1]["time_s"] == pytest.approx(frames[0][1] * 64 / 4e6)
+
+def test_adc_batch_and_text_records():
+	adc_values = [0, 1, 512, 1023, 256, 0, 7, 1000]
+	data = (3300).to_bytes(2, "little") + b"".join(value.to_bytes(2, "little") for value in adc_values)
+	stream = b"DEBUG: plain text line\n\x00" + hello_frame() + encode_frame(TYPE_ADC_BATCH, 1, 500, data)
+	stream += encode_frame(TYPE_TEXT, 2, 600, b"ERROR: in a frame\n")
+	records = TelemetryDecoder().feed(stream)
+	assert [r["type"] for r in records] == ["TEXT", "HELLO", "ADC_BATCH", "TEXT"]
+	assert records[0]["text"] == "DEBUG: plain text line\n"
+	assert (records[2]["vdd_mV"], records[2]["adc_values"]) == (3300, adc_values)
+	assert records[3]["text"] == "ERROR: in a frame\n"
+
+def corrupt(frame: bytes, how: str, rng: random.Random) -> bytes:
+	body = bytearray(frame[:-1]) # keep the delimiter, so the decoder resyncs after it
+	idx = rng.randrange(len(body))
+	if how == "flip":
+		body[idx] ^= 1 << rng.randrange(8)
+	elif how == "drop":
+		del body[idx]
+	elif how == "insert":
+		body.insert(idx, rng.randrange(1, 256))
+	elif how == "truncate":
+		del body[max(idx, 1):] # (all of it would just be a lone 0x00)
+	return bytes(body) + b"\x00"
+
+@pytest.mark.parametrize("how", ["flip", "drop", "insert", "truncate"])
+def test_corruption_is_detected_and_resynced(how):
+	"""One damaged frame in every few: each is rejected (never decoded as a
+	wrong sample), the decoder picks up again at the next 0x00, and the seq gap
+	counts it as dropped."""
+	rng = random.Random(how)
+	frames = cap_frames(2000)
+	stream = bytearray(hello_frame())
+	for idx, (seq, _, _, frame) in enumerate(frames):
+		if idx % 5 == 2 and idx < len(frames) - 1:
+			stream += corrupt(frame, how, rng)
+		else:
+			stream += frame
+
+	decoder = TelemetryDecoder()
+	records = decoder.feed(bytes(stream))
+	# seq wraps every 256 frames, so compare in order with the damaged ones left out
+	expected = [(seq, timestamp, cap_pF) for idx, (seq, timestamp, cap_pF, _) in enumerate(frames)
+		if not (idx % 5 == 2 and idx < len(frames) - 1)]
+	assert cap_records(records) == expected
+	assert decoder.dropped_frames == len(frames) - len(expected)
+	# a flipped bit can turn a byte into 0x00 and split the frame in two, so there may be more pieces than frames
+	assert decoder.bad_frame_count + sum(r["type"] == "TEXT" for r in records) >= len(frames) - len(expected)
+
+def test_garbage_between_frames():
+	rng = random.Random(7)
+	frames = cap_frames(100)
+	stream = bytearray(hello_frame())
+	for *_, frame in frames:
+		stream += bytes(rng.randrange(1, 256) for _ in range(rng.randrange(0, 20))) + b"\x00" + frame
+	records = TelemetryDecoder().feed(bytes(stream))
+	assert cap_records(records) == [(seq, timestamp, cap_pF) for seq, timestamp, cap_pF, _ in frames]
+
+def test_firmware_capture_from_the_simulator():
+	decoder = TelemetryDecoder()
+	records = decoder.feed(SIM_CAPTURE.read_bytes())
+	types = [r["type"] for r in records]
+	assert types[:4] == ["TEXT", "TEXT", "TEXT", "HELLO"]
+	assert records[3]["fcy_hz"] == 4000000 and records[3]["prescale"] == 64
+	caps = [r for r in records if r["type"] == "CAP_PF"]
+	assert len(caps) >= 20
+	assert [r["seq"] for r in caps] == list(range(1, len(caps) + 1))
+	# the uncalibrated model reads 1 uF ~23% low (see PIC24_Host_Sim), steadily
+	assert all(700000 < r["cap_pF"] < 800000 for r in caps)
+	assert all(b["time_s"] > a["time_s"] for a, b in zip(caps, caps[1:]))
+	assert (decoder.bad_frame_count, decoder.dropped_frames) == (0, 0)
+	# 4 bytes of data in 14-15 on the wire, against "    REPORT_CAP_pF=767022\n" + NUL as text
+	assert decoder.frame_bytes / decoder.sample_count < len("    REPORT_CAP_pF=767022\n\x00") / 1.5
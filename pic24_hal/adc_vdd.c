@@ -0,0 +1,90 @@
+/*
+ * File:   adc_vdd.c
+ */
+
+
+#include "xc.h"
+#include "adc_vdd.h"
+
+// AD1CHS CH0SA mux selection for the internal band gap reference (VBG)
+#define ADC_CHANNEL_VBG (0b1111)
+
+// VBG is 1.2 V typical (1.14 V to 1.26 V) on the PIC24F16KA102. This is the
+// nominal value, not calibrated per part: vdd_mV, and every mV figure scaled
+// by it, carries that +/-5%
+#define ADC_VBG_MV (1200UL)
+
+// readings outside this window are treated as glitches, and the cache is kept
+#define VDD_MIN_VALID_MV (1800UL)
+#define VDD_MAX_VALID_MV (3600UL)
+
+// last measured supply voltage; starts at the nominal value until measured
+uint16_t vdd_mV = ADC_NOMINAL_VDD_MV;
+
+// zero-scale error, removed in adc_val_to_mV(); see calibrate_adc_offset()
+int16_t adc_offset = 0;
+
+uint16_t read_adc_value(void) {
+    // Returns a 10-bit unsigned number
+    
+    // Enable ADC module
+    AD1CON1bits.ADON = 1;
+    
+    AD1CON1bits.SAMP = 1; // Start sampling
+    while (!AD1CON1bits.DONE); // Wait for conversion to complete
+    
+    const uint16_t adc_value = ADC1BUF0;
+    
+    AD1CON1bits.SAMP = 0; // End sampling
+    AD1CON1bits.ADON = 0; // Turn off ADC - saves power
+    
+    return adc_value;
+}
+
+float adc_val_to_volts(uint16_t val_10_bits) {
+    return ((float) val_10_bits) * ((float) vdd_mV) / 1000.0 / 1024.0;
+}
+
+uint16_t adc_val_to_mV(uint16_t val_10_bits) {
+    // adc_val_to_volts() * 1000, without the floats
+    // first, cast to a wider type to avoid overflow, because I don't trust C
+    int32_t val_corrected = ((int32_t) val_10_bits) - adc_offset;
+    if (val_corrected < 0) {
+        val_corrected = 0;
+    }
+    const uint32_t val_wider = (uint32_t) val_corrected;
+    return (uint16_t) ((val_wider * vdd_mV) >> 10);
+}
+
+uint16_t update_vdd_mV(void) {
+    // The ADC full-scale is VDD, so a known input (VBG) measures VDD:
+    //   vbg_adc_val = VBG / VDD * 1024  =>  VDD = VBG * 1024 / vbg_adc_val
+    const uint8_t orig_channel = AD1CHSbits.CH0SA;
+    
+    AD1CHSbits.CH0SA = ADC_CHANNEL_VBG;
+    const uint16_t vbg_adc_val = read_adc_value(); // SAMC=31 T_ad gives VBG time to settle
+    AD1CHSbits.CH0SA = orig_channel;
+    
+    if (vbg_adc_val == 0) {
+        return vdd_mV; // can't divide, keep the last good value
+    }
+    
+    const uint32_t new_vdd_mV = (ADC_VBG_MV << 10) / vbg_adc_val;
+    if ((new_vdd_mV >= VDD_MIN_VALID_MV) && (new_vdd_mV <= VDD_MAX_VALID_MV)) {
+        vdd_mV = (uint16_t) new_vdd_mV;
+    }
+    return vdd_mV;
+}
+
+void vdd_monitor_poll(void) {
+    // VDD sags slowly (battery), so only pay for the extra conversion periodically
+    static uint8_t poll_count = 0;
+    
+    if (poll_count == 0) {
+        update_vdd_mV();
+    }
+    poll_count++;
+    if (poll_count >= VDD_MONITOR_INTERVAL) {
+        poll_count = 0;
+    }
+}
@@ -26,26 +26,31 @@
  * Revision history: 
  */
 
-// This is a guard condition so that contents of this file are not included
 // more than once.  
-#ifndef __INCLUDE_GUARD_CLOCK_H__
-#define	__INCLUDE_GUARD_CLOCK_H__
+#ifndef __INCLUDE_GUARD__ADC_VDD_H__
+#define	__INCLUDE_GUARD__ADC_VDD_H__
 
 #include <xc.h> // include processor files - each processor file is guarded.  
 #include <stdint.h>
 
+// Conversions and the supply they're ratiometric to, shared by the projects
+// that use the ADC; each project's adc.c has init_adc() (its pin and timing).
+// read_adc_value() converts the channel AD1CHS selects (SSRC = 0b111).
+uint16_t read_adc_value(void);
 
-#ifdef	__cplusplus
-extern "C" {
-#endif /* __cplusplus */
+// 10-bit codes: one LSB is VDD / 1024, in both
+float adc_val_to_volts(uint16_t val_10_bits);
+uint16_t adc_val_to_mV(uint16_t val_10_bits);
 
-    // TODO If C++ is being used, regular C code needs function names to have C 
-    // linkage so the functions can be used by the c code. 
+// VDD monitor: conversions are ratiometric to VDD, so VDD is measured against
+// the internal band gap and cached here
+#define ADC_NOMINAL_VDD_MV (3300)
+#define VDD_MONITOR_INTERVAL (16) // re-measure VDD every Nth vdd_monitor_poll()
 
-#ifdef	__cplusplus
-}
-#endif /* __cplusplus */
+extern uint16_t vdd_mV;
+extern int16_t adc_offset; // counts read with the input grounded; 0 until calibrated
 
-void set_clock_freq(uint16_t clk_freq_khz);
+uint16_t update_vdd_mV(void);
+void vdd_monitor_poll(void);
 
-#endif	/* __INCLUDE_GUARD_CLOCK_H__ */
+#endif	/* __INCLUDE_GUARD__ADC_VDD_H__ */
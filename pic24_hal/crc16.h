@@ -28,18 +28,16 @@
 
 // This is a guard condition so that contents of this file are not included
 // more than once.  
-#ifndef __INCLUDE_GUARD_TIMER_H__
-#define	__INCLUDE_GUARD_TIMER_H__
+#ifndef __INCLUDE_GUARD__CRC16_H__
+#define	__INCLUDE_GUARD__CRC16_H__
 
 #include <xc.h> // include processor files - each processor file is guarded.  
+#include <stdint.h>
 
-extern uint16_t active_clk_freq_khz;
-extern uint16_t active_clk_freq_MHz;
+// CRC-16/CCITT-FALSE: poly 0x1021, start with crc = CRC16_CCITT_INIT, no final XOR.
+// Chain calls by passing the previous result back in as `crc`.
+#define CRC16_CCITT_INIT (0xFFFF)
 
-void delay_us(uint16_t delay_time_us);
-//void delay_ms(uint16_t delay_time_ms); // disable
-void delay_sec(uint16_t delay_time_sec);
-
-
-#endif	/* __INCLUDE_GUARD_TIMER_H__ */
+uint16_t crc16_ccitt(uint16_t crc, const uint8_t* data, uint16_t len);
 
+#endif	/* __INCLUDE_GUARD__CRC16_H__ */
@@ -0,0 +1,67 @@
+/*
+ * File:   profile.c
+ */
+
+
+#include "xc.h"
+#include "profile.h"
+#include "timebase.h"
+#include "uart.h"
+
+profile_record_t profile_ring[PROFILE_RING_LEN];
+volatile uint8_t profile_head = 0; // next to write
+volatile uint8_t profile_tail = 0; // next to read
+volatile uint16_t profile_dropped = 0;
+
+uint32_t profile_last_dump_ticks = 0;
+
+void profile_init(void) {
+    if (!T2CONbits.TON || !T2CONbits.T32) {
+        timebase_start();
+    }
+    profile_last_dump_ticks = timebase_now();
+}
+
+uint8_t profile_send_byte(uint8_t byte, uint8_t checksum) {
+    XmitUART2((char) byte, 1);
+    return checksum + byte;
+}
+
+void profile_dump(void) {
+    // only this frame's records: probes from ISRs keep landing while it is sent
+    const uint8_t head = profile_head;
+    const uint8_t count = ((uint8_t) (head - profile_tail)) % PROFILE_RING_LEN;
+    const uint16_t dropped = profile_dropped;
+    profile_dropped = 0;
+    
+    uint8_t checksum = 0;
+    XmitUART2((char) PROFILE_FRAME_SYNC_0, 1);
+    XmitUART2((char) PROFILE_FRAME_SYNC_1, 1);
+    checksum = profile_send_byte(count, checksum);
+    checksum = profile_send_byte(dropped & 0xFF, checksum);
+    checksum = profile_send_byte(dropped >> 8, checksum);
+    
+    while (profile_tail != head) {
+        const profile_record_t* record = &profile_ring[profile_tail];
+        checksum = profile_send_byte(record->tag, checksum);
+        checksum = profile_send_byte(record->lsw & 0xFF, checksum);
+        checksum = profile_send_byte(record->lsw >> 8, checksum);
+        checksum = profile_send_byte(record->msw & 0xFF, checksum);
+        checksum = profile_send_byte(record->msw >> 8, checksum);
+        profile_tail = (profile_tail + 1) % PROFILE_RING_LEN;
+    }
+    XmitUART2((char) checksum, 1);
+    
+    profile_last_dump_ticks = timebase_now();
+}
+
+void profile_poll(void) {
+    const uint8_t count = ((uint8_t) (profile_head - profile_tail)) % PROFILE_RING_LEN;
+    if (count == 0) {
+        return;
+    }
+    if ((count >= PROFILE_DUMP_THRESHOLD)
+            || ((timebase_now() - profile_last_dump_ticks) >= PROFILE_DUMP_PERIOD_TICKS)) {
+        profile_dump();
+    }
+}
@@ -0,0 +1,130 @@
+/* Microchip Technology Inc. and its subsidiaries.  You may use this software 
+ * and any derivatives exclusively with Microchip products. 
+ * 
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS".  NO WARRANTIES, WHETHER 
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED 
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A 
+ * PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION 
+ * WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION. 
+ *
+ * IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, 
+ * INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND 
+ * WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS 
+ * BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE 
+ * FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS 
+ * IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF 
+ * ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE 
+ * TERMS. 
+ */
+
+/* 
+ * File:   
+ * Author: 
+ * Comments:
+ * Revision history: 
+ */
+
+// This is a guard condition so that contents of this file are not included
+// more than once.  
+#ifndef __INCLUDE_GUARD__PROFILE_H__
+#define	__INCLUDE_GUARD__PROFILE_H__
+
+#include <xc.h>
+#include <stdint.h>
+
+// Section profiler: PROFILE_START/PROFILE_STOP record a tag and a timebase
+// timestamp (Timer2/3, 250 ns at 4 MHz) into a RAM ring, and profile_poll()
+// sends the ring as a binary frame over UART2 now and then.
+// Profile_Python_Decoder/decode_profile.py pairs the records up and prints
+// min/mean/max/p99 per section.
+//
+// A probe is a dozen or so instructions: DISI, the ring index check, two
+// timer reads, three stores. With PROFILE_ENABLED at 0 every probe compiles
+// to nothing.
+//
+// A project using it adds profile.c and timebase.c, and keeps its own
+// profile_sections.h (see Project_5_CVREF's): PROFILE_ENABLED and the
+// optional PROFILE_SCOPE_PIN_ENABLED, then this header, then its
+// profile_section_t enum. The decoder reads the section names from there,
+// so keep the PROFILE_SECTION_ prefix, the implicit numbering, and
+// PROFILE_SECTION_COUNT last (at most 128 sections).
+
+#ifndef PROFILE_ENABLED
+#define PROFILE_ENABLED (0)
+#endif
+
+// 1 = also drive RB8 (the debug LED) high for the duration of each section,
+// for the scope; sections must not nest when this is on
+#ifndef PROFILE_SCOPE_PIN_ENABLED
+#define PROFILE_SCOPE_PIN_ENABLED (0)
+#endif
+
+// power of 2, so the wrap compiles to a mask; 6 bytes each (the tag is padded)
+#define PROFILE_RING_LEN (32)
+
+// profile_poll() sends once the ring is this full, or the period is up
+#define PROFILE_DUMP_THRESHOLD (PROFILE_RING_LEN / 2)
+#define PROFILE_DUMP_PERIOD_TICKS (4000000UL) // 1 s at 4 MHz
+
+// the frame: sync, count, dropped (LE16), count * record, checksum of
+// everything after the sync
+#define PROFILE_FRAME_SYNC_0 (0xA5)
+#define PROFILE_FRAME_SYNC_1 (0x5A)
+
+typedef struct {
+    uint8_t tag; // section << 1, bit 0 = 1 for a stop
+    uint16_t lsw; // timebase, low then high word
+    uint16_t msw;
+} profile_record_t;
+
+extern profile_record_t profile_ring[PROFILE_RING_LEN];
+extern volatile uint8_t profile_head;
+extern volatile uint8_t profile_tail;
+extern volatile uint16_t profile_dropped;
+
+#if PROFILE_SCOPE_PIN_ENABLED
+#define PROFILE_SCOPE_PIN(level) (LATBbits.LATB8 = (level))
+#else
+#define PROFILE_SCOPE_PIN(level)
+#endif
+
+// DISI keeps an ISR's probe from landing between the index read and update;
+// clearing DISICNT ends it. Reading TMR2 latches TMR3 into TMR3HLD, so the
+// two words always match.
+#define PROFILE_RECORD(record_tag) do { \
+    __builtin_disi(0x3FFF); \
+    const uint8_t profile_idx = profile_head; \
+    const uint8_t profile_next = (profile_idx + 1) % PROFILE_RING_LEN; \
+    if (profile_next != profile_tail) { \
+        profile_ring[profile_idx].lsw = TMR2; \
+        profile_ring[profile_idx].msw = TMR3HLD; \
+        profile_ring[profile_idx].tag = (record_tag); \
+        profile_head = profile_next; \
+    } \
+    else { \
+        profile_dropped++; \
+    } \
+    DISICNT = 0; \
+} while (0)
+
+#if PROFILE_ENABLED
+#define PROFILE_START(section) do { PROFILE_SCOPE_PIN(1); PROFILE_RECORD((uint8_t) ((section) << 1)); } while (0)
+#define PROFILE_STOP(section) do { PROFILE_RECORD((uint8_t) (((section) << 1) | 1)); PROFILE_SCOPE_PIN(0); } while (0)
+#else
+#define PROFILE_START(section)
+#define PROFILE_STOP(section)
+#endif
+
+// starts the Timer2/3 timebase if it is not already running
+void profile_init(void);
+
+// sends a frame if the ring is filling up or the period is up; call it from
+// the main loop, outside any section
+void profile_poll(void);
+
+// sends whatever is in the ring now
+void profile_dump(void);
+
+#endif	/* __INCLUDE_GUARD__PROFILE_H__ */
@@ -0,0 +1,39 @@
+/*
+ * File:   stack_paint.c
+ */
+
+
+#include "xc.h"
+#include "stack_paint.h"
+
+uint16_t stack_paint_start = 0; // first painted address
+uint16_t stack_paint_end = 0; // SPLIM: one past the last painted word
+
+void stack_paint(void) {
+    const uint16_t sp = WREG15;
+    stack_paint_start = (sp + STACK_PAINT_MARGIN_BYTES) & ~1U;
+    stack_paint_end = SPLIM;
+    
+    for (uint16_t addr = stack_paint_start; addr < stack_paint_end; addr += 2) {
+        *((volatile uint16_t*) (uintptr_t) addr) = STACK_PAINT_PATTERN;
+    }
+}
+
+// first address above the highest overwritten word; scanned down from the
+// top, so a stale copy of the pattern lower down can't hide the real mark
+uint16_t stack_paint_high_water_addr(void) {
+    uint16_t addr = stack_paint_end;
+    while ((addr > stack_paint_start)
+            && (*((volatile uint16_t*) (uintptr_t) (addr - 2)) == STACK_PAINT_PATTERN)) {
+        addr -= 2;
+    }
+    return addr;
+}
+
+uint16_t stack_high_water_bytes(void) {
+    return stack_paint_high_water_addr() - stack_paint_start;
+}
+
+uint16_t stack_headroom_bytes(void) {
+    return stack_paint_end - stack_paint_high_water_addr();
+}
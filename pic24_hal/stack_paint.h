@@ -19,33 +19,30 @@
  * TERMS. 
  */
 
-/* 
- * File:   
- * Author: 
- * Comments:
- * Revision history: 
- */
 
 // This is a guard condition so that contents of this file are not included
 // more than once.  
-#ifndef __INCLUDE_GUARD_CLOCK_H__
-#define	__INCLUDE_GUARD_CLOCK_H__
+#ifndef __INCLUDE_GUARD__STACK_PAINT_H__
+#define	__INCLUDE_GUARD__STACK_PAINT_H__
 
-#include <xc.h> // include processor files - each processor file is guarded.  
+#include <xc.h>
 #include <stdint.h>
 
+// Stack high-water mark. The PIC24 stack grows up from the end of static
+// data to SPLIM; stack_paint() fills the unused part with a pattern, and the
+// queries find the highest word that has been overwritten since.
+// The build-time estimate is PIC24_Host_Sim/stack_check.py.
 
-#ifdef	__cplusplus
-extern "C" {
-#endif /* __cplusplus */
+#define STACK_PAINT_PATTERN (0xA55A)
+#define STACK_PAINT_MARGIN_BYTES (16) // above W15 at the call, left alone
 
-    // TODO If C++ is being used, regular C code needs function names to have C 
-    // linkage so the functions can be used by the c code. 
+// Call first thing in main(), before any interrupt is enabled
+void stack_paint(void);
 
-#ifdef	__cplusplus
-}
-#endif /* __cplusplus */
+// bytes of stack ever used above where stack_paint() was called from
+uint16_t stack_high_water_bytes(void);
 
-void set_clock_freq(uint16_t clk_freq_khz);
+// bytes below SPLIM that have never been touched
+uint16_t stack_headroom_bytes(void);
 
-#endif	/* __INCLUDE_GUARD_CLOCK_H__ */
+#endif	/* __INCLUDE_GUARD__STACK_PAINT_H__ */
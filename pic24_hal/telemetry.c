@@ -0,0 +1,159 @@
+/*
+ * File:   telemetry.c
+ */
+
+
+#include "xc.h"
+#include "telemetry.h"
+#include "crc16.h"
+#include "uart.h"
+
+#include <string.h>
+
+extern uint16_t active_clk_freq_khz; // clock.c
+
+volatile uint16_t telemetry_time_msw = 0; // Timer3 overflows, i.e. the upper 16 bits of the timestamp
+uint8_t telemetry_seq = 0; // one counter for all record types, so the host sees every lost frame
+
+void telemetry_init(void) {
+    telemetry_time_msw = 0;
+    telemetry_seq = 0;
+
+    // Timer3 free-running for the timestamps
+    T3CON = 0;
+    TMR3 = 0;
+    PR3 = 0xFFFF;
+    T3CONbits.TCKPS = TELEMETRY_TIMER3_TCKPS;
+    IFS0bits.T3IF = 0;
+    IPC2bits.T3IP = TELEMETRY_TIMER3_PRIORITY;
+    IEC0bits.T3IE = 1;
+    T3CONbits.TON = 1;
+
+    // a lone 0x00 ends whatever text came before, then tell the host the tick rate
+    XmitUART2(0, 1);
+    const uint32_t fcy_hz = (uint32_t) active_clk_freq_khz * 500;
+    const uint8_t hello[7] = {
+        fcy_hz & 0xFF, (fcy_hz >> 8) & 0xFF, (fcy_hz >> 16) & 0xFF, fcy_hz >> 24,
+        TELEMETRY_TIMER3_PRESCALE & 0xFF, TELEMETRY_TIMER3_PRESCALE >> 8,
+        TELEMETRY_PROTOCOL_VERSION,
+    };
+    telemetry_send(TELEMETRY_TYPE_HELLO, telemetry_timestamp(), hello, sizeof(hello));
+}
+
+void __attribute__ ((interrupt, no_auto_psv)) _T3Interrupt(void) {
+    IFS0bits.T3IF = 0;
+    telemetry_time_msw++;
+}
+
+uint32_t telemetry_timestamp(void) {
+    uint16_t msw;
+    uint16_t lsw;
+    do {
+        msw = telemetry_time_msw;
+        lsw = TMR3;
+    } while (msw != telemetry_time_msw);
+
+    if (IFS0bits.T3IF && (lsw < 0x8000)) {
+        msw++; // just wrapped, but _T3Interrupt() can't run yet (called with interrupts masked)
+    }
+    return ((uint32_t) msw << 16) | lsw;
+}
+
+// COBS: each 0x00 is replaced by the distance to the next one, and the first
+// byte points at the first. Frames are far shorter than 254 bytes, so there's
+// never a full 0xFF block to split.
+static uint8_t telemetry_cobs_encode(const uint8_t* raw, uint8_t len, uint8_t* out) {
+    uint8_t code_idx = 0;
+    uint8_t code = 1;
+    uint8_t out_len = 1;
+    for (uint8_t i = 0; i < len; i++) {
+        if (raw[i] == 0) {
+            out[code_idx] = code;
+            code_idx = out_len++;
+            code = 1;
+        }
+        else {
+            out[out_len++] = raw[i];
+            code++;
+        }
+    }
+    out[code_idx] = code;
+    return out_len;
+}
+
+// Builds a complete frame (ending in 0x00) in `frame`, which must hold
+// TELEMETRY_MAX_FRAME_LEN bytes. Returns its length.
+uint8_t telemetry_encode(uint8_t type, uint32_t timestamp, const uint8_t* data, uint8_t data_len, uint8_t* frame) {
+    if (data_len > TELEMETRY_MAX_DATA_LEN) {
+        data_len = TELEMETRY_MAX_DATA_LEN;
+    }
+
+    uint8_t raw[TELEMETRY_HEADER_LEN + TELEMETRY_MAX_DATA_LEN + TELEMETRY_CRC_LEN];
+    raw[0] = type;
+    raw[1] = telemetry_seq++;
+    raw[2] = timestamp & 0xFF;
+    raw[3] = (timestamp >> 8) & 0xFF;
+    raw[4] = (timestamp >> 16) & 0xFF;
+    raw[5] = timestamp >> 24;
+    memcpy(raw + TELEMETRY_HEADER_LEN, data, data_len);
+
+    uint8_t raw_len = TELEMETRY_HEADER_LEN + data_len;
+    const uint16_t crc = crc16_ccitt(CRC16_CCITT_INIT, raw, raw_len);
+    raw[raw_len++] = crc & 0xFF;
+    raw[raw_len++] = crc >> 8;
+
+    uint8_t frame_len = telemetry_cobs_encode(raw, raw_len, frame);
+    frame[frame_len++] = 0;
+    return frame_len;
+}
+
+static void telemetry_xmit(const uint8_t* frame, uint8_t frame_len) {
+    for (uint8_t i = 0; i < frame_len; i++) {
+        XmitUART2(frame[i], 1);
+    }
+}
+
+// Blocking send, like Disp2String()
+void telemetry_send(uint8_t type, uint32_t timestamp, const uint8_t* data, uint8_t data_len) {
+    uint8_t frame[TELEMETRY_MAX_FRAME_LEN];
+    telemetry_xmit(frame, telemetry_encode(type, timestamp, data, data_len, frame));
+}
+
+// Debug lines in binary mode, split over as many frames as it takes
+void telemetry_send_text(const char* str) {
+    const uint32_t timestamp = telemetry_timestamp();
+    uint16_t len = strlen(str);
+    while (len > 0) {
+        const uint8_t chunk_len = (len > TELEMETRY_MAX_DATA_LEN) ? TELEMETRY_MAX_DATA_LEN : len;
+        telemetry_send(TELEMETRY_TYPE_TEXT, timestamp, (const uint8_t*) str, chunk_len);
+        str += chunk_len;
+        len -= chunk_len;
+    }
+}
+
+// The CAP_PF frame, for telemetry_send_cap_pF() and for senders that queue
+// it instead (stream.c), like telemetry_encode()
+uint8_t telemetry_encode_cap_pF(uint32_t c_pF, uint8_t* frame) {
+    const uint8_t data[4] = {c_pF & 0xFF, (c_pF >> 8) & 0xFF, (c_pF >> 16) & 0xFF, c_pF >> 24};
+    return telemetry_encode(TELEMETRY_TYPE_CAP_PF, telemetry_timestamp(), data, sizeof(data), frame);
+}
+
+void telemetry_send_cap_pF(uint32_t c_pF) {
+    uint8_t frame[TELEMETRY_MAX_FRAME_LEN];
+    telemetry_xmit(frame, telemetry_encode_cap_pF(c_pF, frame));
+}
+
+// `timestamp` is when adc_vals[0] was taken
+void telemetry_send_adc_batch(uint32_t timestamp, uint16_t vdd_mV, const uint16_t* adc_vals, uint8_t count) {
+    if (count > TELEMETRY_ADC_BATCH_LEN) {
+        count = TELEMETRY_ADC_BATCH_LEN;
+    }
+    uint8_t data[2 + 2 * TELEMETRY_ADC_BATCH_LEN];
+    data[0] = vdd_mV & 0xFF;
+    data[1] = vdd_mV >> 8;
+    for (uint8_t i = 0; i < count; i++) {
+        data[2 + 2 * i] = adc_vals[i] & 0xFF;
+        data[3 + 2 * i] = adc_vals[i] >> 8;
+    }
+    telemetry_send(TELEMETRY_TYPE_ADC_BATCH, timestamp, data, 2 + 2 * count);
+}
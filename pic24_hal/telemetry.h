@@ -0,0 +1,76 @@
+/* Microchip Technology Inc. and its subsidiaries.  You may use this software 
+ * and any derivatives exclusively with Microchip products. 
+ * 
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS".  NO WARRANTIES, WHETHER 
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED 
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A 
+ * PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION 
+ * WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION. 
+ *
+ * IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, 
+ * INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND 
+ * WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS 
+ * BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE 
+ * FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS 
+ * IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF 
+ * ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE 
+ * TERMS. 
+ */
+
+/* 
+ * File:   
+ * Author: 
+ * Comments:
+ * Revision history: 
+ */
+
+// This is a guard condition so that contents of this file are not included
+// more than once.  
+#ifndef __INCLUDE_GUARD__TELEMETRY_H__
+#define	__INCLUDE_GUARD__TELEMETRY_H__
+
+#include <xc.h> // include processor files - each processor file is guarded.  
+#include <stdint.h>
+
+// Binary telemetry frames, as an alternative to the text reports.
+// Before encoding, a frame is:
+//   type (1), seq (1), timestamp (LE32, Timer3 ticks), data (0..TELEMETRY_MAX_DATA_LEN), CRC-16 (LE16)
+// The CRC is CRC-16/CCITT-FALSE over everything before it. The whole thing is
+// COBS-encoded, so it has no 0x00 bytes, and a 0x00 ends it. The host can
+// resync on any 0x00 (including the NUL that Disp2String() sends after each
+// text line), and a gap in `seq` means frames were lost.
+#define TELEMETRY_PROTOCOL_VERSION (1)
+#define TELEMETRY_HEADER_LEN (6)
+#define TELEMETRY_CRC_LEN (2)
+#define TELEMETRY_MAX_DATA_LEN (24)
+#define TELEMETRY_MAX_FRAME_LEN (TELEMETRY_HEADER_LEN + TELEMETRY_MAX_DATA_LEN + TELEMETRY_CRC_LEN + 2) // + COBS code byte, + 0x00
+
+// Timestamp: Timer3 free-running at Fcy/64 (16 us at 8 MHz), extended to 32 bits by _T3Interrupt()
+#define TELEMETRY_TIMER3_PRESCALE (64)
+#define TELEMETRY_TIMER3_TCKPS (0b10) // 1:64
+#define TELEMETRY_TIMER3_PRIORITY (1)
+
+#define TELEMETRY_ADC_BATCH_LEN (8) // samples per ADC_BATCH frame: 28 bytes on the wire vs ~33 per text line
+
+// Record types (App2_Capacitance_Sensor sends CAP_PF, ADC_Driver_Project ADC_BATCH)
+typedef enum {
+    TELEMETRY_TYPE_HELLO = 0x01, // Fcy Hz (LE32), Timer3 prescale (LE16), protocol version (1)
+    TELEMETRY_TYPE_TEXT = 0x02, // ASCII, no terminator
+    TELEMETRY_TYPE_CAP_PF = 0x10, // capacitance in pF (LE32)
+    TELEMETRY_TYPE_ADC_BATCH = 0x11, // VDD mV (LE16), then ADC counts (LE16 each); timestamp is the first sample
+} telemetry_type_t;
+
+void telemetry_init(void);
+uint32_t telemetry_timestamp(void);
+uint8_t telemetry_encode(uint8_t type, uint32_t timestamp, const uint8_t* data, uint8_t data_len, uint8_t* frame);
+void telemetry_send(uint8_t type, uint32_t timestamp, const uint8_t* data, uint8_t data_len);
+void telemetry_send_text(const char* str);
+uint8_t telemetry_encode_cap_pF(uint32_t c_pF, uint8_t* frame);
+void telemetry_send_cap_pF(uint32_t c_pF);
+void telemetry_send_adc_batch(uint32_t timestamp, uint16_t vdd_mV, const uint16_t* adc_vals, uint8_t count);
+
+void __attribute__ ((interrupt, no_auto_psv)) _T3Interrupt(void);
+
+#endif	/* __INCLUDE_GUARD__TELEMETRY_H__ */
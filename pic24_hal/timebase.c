@@ -0,0 +1,33 @@
+/*
+ * File:   timebase.c
+ */
+
+
+#include "xc.h"
+#include "timebase.h"
+
+void timebase_start(void) {
+    T2CON = 0;
+    T3CON = 0;
+    T2CONbits.T32 = 1; // Timer2 (LSW) + Timer3 (MSW) as one 32-bit timer
+    T2CONbits.TCKPS = 0b00; // 1:1 from Fcy
+    TMR3 = 0;
+    TMR2 = 0;
+    PR3 = 0xFFFF; // count all the way round
+    PR2 = 0xFFFF;
+    IEC0bits.T3IE = 0; // no interrupt needed, it just runs
+    T2CONbits.TON = 1;
+}
+
+// Reading TMR2 latches TMR3 into TMR3HLD, so the two halves match unless an
+// ISR reads TMR2 in between and latches a later TMR3. DISI holds off ISRs of
+// priority 1-6 for the pair; clearing DISICNT ends it. So callers are main()
+// and ISRs below priority 7, and not code inside a DISI of its own (such as
+// PROFILE_RECORD), which this would end early.
+uint32_t timebase_now(void) {
+    __builtin_disi(0x3FFF);
+    const uint16_t lsw = TMR2;
+    const uint16_t msw = TMR3HLD;
+    DISICNT = 0;
+    return (((uint32_t) msw) << 16) | lsw;
+}
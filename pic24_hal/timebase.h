@@ -28,19 +28,17 @@
 
 // This is a guard condition so that contents of this file are not included
 // more than once.  
-#ifndef __INCLUDE_GUARD__DELAY_H__
-#define	__INCLUDE_GUARD__DELAY_H__
+#ifndef __INCLUDE_GUARD__TIMEBASE_H__
+#define	__INCLUDE_GUARD__TIMEBASE_H__
 
 #include <xc.h>
+#include <stdint.h>
 
-// import to make delay32 available
-#define FCY (4000000UL) // half of 8 MHz
-#include <libpic30.h>
+// Timer2/3 as one free-running 32-bit counter at Fcy, for event timestamps.
+// At 4 MHz it ticks every 250 ns and wraps after ~17.9 minutes.
+#define TIMEBASE_TICKS_PER_US (4)
 
-#define delay32_ms(delay_time_ms) (__delay_ms((delay_time_ms)))
-#define delay32_us(delay_time_us) (__delay_us((delay_time_us)))
-#define delay32_cycles(delay_time_cycles) (__delay32((delay_time_cycles)))
-
-
-#endif	/* __INCLUDE_GUARD__DELAY_H__ */
+void timebase_start(void);
+uint32_t timebase_now(void);
 
+#endif	/* __INCLUDE_GUARD__TIMEBASE_H__ */
@@ -7,16 +7,15 @@
 
 
 #include "xc.h"
-#include "math.h"
 #include "string.h"
 
 #include "uart.h"
 
 
-
-
 unsigned int clkval;
 
+volatile uint8_t uart_rx_enabled = 0; // set by uart_rx_start()
+
 ///// Initialization of UART 2 module.
 
 void InitUART2(void) 
@@ -81,7 +80,7 @@ void InitUART2(void)
 	IEC1bits.U2TXIE = 1;	// Enable Transmit Interrupts
 	IFS1bits.U2RXIF = 0;	// Clear the Recieve Interrupt Flag
 	IPC7bits.U2RXIP = 4; //UART2 Rx interrupt has 2nd highest priority
-    IEC1bits.U2RXIE = 0;	// Disable Recieve Interrupts
+    IEC1bits.U2RXIE = uart_rx_enabled;	// Recieve Interrupts only once uart_rx_start() was called
 
 	U2MODEbits.UARTEN = 1;	// And turn the peripheral on
 
@@ -98,7 +97,9 @@ void InitUART2(void)
 void XmitUART2(char CharNum, unsigned int repeatNo)
 {	
 	
-	InitUART2();	//Initialize UART2 module and turn it on
+	if (!uart_rx_enabled) {
+		InitUART2();	//Initialize UART2 module and turn it on
+	}
 	while(repeatNo!=0) 
 	{
 		while(U2STAbits.UTXBF==1)	//Just loop here till the FIFO buffers have room for one more entry
@@ -112,7 +113,9 @@ void XmitUART2(char CharNum, unsigned int repeatNo)
 	{
 		//Idle();
 	}
-	U2MODEbits.UARTEN = 0;	
+	if (!uart_rx_enabled) {
+		U2MODEbits.UARTEN = 0;	// (but not while receiving: that would flush the RX FIFO)
+	}
 //	LATBbits.LATB9=1;
 	return;
 }
@@ -121,91 +124,17 @@ void XmitUART2(char CharNum, unsigned int repeatNo)
 void __attribute__ ((interrupt, no_auto_psv)) _U2RXInterrupt(void) {
 //	LATA = U2RXREG;
 	IFS1bits.U2RXIF = 0;
+	if (uart_queue_rx_isr) {
+		uart_queue_rx_isr();
+	}
 }
 void __attribute__ ((interrupt, no_auto_psv)) _U2TXInterrupt(void) {
 	IFS1bits.U2TXIF = 0;
-
-}
-
-
-
-
-// Displays 16 bit number in Hex form using UART2
-void Disp2Hex(unsigned int DispData)   
-{
-    char i;
-    char nib = 0x00;
-    XmitUART2(' ',1);  // Disp Gap
-    XmitUART2('0',1);  // Disp Hex notation 0x
-    XmitUART2('x',1);
-    
-    for (i=3; i>=0; i--)
-    {
-        nib = ((DispData >> (4*i)) & 0x000F);
-        if (nib >= 0x0A)
-        {
-            nib = nib +0x37;  //For Hex values A-F
-        }
-        else 
-        {
-            nib = nib+0x30;  //For hex values 0-9
-        }
-        XmitUART2(nib,1);
-    }
-    
-    XmitUART2(' ',1);
-    DispData = 0x0000;  // Clear DispData
-    return;
-}
-
-
-void Disp2Hex32(unsigned long int DispData32)   // Displays 32 bit number in Hex form using UART2
-{
-    char i;
-    char nib = 0x00;
-    XmitUART2(' ',1);  // Disp Gap
-    XmitUART2('0',1);  // Disp Hex notation 0x
-    XmitUART2('x',1);
-    
-    for (i=7; i>=0; i--)
-    {
-        nib = ((DispData32 >> (4*i)) & 0x000F);
-        if (nib >= 0x0A)
-        {
-            nib = nib +0x37;  //For Hex values A-F
-        }
-        else 
-        {
-            nib = nib+0x30;  //For hex values 0-9
-        }
-        XmitUART2(nib,1);
-    }
-    
-    XmitUART2(' ',1);
-    DispData32 = 0x00000000;  // Clear DispData
-    return;
+	if (uart_queue_tx_isr) {
+		uart_queue_tx_isr();
+	}
 }
 
-// Displays 16 bit unsigned in in decimal form
-void Disp2Dec(uint16_t Dec_num)
-{
-    uint8_t rem;  //remainder in div by 10
-    uint16_t quot; 
-    uint8_t ctr = 0;  //counter
-    XmitUART2(' ',1);  // Disp Gap
-    while(ctr<5)
-    {
-        quot = Dec_num/(pow(10,(4-ctr)));
-        rem = quot%10;
-        XmitUART2(rem + 0x30 , 1);
-        ctr = ctr + 1;
-    }
-    XmitUART2(' ',1);  // Disp Gap
-    // XmitUART2('\n',1);  // new line
-    // XmitUART2('\r',1);  // carriage return
-   
-    return;
-}
 
 
 void Disp2String(char *str) //Displays String of characters
@@ -8,6 +8,8 @@
 #ifndef __INCLUDE_GUARD_UART2_H__
 #define	__INCLUDE_GUARD_UART2_H__
 
+#include <stdint.h>
+
 #ifdef	__cplusplus
 extern "C" {
 #endif
@@ -25,10 +27,17 @@ void XmitUART2(char, unsigned int);
 void __attribute__ ((interrupt, no_auto_psv)) _U2RXInterrupt(void);
 void __attribute__ ((interrupt, no_auto_psv)) _U2TXInterrupt(void); 
 
+// uart_queue.c's, for the projects that use it: uart_rx_enabled keeps the UART
+// on between transmissions, and the interrupts call the two ISR functions.
+// They are weak, so without uart_queue.c they are NULL and the calls skipped.
+extern volatile uint8_t uart_rx_enabled;
+void uart_queue_rx_isr(void) __attribute__((weak));
+void uart_queue_tx_isr(void) __attribute__((weak));
+
 void Disp2Hex(unsigned int);
 void Disp2Hex32(unsigned long int);
 void Disp2String(char*);
-void Disp2Dec(unsigned int);
+void Disp2Dec(uint16_t);
 
 #endif	/* __INCLUDE_GUARD_UART2_H__ */
 
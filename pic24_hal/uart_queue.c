@@ -0,0 +1,150 @@
+/*
+ * File:   uart_queue.c
+ */
+
+
+#include "xc.h"
+#include "string.h"
+
+#include "uart_queue.h"
+
+// Non-blocking transmit queue, drained by _U2TXInterrupt(), and receive ring,
+// filled by _U2RXInterrupt() (uart.c calls the two below). For each,
+// main() writes one index and the ISR the other, so neither side needs to lock.
+volatile char uart_tx_buf[UART_TX_BUF_LEN];
+volatile uint8_t uart_rx_buf[UART_RX_BUF_LEN];
+volatile uint8_t uart_tx_head = 0; // next to write
+volatile uint8_t uart_tx_tail = 0; // next to send
+volatile uint8_t uart_rx_head = 0; // next to fill
+volatile uint8_t uart_rx_tail = 0; // next to read (uart_rx_getc())
+volatile uint8_t uart_rx_lost = 0; // bytes were lost; put UART_RX_LOST in the ring before the next one
+
+// receive errors since uart_rx_start(); 16-bit, so main() reads them in one go
+volatile uint16_t uart_rx_overrun_count = 0; // OERR: the 4-deep hardware FIFO filled up
+volatile uint16_t uart_rx_framing_error_count = 0; // FERR: no stop bit (noise, wrong baud, a break)
+volatile uint16_t uart_rx_dropped_count = 0; // the ring was full; main() isn't keeping up
+
+///// _U2RXInterrupt()'s work; its interrupt is on once uart_rx_start() was called.
+void uart_queue_rx_isr(void) {
+	// empty the hardware FIFO into the ring
+	uint8_t head = uart_rx_head;
+	while (U2STAbits.URXDA) {
+		const uint8_t framing_error = U2STAbits.FERR; // for the char at the top of the FIFO
+		const uint8_t c = U2RXREG;
+		if (framing_error) {
+			uart_rx_framing_error_count++;
+			uart_rx_lost = 1;
+			continue;
+		}
+		// mark where bytes went missing, then the byte itself
+		uint8_t next = (head + 1) % UART_RX_BUF_LEN;
+		if (uart_rx_lost && (next != uart_rx_tail)) {
+			uart_rx_buf[head] = UART_RX_LOST;
+			head = next;
+			next = (head + 1) % UART_RX_BUF_LEN;
+			uart_rx_lost = 0;
+		}
+		if (uart_rx_lost || (next == uart_rx_tail)) {
+			uart_rx_dropped_count++;
+			uart_rx_lost = 1;
+			continue;
+		}
+		uart_rx_buf[head] = c;
+		head = next;
+	}
+	uart_rx_head = head;
+	
+	// an overrun stops the receiver until OERR is cleared; the FIFO has been read by now
+	if (U2STAbits.OERR) {
+		uart_rx_overrun_count++;
+		uart_rx_lost = 1;
+		U2STAbits.OERR = 0;
+	}
+}
+
+///// _U2TXInterrupt()'s work: send what is queued.
+void uart_queue_tx_isr(void) {
+	// top up the hardware FIFO from the queue
+	while ((uart_tx_tail != uart_tx_head) && (U2STAbits.UTXBF == 0)) {
+		U2TXREG = uart_tx_buf[uart_tx_tail];
+		uart_tx_tail = (uart_tx_tail + 1) % UART_TX_BUF_LEN;
+	}
+}
+
+///// Start receiving: turns the UART on, and keeps it on, with the RX interrupt
+///// filling the ring for uart_rx_getc().
+void uart_rx_start(void) {
+	uart_rx_head = 0;
+	uart_rx_tail = 0;
+	uart_rx_overrun_count = 0;
+	uart_rx_framing_error_count = 0;
+	uart_rx_dropped_count = 0;
+	uart_rx_lost = 0;
+	uart_rx_enabled = 1;
+	InitUART2();
+}
+
+///// Next received byte into *c; returns 0 if there is none. UART_RX_LOST
+///// means bytes were lost at this point (overrun, framing error, ring full).
+uint8_t uart_rx_getc(uint8_t* c) {
+	const uint8_t tail = uart_rx_tail;
+	if (tail == uart_rx_head) {
+		return 0;
+	}
+	*c = uart_rx_buf[tail];
+	uart_rx_tail = (tail + 1) % UART_RX_BUF_LEN;
+	return 1;
+}
+
+///// Bytes waiting in the ring.
+uint8_t uart_rx_count(void) {
+	return (uart_rx_head - uart_rx_tail + UART_RX_BUF_LEN) % UART_RX_BUF_LEN;
+}
+
+///// The waiting byte `offset` places after the next one, left in the ring;
+///// offset must be < uart_rx_count().
+uint8_t uart_rx_peek(uint8_t offset) {
+	return uart_rx_buf[(uart_rx_tail + offset) % UART_RX_BUF_LEN];
+}
+
+///// Wait until the queue is empty and the last char has gone out, e.g.
+///// before going back to Disp2String().
+void uart_tx_flush(void) {
+	while ((uart_tx_tail != uart_tx_head) || (U2STAbits.TRMT == 0));
+}
+
+uint8_t uart_tx_free(void) {
+	return (UART_TX_BUF_LEN - 1) - ((uart_tx_head - uart_tx_tail + UART_TX_BUF_LEN) % UART_TX_BUF_LEN);
+}
+
+///// Queue a whole string for the TX interrupt to send, and return right away.
+///// Returns 0 (and queues nothing) if it does not fit; the caller decides
+///// whether to drop it or try again later.
+///// Don't mix with Disp2String() while the queue is busy: XmitUART2() turns the
+///// UART off when it's done.
+uint8_t uart_tx_enqueue(const char* str) {
+	return uart_tx_enqueue_bytes((const uint8_t*) str, strlen(str));
+}
+
+///// Same, for binary data that may contain 0x00 (telemetry frames).
+uint8_t uart_tx_enqueue_bytes(const uint8_t* data, uint8_t len) {
+	if (len > uart_tx_free()) {
+		return 0;
+	}
+	
+	if (U2MODEbits.UARTEN == 0) {
+		InitUART2();
+	}
+	U2STAbits.UTXISEL1 = 0; // interrupt whenever a char moves to the shift
+	U2STAbits.UTXISEL0 = 0; // register, i.e. the FIFO has room again
+	
+	uint8_t head = uart_tx_head;
+	for (uint8_t i = 0; i < len; i++) {
+		uart_tx_buf[head] = data[i];
+		head = (head + 1) % UART_TX_BUF_LEN;
+	}
+	uart_tx_head = head; // publish to the ISR in one write
+	
+	IFS1bits.U2TXIF = 1; // kick the ISR in case the transmitter is idle
+	return 1;
+}
@@ -0,0 +1,60 @@
+/* Microchip Technology Inc. and its subsidiaries.  You may use this software 
+ * and any derivatives exclusively with Microchip products. 
+ * 
+ * THIS SOFTWARE IS SUPPLIED BY MICROCHIP "AS IS".  NO WARRANTIES, WHETHER 
+ * EXPRESS, IMPLIED OR STATUTORY, APPLY TO THIS SOFTWARE, INCLUDING ANY IMPLIED 
+ * WARRANTIES OF NON-INFRINGEMENT, MERCHANTABILITY, AND FITNESS FOR A 
+ * PARTICULAR PURPOSE, OR ITS INTERACTION WITH MICROCHIP PRODUCTS, COMBINATION 
+ * WITH ANY OTHER PRODUCTS, OR USE IN ANY APPLICATION. 
+ *
+ * IN NO EVENT WILL MICROCHIP BE LIABLE FOR ANY INDIRECT, SPECIAL, PUNITIVE, 
+ * INCIDENTAL OR CONSEQUENTIAL LOSS, DAMAGE, COST OR EXPENSE OF ANY KIND 
+ * WHATSOEVER RELATED TO THE SOFTWARE, HOWEVER CAUSED, EVEN IF MICROCHIP HAS 
+ * BEEN ADVISED OF THE POSSIBILITY OR THE DAMAGES ARE FORESEEABLE.  TO THE 
+ * FULLEST EXTENT ALLOWED BY LAW, MICROCHIP'S TOTAL LIABILITY ON ALL CLAIMS 
+ * IN ANY WAY RELATED TO THIS SOFTWARE WILL NOT EXCEED THE AMOUNT OF FEES, IF 
+ * ANY, THAT YOU HAVE PAID DIRECTLY TO MICROCHIP FOR THIS SOFTWARE.
+ *
+ * MICROCHIP PROVIDES THIS SOFTWARE CONDITIONALLY UPON YOUR ACCEPTANCE OF THESE 
+ * TERMS. 
+ */
+
+/* 
+ * File:   
+ * Author: 
+ * Comments:
+ * Revision history: 
+ */
+
+// This is a guard condition so that contents of this file are not included
+// more than once.  
+#ifndef __INCLUDE_GUARD__UART_QUEUE_H__
+#define	__INCLUDE_GUARD__UART_QUEUE_H__
+
+#include <xc.h> // include processor files - each processor file is guarded.  
+#include <stdint.h>
+#include "uart.h"
+
+// Optional on top of uart.c: a transmit queue drained by the TX interrupt, so
+// main() doesn't wait on the UART, and a receive ring filled by the RX
+// interrupt. A project using it adds uart_queue.c next to uart.c
+// (App2_Capacitance_Sensor does); the rest keep the blocking Disp2String().
+#define UART_TX_BUF_LEN (128) // must be <= 256, indices are uint8_t
+#define UART_RX_BUF_LEN (64) // same; ~65 ms of back-to-back bytes at 9600 baud
+#define UART_RX_LOST (0x00) // read from the ring where received bytes were lost
+
+extern volatile uint16_t uart_rx_overrun_count;
+extern volatile uint16_t uart_rx_framing_error_count;
+extern volatile uint16_t uart_rx_dropped_count;
+
+uint8_t uart_tx_enqueue(const char* str);
+uint8_t uart_tx_enqueue_bytes(const uint8_t* data, uint8_t len);
+uint8_t uart_tx_free(void);
+void uart_tx_flush(void);
+
+void uart_rx_start(void);
+uint8_t uart_rx_getc(uint8_t* c);
+uint8_t uart_rx_count(void);
+uint8_t uart_rx_peek(uint8_t offset);
+
+#endif	/* __INCLUDE_GUARD__UART_QUEUE_H__ */